@@ -0,0 +1,31 @@
+#include "ControlEvents.h"
+#include <esp_timer.h>
+
+ControlEvents theControlEvents;
+
+void ControlEvents::post(controleventtype_t type) {
+  controlevent_t event = { type, esp_timer_get_time() };
+
+  if (!ring.push(event)) {
+    counters.lost++;
+    return;
+  }
+  counters.posted++;
+  if (counters.posted - handled > counters.maxDepth) {
+    counters.maxDepth = counters.posted - handled;
+  }
+}
+
+bool ControlEvents::next(controlevent_t *event) {
+  uint32_t latency;
+
+  if (!ring.pop(event)) {
+    return false;
+  }
+  handled++;
+  latency = esp_timer_get_time() - event->time;
+  if (latency > counters.worstLatency) {
+    counters.worstLatency = latency;
+  }
+  return true;
+}
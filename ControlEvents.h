@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TaskChannels.h"
+
+// Events of the callbacks for the control loop, in place of a flag per event:
+// the buttons, the commands of the master and the timers post what happened,
+// with the time it happened, and handleControlEvents() in main.cpp, called from
+// buttons_optocoupler_loop(), logs it and shows it on the display. Events are
+// handled in the order they were posted, an event that happens twice before
+// loop() gets to it is handled twice, and an empty queue is one load.
+//
+// The callbacks all run in loop(): the buttons from theInputCapture.loop(),
+// the timers from theTimerWheel.run() and the commands from the events of the
+// network task (see NetworkTask.h), so the ring has one producer.
+#define CONTROL_EVENTS (16)
+
+typedef enum {
+  CONTROL_BUTTON_ON, // the On button switched the compressor on
+  CONTROL_BUTTON_ON_DENIED, // at late hours, the On button must be held for the override
+  CONTROL_BUTTON_OFF, // the Off button switched the compressor off
+  CONTROL_TIMEOUT_EXTENDED, // the On button while the compressor is on
+  CONTROL_PRESSURE_NOT_LOW, // the On button while the pressure is not low
+  CONTROL_PRESSURE_OK, // the Off button cleared the pressure error
+  CONTROL_AUTO_STOP, // stop command
+  CONTROL_AUTO_POWER_ON, // poweron command
+  CONTROL_AUTO_POWER_ON_DENIED, // poweron command at late hours or with a fault
+  NR_OF_CONTROL_EVENTS
+} controleventtype_t;
+
+typedef struct {
+  controleventtype_t type;
+  int64_t time; // in us, esp_timer_get_time() at post()
+} controlevent_t;
+
+typedef struct {
+  uint32_t posted;
+  uint32_t lost; // the ring was full
+  uint32_t maxDepth; // the most events waiting at once, since boot
+  uint32_t worstLatency; // in us, from post() to the event handled, since boot
+} controlcounters_t;
+
+class ControlEvents {
+private:
+  SpscRing<controlevent_t, CONTROL_EVENTS> ring;
+  uint32_t handled = 0;
+
+public:
+  controlcounters_t counters = { 0, 0, 0, 0 };
+
+  void post(controleventtype_t type);
+
+  // the next event, false if there is none
+  bool next(controlevent_t *event);
+};
+
+extern ControlEvents theControlEvents;
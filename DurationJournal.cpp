@@ -0,0 +1,166 @@
+#include "DurationJournal.h"
+#include <ACNode.h>
+#include <SPIFFS.h>
+
+static uint32_t crc32(const uint8_t *data, size_t length) {
+  static const uint32_t nibbleTable[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+  };
+  uint32_t crc = 0xffffffff;
+
+  while (length--) {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ nibbleTable[crc & 0x0f];
+    crc = (crc >> 4) ^ nibbleTable[crc & 0x0f];
+  }
+  return ~crc;
+}
+
+static uint32_t recordCrc(const durationrecord_t *record) {
+  return crc32((const uint8_t *)record, sizeof(durationrecord_t) - sizeof(record->crc));
+}
+
+DurationJournal::DurationJournal() {
+  return;
+}
+
+// only the last DURATION_JOURNAL_MAX_RECORDS records are read, so the time
+// needed at boot is bounded even if compaction failed for a long time. A
+// damaged journal (torn or corrupt record) reports itself as full, so that the
+// next commit compacts it instead of appending behind a partial record.
+bool DurationJournal::scan(const char *path, durationrecord_t *newest, uint16_t *validRecords) {
+  File journalFile;
+  durationrecord_t record;
+  size_t records;
+  bool found = false;
+  bool damaged;
+
+  *validRecords = 0;
+  if (!SPIFFS.exists(path)) {
+    return false;
+  }
+  journalFile = SPIFFS.open(path, "rb");
+  if (!journalFile) {
+    return false;
+  }
+  records = journalFile.size() / sizeof(durationrecord_t);
+  damaged = (journalFile.size() % sizeof(durationrecord_t)) != 0;
+  if (records > DURATION_JOURNAL_MAX_RECORDS) {
+    journalFile.seek((records - DURATION_JOURNAL_MAX_RECORDS) * sizeof(durationrecord_t));
+    records = DURATION_JOURNAL_MAX_RECORDS;
+  }
+  journalFile.setTimeout(0);
+  while (records--) {
+    if (journalFile.readBytes((char*)&record, sizeof(record)) != sizeof(record)) {
+      break;
+    }
+    if (record.crc != recordCrc(&record)) {
+      damaged = true;
+      continue;
+    }
+    (*validRecords)++;
+    if (!found || ((int32_t)(record.sequence - newest->sequence) > 0)) {
+      *newest = record;
+      found = true;
+    }
+  }
+  journalFile.close();
+  if (damaged) {
+    *validRecords = DURATION_JOURNAL_MAX_RECORDS;
+  }
+  return found;
+}
+
+bool DurationJournal::load(unsigned long *poweredTotal, unsigned long *runningTotal) {
+  durationrecord_t newest;
+  durationrecord_t compacted;
+  uint16_t validRecords;
+  bool found;
+
+  found = scan(DURATION_JOURNAL_FILE, &newest, &validRecords);
+  nrOfRecords = validRecords;
+  // a compaction may have been interrupted, the compacted file is complete
+  // if its record is valid and then it is at least as new as the journal
+  if (scan(DURATION_JOURNAL_COMPACT_FILE, &compacted, &validRecords)) {
+    if (!found || ((int32_t)(compacted.sequence - newest.sequence) >= 0)) {
+      newest = compacted;
+      found = true;
+      SPIFFS.remove(DURATION_JOURNAL_FILE);
+      SPIFFS.rename(DURATION_JOURNAL_COMPACT_FILE, DURATION_JOURNAL_FILE);
+      nrOfRecords = 1;
+    } else {
+      SPIFFS.remove(DURATION_JOURNAL_COMPACT_FILE);
+    }
+  }
+  if (!found) {
+    return false;
+  }
+  sequence = newest.sequence;
+  *poweredTotal = newest.poweredTotal;
+  *runningTotal = newest.runningTotal;
+  return true;
+}
+
+bool DurationJournal::append(const char *path, const char *mode, durationrecord_t *record) {
+  File journalFile;
+
+  journalFile = SPIFFS.open(path, mode);
+  if (!journalFile) {
+    Log.print("There was an error opening the ");
+    Log.print(path);
+    Log.println(" file for writing");
+    return false;
+  }
+  if (journalFile.write((byte*)record, sizeof(durationrecord_t)) != sizeof(durationrecord_t)) {
+    Log.print("ERROR --> duration counters NOT stored in ");
+    Log.println(path);
+    journalFile.close();
+    return false;
+  }
+  journalFile.close();
+  return true;
+}
+
+// write the newest record to a new file, then replace the journal by it
+bool DurationJournal::compact(durationrecord_t *record) {
+  if (!append(DURATION_JOURNAL_COMPACT_FILE, "wb", record)) {
+    return false;
+  }
+  SPIFFS.remove(DURATION_JOURNAL_FILE);
+  if (!SPIFFS.rename(DURATION_JOURNAL_COMPACT_FILE, DURATION_JOURNAL_FILE)) {
+    Log.println("ERROR --> duration journal compaction failed");
+    return false;
+  }
+  nrOfRecords = 1;
+  return true;
+}
+
+bool DurationJournal::commit(unsigned long poweredTotal, unsigned long runningTotal) {
+  durationrecord_t record;
+
+  record.sequence = sequence + 1;
+  record.poweredTotal = poweredTotal;
+  record.runningTotal = runningTotal;
+  record.crc = recordCrc(&record);
+
+  if (nrOfRecords >= DURATION_JOURNAL_MAX_RECORDS) {
+    if (!compact(&record)) {
+      return false;
+    }
+  } else {
+    if (!append(DURATION_JOURNAL_FILE, "ab", &record)) {
+      return false;
+    }
+    nrOfRecords++;
+  }
+  sequence = record.sequence;
+  return true;
+}
+
+void DurationJournal::clear() {
+  SPIFFS.remove(DURATION_JOURNAL_FILE);
+  SPIFFS.remove(DURATION_JOURNAL_COMPACT_FILE);
+  sequence = 0;
+  nrOfRecords = 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Append only journal of the powered/running duration counters in SPIFFS.
+// Every commit appends one CRC protected, sequence numbered record, a record
+// torn by a power cut fails its CRC and is skipped at boot. When the journal
+// is full it is compacted into a new file holding only the newest record.
+#define DURATION_JOURNAL_FILE "/init/durationjournal"
+#define DURATION_JOURNAL_COMPACT_FILE "/init/durationjournal.new"
+#define DURATION_JOURNAL_MAX_RECORDS (256) // 4 KB, one SPIFFS block
+
+typedef struct {
+  uint32_t sequence;
+  uint32_t poweredTotal; // in s
+  uint32_t runningTotal; // in s
+  uint32_t crc; // CRC32 of the fields above
+} durationrecord_t;
+
+class DurationJournal {
+private:
+  uint32_t sequence = 0; // of the newest valid record
+  uint16_t nrOfRecords = 0; // in the journal file
+
+  bool scan(const char *path, durationrecord_t *newest, uint16_t *validRecords);
+  bool append(const char *path, const char *mode, durationrecord_t *record);
+  bool compact(durationrecord_t *record);
+
+public:
+  DurationJournal();
+
+  // recover the newest valid record, false if there is none
+  bool load(unsigned long *poweredTotal, unsigned long *runningTotal);
+
+  bool commit(unsigned long poweredTotal, unsigned long runningTotal);
+
+  void clear();
+};
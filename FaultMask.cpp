@@ -0,0 +1,62 @@
+#include "FaultMask.h"
+#include "TimerWheel.h"
+
+const char *faultLabel[FAULT_TEMPERATURE] =
+{
+  "oil_level",
+  "pressure_too_high",
+  "pressure_error",
+  "pressure_not_low",
+};
+
+// the temperature faults are labelled by the number of their sensor
+const char *temperatureFaultLabel[MAX_NR_OF_TEMP_SENSORS] =
+{
+  "temperature_1",
+  "temperature_2",
+  "temperature_3",
+  "temperature_4",
+  "temperature_5",
+  "temperature_6",
+  "temperature_7",
+  "temperature_8",
+};
+
+FaultMask theFaults;
+
+void FaultMask::set(fault_t fault, bool active) {
+  uint32_t bit = FAULT_BIT(fault);
+
+  if (((word.load() & bit) != 0) == active) {
+    return;
+  }
+  if (active) {
+    word.fetch_or(bit);
+    statistics[fault].sets.fetch_add(1, std::memory_order_release);
+    statistics[fault].lastSet.store(uptimeMs() / 1000, std::memory_order_release);
+  } else {
+    word.fetch_and(~bit);
+    statistics[fault].lastClear.store(uptimeMs() / 1000, std::memory_order_release);
+  }
+}
+
+const char *FaultMask::label(fault_t fault) {
+  return (fault < FAULT_TEMPERATURE) ? faultLabel[fault] : temperatureFaultLabel[fault - FAULT_TEMPERATURE];
+}
+
+void FaultMask::describe(uint32_t mask, char *outputStr, size_t size) {
+  uint32_t active = word.load() & mask;
+  uint32_t now = uptimeMs() / 1000;
+  size_t length = 0;
+
+  outputStr[0] = 0;
+  for (uint8_t i = 0; (i < NR_OF_FAULTS) && (length < size); i++) {
+    if (active & FAULT_BIT(i)) {
+      // the esp_timer task may have set it after now was taken
+      uint32_t lastSet = statistics[i].lastSet.load(std::memory_order_acquire);
+
+      length += snprintf(outputStr + length, size - length, "%s%s %lu", (length > 0) ? ", " : "", label((fault_t)i),
+                         (unsigned long)((lastSet < now) ? now - lastSet : 0));
+    }
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "TempSensor.h"
+
+// The faults that keep the compressor off, as one word with a bit per fault.
+// The sensors set and clear their bit when their state changes, the decisions
+// of the control loop and the safety interlock are a test against one of the
+// masks below, and the faults that disable the compressor are one lookup for
+// the report. Per fault the changes are counted and the time of the last set
+// and clear is kept.
+//
+// The word is atomic: the pressure bits are written by the esp_timer task of
+// the safety interlock (see PressureSensor::update()), the others by loop().
+// Each bit has one writer. The statistics are 32 bit atomics, written after
+// the bit, so loop() never reads half a time written by the esp_timer task.
+typedef enum {
+  FAULT_OIL_LEVEL, // the oil level is too low for MAX_OIL_LEVEL_IS_TOO_LOW_WINDOW
+  FAULT_PRESSURE_TOO_HIGH, // the pressure is above PRESSURE_MAX_LIMIT
+  FAULT_PRESSURE_ERROR, // switched off for the pressure, until it is low again or the Off button is pressed
+  FAULT_PRESSURE_NOT_LOW, // the pressure is not below PRESSURE_BELOW_LIMIT
+  FAULT_TEMPERATURE, // sensor n (from 1) is too hot for MAX_TEMP_IS_TOO_HIGH_WINDOW: bit FAULT_TEMPERATURE + n - 1
+  NR_OF_FAULTS = FAULT_TEMPERATURE + MAX_NR_OF_TEMP_SENSORS
+} fault_t;
+
+#define FAULT_BIT(fault) (1UL << (fault))
+#define FAULTS_TEMPERATURE (((1UL << MAX_NR_OF_TEMP_SENSORS) - 1) << FAULT_TEMPERATURE)
+
+// the errors of the oil level and temperature sensors
+#define FAULTS_SENSORS (FAULT_BIT(FAULT_OIL_LEVEL) | FAULTS_TEMPERATURE)
+// the compressor is switched off, by compressorLoop() and the safety interlock
+#define FAULTS_SWITCH_OFF (FAULTS_SENSORS | FAULT_BIT(FAULT_PRESSURE_TOO_HIGH))
+// the compressor cannot be switched on, see compressorIsDisabeled()
+#define FAULTS_DISABLE (FAULTS_SWITCH_OFF | FAULT_BIT(FAULT_PRESSURE_ERROR))
+
+typedef struct {
+  std::atomic<uint32_t> sets { 0 }; // the fault became active
+  std::atomic<uint32_t> lastSet { 0 }; // in s, uptimeMs() / 1000, 0 if never
+  std::atomic<uint32_t> lastClear { 0 }; // in s, uptimeMs() / 1000, 0 if never
+} faultstatistics_t;
+
+class FaultMask {
+private:
+  std::atomic<uint32_t> word { 0 };
+  faultstatistics_t statistics[NR_OF_FAULTS];
+
+public:
+  // only a change is counted and timed
+  void set(fault_t fault, bool active);
+
+  uint32_t faults() { return word.load(); }
+
+  bool isSet(fault_t fault) { return (word.load() & FAULT_BIT(fault)) != 0; }
+
+  bool any(uint32_t mask) { return (word.load() & mask) != 0; }
+
+  const faultstatistics_t &statisticsOf(fault_t fault) { return statistics[fault]; }
+
+  const char *label(fault_t fault);
+
+  // "<label> <s>" of each fault of mask that is set, with the time since it was set, separated by ", "
+  void describe(uint32_t mask, char *outputStr, size_t size);
+};
+
+extern FaultMask theFaults;
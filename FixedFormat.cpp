@@ -0,0 +1,117 @@
+#include "FixedFormat.h"
+
+static const uint32_t powerOf10[FIXED_FORMAT_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+// value = mantissa * 2^-shift, the fraction is scaled and rounded in integer
+// arithmetic, exact and with ties to even, so the digits are those of printf
+static void splitFixed(float value, uint8_t decimals, uint32_t *integerPart, uint32_t *fraction) {
+  uint32_t bits;
+  int16_t shift;
+  uint32_t mantissa;
+  uint64_t scaled;
+  uint64_t remainder;
+  uint64_t half;
+
+  memcpy(&bits, &value, sizeof(bits));
+  mantissa = bits & 0x7fffff;
+  shift = 150 - ((bits >> 23) & 0xff);
+  if (((bits >> 23) & 0xff) == 0) {
+    shift--; // denormal
+  } else {
+    mantissa |= 0x800000;
+  }
+  if (shift <= 0) {
+    *integerPart = mantissa << -shift;
+    *fraction = 0;
+    return;
+  }
+  if (shift > 60) {
+    // below 2^-36, rounds to 0 with up to FIXED_FORMAT_MAX_DECIMALS decimals
+    *integerPart = 0;
+    *fraction = 0;
+    return;
+  }
+  *integerPart = (shift < 32) ? (mantissa >> shift) : 0;
+  scaled = (uint64_t)(mantissa & ((shift < 32) ? ((1UL << shift) - 1) : 0xffffffff)) * powerOf10[decimals];
+  *fraction = scaled >> shift;
+  remainder = scaled - ((uint64_t)*fraction << shift);
+  half = 1ULL << (shift - 1);
+  // without decimals the last digit is the one of the integer part
+  if ((remainder > half) || ((remainder == half) && ((decimals > 0 ? *fraction : *integerPart) & 1))) {
+    (*fraction)++;
+  }
+  if (*fraction >= powerOf10[decimals]) {
+    *fraction -= powerOf10[decimals];
+    (*integerPart)++;
+  }
+}
+
+char *formatFixed(char *buffer, float value, uint8_t width, uint8_t decimals) {
+  char digits[24];
+  uint8_t length = 0;
+  bool negative = false;
+  uint32_t integerPart;
+  uint32_t fraction;
+
+  if (decimals > FIXED_FORMAT_MAX_DECIMALS) {
+    decimals = FIXED_FORMAT_MAX_DECIMALS;
+  }
+  if (isnan(value)) {
+    digits[length++] = 'n';
+    digits[length++] = 'a';
+    digits[length++] = 'n';
+  } else {
+    if (value < 0) {
+      negative = true;
+      value = -value;
+    }
+    if (value > 4294967040.0f) {
+      value = 4294967040.0f; // largest float below 2^32
+    }
+    splitFixed(value, decimals, &integerPart, &fraction);
+    // digits are generated backwards
+    for (uint8_t i = 0; i < decimals; i++) {
+      digits[length++] = '0' + fraction % 10;
+      fraction /= 10;
+    }
+    if (decimals > 0) {
+      digits[length++] = '.';
+    }
+    do {
+      digits[length++] = '0' + integerPart % 10;
+      integerPart /= 10;
+    } while (integerPart > 0);
+    if (negative) {
+      digits[length++] = '-';
+    }
+  }
+  while (width > length) {
+    *buffer++ = ' ';
+    width--;
+  }
+  while (length > 0) {
+    *buffer++ = digits[--length];
+  }
+  *buffer = 0;
+  return buffer;
+}
+
+char *formatFixed(char *buffer, const char *prefix, float value, uint8_t width, uint8_t decimals, const char *suffix) {
+  buffer = formatString(buffer, prefix);
+  buffer = formatFixed(buffer, value, width, decimals);
+  return formatString(buffer, suffix);
+}
+
+char *formatString(char *buffer, const char *s) {
+  while (*s) {
+    *buffer++ = *s++;
+  }
+  *buffer = 0;
+  return buffer;
+}
+
+char *formatChar(char *buffer, char c) {
+  *buffer++ = c;
+  *buffer = 0;
+  return buffer;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Allocation free replacement of sprintf("%<width>.<decimals>f") for the
+// display and report strings. The value is rendered in fixed point: integer
+// part and rounded fraction as unsigned integers, so no float printf code and
+// no heap is used. Every function writes a terminating 0 and returns a
+// pointer to it, so calls can be chained to build a string.
+#define FIXED_FORMAT_MAX_DECIMALS (6)
+
+// right aligned in at least width characters, as printf does
+char *formatFixed(char *buffer, float value, uint8_t width, uint8_t decimals);
+
+// prefix, value and suffix, e.g. formatFixed(str, "Temp1:", t, 7, 2, " C")
+char *formatFixed(char *buffer, const char *prefix, float value, uint8_t width, uint8_t decimals, const char *suffix);
+
+char *formatString(char *buffer, const char *s);
+
+char *formatChar(char *buffer, char c);
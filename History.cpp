@@ -0,0 +1,353 @@
+#include "History.h"
+#include <ACNode.h>
+#include "FixedFormat.h"
+#include "NetworkTask.h"
+
+#define HISTORY_DATA_BITS (sizeof(((historyblock_t *)0)->data) * 8)
+#define HISTORY_MAX_SAMPLE_BITS (4 + 32 + HISTORY_NR_OF_FLOATS * (2 + 5 + 5 + 32) + 6) // worst case encoded sample
+#define HISTORY_NO_WINDOW (0xff) // no previous leading/trailing zero window
+
+// streaming of a window over MQTT
+#define HISTORY_TOPIC "history"
+#define HISTORY_PAGE_SAMPLES (8) // samples per MQTT message, keeps a page well below MQTT_MAX_PACKET_SIZE
+#define HISTORY_PAGE_INTERVAL (100) // in ms, time between pages
+
+extern ACNode node;
+
+History theHistory;
+
+History::History() {
+  return;
+}
+
+bool History::begin() {
+  blocks = (historyblock_t *)malloc(sizeof(historyblock_t) * HISTORY_NR_OF_BLOCKS);
+  if (blocks == NULL) {
+    Log.println("History: not enough memory, history is disabled");
+    return false;
+  }
+  memset(blocks, 0, sizeof(historyblock_t) * HISTORY_NR_OF_BLOCKS);
+  return true;
+}
+
+void History::writeBits(uint32_t value, uint8_t nrOfBits) {
+  historyblock_t *block = &blocks[currentBlock];
+
+  while (nrOfBits > 0) {
+    nrOfBits--;
+    uint16_t pos = block->bitsUsed++;
+    if (value & (1UL << nrOfBits)) {
+      block->data[pos >> 3] |= 0x80 >> (pos & 7);
+    } else {
+      block->data[pos >> 3] &= ~(0x80 >> (pos & 7));
+    }
+  }
+}
+
+uint32_t History::readBits(const historyblock_t *block, historystate_t *state, uint8_t nrOfBits) {
+  uint32_t value = 0;
+
+  while (nrOfBits > 0) {
+    nrOfBits--;
+    uint16_t pos = state->bitPos++;
+    value = (value << 1) | ((block->data[pos >> 3] >> (7 - (pos & 7))) & 1);
+  }
+  return value;
+}
+
+// Gorilla XOR encoding:
+//   '0'                                 same value as before
+//   '10' + meaningful bits              XOR fits the previous leading/trailing zero window
+//   '11' + 5 bits leading zeros + 5 bits length - 1 + meaningful bits
+void History::encodeValue(uint8_t channel, uint32_t value) {
+  uint32_t xorValue = value ^ writer.value[channel];
+  uint8_t leading;
+  uint8_t trailing;
+
+  writer.value[channel] = value;
+  if (xorValue == 0) {
+    writeBits(0, 1);
+    return;
+  }
+  leading = __builtin_clz(xorValue);
+  trailing = __builtin_ctz(xorValue);
+  if ((writer.leading[channel] != HISTORY_NO_WINDOW) && (leading >= writer.leading[channel]) && (trailing >= writer.trailing[channel])) {
+    writeBits(2, 2);
+    writeBits(xorValue >> writer.trailing[channel], 32 - writer.leading[channel] - writer.trailing[channel]);
+    return;
+  }
+  if (leading > 31) {
+    leading = 31;
+  }
+  writeBits(3, 2);
+  writeBits(leading, 5);
+  writeBits(32 - leading - trailing - 1, 5);
+  writeBits(xorValue >> trailing, 32 - leading - trailing);
+  writer.leading[channel] = leading;
+  writer.trailing[channel] = trailing;
+}
+
+uint32_t History::decodeValue(const historyblock_t *block, historystate_t *state, uint8_t channel) {
+  uint8_t length;
+
+  if (readBits(block, state, 1) == 0) {
+    return state->value[channel];
+  }
+  if (readBits(block, state, 1) == 1) {
+    state->leading[channel] = readBits(block, state, 5);
+    length = readBits(block, state, 5) + 1;
+    state->trailing[channel] = 32 - state->leading[channel] - length;
+  } else {
+    length = 32 - state->leading[channel] - state->trailing[channel];
+  }
+  state->value[channel] ^= readBits(block, state, length) << state->trailing[channel];
+  return state->value[channel];
+}
+
+// the first sample of a block is stored as is
+void History::startBlock(const historysample_t *sample) {
+  historyblock_t *block;
+
+  if (nrOfBlocksUsed > 0) {
+    currentBlock = (currentBlock + 1) % HISTORY_NR_OF_BLOCKS;
+  }
+  if (nrOfBlocksUsed < HISTORY_NR_OF_BLOCKS) {
+    nrOfBlocksUsed++;
+  }
+  block = &blocks[currentBlock];
+  block->generation++;
+  block->firstTimestamp = sample->timestamp;
+  block->bitsUsed = 0;
+  block->nrOfSamples = 1;
+
+  writer.timestamp = sample->timestamp;
+  writer.delta = 0;
+  writer.state = sample->machinestate | (sample->opto1 ? 0x10 : 0);
+  writeBits(sample->timestamp, 32);
+  for (uint8_t i = 0; i < HISTORY_NR_OF_FLOATS; i++) {
+    memcpy(&writer.value[i], &sample->value[i], sizeof(uint32_t));
+    writer.leading[i] = HISTORY_NO_WINDOW;
+    writeBits(writer.value[i], 32);
+  }
+  writeBits(writer.state, 5);
+}
+
+void History::add(uint32_t timestamp, float pressure, float temperature1, float temperature2, bool opto1, machinestates_t machinestate) {
+  historysample_t sample;
+  int32_t delta;
+  int32_t deltaOfDelta;
+  uint32_t value;
+  uint8_t state;
+
+  if (blocks == NULL) {
+    return;
+  }
+  sample.timestamp = timestamp;
+  sample.value[0] = pressure;
+  sample.value[1] = temperature1;
+  sample.value[2] = temperature2;
+  sample.opto1 = opto1;
+  sample.machinestate = machinestate;
+
+  if ((nrOfBlocksUsed == 0) || ((size_t)blocks[currentBlock].bitsUsed + HISTORY_MAX_SAMPLE_BITS > HISTORY_DATA_BITS)) {
+    startBlock(&sample);
+    return;
+  }
+
+  // timestamp, delta-of-delta:
+  //   '0' = 0, '10' + 7 bits, '110' + 9 bits, '1110' + 12 bits, '1111' + 32 bits
+  delta = (int32_t)(timestamp - writer.timestamp);
+  deltaOfDelta = delta - writer.delta;
+  writer.timestamp = timestamp;
+  writer.delta = delta;
+  if (deltaOfDelta == 0) {
+    writeBits(0, 1);
+  } else if ((deltaOfDelta >= -63) && (deltaOfDelta <= 64)) {
+    writeBits(2, 2);
+    writeBits(deltaOfDelta + 63, 7);
+  } else if ((deltaOfDelta >= -255) && (deltaOfDelta <= 256)) {
+    writeBits(6, 3);
+    writeBits(deltaOfDelta + 255, 9);
+  } else if ((deltaOfDelta >= -2047) && (deltaOfDelta <= 2048)) {
+    writeBits(14, 4);
+    writeBits(deltaOfDelta + 2047, 12);
+  } else {
+    writeBits(15, 4);
+    writeBits((uint32_t)deltaOfDelta, 32);
+  }
+
+  for (uint8_t i = 0; i < HISTORY_NR_OF_FLOATS; i++) {
+    memcpy(&value, &sample.value[i], sizeof(uint32_t));
+    encodeValue(i, value);
+  }
+
+  // machinestate and opto1: '0' = unchanged, '1' + 5 bits
+  state = machinestate | (opto1 ? 0x10 : 0);
+  if (state == writer.state) {
+    writeBits(0, 1);
+  } else {
+    writeBits(1, 1);
+    writeBits(state, 5);
+    writer.state = state;
+  }
+  blocks[currentBlock].nrOfSamples++;
+}
+
+bool History::decodeNext(historysample_t *sample) {
+  historyblock_t *block;
+  int32_t deltaOfDelta;
+
+  while (true) {
+    block = &blocks[readBlock];
+    if ((block->generation != readGeneration) || (reader.sampleNr >= block->nrOfSamples)) {
+      // block done, or overwritten by the writer while streaming
+      if ((readBlock == currentBlock) && (block->generation == readGeneration)) {
+        return false;
+      }
+      if (blocksLeft == 0) {
+        return false;
+      }
+      blocksLeft--;
+      readBlock = (readBlock + 1) % HISTORY_NR_OF_BLOCKS;
+      readGeneration = blocks[readBlock].generation;
+      reader.bitPos = 0;
+      reader.sampleNr = 0;
+      continue;
+    }
+
+    if (reader.sampleNr == 0) {
+      reader.timestamp = readBits(block, &reader, 32);
+      reader.delta = 0;
+      for (uint8_t i = 0; i < HISTORY_NR_OF_FLOATS; i++) {
+        reader.value[i] = readBits(block, &reader, 32);
+      }
+      reader.state = readBits(block, &reader, 5);
+    } else {
+      if (readBits(block, &reader, 1) == 0) {
+        deltaOfDelta = 0;
+      } else if (readBits(block, &reader, 1) == 0) {
+        deltaOfDelta = (int32_t)readBits(block, &reader, 7) - 63;
+      } else if (readBits(block, &reader, 1) == 0) {
+        deltaOfDelta = (int32_t)readBits(block, &reader, 9) - 255;
+      } else if (readBits(block, &reader, 1) == 0) {
+        deltaOfDelta = (int32_t)readBits(block, &reader, 12) - 2047;
+      } else {
+        deltaOfDelta = (int32_t)readBits(block, &reader, 32);
+      }
+      reader.delta += deltaOfDelta;
+      reader.timestamp += reader.delta;
+      for (uint8_t i = 0; i < HISTORY_NR_OF_FLOATS; i++) {
+        decodeValue(block, &reader, i);
+      }
+      if (readBits(block, &reader, 1) == 1) {
+        reader.state = readBits(block, &reader, 5);
+      }
+    }
+    reader.sampleNr++;
+
+    sample->timestamp = reader.timestamp;
+    for (uint8_t i = 0; i < HISTORY_NR_OF_FLOATS; i++) {
+      memcpy(&sample->value[i], &reader.value[i], sizeof(uint32_t));
+    }
+    sample->machinestate = reader.state & 0x0f;
+    sample->opto1 = (reader.state & 0x10) != 0;
+    return true;
+  }
+}
+
+bool History::requestWindow(uint32_t from, uint32_t to) {
+  if ((blocks == NULL) || (nrOfBlocksUsed == 0) || (from > to)) {
+    return false;
+  }
+  readBlock = (nrOfBlocksUsed < HISTORY_NR_OF_BLOCKS) ? 0 : (currentBlock + 1) % HISTORY_NR_OF_BLOCKS;
+  blocksLeft = nrOfBlocksUsed - 1;
+  // skip the blocks that end before the window starts
+  while ((blocksLeft > 0) && (blocks[(readBlock + 1) % HISTORY_NR_OF_BLOCKS].firstTimestamp <= from)) {
+    readBlock = (readBlock + 1) % HISTORY_NR_OF_BLOCKS;
+    blocksLeft--;
+  }
+  readGeneration = blocks[readBlock].generation;
+  reader.bitPos = 0;
+  reader.sampleNr = 0;
+  windowFrom = from;
+  windowTo = to;
+  pageNr = 0;
+  streaming = true;
+  theTimerWheel.start(&pageTimer, 0, HISTORY_PAGE_INTERVAL, sendPage, this);
+  return true;
+}
+
+// page format, one line per sample:
+//   history <page nr>
+//   <s since boot>,<pressure>,<temperature 1>,<temperature 2>,<opto1>,<machinestate>
+//   ...
+//   end                  (last page only)
+void History::sendPage() {
+  char page[320];
+  char *end;
+  int length;
+  uint8_t nrOfSamples = 0;
+  historysample_t sample;
+
+  length = sprintf(page, "history %u\n", pageNr++);
+  while (nrOfSamples < HISTORY_PAGE_SAMPLES) {
+    if (!decodeNext(&sample) || (sample.timestamp > windowTo)) {
+      streaming = false;
+      theTimerWheel.stop(&pageTimer);
+      break;
+    }
+    if (sample.timestamp < windowFrom) {
+      continue;
+    }
+    end = page + length + sprintf(page + length, "%u", sample.timestamp);
+    for (uint8_t i = 0; i < HISTORY_NR_OF_FLOATS; i++) {
+      end = formatFixed(end, ",", sample.value[i], 0, 2, "");
+    }
+    length = end - page;
+    length += sprintf(page + length, ",%d,%d\n", sample.opto1, sample.machinestate);
+    nrOfSamples++;
+  }
+  if (!streaming) {
+    sprintf(page + length, "end\n");
+  }
+  theNetworkTask.send(HISTORY_TOPIC, page);
+}
+
+void History::sendPage(void *context) {
+  ((History *)context)->sendPage();
+}
+
+uint32_t History::nrOfSamples() {
+  uint32_t total = 0;
+
+  for (uint8_t i = 0; (blocks != NULL) && (i < nrOfBlocksUsed); i++) {
+    total += blocks[i].nrOfSamples;
+  }
+  return total;
+}
+
+uint32_t History::bytesUsed() {
+  uint32_t total = 0;
+
+  for (uint8_t i = 0; (blocks != NULL) && (i < nrOfBlocksUsed); i++) {
+    total += (blocks[i].bitsUsed + 7) / 8;
+  }
+  return total;
+}
+
+void History::logInfo() {
+  uint32_t samples = nrOfSamples();
+  uint32_t bytes = bytesUsed();
+
+  Log.print("History: ");
+  Log.print(samples);
+  Log.print(" samples in ");
+  Log.print(bytes);
+  Log.print(" bytes");
+  if (samples > 0) {
+    Log.print(", ");
+    Log.print((float)bytes * 8 / samples);
+    Log.print(" bits per sample");
+  }
+  Log.println("");
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MachState.h>
+#include "TimerWheel.h"
+
+// In RAM history of the 1 Hz samples, compressed Gorilla style: timestamps as
+// delta-of-delta, floats as XOR with the previous value. The store is a ring
+// of fixed size blocks, the oldest block is overwritten when all are in use.
+#define HISTORY_BLOCK_SIZE (1024) // in bytes, including the block header
+#define HISTORY_NR_OF_BLOCKS (32) // 32 KB in total
+#define HISTORY_NR_OF_FLOATS (3) // pressure, temperature 1, temperature 2
+
+typedef struct {
+  uint32_t timestamp;  // in s since boot
+  float value[HISTORY_NR_OF_FLOATS];
+  bool opto1;
+  machinestates_t machinestate;
+} historysample_t;
+
+typedef struct {
+  uint32_t generation; // incremented every time the block is reused
+  uint32_t firstTimestamp;
+  uint16_t bitsUsed;
+  uint16_t nrOfSamples;
+  uint8_t data[HISTORY_BLOCK_SIZE - 12];
+} historyblock_t;
+
+// encoder or decoder state within a block
+typedef struct {
+  uint32_t timestamp;
+  int32_t delta;
+  uint32_t value[HISTORY_NR_OF_FLOATS];
+  uint8_t leading[HISTORY_NR_OF_FLOATS];
+  uint8_t trailing[HISTORY_NR_OF_FLOATS];
+  uint8_t state; // machinestate, opto1 in bit 4
+  uint16_t bitPos;
+  uint16_t sampleNr;
+} historystate_t;
+
+class History {
+private:
+  historyblock_t *blocks = NULL;
+  uint8_t currentBlock = 0;
+  uint8_t nrOfBlocksUsed = 0;
+  historystate_t writer;
+
+  // page streaming of a requested window
+  bool streaming = false;
+  uint32_t windowFrom;
+  uint32_t windowTo;
+  uint8_t readBlock;
+  uint8_t blocksLeft;
+  uint32_t readGeneration;
+  historystate_t reader;
+  uint16_t pageNr;
+  wheeltimer_t pageTimer;
+
+  void writeBits(uint32_t value, uint8_t nrOfBits);
+  uint32_t readBits(const historyblock_t *block, historystate_t *state, uint8_t nrOfBits);
+  void encodeValue(uint8_t channel, uint32_t value);
+  uint32_t decodeValue(const historyblock_t *block, historystate_t *state, uint8_t channel);
+  void startBlock(const historysample_t *sample);
+  bool decodeNext(historysample_t *sample);
+  static void sendPage(void *context);
+  void sendPage();
+
+public:
+  History();
+
+  bool begin();
+
+  void add(uint32_t timestamp, float pressure, float temperature1, float temperature2, bool opto1, machinestates_t machinestate);
+
+  // stream the samples from..to (in s since boot) over MQTT, one page per HISTORY_PAGE_INTERVAL
+  bool requestWindow(uint32_t from, uint32_t to);
+
+  uint32_t nrOfSamples();
+
+  uint32_t bytesUsed();
+
+  void logInfo();
+};
+
+extern History theHistory;
@@ -0,0 +1,134 @@
+#include "InputCapture.h"
+#include <esp_timer.h>
+
+// the inputs register themselves, before setup() runs
+static CapturedInput *capturedInputs = NULL;
+
+InputCapture theInputCapture;
+
+CapturedInput::CapturedInput(uint8_t pin, inputmode_t mode, uint32_t debounce) {
+  this->pin = pin;
+  this->mode = mode;
+  this->debounce = (int64_t)debounce * 1000;
+  level = (mode == INPUT_PULSES) ? LOW : HIGH;
+  edgeLevel = level;
+  isrLevel = level;
+  next = capturedInputs;
+  capturedInputs = this;
+}
+
+void IRAM_ATTR InputCapture::edgeInterrupt(void *arg) {
+  CapturedInput *input = (CapturedInput *)arg;
+  inputedge_t edge;
+  BaseType_t taskWoken = pdFALSE;
+
+  edge.level = digitalRead(input->pin);
+  edge.time = esp_timer_get_time();
+  // GPIO36 and GPIO39 also interrupt without an edge while ADC1 samples, the level did not change then
+  if (edge.level == input->isrLevel) {
+    return;
+  }
+  edge.input = input;
+  edge.actionTime = -1;
+  if ((input->action != NULL) && (edge.time - input->isrLastEdge >= input->debounce) && input->action(edge.level)) {
+    edge.actionTime = esp_timer_get_time() - edge.time;
+  }
+  input->isrLevel = edge.level;
+  input->isrLastEdge = edge.time;
+  if (xQueueSendFromISR(theInputCapture.edgeQueue, &edge, &taskWoken) != pdTRUE) {
+    theInputCapture.isrOverruns++;
+  }
+  if (taskWoken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+void InputCapture::begin() {
+  int64_t now = esp_timer_get_time();
+
+  edgeQueue = xQueueCreate(INPUT_CAPTURE_QUEUE_SIZE, sizeof(inputedge_t));
+  for (CapturedInput *input = capturedInputs; input != NULL; input = input->next) {
+    input->isrLevel = digitalRead(input->pin);
+    input->edgeLevel = input->isrLevel;
+    input->lastEdge = now;
+    attachInterruptArg(digitalPinToInterrupt(input->pin), edgeInterrupt, input, CHANGE);
+  }
+}
+
+// time: when the level changed, decided: from when the change could be known
+void InputCapture::change(CapturedInput *input, int level, int64_t time, int64_t decided) {
+  input->level = level;
+  input->lastChange = time;
+  counters.changes++;
+  latency.add(esp_timer_get_time() - decided);
+  if (input->callback != NULL) {
+    input->callback(level);
+  }
+}
+
+void InputCapture::edge(const inputedge_t *edge) {
+  CapturedInput *input = edge->input;
+  int64_t previousEdge = input->lastEdge;
+
+  counters.edges++;
+  input->edgeLevel = edge->level;
+  input->lastEdge = edge->time;
+  if (edge->actionTime >= 0) {
+    // the relay (or whatever the action drives) already follows this edge
+    counters.actions++;
+    actionLatency.add(edge->actionTime);
+    change(input, edge->level, edge->time, edge->time);
+    return;
+  }
+  switch (input->mode) {
+    case INPUT_LEADING:
+      if ((edge->level != input->level) && (edge->time - input->lastChange >= input->debounce)) {
+        change(input, edge->level, edge->time, edge->time);
+      } else {
+        counters.bounces++;
+      }
+      break;
+    case INPUT_SETTLE:
+      if (edge->time - previousEdge < input->debounce) {
+        counters.bounces++;
+      }
+      break;
+    case INPUT_PULSES:
+      if (input->level == LOW) {
+        change(input, HIGH, edge->time, edge->time);
+      }
+      break;
+  }
+}
+
+void InputCapture::loop() {
+  inputedge_t queued;
+  int64_t now;
+
+  while (xQueueReceive(edgeQueue, &queued, 0) == pdTRUE) {
+    edge(&queued);
+  }
+  now = esp_timer_get_time();
+  if (isrOverruns != counters.overruns) {
+    // edges were lost: start again from the levels as they are now
+    counters.overruns = isrOverruns;
+    for (CapturedInput *input = capturedInputs; input != NULL; input = input->next) {
+      input->edgeLevel = digitalRead(input->pin);
+      input->lastEdge = now;
+    }
+  }
+
+  // the levels that were stable long enough
+  for (CapturedInput *input = capturedInputs; input != NULL; input = input->next) {
+    if ((input->edgeLevel == input->level) || (now - input->lastEdge < input->debounce)) {
+      if ((input->mode == INPUT_PULSES) && (input->edgeLevel == HIGH) && (input->level == LOW)) {
+        change(input, HIGH, input->lastEdge, input->lastEdge);
+      }
+      continue;
+    }
+    if ((input->mode == INPUT_LEADING) && (now - input->lastChange < input->debounce)) {
+      continue;
+    }
+    change(input, input->edgeLevel, input->lastEdge, input->lastEdge + input->debounce);
+  }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "LoopProfiler.h"
+
+// Edge capture of the buttons, the opto coupler and the oil level switch: a
+// GPIO interrupt timestamps every edge in us and queues it, loop() debounces
+// on these timestamps and calls the callback of the input. How long a pass of
+// loop() takes changes when the callback is called, not what it is called with.
+//
+//   INPUT_SETTLE   a new level counts when it was stable for the debounce time after its last edge
+//   INPUT_LEADING  the first edge counts at once, the edges within the debounce time after it are bounces
+//   INPUT_PULSES   HIGH while edges come in within the debounce time (the 50 Hz pulses of an opto
+//                  coupler on 230VAC) or the level is HIGH, LOW once both stop
+//
+// An input can have an action that runs in the interrupt, on an edge after at
+// least the debounce time without edges: the Off button switches the relay off
+// without waiting for loop(). loop() always counts an edge the action acted on.
+#define INPUT_CAPTURE_QUEUE_SIZE (32) // edges, all inputs together
+
+class CapturedInput;
+
+typedef void (*inputcallback_t)(int state);
+typedef bool (*inputaction_t)(int level); // called in the interrupt, true if it acted
+
+typedef enum {
+  INPUT_SETTLE,
+  INPUT_LEADING,
+  INPUT_PULSES
+} inputmode_t;
+
+typedef struct {
+  CapturedInput *input;
+  int level;
+  int64_t time; // in us, esp_timer_get_time()
+  int32_t actionTime; // in us after the edge, -1 if the action did not act
+} inputedge_t;
+
+typedef struct {
+  uint32_t edges;
+  uint32_t bounces; // edges that did not change the state
+  uint32_t changes;
+  uint32_t actions; // the interrupt acted
+  uint32_t overruns; // edges lost, the queue was full
+} inputcapturecounters_t;
+
+class CapturedInput {
+  friend class InputCapture;
+
+private:
+  uint8_t pin;
+  inputmode_t mode;
+  int64_t debounce; // in us
+  inputcallback_t callback = NULL;
+  inputaction_t action = NULL;
+  CapturedInput *next;
+
+  // interrupt side
+  volatile int isrLevel;
+  volatile int64_t isrLastEdge = 0;
+
+  // loop side
+  int level;
+  int edgeLevel; // the level after the last edge
+  int64_t lastEdge = 0;
+  int64_t lastChange = 0;
+
+public:
+  // the state starts at HIGH (LOW for INPUT_PULSES), a different level at begin() is a change after the debounce time
+  CapturedInput(uint8_t pin, inputmode_t mode, uint32_t debounce /* in ms */);
+
+  void setCallback(inputcallback_t callback) { this->callback = callback; }
+
+  void setAction(inputaction_t action) { this->action = action; }
+
+  int state() { return level; }
+};
+
+class InputCapture {
+private:
+  QueueHandle_t edgeQueue = NULL;
+  volatile uint32_t isrOverruns = 0;
+
+  static void IRAM_ATTR edgeInterrupt(void *arg);
+  void edge(const inputedge_t *edge);
+  void change(CapturedInput *input, int level, int64_t time, int64_t decided);
+
+public:
+  inputcapturecounters_t counters = { 0, 0, 0, 0, 0 };
+  LoopHistogram latency; // in us, from the edge (or the end of the debounce time) to the callback
+  LoopHistogram actionLatency; // in us, from the edge to the action in the interrupt
+
+  // after pinMode() of the inputs
+  void begin();
+
+  // handles the queued edges and the debounce times that passed
+  void loop();
+};
+
+extern InputCapture theInputCapture;
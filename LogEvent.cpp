@@ -0,0 +1,145 @@
+#include "LogEvent.h"
+#include "LogRing.h"
+
+#include <algorithm>
+#include <stdarg.h>
+#include <stdlib.h>
+
+static const char *const eventFormat[NR_OF_LOG_EVENTS] = {
+#define LOG_EVENT_FORMAT(id, format) format,
+  LOG_EVENTS(LOG_EVENT_FORMAT)
+#undef LOG_EVENT_FORMAT
+};
+
+static logeventlabel_t stateLabel = NULL;
+static logeventlabel_t tempSensorLabel = NULL;
+
+void setLogEventLabels(logeventlabel_t stateLabelFunction, logeventlabel_t tempSensorLabelFunction) {
+  stateLabel = stateLabelFunction;
+  tempSensorLabel = tempSensorLabelFunction;
+}
+
+const char *logEventFormat(uint8_t id) {
+  return (id < NR_OF_LOG_EVENTS) ? eventFormat[id] : NULL;
+}
+
+static uint8_t argumentSize(char specifier) {
+  switch (specifier) {
+    case 'c':
+      return 2;
+    case 'l':
+      return 4;
+    case 'u':
+    case 'm':
+    case 't':
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static size_t encodeArguments(uint8_t *record, logevent_t id, va_list arguments) {
+  size_t length = 0;
+
+  record[length++] = id;
+  for (const char *f = eventFormat[id]; *f; f++) {
+    if ((f[0] != '%') || (argumentSize(f[1]) == 0)) {
+      continue;
+    }
+    f++;
+    uint32_t value = (*f == 'l') ? va_arg(arguments, uint32_t) : (uint32_t)va_arg(arguments, int);
+    for (uint8_t i = 0; i < argumentSize(*f); i++) {
+      record[length++] = (value >> (8 * i)) & 0xff;
+    }
+  }
+  return length;
+}
+
+size_t encodeLogEvent(uint8_t *record, logevent_t id, ...) {
+  va_list arguments;
+
+  va_start(arguments, id);
+  size_t length = encodeArguments(record, id, arguments);
+  va_end(arguments);
+  return length;
+}
+
+// the size of the record of an event, from its format
+static size_t recordSize(uint8_t id) {
+  size_t size = 1;
+
+  for (const char *f = eventFormat[id]; *f; f++) {
+    if (f[0] == '%') {
+      size += argumentSize(f[1]);
+    }
+  }
+  return size;
+}
+
+size_t renderLogEvent(const uint8_t *record, size_t length, char *text, size_t size) {
+  size_t position = 1;
+  size_t used = 0;
+
+  if ((length == 0) || (size == 0) || (record[0] >= NR_OF_LOG_EVENTS) || (recordSize(record[0]) > length)) {
+    return 0;
+  }
+  for (const char *f = eventFormat[record[0]]; *f; f++) {
+    uint8_t nrOfBytes = (f[0] == '%') ? argumentSize(f[1]) : 0;
+    uint32_t value = 0;
+    const char *label = NULL;
+    int printed;
+
+    if (nrOfBytes == 0) {
+      if (used + 1 < size) {
+        text[used++] = *f;
+      }
+      continue;
+    }
+    f++;
+    for (uint8_t i = 0; i < nrOfBytes; i++) {
+      value |= (uint32_t)record[position++] << (8 * i);
+    }
+    switch (*f) {
+      case 'c': {
+        int16_t centi = (int16_t)value;
+        printed = snprintf(text + used, size - used, "%s%d.%02d", (centi < 0) ? "-" : "", abs(centi) / 100, abs(centi) % 100);
+        break;
+      }
+      case 'm':
+        label = (stateLabel != NULL) ? stateLabel(value) : NULL;
+        printed = (label != NULL) ? snprintf(text + used, size - used, "%s", label)
+                                  : snprintf(text + used, size - used, "%u", (unsigned)value);
+        break;
+      case 't':
+        label = (tempSensorLabel != NULL) ? tempSensorLabel(value) : NULL;
+        printed = (label != NULL) ? snprintf(text + used, size - used, "%u (%s)", (unsigned)value, label)
+                                  : snprintf(text + used, size - used, "%u", (unsigned)value);
+        break;
+      default:
+        printed = snprintf(text + used, size - used, "%lu", (unsigned long)value);
+        break;
+    }
+    // snprintf returns the length it needed, the text is cut at size
+    used = std::min(used + (size_t)printed, size - 1);
+  }
+  text[used] = 0;
+  return position;
+}
+
+void logEvent(logevent_t id, ...) {
+  uint8_t record[LOG_EVENT_MAX_SIZE];
+  va_list arguments;
+
+  va_start(arguments, id);
+  size_t length = encodeArguments(record, id, arguments);
+  va_end(arguments);
+
+  if (theLogRing.started()) {
+    theLogRing.event(record, length);
+  } else {
+    char text[LOG_EVENT_TEXT_SIZE];
+
+    renderLogEvent(record, length, text, sizeof(text));
+    Log.println(text);
+  }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Event coded log: the frequent messages are logged as an event number and
+// typed arguments instead of as text. The texts are in the table below, in
+// the firmware for telnet and in every decoder (see bench_eventlog of the
+// host build); MQTT gets the binary records on LOG_EVENT_MQTT_TOPIC.
+//
+// Record: the event number (uint8), then the arguments in the order of the
+// format, little endian. The format tells the size of each argument:
+//
+//   %u  uint8
+//   %c  int16, a value in 0.01 (pressure in bar, temperature in degrees Celcius), rendered as x.xx
+//   %l  uint32
+//   %m  uint8, machine state (machinestates_t), rendered with the state label if known
+//   %t  uint8, temperature sensor number, rendered as "number (label)" if the label is known
+//
+// An MQTT message is LOG_EVENT_VERSION followed by one or more records. New
+// events are added at the end of the table, a number is never reused.
+#define LOG_EVENT_VERSION (1)
+#define LOG_EVENT_MQTT_TOPIC "log_event"
+#define LOG_EVENT_MAX_SIZE (16) // in bytes, the largest record
+#define LOG_EVENT_TEXT_SIZE (160) // in bytes, the longest rendered text
+
+#define LOG_EVENTS(X) \
+  X(EVENT_EMPTY_LINE, "") \
+  X(EVENT_PRESSURE, "Pressure = %c bar") \
+  X(EVENT_OIL_LEVEL_OK, "Oil level is OK!") \
+  X(EVENT_OIL_LEVEL_WARNING, "Warning: Oil level is too low; Compressor will be disabled soon if this issue is not solved; Please verify the oil level and fill up if needed") \
+  X(EVENT_OIL_LEVEL_ERROR, "ERROR: Oil level is too low; Compressor will be disabled; Please maintain the compressor by filling up the oil") \
+  X(EVENT_OIL_LEVEL_OK_NOW, "Oil level OK now!") \
+  X(EVENT_OIL_LEVEL_SOLVED, "SOLVED: Oil level error!") \
+  X(EVENT_TEMP, "Temperature sensor %t = %c degrees Celcius") \
+  X(EVENT_TEMP_NOT_READ, "Error reading temperature sensor %t, perhaps not connected?") \
+  X(EVENT_TEMP_IS_HIGH, "WARNING: Temperature sensor %t is very high!") \
+  X(EVENT_TEMP_IS_TOO_HIGH, "ERROR: Temperature sensor %t is too high, compressor is disabled!") \
+  X(EVENT_TEMP_CRC_ERRORS, "Temperature sensor %t: %l readings with a CRC error") \
+  X(EVENT_TEMP_NOT_REACTING, "Temperature sensor %t: sensor does not react, perhaps not available?") \
+  X(EVENT_TEMP_CRC_NOT_REACTING, "Temperature sensor %t: CRC errors in the readings, please check the wiring of the sensor") \
+  X(EVENT_TEMP_OK_NOW, "Temperature sensor %t: temperature is OK now (below warning threshold)") \
+  X(EVENT_TEMP_ABOVE_WARNING, "WARNING: temperature sensor %t: temperature is above warning level. Please check the compressor") \
+  X(EVENT_TEMP_ERROR, "ERROR, sensor %t: Temperature is too high, compressor is disabled. Please check the compressor!") \
+  X(EVENT_TEMP_BELOW_ERROR, "WARNING, sensor %t: Temperature is below error level now, but still above warning level. Please check the compressor!") \
+  X(EVENT_IS_SWITCHED_OFF, "Compressor is switched off") \
+  X(EVENT_IS_POWERED, "Compressor is switched on, motor is off") \
+  X(EVENT_IS_RUNNING, "Compressor is switched on, motor is running") \
+  X(EVENT_LOG_DROPPED, "Log: %l lines dropped") \
+  X(EVENT_STATE_CHANGED, "Changed from state %m to state %m") \
+  X(EVENT_SWITCHED_OFF, "Compressor switched off") \
+  X(EVENT_SWITCHED_ON, "Compressor switched on, motor is off") \
+  X(EVENT_BUTTON_ON, "Compressor switched on with button") \
+  X(EVENT_BUTTON_ON_DENIED, "Power on denied!\nPower on is disabled during evening/night window") \
+  X(EVENT_BUTTON_OFF, "Compressor switched off with button") \
+  X(EVENT_BUTTON_TIMEOUT_EXTENDED, "Compressor timeout extended with button") \
+  X(EVENT_MANUAL_OVERRIDE, "Warning: compressor was switched on using manual override!") \
+  X(EVENT_DISABLED_BY_ERRORS, "Compressor is disabled now due to error(s). Please check compressor!") \
+  X(EVENT_PRESSURE_TOO_HIGH, "Pressure is too high: %c bar, compressor is switched off") \
+  X(EVENT_TIMEOUT, "Timeout: compressor automatically switched off") \
+  X(EVENT_AUTO_STOP, "Automatic request received: Compressor stopped") \
+  X(EVENT_AUTO_POWER_ON, "Automatic request received: Compressor powered on") \
+  X(EVENT_AUTO_POWER_ON_DENIED, "Automatic request denied to power on the compressor. Reason: late hours/night!")
+
+typedef enum {
+#define LOG_EVENT_ENUM(id, format) id,
+  LOG_EVENTS(LOG_EVENT_ENUM)
+#undef LOG_EVENT_ENUM
+  NR_OF_LOG_EVENTS
+} logevent_t;
+
+// a value as the int16 of %c
+inline int centiValue(float value) {
+  long centi = lroundf(value * 100);
+  return (centi < -32768) ? -32768 : ((centi > 32767) ? 32767 : centi);
+}
+
+// the texts of the labels, NULL if not known; without them the numbers are rendered
+typedef const char *(*logeventlabel_t)(uint8_t value);
+
+void setLogEventLabels(logeventlabel_t stateLabel, logeventlabel_t tempSensorLabel);
+
+const char *logEventFormat(uint8_t id);
+
+// encodes the arguments as the format of the event tells: %c as int, %l as uint32_t, the others as int
+size_t encodeLogEvent(uint8_t *record, logevent_t id, ...);
+
+// renders one record into text, without newline; returns the size of the record, 0 if it is not valid
+size_t renderLogEvent(const uint8_t *record, size_t length, char *text, size_t size);
+
+// logs an event: into theLogRing when it is running, else the rendered text into Log
+void logEvent(logevent_t id, ...);
@@ -0,0 +1,177 @@
+#include "LogRing.h"
+#include "LogEvent.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+LogRing theLogRing;
+
+LogRing::LogRing() : head(0), tail(0), batchPending(false) {
+}
+
+size_t LogRing::write(uint8_t c) {
+  uint8_t p = producer();
+
+  if (c == '\r') {
+    return 1;
+  }
+  if (c == '\n') {
+    line[p][lineLength[p]++] = '\n';
+    commit(line[p], lineLength[p], false);
+    if (lineTruncated[p]) {
+      counters.truncated++;
+    }
+    lineLength[p] = 0;
+    lineTruncated[p] = false;
+    return 1;
+  }
+  // keep room for the newline
+  if (lineLength[p] < LOG_LINE_SIZE - 1) {
+    line[p][lineLength[p]++] = c;
+  } else {
+    lineTruncated[p] = true;
+  }
+  return 1;
+}
+
+size_t LogRing::write(const uint8_t *buf, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    write(buf[i]);
+  }
+  return len;
+}
+
+void LogRing::event(const uint8_t *record, size_t length) {
+  commit((const char *)record, length, true);
+  counters.events++;
+}
+
+void LogRing::commit(const char *text, uint16_t length, bool event) {
+  portENTER_CRITICAL(&commitLock);
+  uint32_t position = head.load(std::memory_order_relaxed);
+  uint32_t oldest = tail.load(std::memory_order_acquire);
+
+  // full: drop the oldest line; if the consumer is reading it, its compare exchange of tail fails
+  while (position - oldest >= LOG_RING_LINES) {
+    if (tail.compare_exchange_weak(oldest, oldest + 1, std::memory_order_acq_rel)) {
+      counters.dropped++;
+      oldest++;
+    }
+  }
+  memcpy(ring[position % LOG_RING_LINES].text, text, length);
+  ring[position % LOG_RING_LINES].length = length;
+  ring[position % LOG_RING_LINES].event = event;
+  head.store(position + 1, std::memory_order_release);
+
+  counters.lines++;
+  portEXIT_CRITICAL(&commitLock);
+}
+
+// copies the oldest line, false if the ring is empty
+bool LogRing::readLine(char *text, uint16_t *length, bool *event) {
+  uint32_t oldest = tail.load(std::memory_order_acquire);
+
+  while (oldest != head.load(std::memory_order_acquire)) {
+    const logline_t &ringLine = ring[oldest % LOG_RING_LINES];
+
+    *length = ringLine.length;
+    *event = ringLine.event;
+    memcpy(text, ringLine.text, *length);
+    if (tail.compare_exchange_strong(oldest, oldest + 1, std::memory_order_acq_rel)) {
+      return true;
+    }
+    // the producer dropped the line while it was copied, oldest holds the new tail
+  }
+  return false;
+}
+
+void LogRing::flush() {
+  char entry[LOG_LINE_SIZE];
+  uint16_t length;
+  bool event;
+
+  // the control loop did not publish the previous batches yet, the lines wait in the ring
+  if (batchPending.load(std::memory_order_acquire)) {
+    return;
+  }
+  batchLength = 0;
+  mqttBatchLength = 0;
+  eventBatch[0] = LOG_EVENT_VERSION;
+  eventBatchLength = 1;
+  while ((batchLength + LOG_LINE_SIZE <= LOG_BATCH_SIZE) && (eventBatchLength + LOG_EVENT_MAX_SIZE <= LOG_EVENT_BATCH_SIZE) &&
+         readLine(entry, &length, &event)) {
+    if (event) {
+      // rendered for the sinks, the record for MQTT
+      if (renderLogEvent((const uint8_t *)entry, length, &batch[batchLength], LOG_LINE_SIZE - 1) == 0) {
+        continue;
+      }
+      batchLength += strlen(&batch[batchLength]);
+      batch[batchLength++] = '\n';
+      memcpy(&eventBatch[eventBatchLength], entry, length);
+      eventBatchLength += length;
+    } else {
+      memcpy(&batch[batchLength], entry, length);
+      batchLength += length;
+      memcpy(&mqttBatch[mqttBatchLength], entry, length);
+      mqttBatchLength += length;
+    }
+  }
+  if (batchLength == 0) {
+    return;
+  }
+  for (auto &handler : handlers) {
+    handler->write((const uint8_t *)batch, batchLength);
+  }
+  counters.batches++;
+  if (mqtt) {
+    // one message, without the last newline
+    if (mqttBatchLength > 0) {
+      mqttBatch[mqttBatchLength - 1] = 0;
+    }
+    batchPending.store(true, std::memory_order_release);
+  }
+}
+
+void LogRing::flushTask(void *parameter) {
+  LogRing *log = (LogRing *)parameter;
+
+  while (true) {
+    log->flush();
+    vTaskDelay(pdMS_TO_TICKS(LOG_FLUSH_PERIOD));
+  }
+}
+
+void LogRing::begin(bool publishMqtt) {
+  mqtt = publishMqtt;
+  isStarted = true;
+  if (taskIsRunning) {
+    return;
+  }
+  taskIsRunning = true;
+  if (xTaskCreatePinnedToCore(flushTask, "log", LOG_FLUSH_TASK_STACK, this, LOG_FLUSH_TASK_PRIORITY, NULL, LOG_FLUSH_TASK_CORE) != pdPASS) {
+    taskIsRunning = false;
+  }
+}
+
+const char *LogRing::pendingMqttBatch() {
+  // without the flush task the control loop flushes
+  if (!taskIsRunning) {
+    flush();
+  }
+  if (!batchPending.load(std::memory_order_acquire) || (mqttBatchLength == 0)) {
+    return NULL;
+  }
+  return mqttBatch;
+}
+
+const uint8_t *LogRing::pendingEventBatch(size_t *length) {
+  if (!batchPending.load(std::memory_order_acquire) || (eventBatchLength <= 1)) {
+    return NULL;
+  }
+  *length = eventBatchLength;
+  return eventBatch;
+}
+
+void LogRing::mqttBatchSent() {
+  batchPending.store(false, std::memory_order_release);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+
+// Asynchronous log: Log writes into theLogRing instead of into the sinks.
+// A completed line is copied into a lock free ring buffer, with one consumer
+// (the flush task); when the ring is full the oldest line is dropped and
+// counted. The control loop writes into it, and a second task added with
+// addProducer() (the network task, see NetworkTask.h) may too: each has its
+// own line being assembled, and a completed line is committed under a
+// spinlock that is held for the copy only. The flush task collects the lines
+// into a batch: the sinks added with addPrintStream() get one write() per
+// batch, and the batch is handed back to the control loop, which publishes
+// it on MQTT with one node.send() (the MQTT client is not thread safe).
+// An event of LogEvent.h takes a ring entry as its binary record: the flush
+// task renders it for the sinks and collects the records for MQTT into an
+// event batch, published on LOG_EVENT_MQTT_TOPIC; the MQTT text batch only
+// holds the text lines.
+#define LOG_RING_LINES (32)
+#define LOG_LINE_SIZE (192) // in bytes, including the newline; longer lines are cut
+#define LOG_BATCH_SIZE (1024) // in bytes
+#define LOG_FLUSH_PERIOD (100) // in ms
+#define LOG_FLUSH_TASK_PRIORITY (1) // lowest above idle
+#define LOG_FLUSH_TASK_CORE (0)
+#define LOG_FLUSH_TASK_STACK (3072) // in bytes
+#define LOG_EVENT_BATCH_SIZE (256) // in bytes
+#define LOG_MQTT_TOPIC "log"
+
+typedef struct {
+  uint32_t lines;     // lines logged, including the events
+  uint32_t events;    // events logged
+  uint32_t dropped;   // lines overwritten before the flush task read them
+  uint32_t truncated; // lines longer than LOG_LINE_SIZE
+  uint32_t batches;   // batches written to the sinks
+} logcounters_t;
+
+class LogRing : public TLog {
+private:
+  typedef struct {
+    uint16_t length;
+    bool event; // text holds the record of an event
+    char text[LOG_LINE_SIZE];
+  } logline_t;
+
+  logline_t ring[LOG_RING_LINES];
+  std::atomic<uint32_t> head; // next line to write, only the producer writes it
+  std::atomic<uint32_t> tail; // oldest line, moved by the consumer and by the producer when it drops a line
+
+  // the line being assembled by each producer, 1 is the task of addProducer()
+  char line[2][LOG_LINE_SIZE];
+  uint16_t lineLength[2] = { 0, 0 };
+  bool lineTruncated[2] = { false, false };
+  TaskHandle_t otherProducer = NULL;
+  portMUX_TYPE commitLock = portMUX_INITIALIZER_UNLOCKED;
+
+  // written by the flush task for the sinks
+  char batch[LOG_BATCH_SIZE];
+  uint16_t batchLength = 0;
+
+  // owned by the flush task until batchPending is set, then by the control loop
+  char mqttBatch[LOG_BATCH_SIZE + 1];
+  uint16_t mqttBatchLength = 0;
+  uint8_t eventBatch[LOG_EVENT_BATCH_SIZE];
+  uint16_t eventBatchLength = 0;
+  std::atomic<bool> batchPending;
+
+  bool mqtt = false;
+  bool isStarted = false;
+  bool taskIsRunning = false;
+
+  uint8_t producer() { return ((otherProducer != NULL) && (xTaskGetCurrentTaskHandle() == otherProducer)) ? 1 : 0; }
+  void commit(const char *text, uint16_t length, bool event);
+  bool readLine(char *text, uint16_t *length, bool *event);
+  static void flushTask(void *parameter);
+
+public:
+  logcounters_t counters = { 0, 0, 0, 0, 0 };
+
+  LogRing();
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t len) override;
+  using Print::write;
+
+  // a record of LogEvent.h, at most LOG_EVENT_MAX_SIZE bytes
+  void event(const uint8_t *record, size_t length);
+
+  // publishMqtt: hand the batches to the control loop, see pendingMqttBatch()
+  void begin(bool publishMqtt);
+
+  bool started() { return isStarted; }
+
+  // a task that logs besides the control loop
+  void addProducer(TaskHandle_t task) { otherProducer = task; }
+
+  // drains the ring into the sinks, called by the flush task
+  void flush();
+
+  // the batch to publish on LOG_MQTT_TOPIC, NULL if there is none; call mqttBatchSent() after publishing
+  const char *pendingMqttBatch();
+  // after pendingMqttBatch(): the event batch to publish on LOG_EVENT_MQTT_TOPIC, NULL if there is none
+  const uint8_t *pendingEventBatch(size_t *length);
+  void mqttBatchSent();
+};
+
+extern LogRing theLogRing;
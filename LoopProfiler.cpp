@@ -0,0 +1,116 @@
+#include "LoopProfiler.h"
+
+const char *loopStageLabel[NR_OF_LOOP_STAGES] =
+{
+  "node",
+  "temp_sensors",
+  "oled_display",
+  "compressor",
+  "buttons_optocoupler",
+  "oil_level_sensor",
+  "state_machine",
+};
+
+typedef struct {
+  const char *label;
+  unsigned long budget; // in us
+} loopworkbudget_t;
+
+const loopworkbudget_t loopWorkBudget[NR_OF_LOOP_WORK] =
+{
+  { "oled_display", 1000 },
+  { "status_log", 2000 },
+  { "calibration_log", 3000 },
+};
+
+LoopProfiler theLoopProfiler;
+
+LoopHistogram::LoopHistogram() {
+  reset();
+}
+
+uint8_t LoopHistogram::bucketOf(unsigned long us) {
+  if (us < LOOP_PROFILER_EXACT_BUCKETS) {
+    return us;
+  }
+  uint8_t msb = 31 - __builtin_clz((uint32_t)us);
+  if (msb > LOOP_PROFILER_MAX_MSB) {
+    return LOOP_PROFILER_BUCKETS - 1;
+  }
+  return LOOP_PROFILER_EXACT_BUCKETS + (msb - 3) * 4 + ((us >> (msb - 2)) & 3);
+}
+
+unsigned long LoopHistogram::bucketLimit(uint8_t bucket) {
+  if (bucket < LOOP_PROFILER_EXACT_BUCKETS) {
+    return bucket;
+  }
+  uint8_t msb = (bucket - LOOP_PROFILER_EXACT_BUCKETS) / 4 + 3;
+  uint8_t sub = (bucket - LOOP_PROFILER_EXACT_BUCKETS) % 4;
+  return ((4UL + sub + 1) << (msb - 2)) - 1;
+}
+
+void LoopHistogram::add(unsigned long us) {
+  buckets[bucketOf(us)]++;
+  count++;
+  if (us > maxTime) {
+    maxTime = us;
+  }
+}
+
+void LoopHistogram::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  maxTime = 0;
+}
+
+unsigned long LoopHistogram::percentile(uint8_t pct) {
+  if (count == 0) {
+    return 0;
+  }
+  uint32_t rank = (uint32_t)(((uint64_t)count * pct + 99) / 100);
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < LOOP_PROFILER_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      unsigned long limit = bucketLimit(i);
+      return (limit < maxTime) ? limit : maxTime;
+    }
+  }
+  return maxTime;
+}
+
+void LoopHistogram::summary(char *outputStr, size_t size) {
+  snprintf(outputStr, size, "%lu/%lu/%lu", percentile(50), percentile(99), maxTime);
+}
+
+LoopProfiler::LoopProfiler() {
+  passStart = 0;
+  lastMark = 0;
+  memset(shed, 0, sizeof(shed));
+}
+
+const char *LoopProfiler::label(loopstage_t loopStage) {
+  return loopStageLabel[loopStage];
+}
+
+const char *LoopProfiler::label(loopwork_t work) {
+  return loopWorkBudget[work].label;
+}
+
+bool LoopProfiler::mayRun(loopwork_t work) {
+  if (micros() - passStart + loopWorkBudget[work].budget <= LOOP_PASS_BUDGET) {
+    return true;
+  }
+  shed[work]++;
+  return false;
+}
+
+void LoopProfiler::summary(loopstage_t loopStage, char *outputStr, size_t size) {
+  stage[loopStage].summary(outputStr, size);
+}
+
+void LoopProfiler::reset() {
+  for (int i = 0; i < NR_OF_LOOP_STAGES; i++) {
+    stage[i].reset();
+  }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Latency histogram per stage of loop(), in us. Buckets are logarithmic with
+// 4 sub-buckets per power of 2, so percentiles are accurate to within 25%.
+#define LOOP_PROFILER_EXACT_BUCKETS (8)   // 0 - 7 us are counted exactly
+#define LOOP_PROFILER_MAX_MSB       (23)  // everything above 2^24 us (16.7 s) ends up in the last bucket
+#define LOOP_PROFILER_BUCKETS       (LOOP_PROFILER_EXACT_BUCKETS + (LOOP_PROFILER_MAX_MSB - 2) * 4)
+
+typedef enum {
+  STAGE_NODE,
+  STAGE_TEMPSENSORS,
+  STAGE_OLEDDISPLAY,
+  STAGE_COMPRESSOR,
+  STAGE_BUTTONS_OPTOCOUPLER,
+  STAGE_OILLEVELSENSOR,
+  STAGE_STATEMACHINE,
+  NR_OF_LOOP_STAGES
+} loopstage_t;
+
+// Load shedding: a pass of loop() has a budget of LOOP_PASS_BUDGET us. The
+// low priority work below has a budget of its own (see LoopProfiler.cpp) and
+// is skipped when the pass has less left than that, after a stalled
+// node.loop() for instance; it is done again in a later pass. All other work,
+// the sensors, the compressor with the safety checks, the buttons and the
+// state machine, always runs.
+#define LOOP_PASS_BUDGET (5000) // in us
+
+typedef enum {
+  WORK_DISPLAY, // the display snapshot, the display task keeps showing the previous one
+  WORK_STATUS_LOG, // the LOGGING_TIME_WINDOW dump, deferred
+  WORK_CALIBRATION_LOG, // the info / calibration log, in a later pass
+  NR_OF_LOOP_WORK
+} loopwork_t;
+
+class LoopHistogram {
+private:
+  uint32_t buckets[LOOP_PROFILER_BUCKETS];
+  uint32_t count;
+  unsigned long maxTime;
+
+  static uint8_t bucketOf(unsigned long us);
+  static unsigned long bucketLimit(uint8_t bucket);
+
+public:
+  LoopHistogram();
+
+  void add(unsigned long us);
+
+  void reset();
+
+  uint32_t samples() { return count; }
+
+  unsigned long percentile(uint8_t pct); // upper limit of the bucket holding the pct-th percentile, in us
+
+  unsigned long maximum() { return maxTime; }
+
+  // "p50/p99/max" in us
+  void summary(char *outputStr, size_t size);
+};
+
+class LoopProfiler {
+private:
+  unsigned long passStart;
+  unsigned long lastMark;
+
+public:
+  LoopHistogram stage[NR_OF_LOOP_STAGES];
+  uint32_t shed[NR_OF_LOOP_WORK]; // since boot
+
+  LoopProfiler();
+
+  // call at the start of loop()
+  void begin() {
+    passStart = micros();
+    lastMark = passStart;
+  }
+
+  // call at the end of each stage; the time since the previous mark is booked on this stage
+  void mark(loopstage_t loopStage) {
+    unsigned long now = micros();
+    stage[loopStage].add(now - lastMark);
+    lastMark = now;
+  }
+
+  const char *label(loopstage_t loopStage);
+  const char *label(loopwork_t work);
+
+  // false if the work does not fit in what is left of LOOP_PASS_BUDGET, it is counted as shed
+  bool mayRun(loopwork_t work);
+
+  // "p50/p99/max" in us
+  void summary(loopstage_t loopStage, char *outputStr, size_t size);
+
+  void reset();
+};
+
+extern LoopProfiler theLoopProfiler;
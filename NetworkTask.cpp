@@ -0,0 +1,162 @@
+#include "NetworkTask.h"
+#include "LogRing.h"
+#include "LogEvent.h"
+
+NetworkTask theNetworkTask;
+
+// node.loop(), the report period and what the control loop and the log published
+void NetworkTask::service() {
+  networkmessage_t message;
+  uint32_t period = reportPeriod.load();
+
+  if ((period != 0) && (period != appliedReportPeriod)) {
+    node.set_report_period(period);
+    appliedReportPeriod = period;
+  }
+  node.loop();
+  counters.passes++;
+
+  while (messages.pop(&message)) {
+    if (message.text) {
+      node.send(message.topic, (const char *)message.payload);
+    } else {
+      node.send(message.topic, message.payload, message.length);
+    }
+  }
+
+  if (theLogRing.started()) {
+    const char *logBatch = theLogRing.pendingMqttBatch();
+    size_t eventBatchLength;
+    const uint8_t *eventBatch = theLogRing.pendingEventBatch(&eventBatchLength);
+
+    if (logBatch != NULL) {
+      node.send(LOG_MQTT_TOPIC, logBatch, true);
+    }
+    if (eventBatch != NULL) {
+      node.send(LOG_EVENT_MQTT_TOPIC, eventBatch, eventBatchLength);
+    }
+    if ((logBatch != NULL) || (eventBatch != NULL)) {
+      theLogRing.mqttBatchSent();
+    }
+  }
+}
+
+void NetworkTask::networkTask(void *parameter) {
+  NetworkTask *network = (NetworkTask *)parameter;
+
+  while (true) {
+    network->service();
+    vTaskDelay(pdMS_TO_TICKS(NETWORK_TASK_PERIOD));
+  }
+}
+
+void NetworkTask::begin(bool useTask) {
+  if (!useTask || taskIsRunning) {
+    return;
+  }
+  taskIsRunning = true;
+  if (xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, this, NETWORK_TASK_PRIORITY, &task, NETWORK_TASK_CORE) != pdPASS) {
+    taskIsRunning = false;
+    return;
+  }
+  // ACNode logs from the task as well
+  theLogRing.addProducer(task);
+}
+
+void NetworkTask::loop() {
+  if (!taskIsRunning) {
+    service();
+  }
+}
+
+void NetworkTask::post(const networkevent_t &event) {
+  if (events.push(event)) {
+    counters.events++;
+  } else {
+    counters.eventsLost++;
+  }
+}
+
+void NetworkTask::postEvent(networkeventtype_t type) {
+  networkevent_t event;
+
+  event.type = type;
+  event.report = 0;
+  event.command[0] = 0;
+  post(event);
+}
+
+void NetworkTask::postError(acnode_error_t error) {
+  networkevent_t event;
+
+  event.type = NETWORK_ERROR;
+  event.error = error;
+  event.report = 0;
+  event.command[0] = 0;
+  post(event);
+}
+
+void NetworkTask::postReport(uint32_t report) {
+  networkevent_t event;
+
+  event.type = NETWORK_REPORTED;
+  event.report = report;
+  event.command[0] = 0;
+  post(event);
+}
+
+void NetworkTask::postCommand(const char *command, const char *rest) {
+  networkevent_t event;
+  size_t length = strlen(command);
+
+  if (rest == NULL) {
+    rest = "";
+  }
+  if (length + 1 + strlen(rest) + 1 > NETWORK_COMMAND_SIZE) {
+    counters.eventsLost++;
+    return;
+  }
+  event.type = NETWORK_COMMAND;
+  event.report = 0;
+  strcpy(event.command, command);
+  strcpy(&event.command[length + 1], rest);
+  post(event);
+}
+
+bool NetworkTask::nextEvent(networkevent_t *event) {
+  return events.pop(event);
+}
+
+void NetworkTask::queue(const char *topic, const uint8_t *payload, size_t length, bool text) {
+  networkmessage_t message;
+
+  if ((strlen(topic) >= NETWORK_TOPIC_SIZE) || (length > NETWORK_MESSAGE_SIZE)) {
+    counters.messagesLost++;
+    return;
+  }
+  strcpy(message.topic, topic);
+  message.text = text;
+  message.length = length;
+  memcpy(message.payload, payload, length);
+  if (messages.push(message)) {
+    counters.messages++;
+  } else {
+    counters.messagesLost++;
+  }
+}
+
+void NetworkTask::send(const char *topic, const uint8_t *payload, size_t length) {
+  if (!taskIsRunning || inTask()) {
+    node.send(topic, payload, length);
+  } else {
+    queue(topic, payload, length, false);
+  }
+}
+
+void NetworkTask::send(const char *topic, const char *payload) {
+  if (!taskIsRunning || inTask()) {
+    node.send(topic, payload);
+  } else {
+    queue(topic, (const uint8_t *)payload, strlen(payload) + 1, true);
+  }
+}
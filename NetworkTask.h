@@ -0,0 +1,110 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include "TaskChannels.h"
+
+// Networking task: node.loop() with Ethernet, MQTT, telnet and OTA runs in its
+// own task on core 0, the sensors, the state machine and the relay stay in
+// loop() on core 1, so a reconnect or a slow broker no longer shows up in the
+// time a pass of loop() takes. The two sides share the node only through lock
+// free channels (TaskChannels.h):
+//
+//   events    network -> control: connected, disconnected, error, the commands
+//             of onValidatedCmd() and the reports sent by onReport()
+//   messages  control -> network: the MQTT messages of the control loop
+//             (change reports, history pages), published by the task
+//
+// The values of the report are a snapshot published by the control loop, see
+// main.cpp. The log batches of theLogRing are published by the task too.
+//
+// Without the task (it could not be started, or the log is not asynchronous)
+// node.loop() runs from loop() as before, send() publishes at once and the
+// events are handled in the same pass.
+#define NETWORK_TASK_PRIORITY (1) // as loop() on the other core
+#define NETWORK_TASK_CORE (0)
+#define NETWORK_TASK_STACK (8192) // in bytes, the MQTT, telnet and OTA handling of ACNode
+#define NETWORK_TASK_PERIOD (1) // in ms, between passes of node.loop()
+#define NETWORK_EVENTS (8)
+#define NETWORK_MESSAGES (8)
+#define NETWORK_MESSAGE_SIZE (320) // in bytes, a history page
+#define NETWORK_TOPIC_SIZE (16)
+#define NETWORK_COMMAND_SIZE (64) // in bytes, the command and the rest of the line
+
+typedef enum {
+  NETWORK_CONNECTED,
+  NETWORK_DISCONNECTED,
+  NETWORK_ERROR,
+  NETWORK_COMMAND,
+  NETWORK_REPORTED
+} networkeventtype_t;
+
+typedef struct {
+  networkeventtype_t type;
+  acnode_error_t error; // NETWORK_ERROR
+  uint32_t report; // NETWORK_REPORTED: the number of the report snapshot sent as CBOR, 0 if none was sent
+  char command[NETWORK_COMMAND_SIZE]; // NETWORK_COMMAND: the command, a 0, the rest
+} networkevent_t;
+
+typedef struct {
+  char topic[NETWORK_TOPIC_SIZE];
+  bool text; // published as a string, the payload ends with a 0
+  uint16_t length;
+  uint8_t payload[NETWORK_MESSAGE_SIZE];
+} networkmessage_t;
+
+typedef struct {
+  uint32_t passes; // of node.loop()
+  uint32_t events;
+  uint32_t eventsLost; // the ring was full, the control loop did not keep up
+  uint32_t messages;
+  uint32_t messagesLost; // the ring was full or the message too long
+} networkcounters_t;
+
+class NetworkTask {
+private:
+  SpscRing<networkevent_t, NETWORK_EVENTS> events;
+  SpscRing<networkmessage_t, NETWORK_MESSAGES> messages;
+  std::atomic<uint32_t> reportPeriod { 0 }; // in ms, 0 until the control loop sets one
+  uint32_t appliedReportPeriod = 0;
+  TaskHandle_t task = NULL;
+  bool taskIsRunning = false;
+
+  static void networkTask(void *parameter);
+  void service();
+  void post(const networkevent_t &event);
+  void queue(const char *topic, const uint8_t *payload, size_t length, bool text);
+  bool inTask() { return taskIsRunning && (xTaskGetCurrentTaskHandle() == task); }
+
+public:
+  networkcounters_t counters = { 0, 0, 0, 0, 0 };
+
+  // after node.begin(); useTask false keeps node.loop() in loop()
+  void begin(bool useTask);
+
+  bool taskRunning() { return taskIsRunning; }
+
+  // from loop(): node.loop() and what it published, without the task
+  void loop();
+
+  // network side, from the callbacks of the node
+  void postEvent(networkeventtype_t type);
+  void postError(acnode_error_t error);
+  void postCommand(const char *command, const char *rest);
+  void postReport(uint32_t report);
+
+  // control side: the next event, false if there is none
+  bool nextEvent(networkevent_t *event);
+
+  // publishes on the node, from the task; at once without the task or when called by the task
+  void send(const char *topic, const uint8_t *payload, size_t length);
+  void send(const char *topic, const char *payload);
+
+  // the report period of the node, applied by the task
+  void setReportPeriod(unsigned long period) { reportPeriod = period; }
+};
+
+extern NetworkTask theNetworkTask;
@@ -1,7 +1,10 @@
 #include "OilLevelSensor.h"
 #include "OledDisplay.h"
-#include <ButtonDebounce.h>
+#include "InputCapture.h"
 #include <ACNode.h>
+#include "LogEvent.h"
+#include "TimerWheel.h"
+#include "FaultMask.h"
 
 #ifndef OILLEVELSENSOR
 #define OILLEVELSENSOR  (39)  // digital input
@@ -11,12 +14,18 @@
 #define TO_LOW_OIL_LEVEL (LOW) // the input level of the GPIO port used for the oil level sensor signalling too low oil level
 #define MAX_OIL_LEVEL_IS_TOO_LOW_WINDOW (10000) // in ms default 10000 = 10 seconds. Error is signalled after this time window is passed
 
-ButtonDebounce oilLevel(OILLEVELSENSOR, 300 /* mSeconds */); // to signal if the oil level is too low (or not)
+CapturedInput oilLevel(OILLEVELSENSOR, INPUT_SETTLE, 300 /* mSeconds */); // to signal if the oil level is too low (or not)
 
 bool oilLevelIsTooLow = false;
-bool waitForError = false;
-unsigned long oilLevelIsTooLowStart = 0;
 bool ErrorOilLevelIsTooLow = false;
+wheeltimer_t oilLevelErrorTimer; // the oil level is too low for MAX_OIL_LEVEL_IS_TOO_LOW_WINDOW
+
+void oilLevelError(void *context) {
+  ErrorOilLevelIsTooLow = true;
+  theFaults.set(FAULT_OIL_LEVEL, true);
+  nextTimeDisplay = true;
+  logEvent(EVENT_OIL_LEVEL_ERROR);
+}
 
 OilLevelSensor::OilLevelSensor() {
   return;
@@ -30,37 +39,27 @@ void OilLevelSensor::begin() {
     if (oilLevel.state() == TO_LOW_OIL_LEVEL) {
       nextTimeDisplay = true;
       oilLevelIsTooLow = true;
-      oilLevelIsTooLowStart = millis();
-      waitForError = true;
-      Log.println("Warning: Oil level is too low; Compressor will be disabled soon if this issue is not solved; Please verify the oil level and fill up if needed");
+      theTimerWheel.start(&oilLevelErrorTimer, MAX_OIL_LEVEL_IS_TOO_LOW_WINDOW, 0, oilLevelError, NULL);
+      logEvent(EVENT_OIL_LEVEL_WARNING);
     } else {
       if (ErrorOilLevelIsTooLow) {
-        Log.println("SOLVED: Oil level error!");
+        logEvent(EVENT_OIL_LEVEL_SOLVED);
         nextTimeDisplay = true;
       } else {
         if (oilLevelIsTooLow) {
-          Log.println("Oil level OK now!");
+          logEvent(EVENT_OIL_LEVEL_OK_NOW);
           nextTimeDisplay = true;
       }
       }
       oilLevelIsTooLow = false;
-      oilLevelIsTooLowStart = 0;
       ErrorOilLevelIsTooLow = false;
-      waitForError = false;
+      theFaults.set(FAULT_OIL_LEVEL, false);
+      theTimerWheel.stop(&oilLevelErrorTimer);
     }
   });
 }
 
+// the input is handled by theInputCapture and the error window by theTimerWheel
 void OilLevelSensor::loop() {
-  oilLevel.update();
-  
-  if (waitForError) {
-    if ((millis() - oilLevelIsTooLowStart) >= MAX_OIL_LEVEL_IS_TOO_LOW_WINDOW) {
-      waitForError = false;
-      ErrorOilLevelIsTooLow = true;
-      nextTimeDisplay = true;
-      Log.println("ERROR: Oil level is too low; Compressor will be disabled; Please maintain the compressor by filling up the oil");
-    }
-  }
 }
 
@@ -1,6 +1,9 @@
 #include "OledDisplay.h"
 
 #include <U8x8lib.h> // install U8g2 library by oliver
+#include <freertos/task.h>
+#include "FixedFormat.h"
+#include "TimerWheel.h"
 
 // for I2C display
 #ifndef I2C_SDA
@@ -12,9 +15,29 @@
 
 // oled display
 #define DISPLAY_WINDOW (1000) // in ms, update display time
+#define DISPLAY_I2C_CLOCK (400000) // in Hz, hardware I2C
+
+// display task, on the protocol core so that it never delays the control loop
+#define DISPLAY_TASK_PERIOD (100) // in ms
+#define DISPLAY_TASK_PRIORITY (1) // lowest above idle
+#define DISPLAY_TASK_CORE (0)
+#define DISPLAY_TASK_STACK (4096) // in bytes
+#define DISPLAY_STATUS_QUEUE_LENGTH (8)
+
+#define DISPLAY_DEGREES_C " \260C" // degree sign (176) of the extended fonts
+
+// temperature lines of the normal display, with more sensors the lines page through all sensors
+#define DISPLAY_TEMP_LINES (2)
+#define DISPLAY_TEMP_FIRST_LINE (5)
+#define DISPLAY_TEMP_PAGE_TIME (3000) // in ms
 
 #define KEEP_STATUS_LINE_TIME (5000) // in ms, default = 5 s (5000), the time certain status messages are shown on the bottom line of the display
 
+// shadow of the tiles on the panel, only tiles that change are sent
+#define DISPLAY_COLS (16) // in tiles
+#define DISPLAY_ROWS (16) // in tiles
+#define DISPLAY_TILE_BYTES (32) // 8x8 pixels, 4 bit greyscale
+
 typedef enum {
   NORMALDISPLAY,        // Normal display shown when there is no error, showing current compressor state etc.
   ERRORDISPLAY
@@ -24,7 +47,7 @@ struct {
   const char * statusmessage;
   int y;
   bool temporarily;
-} dispstatus[ERRORHIGHTEMP2 + 1] = 
+} dispstatus[ERRORHIGHTEMP + 1] = 
 {
 	{ "                ", 15, false },
 	{ "Release button  ", 15, false },
@@ -43,29 +66,29 @@ struct {
 	{ "OilLevel OK!    ", 7, false },
 	{ "Warning         ", 15, false },
 	{ "ERROR           ", 15, false },
-	{ "Warning         ", 15, false },
-	{ "ERROR           ", 15, false },
 };
 
-bool nextTimeDisplay = true;
+std::atomic<bool> nextTimeDisplay { true };
 
 bool showStatusTemporarily = false;
-unsigned long clearStatusLineTime = 0;
+uint64_t clearStatusLineTime = 0; // uptimeMs()
 
 machinestates_t laststateDisplayed = BOOTING;
 
 displaystates_t currentDisplayState = NORMALDISPLAY;
-unsigned long updateDisplayTime = 0;
+uint64_t updateDisplayTime = 0; // uptimeMs()
 
 bool lastOilLevelDisplayed = false;
 
-float lastTempDisplayed1 = -500;
-float lastTempDisplayed2 = -500;
+// per temperature line of the display: the sensor (index in the snapshot) and its value
+float lastTempDisplayed[DISPLAY_TEMP_LINES] = { -500, -500 };
+int lastTempSensorDisplayed[DISPLAY_TEMP_LINES] = { -1, -1 };
+uint8_t tempPage = 0;
+uint64_t nextTempPageTime = 0; // uptimeMs()
 
-bool previousTempIsHigh1 = false;
-bool previousErrorTempIsTooHigh1 = false;
-bool previousTempIsHigh2 = false;
-bool previousErrorTempIsTooHigh2 = false;
+bool previousTempIsHigh = false;
+bool previousErrorTempIsTooHigh = false;
+uint32_t previousErrorTempSensors = 0; // bit per sensor
 
 bool previousErrorOilLevelIsTooLow = false;
 float lastPressureDisplayed = -1;
@@ -76,135 +99,270 @@ float runningTime = 0.0;
 float lastRunningDisplayed = 0.0;
 
 // for 1.5 inch OLED Display 128*128 pixels wit - I2C
-U8X8_SSD1327_WS_128X128_SW_I2C u8x8(I2C_SCL, I2C_SDA, U8X8_PIN_NONE);
+U8X8_SSD1327_WS_128X128_HW_I2C u8x8(U8X8_PIN_NONE, I2C_SCL, I2C_SDA);
 
-OledDisplay::OledDisplay() {
-  return;
+// what each tile of the panel shows: a part of a glyph of a font, blank is a space without font
+typedef struct {
+  const uint8_t *font;
+  uint8_t glyph;
+  uint8_t part; // tile within the glyph, row * glyph width + column
+} displaytile_t;
+
+displaytile_t shadowTiles[DISPLAY_ROWS][DISPLAY_COLS];
+const uint8_t *currentFont = NULL;
+
+displaytraffic_t displayTraffic = { 0, 0, 0, 0, 0 };
+uint32_t frameBytesSent = 0;
+
+void setDisplayFont(const uint8_t *font) {
+  currentFont = font;
+  u8x8.setFont(font);
 }
 
-void OledDisplay::begin(float tempIsHighLevel1, float tempIsTooHighLevel1, float tempIsHighLevel2, float tempIsTooHighLevel2) {
-// for 1.5 inch OLED Display 128*128 pixels wit - I2C
-  pinMode(I2C_SDA, OUTPUT);
-  pinMode(I2C_SCL, OUTPUT);
-  digitalWrite(I2C_SDA, 0);
-  digitalWrite(I2C_SCL, 0);
+void resetDisplayTiles() {
+  u8x8.clearDisplay();
+  memset(shadowTiles, 0, sizeof(shadowTiles));
+  for (uint8_t y = 0; y < DISPLAY_ROWS; y++) {
+    for (uint8_t x = 0; x < DISPLAY_COLS; x++) {
+      shadowTiles[y][x].glyph = ' ';
+    }
+  }
+  displayTraffic.bytesDrawn += DISPLAY_ROWS * DISPLAY_COLS * DISPLAY_TILE_BYTES;
+  displayTraffic.bytesSent += DISPLAY_ROWS * DISPLAY_COLS * DISPLAY_TILE_BYTES;
+  frameBytesSent += DISPLAY_ROWS * DISPLAY_COLS * DISPLAY_TILE_BYTES;
+}
+
+// replaces u8x8.drawString: the characters whose tiles differ from the shadow
+// are sent in runs, the other characters are already on the panel
+void drawDisplayString(uint8_t x, uint8_t y, const char *s) {
+  uint8_t w = currentFont[2];
+  uint8_t h = currentFont[3];
+  char run[DISPLAY_COLS + 1];
+  uint8_t runLength = 0;
+  uint8_t runX = x;
+  displaytile_t tile;
+  bool dirty;
+
+  for (; *s && (x + w <= DISPLAY_COLS); s++, x += w) {
+    dirty = false;
+    for (uint8_t dy = 0; (dy < h) && (y + dy < DISPLAY_ROWS); dy++) {
+      for (uint8_t dx = 0; dx < w; dx++) {
+        tile.font = (*s == ' ') ? NULL : currentFont;
+        tile.glyph = *s;
+        tile.part = (*s == ' ') ? 0 : dy * w + dx;
+        displaytile_t *shadow = &shadowTiles[y + dy][x + dx];
+        if ((shadow->font != tile.font) || (shadow->glyph != tile.glyph) || (shadow->part != tile.part)) {
+          *shadow = tile;
+          dirty = true;
+        }
+      }
+    }
+    displayTraffic.bytesDrawn += w * h * DISPLAY_TILE_BYTES;
+    if (dirty) {
+      if (runLength == 0) {
+        runX = x;
+      }
+      run[runLength++] = *s;
+    } else if (runLength > 0) {
+      run[runLength] = 0;
+      u8x8.drawString(runX, y, run);
+      displayTraffic.bytesSent += runLength * w * h * DISPLAY_TILE_BYTES;
+      frameBytesSent += runLength * w * h * DISPLAY_TILE_BYTES;
+      runLength = 0;
+    }
+  }
+  if (runLength > 0) {
+    run[runLength] = 0;
+    u8x8.drawString(runX, y, run);
+    displayTraffic.bytesSent += runLength * w * h * DISPLAY_TILE_BYTES;
+    frameBytesSent += runLength * w * h * DISPLAY_TILE_BYTES;
+  }
+}
+
+// replaces u8x8.clearDisplay: only the tiles that are not blank yet are cleared
+void clearDisplayTiles() {
+  const uint8_t *font = currentFont;
+  char blankRow[DISPLAY_COLS + 1];
+
+  memset(blankRow, ' ', DISPLAY_COLS);
+  blankRow[DISPLAY_COLS] = 0;
+  setDisplayFont(u8x8_font_chroma48medium8_r);
+  for (uint8_t y = 0; y < DISPLAY_ROWS; y++) {
+    drawDisplayString(0, y, blankRow);
+  }
+  setDisplayFont(font);
+}
 
-  theTempIsHighLevel1 = tempIsHighLevel1;
-  theTempIsTooHighLevel1 = tempIsTooHighLevel1;
-  theTempIsHighLevel2 = tempIsHighLevel2;
-  theTempIsTooHighLevel2 = tempIsTooHighLevel2;
+// called at the start of every DISPLAY_WINDOW update
+void nextDisplayFrame() {
+  displayTraffic.frames++;
+  displayTraffic.lastFrameBytesSent = frameBytesSent;
+  if (frameBytesSent > displayTraffic.maxFrameBytesSent) {
+    displayTraffic.maxFrameBytesSent = frameBytesSent;
+  }
+  frameBytesSent = 0;
+}
+
+OledDisplay::OledDisplay() {
+  return;
+}
 
+void OledDisplay::begin() {
+  u8x8.setBusClock(DISPLAY_I2C_CLOCK);
   u8x8.begin();
-  u8x8.clear();
+  resetDisplayTiles();
   u8x8.setCursor(0, 0);
 
-  u8x8.setFont(u8x8_font_px437wyse700a_2x2_r);
+  setDisplayFont(u8x8_font_px437wyse700a_2x2_r);
 
-  u8x8.drawString(0, 0, "CompNode");
+  drawDisplayString(0, 0, "CompNode");
 
-  u8x8.setFont(u8x8_font_px437wyse700b_2x2_r);
-  u8x8.drawString(0, 2, SOFTWARE_VERSION);
+  setDisplayFont(u8x8_font_px437wyse700b_2x2_r);
+  drawDisplayString(0, 2, SOFTWARE_VERSION);
 
-  u8x8.setFont(u8x8_font_chroma48medium8_r);
-  u8x8.drawString(0, 4, " c Hans Beerman ");
-  u8x8.drawString(0, 6, "Booting, please ");
-  u8x8.drawString(0, 7, "      wait      ");
+  setDisplayFont(u8x8_font_chroma48medium8_r);
+  drawDisplayString(0, 4, " c Hans Beerman ");
+  drawDisplayString(0, 6, "Booting, please ");
+  drawDisplayString(0, 7, "      wait      ");
 }
 
 void OledDisplay::clearDisplay() {
-  u8x8.clearDisplay();
+  clearDisplayTiles();
 }
 
 void OledDisplay::showStatus(statusdisplay_t statusMessage) {
+  if (taskIsRunning) {
+    // a full queue drops the message, the next status overwrites it anyway
+    xQueueSend(statusQueue, &statusMessage, 0);
+  } else {
+    renderStatus(statusMessage);
+  }
+}
+
+void OledDisplay::renderStatus(statusdisplay_t statusMessage, const displaytemperature_t *temp) {
   char outputStr[20];
+  char prefixStr[12];
 
   switch (statusMessage) {
     case NOSTATUS:
     case ERRORLOWOILLEVEL:
     case NOLOWOILLEVEL:
-      u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-      u8x8.drawString(0, dispstatus[statusMessage].y, dispstatus[statusMessage].statusmessage);
-      break;
-    case WARNINGHIGHTEMP1:
-      u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-      sprintf(outputStr, "WARNING >%4.0f %cC", theTempIsHighLevel1, 176);
-      u8x8.drawString(0, dispstatus[statusMessage].y, outputStr);
+      setDisplayFont(u8x8_font_amstrad_cpc_extended_f);
+      drawDisplayString(0, dispstatus[statusMessage].y, dispstatus[statusMessage].statusmessage);
       break;
-    case ERRORHIGHTEMP1:
-      u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-      sprintf(outputStr, "ERROR 1 >%4.0f %cC", theTempIsTooHighLevel1, 176);
-      u8x8.drawString(0, dispstatus[statusMessage].y, outputStr);
-      break;
-    case WARNINGHIGHTEMP2:
-      u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-      sprintf(outputStr, "WARNING >%4.0f %cC", theTempIsHighLevel2, 176);
-      u8x8.drawString(0, dispstatus[statusMessage].y, outputStr);
+    case WARNINGHIGHTEMP:
+      if (temp == NULL) {
+        setDisplayFont(u8x8_font_chroma48medium8_r);
+        drawDisplayString(0, dispstatus[statusMessage].y, dispstatus[statusMessage].statusmessage);
+        break;
+      }
+      setDisplayFont(u8x8_font_amstrad_cpc_extended_f);
+      formatFixed(outputStr, "WARNING >", temp->tempIsHighLevel, 4, 0, DISPLAY_DEGREES_C);
+      drawDisplayString(0, dispstatus[statusMessage].y, outputStr);
       break;
-    case ERRORHIGHTEMP2:
-      u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-      sprintf(outputStr, "ERROR 2 >%4.0f %cC", theTempIsTooHighLevel2, 176);
-      u8x8.drawString(0, dispstatus[statusMessage].y, outputStr);
+    case ERRORHIGHTEMP:
+      if (temp == NULL) {
+        setDisplayFont(u8x8_font_chroma48medium8_r);
+        drawDisplayString(0, dispstatus[statusMessage].y, dispstatus[statusMessage].statusmessage);
+        break;
+      }
+      setDisplayFont(u8x8_font_amstrad_cpc_extended_f);
+      sprintf(prefixStr, "ERROR %d >", temp->number);
+      formatFixed(outputStr, prefixStr, temp->tempIsTooHighLevel, 4, 0, DISPLAY_DEGREES_C);
+      drawDisplayString(0, dispstatus[statusMessage].y, outputStr);
       break;
     default:
-      u8x8.setFont(u8x8_font_chroma48medium8_r);
-      u8x8.drawString(0, dispstatus[statusMessage].y, dispstatus[statusMessage].statusmessage);
+      setDisplayFont(u8x8_font_chroma48medium8_r);
+      drawDisplayString(0, dispstatus[statusMessage].y, dispstatus[statusMessage].statusmessage);
       break;
   }
   
   showStatusTemporarily = dispstatus[statusMessage].temporarily;
-  clearStatusLineTime = millis() + KEEP_STATUS_LINE_TIME;
+  clearStatusLineTime = uptimeMs() + KEEP_STATUS_LINE_TIME;
 }
 
 void OledDisplay::clearEEPromWarning() {
-  u8x8.setFont(u8x8_font_chroma48medium8_r);
-  u8x8.drawString(0, 9, "Keep Olimex BUT2");
-  u8x8.drawString(0, 10, "pressed for at  ");
-  u8x8.drawString(0, 11, "least 4 seconds ");
-  u8x8.drawString(0, 12, "to clear EEProm ");
-  u8x8.drawString(0, 13, "and cache memory");
+  setDisplayFont(u8x8_font_chroma48medium8_r);
+  drawDisplayString(0, 9, "Keep Olimex BUT2");
+  drawDisplayString(0, 10, "pressed for at  ");
+  drawDisplayString(0, 11, "least 4 seconds ");
+  drawDisplayString(0, 12, "to clear EEProm ");
+  drawDisplayString(0, 13, "and cache memory");
 }
 
 void OledDisplay::clearEEPromMessage() {
-  u8x8.setFont(u8x8_font_chroma48medium8_r);
-  u8x8.drawString(0, 9, "EEProm and cache");
-  u8x8.drawString(0, 10, "will be cleared ");
-  u8x8.drawString(0, 11, "                ");
-  u8x8.drawString(0, 12, "                ");
-  u8x8.drawString(0, 13, "                ");
+  setDisplayFont(u8x8_font_chroma48medium8_r);
+  drawDisplayString(0, 9, "EEProm and cache");
+  drawDisplayString(0, 10, "will be cleared ");
+  drawDisplayString(0, 11, "                ");
+  drawDisplayString(0, 12, "                ");
+  drawDisplayString(0, 13, "                ");
 }
 
 void OledDisplay::EEPromCleared() {
-  u8x8.setFont(u8x8_font_chroma48medium8_r);
-  u8x8.drawString(0, 12, "EEProm cleared  ");
+  setDisplayFont(u8x8_font_chroma48medium8_r);
+  drawDisplayString(0, 12, "EEProm cleared  ");
 }
 
 void OledDisplay::cacheCleared() {
-  u8x8.setFont(u8x8_font_chroma48medium8_r);
-  u8x8.drawString(0, 13, "Cache cleared   ");
+  setDisplayFont(u8x8_font_chroma48medium8_r);
+  drawDisplayString(0, 13, "Cache cleared   ");
 }
 
-void OledDisplay::loop(bool oilLevelIsTooLow, bool ErrorOilLevelIsTooLow, float temperature1, bool tempIsHigh1, 
-                      bool ErrorTempIsTooHigh1, float temperature2, bool tempIsHigh2, bool ErrorTempIsTooHigh2, bool ErrorPressureIsToHigh,
-                      float pressure, machinestates_t machinestate,
-                      unsigned long powered_total, unsigned long powered_last,
-                      unsigned long running_total, unsigned long running_last) {
+// "Temp<n>:  21.50 °C", 16 characters
+static void formatTemperatureLine(char *outputStr, const displaytemperature_t *temp) {
+  char prefixStr[12];
 
+  sprintf(prefixStr, "Temp%d:", temp->number);
+  if (temp->temperature < -100) {
+    formatString(formatString(outputStr, prefixStr), " N.A.     ");
+  } else {
+    formatFixed(outputStr, prefixStr, temp->temperature, 7, 2, DISPLAY_DEGREES_C);
+  }
+}
+
+void OledDisplay::render(const displaysnapshot_t *snapshot) {
+  bool oilLevelIsTooLow = snapshot->oilLevelIsTooLow;
+  bool ErrorOilLevelIsTooLow = snapshot->ErrorOilLevelIsTooLow;
+  bool ErrorPressureIsToHigh = snapshot->ErrorPressureIsTooHigh;
+  float pressure = snapshot->pressure;
+  machinestates_t machinestate = snapshot->machinestate;
+  unsigned long powered_total = snapshot->powered_total;
+  unsigned long powered_last = snapshot->powered_last;
+  unsigned long running_total = snapshot->running_total;
+  unsigned long running_last = snapshot->running_last;
   char outputStr[20];
-  bool temp1PrintAll = false;
-  bool temp2PrintAll = false;
+  // the first sensor with a warning and with an error, shown on the status line
+  const displaytemperature_t *warmSensor = NULL;
+  const displaytemperature_t *hotSensor = NULL;
+  uint32_t errorTempSensors = 0;
+  uint8_t nrOfErrorTempSensors = 0;
+  uint8_t line;
+  int index;
+
+  for (uint8_t i = 0; i < snapshot->nrOfTempSensors; i++) {
+    if (snapshot->temp[i].tempIsHigh && (warmSensor == NULL)) {
+      warmSensor = &snapshot->temp[i];
+    }
+    if (snapshot->temp[i].ErrorTempIsTooHigh) {
+      if (hotSensor == NULL) {
+        hotSensor = &snapshot->temp[i];
+      }
+      errorTempSensors |= 1UL << i;
+      nrOfErrorTempSensors++;
+    }
+  }
 
-  if (!ErrorOilLevelIsTooLow && !ErrorTempIsTooHigh1 && !ErrorTempIsTooHigh2) {
+  if (!ErrorOilLevelIsTooLow && (hotSensor == NULL)) {
     if (currentDisplayState == ERRORDISPLAY) {
       nextTimeDisplay = true;
-      previousTempIsHigh1 = !tempIsHigh1;
-      previousTempIsHigh2 = !tempIsHigh2;
-      u8x8.clearDisplay();
+      clearDisplayTiles();
       currentDisplayState = NORMALDISPLAY;
     }
   } else {
     if (currentDisplayState == NORMALDISPLAY) {
       nextTimeDisplay = true;
-      u8x8.clearDisplay();
+      clearDisplayTiles();
       currentDisplayState = ERRORDISPLAY;
     }
   }
@@ -212,108 +370,68 @@ void OledDisplay::loop(bool oilLevelIsTooLow, bool ErrorOilLevelIsTooLow, float
   switch (currentDisplayState)
   {
     case NORMALDISPLAY:
-      if (millis() > updateDisplayTime)
+      if (uptimeMs() > updateDisplayTime)
       {
-        updateDisplayTime = millis() + DISPLAY_WINDOW;
+        updateDisplayTime = uptimeMs() + DISPLAY_WINDOW;
+        nextDisplayFrame();
+        // set by the sensors from loop(), taken once per frame
+        bool redraw = nextTimeDisplay.exchange(false);
 
-        if ((pressure != lastPressureDisplayed) || nextTimeDisplay) {
+        if ((pressure != lastPressureDisplayed) || redraw) {
           lastPressureDisplayed = pressure;
-          u8x8.setFont(u8x8_font_px437wyse700b_2x2_f);
-          if (nextTimeDisplay) {
-            u8x8.drawString(0, 0, "Pressure");
-            sprintf(outputStr, "%4.1f bar", pressure); 
+          setDisplayFont(u8x8_font_px437wyse700b_2x2_f);
+          if (redraw) {
+            drawDisplayString(0, 0, "Pressure");
+            formatFixed(outputStr, "", pressure, 4, 1, " bar");
           } else {
-            sprintf(outputStr, "%4.1f", pressure); 
+            formatFixed(outputStr, pressure, 4, 1);
           }
-          u8x8.drawString(0, 2, outputStr);
+          drawDisplayString(0, 2, outputStr);
         }
-        if ((temperature1 != lastTempDisplayed1) || nextTimeDisplay) {
-          lastTempDisplayed1 = temperature1;
-          u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-          if (nextTimeDisplay) {
-            if (temperature1 < -100) {
-              sprintf(outputStr, "Temp1: N.A.     ");
-            } else {
-              sprintf(outputStr, "Temp1:%7.2f %cC", temperature1, 176);
-            }
-            u8x8.drawString(0, 5, outputStr);
-          } else {
-            if (temperature1 < -100) {
-              sprintf(outputStr, " N.A.     ");
-              temp1PrintAll = true;
-            } else {
-              if (temp1PrintAll) {
-                sprintf(outputStr, "%7.2f %cC", temperature1, 176);
-              } else {
-                sprintf(outputStr, "%7.2f", temperature1);
-              }
-              temp1PrintAll = false;
+        if ((snapshot->nrOfTempSensors > DISPLAY_TEMP_LINES) && (uptimeMs() > nextTempPageTime)) {
+          nextTempPageTime = uptimeMs() + DISPLAY_TEMP_PAGE_TIME;
+          tempPage = (tempPage + 1) % ((snapshot->nrOfTempSensors + DISPLAY_TEMP_LINES - 1) / DISPLAY_TEMP_LINES);
+        }
+        if (snapshot->nrOfTempSensors <= DISPLAY_TEMP_LINES) {
+          tempPage = 0;
+        }
+        setDisplayFont(u8x8_font_amstrad_cpc_extended_f);
+        for (line = 0; line < DISPLAY_TEMP_LINES; line++) {
+          index = tempPage * DISPLAY_TEMP_LINES + line;
+          if (index >= snapshot->nrOfTempSensors) {
+            if ((lastTempSensorDisplayed[line] != -1) || redraw) {
+              lastTempSensorDisplayed[line] = -1;
+              drawDisplayString(0, DISPLAY_TEMP_FIRST_LINE + line, "                ");
             }
-            u8x8.drawString(6, 5, outputStr);
+            continue;
           }
-          if ((previousTempIsHigh1 != tempIsHigh1) || (previousErrorTempIsTooHigh1 != ErrorTempIsTooHigh1) || nextTimeDisplay) {
-            if (ErrorTempIsTooHigh1) {
-              showStatus(ERRORHIGHTEMP1);
-            } else {
-              if (tempIsHigh1) {
-                showStatus(WARNINGHIGHTEMP1);
-              } else {
-                if (!tempIsHigh2) {
-                  showStatus(NOSTATUS);
-                }
-              }
-            }
-            previousErrorTempIsTooHigh1 = ErrorTempIsTooHigh1;  
-            previousTempIsHigh1 = tempIsHigh1;
+          if ((snapshot->temp[index].temperature != lastTempDisplayed[line]) || (index != lastTempSensorDisplayed[line]) || redraw) {
+            lastTempDisplayed[line] = snapshot->temp[index].temperature;
+            lastTempSensorDisplayed[line] = index;
+            formatTemperatureLine(outputStr, &snapshot->temp[index]);
+            drawDisplayString(0, DISPLAY_TEMP_FIRST_LINE + line, outputStr);
           }
         }
 
-        if ((temperature2 != lastTempDisplayed2) || nextTimeDisplay) {
-          lastTempDisplayed2 = temperature2;
-          u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-          if (nextTimeDisplay) {
-            if (temperature2 < -100) {
-              sprintf(outputStr, "Temp2: N.A.     ");
-            } else {
-              sprintf(outputStr, "Temp2:%7.2f %cC", temperature2, 176);
-            }
-            u8x8.drawString(0, 6, outputStr);
+        if ((previousTempIsHigh != (warmSensor != NULL)) || (previousErrorTempIsTooHigh != (hotSensor != NULL)) || redraw) {
+          if (hotSensor != NULL) {
+            renderStatus(ERRORHIGHTEMP, hotSensor);
           } else {
-            if (temperature2 < -100) {
-              sprintf(outputStr, " N.A.     ");
-              temp2PrintAll = true;
+            if (warmSensor != NULL) {
+              renderStatus(WARNINGHIGHTEMP, warmSensor);
             } else {
-              if (temp2PrintAll) {
-                sprintf(outputStr, "%7.2f %cC", temperature2, 176);
-              } else {
-                sprintf(outputStr, "%7.2f", temperature2);
-              }
-              temp2PrintAll = false;
-            }
-            u8x8.drawString(6, 6, outputStr);
-          }
-          if ((previousTempIsHigh2 != tempIsHigh2) || (previousErrorTempIsTooHigh2 != ErrorTempIsTooHigh2) || nextTimeDisplay) {
-            if (ErrorTempIsTooHigh2) {
-              showStatus(ERRORHIGHTEMP2);
-            } else {
-              if (tempIsHigh2) {
-                showStatus(WARNINGHIGHTEMP2);
-              } else {
-                if (!tempIsHigh1) {
-                  showStatus(NOSTATUS);
-                }
-              }
+              renderStatus(NOSTATUS);
             }
-            previousErrorTempIsTooHigh2 = ErrorTempIsTooHigh2;  
-            previousTempIsHigh2 = tempIsHigh2;
           }
+          previousErrorTempIsTooHigh = (hotSensor != NULL);
+          previousTempIsHigh = (warmSensor != NULL);
         }
 
-        if ((machinestate != laststateDisplayed)  || nextTimeDisplay) {
+        if ((machinestate != laststateDisplayed)  || redraw) {
           laststateDisplayed = machinestate;
-          u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-          if (nextTimeDisplay) {
-            u8x8.drawString(0, 9, "Machine state:  ");
+          setDisplayFont(u8x8_font_amstrad_cpc_extended_f);
+          if (redraw) {
+            drawDisplayString(0, 9, "Machine state:  ");
           }
           switch (machinestate) {
             case BOOTING:
@@ -341,76 +459,71 @@ void OledDisplay::loop(bool oilLevelIsTooLow, bool ErrorOilLevelIsTooLow, float
                 sprintf(outputStr, "Motor is running");
             break;
           }      
-          u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-          u8x8.drawString(0, 10, outputStr);
+          setDisplayFont(u8x8_font_amstrad_cpc_extended_f);
+          drawDisplayString(0, 10, outputStr);
         }
 
-        if ((oilLevelIsTooLow != lastOilLevelDisplayed) || nextTimeDisplay) {
+        if ((oilLevelIsTooLow != lastOilLevelDisplayed) || redraw) {
           lastOilLevelDisplayed = oilLevelIsTooLow;
           if (oilLevelIsTooLow) {
-            showStatus(ERRORLOWOILLEVEL);
+            renderStatus(ERRORLOWOILLEVEL);
           } else {
-            showStatus(NOLOWOILLEVEL);
+            renderStatus(NOLOWOILLEVEL);
           }
         }
 
-        if ((machinestate >= POWERED) || nextTimeDisplay) {
+        if ((machinestate >= POWERED) || redraw) {
           if (machinestate < POWERED) {
             poweredTime = (float)powered_total / 3600.0;
           } else {
             poweredTime = ((float)powered_total + ((float)millis() - float(powered_last)) / 1000.0) / 3600.0;
           }
 
-          if ((poweredTime != lastPoweredDisplayed) || nextTimeDisplay) {
+          if ((poweredTime != lastPoweredDisplayed) || redraw) {
             lastPoweredDisplayed = poweredTime;
-            u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-            if (nextTimeDisplay) {
-              sprintf(outputStr, "On: %9.2f hr", poweredTime);
-              u8x8.drawString(0, 12, outputStr);
+            setDisplayFont(u8x8_font_amstrad_cpc_extended_f);
+            if (redraw) {
+              formatFixed(outputStr, "On: ", poweredTime, 9, 2, " hr");
+              drawDisplayString(0, 12, outputStr);
             } else {
-              sprintf(outputStr, "%9.2f", poweredTime);
-              u8x8.drawString(4, 12, outputStr);
+              formatFixed(outputStr, poweredTime, 9, 2);
+              drawDisplayString(4, 12, outputStr);
             }
           }
         }
 
-        if ((machinestate == RUNNING) || nextTimeDisplay) {
+        if ((machinestate == RUNNING) || redraw) {
           if (machinestate < RUNNING) {
             runningTime = (float)running_total / 3600.0;
           } else {
             runningTime = ((float)running_total + ((float)millis() - (float)running_last) / 1000.0) / 3600.0;
           }
 
-          if ((runningTime != lastRunningDisplayed) || nextTimeDisplay) {
+          if ((runningTime != lastRunningDisplayed) || redraw) {
             lastRunningDisplayed = runningTime;
-            u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-            if (nextTimeDisplay) {
-              sprintf(outputStr, "Run:%9.2f hr", runningTime);
-              u8x8.drawString(0, 13, outputStr);
+            setDisplayFont(u8x8_font_amstrad_cpc_extended_f);
+            if (redraw) {
+              formatFixed(outputStr, "Run:", runningTime, 9, 2, " hr");
+              drawDisplayString(0, 13, outputStr);
             } else {
-              sprintf(outputStr, "%9.2f", runningTime);
-              u8x8.drawString(4, 13, outputStr);
+              formatFixed(outputStr, runningTime, 9, 2);
+              drawDisplayString(4, 13, outputStr);
             }
           }
         }
-        nextTimeDisplay = false;
       }
 
-      if (showStatusTemporarily && (millis() > clearStatusLineTime)) {
-        if (tempIsHigh1 || tempIsHigh2)  {
-          showStatus(WARNINGHIGHTEMP1);
+      if (showStatusTemporarily && (uptimeMs() > clearStatusLineTime)) {
+        if (warmSensor != NULL)  {
+          renderStatus(WARNINGHIGHTEMP, warmSensor);
         } else {
-          if (ErrorTempIsTooHigh1) {
-            showStatus(ERRORHIGHTEMP1);
+          if (hotSensor != NULL) {
+            renderStatus(ERRORHIGHTEMP, hotSensor);
           } else {
-            if (ErrorTempIsTooHigh2) {
-              showStatus(ERRORHIGHTEMP2);
+            if (ErrorPressureIsToHigh) {
+              renderStatus(ERRORPRESSUREISTOOHIGH);
             } else {
-              if (ErrorPressureIsToHigh) {
-                showStatus(ERRORPRESSUREISTOOHIGH);
-              } else {
-                showStatus(NOSTATUS);
-              }
+              renderStatus(NOSTATUS);
             }
           }
         }
@@ -419,80 +532,117 @@ void OledDisplay::loop(bool oilLevelIsTooLow, bool ErrorOilLevelIsTooLow, float
 
     break;
     case ERRORDISPLAY:
-      if (millis() > updateDisplayTime)
+      if (uptimeMs() > updateDisplayTime)
       {
-        updateDisplayTime = millis() + DISPLAY_WINDOW;
-        if (nextTimeDisplay) {
-          u8x8.setFont(u8x8_font_px437wyse700a_2x2_r);
-          u8x8.drawString(0, 0, "MAINTAIN");
-          u8x8.drawString(0, 2, "COMPRSR.");
-          u8x8.setFont(u8x8_font_px437wyse700a_2x2_r);
-          u8x8.drawString(0, 12, "COMPRSR.");  
-          u8x8.drawString(0, 14, "DISABLED");
+        updateDisplayTime = uptimeMs() + DISPLAY_WINDOW;
+        nextDisplayFrame();
+        bool redraw = nextTimeDisplay.exchange(false);
+        if (redraw) {
+          setDisplayFont(u8x8_font_px437wyse700a_2x2_r);
+          drawDisplayString(0, 0, "MAINTAIN");
+          drawDisplayString(0, 2, "COMPRSR.");
+          setDisplayFont(u8x8_font_px437wyse700a_2x2_r);
+          drawDisplayString(0, 12, "COMPRSR.");  
+          drawDisplayString(0, 14, "DISABLED");
         }
 
-        if ((previousErrorTempIsTooHigh1 != ErrorTempIsTooHigh1) || (previousErrorTempIsTooHigh2 != ErrorTempIsTooHigh2) || nextTimeDisplay) {
-          previousErrorTempIsTooHigh1 = ErrorTempIsTooHigh1;
-          previousErrorTempIsTooHigh2 = ErrorTempIsTooHigh2;
-          if ((ErrorTempIsTooHigh1) || (ErrorTempIsTooHigh2)) {
-            u8x8.setFont(u8x8_font_chroma48medium8_r);
-            if (!ErrorTempIsTooHigh2) {
-              u8x8.drawString(0, 8, "TEMPERATURE 1   ");
-              u8x8.drawString(0, 9, "IS TOO HIGH     ");
-            } else {
-              if (!ErrorTempIsTooHigh1) {
-                u8x8.drawString(0, 8, "TEMPERATURE 2   ");
-                u8x8.drawString(0, 9, "IS TOO HIGH     ");
-              } else {
-                u8x8.drawString(0, 8, "TEMPERATURE 1+2 ");
-                u8x8.drawString(0, 9, "ARE TOO HIGH    ");
+        if ((previousErrorTempSensors != errorTempSensors) || redraw) {
+          previousErrorTempSensors = errorTempSensors;
+          setDisplayFont(u8x8_font_chroma48medium8_r);
+          if (errorTempSensors != 0) {
+            // e.g. "TEMPERATURE 1+2 " "ARE TOO HIGH    "
+            char *end = formatString(outputStr, "TEMPERATURE");
+            char separator = ' ';
+            for (uint8_t i = 0; i < snapshot->nrOfTempSensors; i++) {
+              if ((errorTempSensors & (1UL << i)) && (end - outputStr + 2 <= DISPLAY_COLS)) {
+                end = formatChar(end, separator);
+                end = formatChar(end, '0' + snapshot->temp[i].number % 10);
+                separator = '+';
               }
             }
+            while (end - outputStr < DISPLAY_COLS) {
+              end = formatChar(end, ' ');
+            }
+            drawDisplayString(0, 8, outputStr);
+            drawDisplayString(0, 9, (nrOfErrorTempSensors == 1) ? "IS TOO HIGH     " : "ARE TOO HIGH    ");
           } else {
-            u8x8.setFont(u8x8_font_chroma48medium8_r);
-            u8x8.drawString(0, 8, "                ");
-            u8x8.drawString(0, 9, "                ");
+            drawDisplayString(0, 8, "                ");
+            drawDisplayString(0, 9, "                ");
           }
         }
 
-        if (ErrorTempIsTooHigh1) {
-          if ((temperature1 != lastTempDisplayed1) || nextTimeDisplay) {
-            lastTempDisplayed1 = temperature1;
-            u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-            sprintf(outputStr, "Temp1:%7.2f %cC", temperature1, 176);
-            u8x8.drawString(0, 10, outputStr);
+        // the first sensors that are too hot
+        index = 0;
+        setDisplayFont(u8x8_font_amstrad_cpc_extended_f);
+        for (line = 0; line < DISPLAY_TEMP_LINES; line++) {
+          while ((index < snapshot->nrOfTempSensors) && !(errorTempSensors & (1UL << index))) {
+            index++;
           }
-        } else {
-          u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-          u8x8.drawString(0, 10, "                ");
-        }
-
-        if (ErrorTempIsTooHigh2) {
-          if ((temperature2 != lastTempDisplayed2) || nextTimeDisplay) {
-            lastTempDisplayed2 = temperature2;
-            u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-            sprintf(outputStr, "Temp2:%7.2f %cC", temperature2, 176);
-            u8x8.drawString(0, 11, outputStr);
+          if (index >= snapshot->nrOfTempSensors) {
+            drawDisplayString(0, 10 + line, "                ");
+            lastTempSensorDisplayed[line] = -1;
+            continue;
           }
-        } else {
-          u8x8.setFont(u8x8_font_amstrad_cpc_extended_f);
-          u8x8.drawString(0, 11, "                ");
+          if ((snapshot->temp[index].temperature != lastTempDisplayed[line]) || (index != lastTempSensorDisplayed[line]) || redraw) {
+            lastTempDisplayed[line] = snapshot->temp[index].temperature;
+            lastTempSensorDisplayed[line] = index;
+            formatTemperatureLine(outputStr, &snapshot->temp[index]);
+            drawDisplayString(0, 10 + line, outputStr);
+          }
+          index++;
         }
 
-        if ((ErrorOilLevelIsTooLow != previousErrorOilLevelIsTooLow) || nextTimeDisplay) {
+        if ((ErrorOilLevelIsTooLow != previousErrorOilLevelIsTooLow) || redraw) {
           previousErrorOilLevelIsTooLow = ErrorOilLevelIsTooLow;
           if (ErrorOilLevelIsTooLow) {
-            u8x8.setFont(u8x8_font_chroma48medium8_r);
-            u8x8.drawString(0, 5, "OIL LEVEL       ");
-            u8x8.drawString(0, 6, "IS TOO LOW      ");
+            setDisplayFont(u8x8_font_chroma48medium8_r);
+            drawDisplayString(0, 5, "OIL LEVEL       ");
+            drawDisplayString(0, 6, "IS TOO LOW      ");
           } else {
-            u8x8.setFont(u8x8_font_chroma48medium8_r);
-            u8x8.drawString(0, 5, "                ");
-            u8x8.drawString(0, 6, "                ");
+            setDisplayFont(u8x8_font_chroma48medium8_r);
+            drawDisplayString(0, 5, "                ");
+            drawDisplayString(0, 6, "                ");
           }
         }
-        nextTimeDisplay = false;
       }
     break;
   }
 }
+
+void OledDisplay::publish(const displaysnapshot_t *snapshot) {
+  snapshots.publish(*snapshot);
+  // without the display task (it could not be started) loop() draws it
+  if (!taskIsRunning) {
+    render(snapshot);
+  }
+}
+
+void OledDisplay::displayTask(void *parameter) {
+  OledDisplay *display = (OledDisplay *)parameter;
+  displaysnapshot_t snapshot;
+  statusdisplay_t statusMessage;
+
+  while (true) {
+    if (display->snapshots.read(&snapshot)) {
+      display->snapshotAvailable = true;
+    }
+    if (display->snapshotAvailable) {
+      display->render(&snapshot);
+    }
+    while (xQueueReceive(display->statusQueue, &statusMessage, 0) == pdTRUE) {
+      display->renderStatus(statusMessage);
+    }
+    vTaskDelay(pdMS_TO_TICKS(DISPLAY_TASK_PERIOD));
+  }
+}
+
+void OledDisplay::startTask() {
+  statusQueue = xQueueCreate(DISPLAY_STATUS_QUEUE_LENGTH, sizeof(statusdisplay_t));
+  if (statusQueue == NULL) {
+    return;
+  }
+  taskIsRunning = true;
+  if (xTaskCreatePinnedToCore(displayTask, "display", DISPLAY_TASK_STACK, this, DISPLAY_TASK_PRIORITY, NULL, DISPLAY_TASK_CORE) != pdPASS) {
+    taskIsRunning = false;
+  }
+}
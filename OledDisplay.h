@@ -1,6 +1,11 @@
 #pragma once
 
 #include <MachState.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "TaskChannels.h"
+#include "TempSensor.h"
 
 // software version
 #define SOFTWARE_VERSION "  V0.12 "
@@ -21,25 +26,74 @@ typedef enum {
   ERRORPRESSUREISTOOHIGH,
   ERRORLOWOILLEVEL,
   NOLOWOILLEVEL,
-  WARNINGHIGHTEMP1,
-  ERRORHIGHTEMP1,
-  WARNINGHIGHTEMP2,
-  ERRORHIGHTEMP2
+  WARNINGHIGHTEMP,
+  ERRORHIGHTEMP
 } statusdisplay_t;
 
-extern bool nextTimeDisplay;
+// bus traffic of the display in bytes: drawn is what the display code asked
+// for, sent is what went to the panel after skipping the unchanged tiles
+typedef struct {
+  uint32_t frames; // DISPLAY_WINDOW updates
+  uint64_t bytesDrawn;
+  uint64_t bytesSent;
+  uint32_t lastFrameBytesSent; // during the previous frame
+  uint32_t maxFrameBytesSent;
+} displaytraffic_t;
+
+typedef struct {
+  uint8_t number; // sensor number as used in logging
+  float temperature;
+  float tempIsHighLevel;
+  float tempIsTooHighLevel;
+  bool tempIsHigh;
+  bool ErrorTempIsTooHigh;
+} displaytemperature_t;
+
+// the values shown on the display, published by the control loop
+typedef struct {
+  bool oilLevelIsTooLow;
+  bool ErrorOilLevelIsTooLow;
+  uint8_t nrOfTempSensors;
+  displaytemperature_t temp[MAX_NR_OF_TEMP_SENSORS];
+  bool ErrorPressureIsTooHigh;
+  float pressure;
+  machinestates_t machinestate;
+  unsigned long powered_total;
+  unsigned long powered_last;
+  unsigned long running_total;
+  unsigned long running_last;
+} displaysnapshot_t;
+
+// redraw the whole display at the next frame, set from loop() and the display task
+extern std::atomic<bool> nextTimeDisplay;
+extern displaytraffic_t displayTraffic;
 
 class OledDisplay {
 private:
-  float theTempIsHighLevel1;
-  float theTempIsTooHighLevel1;
-  float theTempIsHighLevel2;
-  float theTempIsTooHighLevel2;
+  // published by the control loop, read by the display task
+  SnapshotBuffer<displaysnapshot_t> snapshots;
+  bool snapshotAvailable = false;
+
+  // status messages requested while the display task runs
+  QueueHandle_t statusQueue = NULL;
+  bool taskIsRunning = false;
+
+  static void displayTask(void *parameter);
+
+  // temp: the sensor of a temperature warning or error
+  void renderStatus(statusdisplay_t statusMessage, const displaytemperature_t *temp = NULL);
+
+  void render(const displaysnapshot_t *snapshot);
 public:
 	OledDisplay();
 
-  void begin(float tempIsHighLevel1, float tempIsTooHighLevel1, float tempIsHighLevel2, float tempIsTooHighLevel2);
+  void begin();
+
+  // from here on the display is only drawn by the display task; if it cannot
+  // be started publish() draws it from loop()
+  void startTask();
 
+  // drawn at once, only to be used before startTask()
   void clearDisplay();
 
   void showStatus(statusdisplay_t statusMessage);
@@ -52,9 +106,6 @@ public:
 
   void cacheCleared();
 
-  void loop(bool oilLevelIsTooLow, bool ErrorOilLevelIsTooLow, float temperature1, bool tempIsHigh1, 
-            bool ErrorTempIsTooHigh1, float temperature2, bool tempIsHigh2, bool ErrorTempIsTooHigh2, bool ErrorPressureIsToHigh, 
-            float pressure, machinestates_t machinestate,
-            unsigned long powered_total, unsigned long powered_last,
-            unsigned long running_total, unsigned long running_last);
+  // called by the control loop, never blocks
+  void publish(const displaysnapshot_t *snapshot);
 };
@@ -0,0 +1,269 @@
+#include "OneWireRmt.h"
+
+#include <driver/gpio.h>
+#include <rom/gpio.h>
+#include <soc/gpio_sig_map.h>
+
+// RMT clock: 80 MHz APB / 80, one tick is 1 us
+#define ONEWIRE_RMT_CLK_DIV (80)
+
+// OneWire timing, in us (standard speed)
+#define ONEWIRE_RESET_LOW (480)
+#define ONEWIRE_RESET_HIGH (70)
+#define ONEWIRE_WRITE_1_LOW (6)
+#define ONEWIRE_WRITE_1_HIGH (64)
+#define ONEWIRE_WRITE_0_LOW (60)
+#define ONEWIRE_WRITE_0_HIGH (10)
+#define ONEWIRE_READ_THRESHOLD (15) // a longer low in a read slot is a 0 from the device
+
+// reception ends when the bus did not change for this time, in us
+#define ONEWIRE_RX_IDLE_RESET (ONEWIRE_RESET_LOW + 120)
+#define ONEWIRE_RX_IDLE_SLOT (ONEWIRE_WRITE_1_HIGH + 30)
+#define ONEWIRE_RX_FILTER (30) // in APB ticks, glitches below 0.4 us are ignored
+#define ONEWIRE_RX_BUFFER_SIZE (2048) // in bytes
+
+#define ONEWIRE_MATCH_ROM (0x55)
+#define ONEWIRE_SKIP_ROM (0xCC)
+#define DS18B20_CONVERT_T (0x44)
+#define DS18B20_READ_SCRATCHPAD (0xBE)
+
+bool OneWireRmt::begin(uint8_t pin) {
+  rmt_config_t txConfig = {};
+  rmt_config_t rxConfig = {};
+
+  txConfig.rmt_mode = RMT_MODE_TX;
+  txConfig.channel = ONEWIRE_RMT_TX_CHANNEL;
+  txConfig.gpio_num = (gpio_num_t)pin;
+  txConfig.clk_div = ONEWIRE_RMT_CLK_DIV;
+  txConfig.mem_block_num = 1;
+  txConfig.tx_config.idle_level = RMT_IDLE_LEVEL_HIGH;
+  txConfig.tx_config.idle_output_en = true;
+  txConfig.tx_config.carrier_en = false;
+  txConfig.tx_config.loop_en = false;
+
+  rxConfig.rmt_mode = RMT_MODE_RX;
+  rxConfig.channel = ONEWIRE_RMT_RX_CHANNEL;
+  rxConfig.gpio_num = (gpio_num_t)pin;
+  rxConfig.clk_div = ONEWIRE_RMT_CLK_DIV;
+  rxConfig.mem_block_num = ONEWIRE_RMT_RX_MEM_BLOCKS;
+  rxConfig.rx_config.filter_en = true;
+  rxConfig.rx_config.filter_ticks_thresh = ONEWIRE_RX_FILTER;
+  rxConfig.rx_config.idle_threshold = ONEWIRE_RX_IDLE_SLOT;
+
+  if ((rmt_config(&txConfig) != ESP_OK) || (rmt_driver_install(ONEWIRE_RMT_TX_CHANNEL, 0, 0) != ESP_OK)) {
+    return false;
+  }
+  if ((rmt_config(&rxConfig) != ESP_OK) || (rmt_driver_install(ONEWIRE_RMT_RX_CHANNEL, ONEWIRE_RX_BUFFER_SIZE, 0) != ESP_OK)) {
+    rmt_driver_uninstall(ONEWIRE_RMT_TX_CHANNEL);
+    return false;
+  }
+  if (rmt_get_ringbuf_handle(ONEWIRE_RMT_RX_CHANNEL, &rxRingbuffer) != ESP_OK) {
+    rmt_driver_uninstall(ONEWIRE_RMT_RX_CHANNEL);
+    rmt_driver_uninstall(ONEWIRE_RMT_TX_CHANNEL);
+    return false;
+  }
+
+  // TX drives the pin open drain, RX listens on the same pin
+  gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_matrix_out(pin, RMT_SIG_OUT0_IDX + ONEWIRE_RMT_TX_CHANNEL, 0, 0);
+  gpio_matrix_in(pin, RMT_SIG_IN0_IDX + ONEWIRE_RMT_RX_CHANNEL, 0);
+
+  available = true;
+  return true;
+}
+
+bool OneWireRmt::convertAll(onewirecallback_t doneCallback, void *context) {
+  return start(NULL, DS18B20_CONVERT_T, 0, doneCallback, context);
+}
+
+bool OneWireRmt::readScratchpad(const uint8_t *rom, onewirecallback_t doneCallback, void *context) {
+  return start(rom, DS18B20_READ_SCRATCHPAD, ONEWIRE_SCRATCHPAD_SIZE, doneCallback, context);
+}
+
+// rom NULL: skip ROM, all devices
+bool OneWireRmt::start(const uint8_t *rom, uint8_t command, uint8_t nrOfBytesToRead, onewirecallback_t doneCallback, void *context) {
+  if (!available || busy()) {
+    return false;
+  }
+  writeLength = 0;
+  if (rom == NULL) {
+    writeBuffer[writeLength++] = ONEWIRE_SKIP_ROM;
+  } else {
+    writeBuffer[writeLength++] = ONEWIRE_MATCH_ROM;
+    memcpy(&writeBuffer[writeLength], rom, 8);
+    writeLength += 8;
+  }
+  writeBuffer[writeLength++] = command;
+  readLength = nrOfBytesToRead;
+  callback = doneCallback;
+  callbackContext = context;
+  counters.transactions++;
+  startPhase(RESETTING);
+  return true;
+}
+
+void OneWireRmt::startPhase(onewirestate_t phase) {
+  uint16_t nrOfItems = 0;
+
+  if (phase == RESETTING) {
+    items[nrOfItems].level0 = 0;
+    items[nrOfItems].duration0 = ONEWIRE_RESET_LOW;
+    items[nrOfItems].level1 = 1;
+    items[nrOfItems].duration1 = ONEWIRE_RESET_HIGH;
+    nrOfItems++;
+    rmt_set_rx_idle_thresh(ONEWIRE_RMT_RX_CHANNEL, ONEWIRE_RX_IDLE_RESET);
+  } else {
+    // the bytes to write, LSB first, then the read slots: a read slot is a write 1 slot
+    for (uint16_t bit = 0; bit < (uint16_t)(writeLength + readLength) * 8; bit++) {
+      bool one = (bit >= writeLength * 8) || (writeBuffer[bit / 8] & (1 << (bit % 8)));
+      items[nrOfItems].level0 = 0;
+      items[nrOfItems].duration0 = one ? ONEWIRE_WRITE_1_LOW : ONEWIRE_WRITE_0_LOW;
+      items[nrOfItems].level1 = 1;
+      items[nrOfItems].duration1 = one ? ONEWIRE_WRITE_1_HIGH : ONEWIRE_WRITE_0_HIGH;
+      nrOfItems++;
+    }
+    rmt_set_rx_idle_thresh(ONEWIRE_RMT_RX_CHANNEL, ONEWIRE_RX_IDLE_SLOT);
+  }
+  state = phase;
+  phaseStart = millis();
+  rmt_rx_start(ONEWIRE_RMT_RX_CHANNEL, true);
+  rmt_write_items(ONEWIRE_RMT_TX_CHANNEL, items, nrOfItems, false);
+}
+
+// after the reset pulse a device pulls the bus low
+bool OneWireRmt::presenceDetected(const rmt_item32_t *received, size_t nrOfItems) {
+  uint8_t lowPeriods = 0;
+
+  for (size_t i = 0; i < nrOfItems; i++) {
+    if ((received[i].level0 == 0) && (received[i].duration0 > 0)) {
+      lowPeriods++;
+    }
+    if ((received[i].level1 == 0) && (received[i].duration1 > 0)) {
+      lowPeriods++;
+    }
+  }
+  return lowPeriods >= 2;
+}
+
+// every low period of the bus is a slot, the read slots are the last ones
+bool OneWireRmt::decodeRead(const rmt_item32_t *received, size_t nrOfItems) {
+  uint16_t firstReadSlot = writeLength * 8;
+  uint16_t slot = 0;
+  uint16_t duration;
+
+  memset(readBuffer, 0, sizeof(readBuffer));
+  for (size_t i = 0; i < nrOfItems * 2; i++) {
+    if ((i & 1) == 0) {
+      if ((received[i / 2].level0 != 0) || (received[i / 2].duration0 == 0)) {
+        continue;
+      }
+      duration = received[i / 2].duration0;
+    } else {
+      if ((received[i / 2].level1 != 0) || (received[i / 2].duration1 == 0)) {
+        continue;
+      }
+      duration = received[i / 2].duration1;
+    }
+    if ((slot >= firstReadSlot) && (duration <= ONEWIRE_READ_THRESHOLD)) {
+      readBuffer[(slot - firstReadSlot) / 8] |= 1 << ((slot - firstReadSlot) % 8);
+    }
+    slot++;
+  }
+  return slot == (uint16_t)(writeLength + readLength) * 8;
+}
+
+void OneWireRmt::finish(onewireresult_t result) {
+  onewirecallback_t doneCallback = callback;
+
+  rmt_rx_stop(ONEWIRE_RMT_RX_CHANNEL);
+  state = IDLE;
+  switch (result) {
+    case ONEWIRE_NO_PRESENCE:
+      counters.noPresence++;
+      break;
+    case ONEWIRE_NO_RESPONSE:
+      counters.noResponse++;
+      break;
+    case ONEWIRE_CRC_ERROR:
+      counters.crcErrors++;
+      break;
+    case ONEWIRE_TIMEOUT:
+      counters.timeouts++;
+      break;
+    case ONEWIRE_OK:
+      break;
+  }
+  // the callback may start the next transaction
+  callback = NULL;
+  if (doneCallback != NULL) {
+    doneCallback(result, readBuffer, callbackContext);
+  }
+}
+
+void OneWireRmt::loop() {
+  rmt_item32_t *received;
+  size_t size = 0;
+  bool allOnes = true;
+
+  if (state == IDLE) {
+    return;
+  }
+  received = (rmt_item32_t *)xRingbufferReceive(rxRingbuffer, &size, 0);
+  if (received == NULL) {
+    if (millis() - phaseStart > ONEWIRE_RMT_TIMEOUT) {
+      finish(ONEWIRE_TIMEOUT);
+    }
+    return;
+  }
+
+  if (state == RESETTING) {
+    bool present = presenceDetected(received, size / sizeof(rmt_item32_t));
+    vRingbufferReturnItem(rxRingbuffer, received);
+    rmt_rx_stop(ONEWIRE_RMT_RX_CHANNEL);
+    if (!present) {
+      finish(ONEWIRE_NO_PRESENCE);
+      return;
+    }
+    startPhase(TRANSFERRING);
+    return;
+  }
+
+  bool complete = decodeRead(received, size / sizeof(rmt_item32_t));
+  vRingbufferReturnItem(rxRingbuffer, received);
+  if (!complete) {
+    finish(ONEWIRE_TIMEOUT);
+    return;
+  }
+  if (readLength == 0) {
+    finish(ONEWIRE_OK);
+    return;
+  }
+  for (uint8_t i = 0; i < readLength; i++) {
+    allOnes = allOnes && (readBuffer[i] == 0xff);
+  }
+  if (allOnes) {
+    finish(ONEWIRE_NO_RESPONSE);
+  } else if (crc8(readBuffer, readLength - 1) != readBuffer[readLength - 1]) {
+    finish(ONEWIRE_CRC_ERROR);
+  } else {
+    finish(ONEWIRE_OK);
+  }
+}
+
+// Dallas/Maxim CRC-8, polynomial x^8 + x^5 + x^4 + 1
+uint8_t OneWireRmt::crc8(const uint8_t *data, uint8_t length) {
+  uint8_t crc = 0;
+
+  while (length--) {
+    uint8_t byte = *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      uint8_t mix = (crc ^ byte) & 0x01;
+      crc >>= 1;
+      if (mix) {
+        crc ^= 0x8C;
+      }
+      byte >>= 1;
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include <freertos/ringbuf.h>
+
+// OneWire transport on the RMT peripheral: the TX channel writes the reset
+// pulse and the time slots, the RX channel on the same (open drain) pin
+// records the bus, so nothing is bit-banged with the interrupts disabled.
+// A transaction is a state machine that loop() advances without waiting;
+// when it ends the callback is called from loop().
+#define ONEWIRE_RMT_TX_CHANNEL (RMT_CHANNEL_0) // 1 memory block, the driver refills it
+#define ONEWIRE_RMT_RX_CHANNEL (RMT_CHANNEL_4) // uses the memory blocks of channels 4 - 7
+#define ONEWIRE_RMT_RX_MEM_BLOCKS (4) // 256 slots: match ROM, command and a 9 byte scratchpad
+#define ONEWIRE_RMT_MAX_SLOTS (160) // in bits, the longest transaction
+#define ONEWIRE_RMT_TIMEOUT (50) // in ms, a phase that is not recorded in time is aborted
+
+#define ONEWIRE_SCRATCHPAD_SIZE (9)
+
+typedef enum {
+  ONEWIRE_OK,
+  ONEWIRE_NO_PRESENCE, // no device answered the reset pulse
+  ONEWIRE_NO_RESPONSE, // only ones read back: the addressed device is not on the bus
+  ONEWIRE_CRC_ERROR,   // data read back, but the CRC does not match
+  ONEWIRE_TIMEOUT      // the RMT did not record the phase
+} onewireresult_t;
+
+// data: the bytes read, only valid for ONEWIRE_OK
+typedef void (*onewirecallback_t)(onewireresult_t result, const uint8_t *data, void *context);
+
+typedef struct {
+  uint32_t transactions;
+  uint32_t noPresence;
+  uint32_t noResponse;
+  uint32_t crcErrors;
+  uint32_t timeouts;
+} onewirecounters_t;
+
+class OneWireRmt {
+private:
+  typedef enum {
+    IDLE,
+    RESETTING,
+    TRANSFERRING
+  } onewirestate_t;
+
+  onewirestate_t state = IDLE;
+  bool available = false;
+  RingbufHandle_t rxRingbuffer = NULL;
+  rmt_item32_t items[ONEWIRE_RMT_MAX_SLOTS];
+  uint8_t writeBuffer[ONEWIRE_SCRATCHPAD_SIZE + 1];
+  uint8_t writeLength = 0;
+  uint8_t readBuffer[ONEWIRE_SCRATCHPAD_SIZE];
+  uint8_t readLength = 0;
+  unsigned long phaseStart = 0;
+  onewirecallback_t callback = NULL;
+  void *callbackContext = NULL;
+
+  bool start(const uint8_t *rom, uint8_t command, uint8_t nrOfBytesToRead, onewirecallback_t doneCallback, void *context);
+  void startPhase(onewirestate_t phase);
+  bool presenceDetected(const rmt_item32_t *received, size_t nrOfItems);
+  bool decodeRead(const rmt_item32_t *received, size_t nrOfItems);
+  void finish(onewireresult_t result);
+
+public:
+  onewirecounters_t counters = { 0, 0, 0, 0, 0 };
+
+  // false if the RMT driver cannot be installed, the bit-banged OneWire library is used then
+  bool begin(uint8_t pin);
+
+  bool isAvailable() { return available; }
+
+  bool busy() { return state != IDLE; }
+
+  // skip ROM, convert T: all devices start a conversion; false if the bus is busy
+  bool convertAll(onewirecallback_t doneCallback, void *context);
+
+  // match ROM, read scratchpad: data holds the 9 bytes of the scratchpad; false if the bus is busy
+  bool readScratchpad(const uint8_t *rom, onewirecallback_t doneCallback, void *context);
+
+  // advances the current transaction, never waits for the bus
+  void loop();
+
+  static uint8_t crc8(const uint8_t *data, uint8_t length);
+};
@@ -0,0 +1,186 @@
+#include "OperatingHours.h"
+#include <ACNode.h>
+#include <NTP.h>
+#include <SPIFFS.h>
+
+extern NTP ntp;
+
+const char *dayLabel[7] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+
+OperatingHours theOperatingHours;
+
+uint32_t OperatingHours::window(uint8_t from, uint8_t to) {
+  uint32_t hours = 0;
+
+  for (uint8_t hour = 0; hour < 24; hour++) {
+    if ((from <= to) ? ((hour >= from) && (hour < to)) : ((hour >= from) || (hour < to))) {
+      hours |= 1UL << hour;
+    }
+  }
+  return hours;
+}
+
+void OperatingHours::begin(uint32_t defaultHours) {
+  if (!load()) {
+    memset(&calendar, 0, sizeof(calendar));
+    for (uint8_t day = 0; day < 7; day++) {
+      calendar.week[day] = defaultHours & OPERATING_HOURS_ALL_DAY;
+    }
+  }
+  validUntil = 0;
+}
+
+void OperatingHours::recompute() {
+  uint32_t now = ntp.epoch();
+  uint8_t day = ntp.weekDay();
+  uint8_t hour = ntp.hours();
+  uint32_t offset = 3600 - (ntp.minutes() * 60 + ntp.seconds()); // to the next hour
+  bool weekAllowed = (calendar.week[day] >> hour) & 1;
+  uint32_t next = 0;
+
+  counters.recomputes++;
+  // the next hour of the week that differs from this one
+  for (uint16_t slot = hour + 1; slot < hour + 7 * 24; slot++, offset += 3600) {
+    if (((calendar.week[(day + slot / 24) % 7] >> (slot % 24)) & 1) != weekAllowed) {
+      next = now + offset;
+      break;
+    }
+  }
+
+  // an override is in force from its start to its end, the last one added wins
+  allowed = weekAllowed;
+  for (uint8_t i = 0; i < OPERATING_HOURS_OVERRIDES; i++) {
+    const operatingoverride_t &o = calendar.overrides[i];
+
+    if (o.to <= now) {
+      continue;
+    }
+    if (o.from <= now) {
+      allowed = o.allowed;
+    }
+    uint32_t edge = (o.from > now) ? o.from : o.to;
+    if ((next == 0) || (edge < next)) {
+      next = edge;
+    }
+  }
+
+  changeAt = next;
+  validUntil = uptimeMs() + 1000ULL * (((next == 0) || (next - now > OPERATING_HOURS_RECHECK)) ? OPERATING_HOURS_RECHECK : next - now);
+}
+
+bool OperatingHours::setHours(int8_t day, uint8_t from, uint8_t to) {
+  if ((day < -1) || (day > 6) || (from > 23) || (to > 24)) {
+    return false;
+  }
+  for (uint8_t d = 0; d < 7; d++) {
+    if ((day == -1) || (day == d)) {
+      calendar.week[d] = window(from, to);
+    }
+  }
+  validUntil = 0;
+  return save();
+}
+
+bool OperatingHours::addOverride(uint32_t from, uint32_t to, bool allowed) {
+  uint32_t now = ntp.epoch();
+  int8_t free = -1;
+
+  if ((to <= from) || (to <= now)) {
+    return false;
+  }
+  // a slot that is not used or has ended; the new override goes last, it wins over the others
+  for (uint8_t i = 0; i < OPERATING_HOURS_OVERRIDES; i++) {
+    if (calendar.overrides[i].to <= now) {
+      free = i;
+      break;
+    }
+  }
+  if (free < 0) {
+    return false;
+  }
+  for (uint8_t i = free; i + 1 < OPERATING_HOURS_OVERRIDES; i++) {
+    calendar.overrides[i] = calendar.overrides[i + 1];
+  }
+  calendar.overrides[OPERATING_HOURS_OVERRIDES - 1] = { from, to, allowed };
+  validUntil = 0;
+  return save();
+}
+
+void OperatingHours::clearOverrides() {
+  memset(calendar.overrides, 0, sizeof(calendar.overrides));
+  validUntil = 0;
+  save();
+}
+
+void OperatingHours::dump() {
+  char outputStr[100];
+  uint32_t now = ntp.epoch();
+
+  for (uint8_t day = 0; day < 7; day++) {
+    int length = snprintf(outputStr, sizeof(outputStr), "Operating hours %s ", dayLabel[day]);
+
+    for (uint8_t hour = 0; hour < 24; hour++) {
+      outputStr[length++] = ((calendar.week[day] >> hour) & 1) ? '#' : '.';
+    }
+    outputStr[length] = 0;
+    Log.println(outputStr);
+  }
+  for (uint8_t i = 0; i < OPERATING_HOURS_OVERRIDES; i++) {
+    const operatingoverride_t &o = calendar.overrides[i];
+
+    if (o.to > now) {
+      snprintf(outputStr, sizeof(outputStr), "Operating hours override %lu - %lu: %s", (unsigned long)o.from,
+               (unsigned long)o.to, o.allowed ? "allowed" : "denied");
+      Log.println(outputStr);
+    }
+  }
+  snprintf(outputStr, sizeof(outputStr), "Operating hours: switching on is %s, %lu recomputes for %lu checks",
+           isAllowed() ? "allowed" : "denied", (unsigned long)counters.recomputes, (unsigned long)counters.checks);
+  Log.println(outputStr);
+}
+
+bool OperatingHours::load() {
+  File calendarFile;
+  operatingcalendar_t storedCalendar;
+
+  if (!SPIFFS.exists(OPERATING_HOURS_FILE)) {
+    return false;
+  }
+  calendarFile = SPIFFS.open(OPERATING_HOURS_FILE, "rb");
+  if (!calendarFile) {
+    Log.print("There was an error opening the ");
+    Log.print(OPERATING_HOURS_FILE);
+    Log.println(" file for reading");
+    return false;
+  }
+  calendarFile.setTimeout(0);
+  if (calendarFile.readBytes((char*)&storedCalendar, sizeof(storedCalendar)) != sizeof(storedCalendar)) {
+    Log.print("Invalid operating hours in ");
+    Log.print(OPERATING_HOURS_FILE);
+    Log.println(", using the default hours");
+    calendarFile.close();
+    return false;
+  }
+  calendarFile.close();
+  calendar = storedCalendar;
+  return true;
+}
+
+bool OperatingHours::save() {
+  File calendarFile;
+
+  calendarFile = SPIFFS.open(OPERATING_HOURS_FILE, "wb");
+  if (!calendarFile) {
+    Log.print("There was an error opening the ");
+    Log.print(OPERATING_HOURS_FILE);
+    Log.println(" file for writing");
+    return false;
+  }
+  if (calendarFile.write((byte*)&calendar, sizeof(calendar)) != sizeof(calendar)) {
+    Log.println("ERROR --> operating hours NOT stored in SPIFFS");
+    calendarFile.close();
+    return false;
+  }
+  calendarFile.close();
+  return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TimerWheel.h"
+
+// The hours in which the compressor may be switched on by the poweron command
+// or a normal press of the On button, see compressorIsDisabeled(): a bit per
+// hour of each day of the week, and overrides for a holiday or a build night
+// that allow or deny switching on between two times. The calendar is stored in
+// OPERATING_HOURS_FILE in SPIFFS and changed with the hours and override
+// commands of the master, without reflashing.
+//
+// isAllowed() is a compare against a cached deadline in uptimeMs(): the
+// answer is recomputed from the local time of NTP only when the next change
+// of the week or an override is due, after OPERATING_HOURS_RECHECK to follow
+// summer time, or at once after invalidate() when NTP set the clock.
+#define OPERATING_HOURS_FILE "/init/hours"
+#define OPERATING_HOURS_OVERRIDES (8)
+#define OPERATING_HOURS_RECHECK (3600) // in s
+#define OPERATING_HOURS_ALL_DAY (0xffffff) // hour 0 to 23
+
+typedef struct {
+  uint32_t from; // in s since 1970, ntp.epoch()
+  uint32_t to;
+  bool allowed;
+} operatingoverride_t;
+
+typedef struct {
+  uint32_t week[7]; // day 0 = Sunday, bit h: switching on is allowed from h:00 to h:59
+  operatingoverride_t overrides[OPERATING_HOURS_OVERRIDES]; // to == 0: not used
+} operatingcalendar_t;
+
+typedef struct {
+  uint32_t recomputes;
+  uint32_t checks;
+} operatingcounters_t;
+
+class OperatingHours {
+private:
+  operatingcalendar_t calendar;
+  bool allowed = false;
+  uint64_t validUntil = 0; // uptimeMs()
+  uint32_t changeAt = 0; // ntp.epoch() of the next start or end of an hour window or override, 0 if none within a week
+
+  bool load();
+  bool save();
+  void recompute();
+
+public:
+  operatingcounters_t counters = { 0, 0 };
+
+  // defaultHours: the hours of every day in which switching on is allowed, without a stored calendar
+  void begin(uint32_t defaultHours);
+
+  bool isAllowed() {
+    counters.checks++;
+    if (uptimeMs() >= validUntil) {
+      recompute();
+    }
+    return allowed;
+  }
+
+  // the clock was set, the cached answer may be from before the first NTP sync
+  void invalidate() { validUntil = 0; }
+
+  // ntp.epoch() from which isAllowed() may change, 0 if not within a week
+  uint32_t nextChange() {
+    isAllowed();
+    return changeAt;
+  }
+
+  // the hours of day (0 = Sunday, -1: every day) from..to, wrapping past midnight if to < from, none if to == from
+  bool setHours(int8_t day, uint8_t from, uint8_t to);
+
+  // allowed or denied between from and to (in s since 1970, ntp.epoch()), over the week
+  bool addOverride(uint32_t from, uint32_t to, bool allowed);
+  void clearOverrides();
+
+  void dump();
+
+  // hour from to hour to, wrapping past midnight if to < from, as a mask of week[]
+  static uint32_t window(uint8_t from, uint8_t to);
+};
+
+extern OperatingHours theOperatingHours;
@@ -1,39 +1,305 @@
 #include "PressureSensor.h"
+#include "FaultMask.h"
 #include <ACNode.h>
+#include <driver/i2s.h>
+#include <driver/adc.h>
+#include <SPIFFS.h>
 
 #ifndef PRESSURESENSOR
 #define PRESSURESENSOR  (35)  // analog input
 #endif
+#ifndef PRESSURESENSOR_ADC_CHANNEL
+#define PRESSURESENSOR_ADC_CHANNEL (ADC1_CHANNEL_7) // GPIO35
+#endif
 
 // pressure sensor
 #define PRESSURE_SAMPLE_WINDOW (1000) // in ms
+// default calibration, used until the sensor is calibrated at runtime
 #define PRESSURE_CALIBRATE_VALUE_0_5V (144) // in measured bits
 #define PRESSURE_CALIBRATE_VALUE_4_5V (3000) // in measured bits
+#define PRESSURE_AT_4_5V (12.0) // in bar, the sensor outputs 0.5 V at 0 bar and 4.5 V at this pressure
+#define PRESSURE_CALIBRATE_SPLIT (6.0) // in bar, calibration below this pressure sets the low point, else the high point
+#define PRESSURE_CALIBRATE_MIN_SPAN (200) // in bits, minimum ADC difference between both calibration points
+#define PRESSURE_CALIBRATION_FILE "/init/pressure"
+
+// continuous sampling
+#define PRESSURE_CONTINUOUS_SAMPLING (true) // false = single analogRead every PRESSURE_SAMPLE_WINDOW ms
+#define PRESSURE_DMA_I2S_PORT (I2S_NUM_0)
+#define PRESSURE_DMA_SAMPLE_RATE (10000) // in Hz
+#define PRESSURE_DMA_BUFFER_COUNT (8)
+#define PRESSURE_DMA_BUFFER_LEN (500) // in samples, 8 * 500 samples = 400 ms before the DMA overruns
+#define PRESSURE_DMA_BLOCK (40) // DMA samples averaged into one raw sample, 10000 / 40 = 250 Hz
+#define PRESSURE_FILTER_LENGTH (25) // raw samples, the pressure is the median of the last 100 ms
 
 int pressureADCVal = 0;
-float pressureVoltage = 0;
+uint16_t pressureCentibar = 0;
 float pressure = 0;
-unsigned long pressureNextSampleTime = 0;
 bool newCalibrationInfoAvailable = false;
 
 PressureSensor::PressureSensor(float maxPressureLimit, float minPressureLimit) {
-  pressureMaxLimit = maxPressureLimit;
-  pressureMinLimit = minPressureLimit;
+  pressureMaxLimit = (uint16_t)(maxPressureLimit * 100.0 + 0.5);
+  pressureMinLimit = (uint16_t)(minPressureLimit * 100.0 + 0.5);
+  calibration.adcLow = PRESSURE_CALIBRATE_VALUE_0_5V;
+  calibration.centibarLow = 0;
+  calibration.adcHigh = PRESSURE_CALIBRATE_VALUE_4_5V;
+  calibration.centibarHigh = (uint16_t)(PRESSURE_AT_4_5V * 100.0 + 0.5);
+  buildConversionTable();
 	return;
 }
 
-void PressureSensor::loop() {
-  if (millis() > pressureNextSampleTime) {
-    pressureNextSampleTime = millis() + PRESSURE_SAMPLE_WINDOW;
-    pressureADCVal = analogRead(PRESSURESENSOR);
-    if (pressureADCVal < PRESSURE_CALIBRATE_VALUE_0_5V) {
-      pressureADCVal = PRESSURE_CALIBRATE_VALUE_0_5V;
+void PressureSensor::buildConversionTable() {
+  int32_t adcSpan = (int32_t)calibration.adcHigh - (int32_t)calibration.adcLow;
+  int32_t centibarSpan = (int32_t)calibration.centibarHigh - (int32_t)calibration.centibarLow;
+  int32_t centibar;
+
+  // the line through both calibration points, also below the low point, which may be above 0 bar
+  for (int32_t adc = 0; adc < PRESSURE_ADC_RANGE; adc++) {
+    int32_t delta = (adc - calibration.adcLow) * centibarSpan;
+
+    centibar = calibration.centibarLow + ((delta >= 0) ? delta + adcSpan / 2 : delta - adcSpan / 2) / adcSpan;
+    if (centibar < 0) {
+      centibar = 0;
+    }
+    if (centibar > 0xffff) {
+      centibar = 0xffff;
+    }
+    adcToCentibar[adc] = centibar;
+  }
+}
+
+bool PressureSensor::loadCalibration() {
+  File calibrationFile;
+  pressurecalibration_t storedCalibration;
+
+  if (!SPIFFS.exists(PRESSURE_CALIBRATION_FILE)) {
+    return false;
+  }
+  calibrationFile = SPIFFS.open(PRESSURE_CALIBRATION_FILE, "rb");
+  if (!calibrationFile) {
+    Log.print("There was an error opening the ");
+    Log.print(PRESSURE_CALIBRATION_FILE);
+    Log.println(" file for reading");
+    return false;
+  }
+  calibrationFile.setTimeout(0);
+  if ((calibrationFile.readBytes((char*)&storedCalibration, sizeof(storedCalibration)) != sizeof(storedCalibration)) ||
+      (storedCalibration.adcHigh < storedCalibration.adcLow + PRESSURE_CALIBRATE_MIN_SPAN) ||
+      (storedCalibration.adcHigh >= PRESSURE_ADC_RANGE) ||
+      (storedCalibration.centibarHigh <= storedCalibration.centibarLow)) {
+    Log.print("Invalid pressure calibration in ");
+    Log.print(PRESSURE_CALIBRATION_FILE);
+    Log.println(", using the default calibration");
+    calibrationFile.close();
+    return false;
+  }
+  calibrationFile.close();
+  calibration = storedCalibration;
+  return true;
+}
+
+bool PressureSensor::saveCalibration() {
+  File calibrationFile;
+
+  calibrationFile = SPIFFS.open(PRESSURE_CALIBRATION_FILE, "wb");
+  if (!calibrationFile) {
+    Log.print("There was an error opening the ");
+    Log.print(PRESSURE_CALIBRATION_FILE);
+    Log.println(" file for writing");
+    return false;
+  }
+  if (calibrationFile.write((byte*)&calibration, sizeof(calibration)) != sizeof(calibration)) {
+    Log.println("ERROR --> pressure calibration NOT stored in SPIFFS");
+    calibrationFile.close();
+    return false;
+  }
+  calibrationFile.close();
+  return true;
+}
+
+bool PressureSensor::calibrate(float referencePressure) {
+  pressurecalibration_t newCalibration = calibration;
+  uint16_t centibar;
+
+  if ((referencePressure < 0) || (referencePressure > 600.0)) {
+    return false;
+  }
+  centibar = (uint16_t)(referencePressure * 100.0 + 0.5);
+  if (referencePressure < PRESSURE_CALIBRATE_SPLIT) {
+    newCalibration.adcLow = pressureADCVal;
+    newCalibration.centibarLow = centibar;
+  } else {
+    newCalibration.adcHigh = pressureADCVal;
+    newCalibration.centibarHigh = centibar;
+  }
+  if ((newCalibration.adcHigh < newCalibration.adcLow + PRESSURE_CALIBRATE_MIN_SPAN) ||
+      (newCalibration.centibarHigh <= newCalibration.centibarLow)) {
+    Log.println("Pressure calibration rejected: calibration points are too close together");
+    return false;
+  }
+  calibration = newCalibration;
+  buildConversionTable();
+  saveCalibration();
+  logCalibration();
+  return true;
+}
+
+void PressureSensor::logCalibration() {
+  Log.print("Pressure calibration: ");
+  Log.print(calibration.adcLow);
+  Log.print(" bits = ");
+  Log.print(calibration.centibarLow / 100.0);
+  Log.print(" bar, ");
+  Log.print(calibration.adcHigh);
+  Log.print(" bits = ");
+  Log.print(calibration.centibarHigh / 100.0);
+  Log.println(" bar");
+}
+
+void PressureSensor::logRawSamples(uint16_t nrOfSamples) {
+  uint16_t samples[PRESSURE_RING_SIZE];
+  char outputStr[PRESSURE_SAMPLES_PER_LINE * 6 + 1];
+
+  nrOfSamples = getRawSamples(samples, (nrOfSamples < PRESSURE_RING_SIZE) ? nrOfSamples : PRESSURE_RING_SIZE);
+  Log.print("Pressure raw samples: ");
+  Log.print(nrOfSamples);
+  Log.print(" of ");
+  Log.print(getRawSamplesTotal());
+  Log.println(" since boot, oldest first");
+  for (uint16_t line = 0; line < nrOfSamples; line += PRESSURE_SAMPLES_PER_LINE) {
+    int length = 0;
+
+    for (uint16_t i = line; (i < nrOfSamples) && (i < line + PRESSURE_SAMPLES_PER_LINE); i++) {
+      length += snprintf(outputStr + length, sizeof(outputStr) - length, "%s%u", (i > line) ? " " : "", samples[i]);
+    }
+    Log.println(outputStr);
+  }
+}
+
+void PressureSensor::begin() {
+  i2s_config_t i2sConfig;
+  esp_err_t err;
+
+  if (loadCalibration()) {
+    buildConversionTable();
+  }
+
+  theTimerWheel.start(&sampleTimer, 0, PRESSURE_SAMPLE_WINDOW, sample, this);
+
+  if (!PRESSURE_CONTINUOUS_SAMPLING) {
+    return;
+  }
+
+  // same width and attenuation as analogRead() uses, so the calibration values stay valid
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  adc1_config_channel_atten(PRESSURESENSOR_ADC_CHANNEL, ADC_ATTEN_DB_11);
+
+  i2sConfig.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+  i2sConfig.sample_rate = PRESSURE_DMA_SAMPLE_RATE;
+  i2sConfig.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+  i2sConfig.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+  i2sConfig.communication_format = I2S_COMM_FORMAT_I2S_MSB;
+  i2sConfig.intr_alloc_flags = 0;
+  i2sConfig.dma_buf_count = PRESSURE_DMA_BUFFER_COUNT;
+  i2sConfig.dma_buf_len = PRESSURE_DMA_BUFFER_LEN;
+  i2sConfig.use_apll = false;
+
+  err = i2s_driver_install(PRESSURE_DMA_I2S_PORT, &i2sConfig, 0, NULL);
+  if (err == ESP_OK) {
+    err = i2s_set_adc_mode(ADC_UNIT_1, PRESSURESENSOR_ADC_CHANNEL);
+  }
+  if (err == ESP_OK) {
+    err = i2s_adc_enable(PRESSURE_DMA_I2S_PORT);
+  }
+  if (err != ESP_OK) {
+    i2s_driver_uninstall(PRESSURE_DMA_I2S_PORT);
+    Log.print("Pressure sensor: continuous sampling not available (error ");
+    Log.print(err);
+    Log.println("), falling back to single samples");
+    return;
+  }
+  continuousSampling = true;
+}
+
+void PressureSensor::setPressure(int adcValue) {
+  pressureADCVal = adcValue;
+  pressureCentibar = toCentibar(adcValue);
+  pressure = pressureCentibar * 0.01f; // pressure in bar
+  pressureIsAboveMaximum = pressureCentibar > pressureMaxLimit;
+  pressureIsBelowMinimum = pressureCentibar < pressureMinLimit;
+  theFaults.set(FAULT_PRESSURE_TOO_HIGH, pressureIsAboveMaximum);
+  theFaults.set(FAULT_PRESSURE_NOT_LOW, !pressureIsBelowMinimum);
+}
+
+void PressureSensor::addRawSample(uint16_t adcValue) {
+  portENTER_CRITICAL(&rawSamplesLock);
+  rawSamples[rawHead] = adcValue;
+  rawHead = (rawHead + 1) % PRESSURE_RING_SIZE;
+  if (rawCount < PRESSURE_RING_SIZE) {
+    rawCount++;
+  }
+  rawSamplesTotal++;
+  portEXIT_CRITICAL(&rawSamplesLock);
+}
+
+// true if there were new samples
+bool PressureSensor::readDMASamples() {
+  uint16_t dmaSamples[PRESSURE_DMA_BLOCK];
+  size_t bytesRead;
+  uint32_t sum;
+  size_t nrOfSamples;
+  bool newSamples = false;
+
+  // never wait for the DMA, only take what has been sampled already
+  while ((i2s_read(PRESSURE_DMA_I2S_PORT, dmaSamples, sizeof(dmaSamples), &bytesRead, 0) == ESP_OK) && (bytesRead > 0)) {
+    nrOfSamples = bytesRead / sizeof(uint16_t);
+    sum = 0;
+    for (size_t i = 0; i < nrOfSamples; i++) {
+      sum += dmaSamples[i] & 0x0fff; // the upper 4 bits hold the ADC channel
+    }
+    addRawSample(sum / nrOfSamples);
+    newSamples = true;
+  }
+  return newSamples;
+}
+
+// only from the task that writes the ring
+uint16_t PressureSensor::medianOfLastSamples(uint16_t nrOfSamples) {
+  uint16_t sorted[PRESSURE_FILTER_LENGTH];
+  uint16_t index;
+  uint16_t value;
+  int j;
+
+  if (nrOfSamples > rawCount) {
+    nrOfSamples = rawCount;
+  }
+  if (nrOfSamples > PRESSURE_FILTER_LENGTH) {
+    nrOfSamples = PRESSURE_FILTER_LENGTH;
+  }
+  // insertion sort, the window is small
+  for (uint16_t i = 0; i < nrOfSamples; i++) {
+    index = (rawHead + PRESSURE_RING_SIZE - 1 - i) % PRESSURE_RING_SIZE;
+    value = rawSamples[index];
+    for (j = i - 1; (j >= 0) && (sorted[j] > value); j--) {
+      sorted[j + 1] = sorted[j];
     }
-    pressureVoltage = (((float)pressureADCVal - (float)PRESSURE_CALIBRATE_VALUE_0_5V) * 4.0) / ((float)PRESSURE_CALIBRATE_VALUE_4_5V - (float)PRESSURE_CALIBRATE_VALUE_0_5V) + 0.5;
-    pressure = (((pressureVoltage - 0.5) / 4.0) * 1.2) * 10; // pressure in bar
-    newCalibrationInfoAvailable = true;
-    pressureIsAboveMaximum = pressure > pressureMaxLimit;
-    pressureIsBelowMinimum = pressure < pressureMinLimit;
+    sorted[j + 1] = value;
+  }
+  return sorted[nrOfSamples / 2];
+}
+
+// every PRESSURE_SAMPLE_WINDOW: a single sample, or only the calibration info with continuous sampling
+void PressureSensor::sample(void *context) {
+  PressureSensor *sensor = (PressureSensor *)context;
+
+  if (!sensor->continuousSampling) {
+    sensor->setPressure(analogRead(PRESSURESENSOR));
+  }
+  sensor->newCalibrationInfoAvailable = true;
+}
+
+void PressureSensor::update() {
+  if (continuousSampling && readDMASamples()) {
+    setPressure(medianOfLastSamples(PRESSURE_FILTER_LENGTH));
   }
 }
 
@@ -42,11 +308,40 @@ void PressureSensor::logInfoCalibration() {
   Log.print(pressureADCVal);
   Log.println(" bits");
   Log.print("Pressure voltage = ");
-  Log.print(pressureVoltage);
+  Log.print(0.5 + pressure * 4.0 / PRESSURE_AT_4_5V); // nominal sensor output
   Log.println(" V");
   Log.print("Pressure = ");
   Log.print(pressure);
   Log.println(" bar");
+  if (continuousSampling) {
+    uint16_t minADCVal = 0xffff;
+    uint16_t maxADCVal = 0;
+    uint16_t nrOfSamples;
+    unsigned long total;
+
+    portENTER_CRITICAL(&rawSamplesLock);
+    nrOfSamples = rawCount;
+    total = rawSamplesTotal;
+    for (uint16_t i = 0; i < rawCount; i++) {
+      if (rawSamples[i] < minADCVal) {
+        minADCVal = rawSamples[i];
+      }
+      if (rawSamples[i] > maxADCVal) {
+        maxADCVal = rawSamples[i];
+      }
+    }
+    portEXIT_CRITICAL(&rawSamplesLock);
+    Log.print("Pressure ADC raw samples: ");
+    Log.print(total);
+    Log.print(" total, last ");
+    Log.print(nrOfSamples);
+    Log.print(" between ");
+    Log.print(minADCVal);
+    Log.print(" and ");
+    Log.print(maxADCVal);
+    Log.println(" bits");
+  }
+  logCalibration();
   newCalibrationInfoAvailable = false;
 }
 
@@ -58,4 +353,26 @@ void PressureSensor::logInfoCalibration() {
     return pressureIsBelowMinimum;
   }
 
+uint16_t PressureSensor::getRawSamples(uint16_t *buffer, uint16_t maxSamples) {
+  uint16_t nrOfSamples;
+  uint16_t index;
 
+  portENTER_CRITICAL(&rawSamplesLock);
+  nrOfSamples = (maxSamples < rawCount) ? maxSamples : rawCount;
+  index = (rawHead + PRESSURE_RING_SIZE - nrOfSamples) % PRESSURE_RING_SIZE;
+  for (uint16_t i = 0; i < nrOfSamples; i++) {
+    buffer[i] = rawSamples[index];
+    index = (index + 1) % PRESSURE_RING_SIZE;
+  }
+  portEXIT_CRITICAL(&rawSamplesLock);
+  return nrOfSamples;
+}
+
+unsigned long PressureSensor::getRawSamplesTotal() {
+  unsigned long total;
+
+  portENTER_CRITICAL(&rawSamplesLock);
+  total = rawSamplesTotal;
+  portEXIT_CRITICAL(&rawSamplesLock);
+  return total;
+}
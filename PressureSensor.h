@@ -1,25 +1,84 @@
 #pragma once
 
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "TimerWheel.h"
+
+// continuous sampling: the ADC is read by the I2S peripheral using DMA, each
+// block of DMA samples is averaged into one entry of the raw sample ring buffer;
+// the ring is written from the esp_timer task (see update()) and read from loop()
+#define PRESSURE_RING_SIZE (256) // raw samples, ~1 s at 250 Hz
+#define PRESSURE_SAMPLES_PER_LINE (16) // raw samples per line of logRawSamples()
+
+// ADC to pressure conversion table, in centibar, indexed by the 12 bit ADC value
+#define PRESSURE_ADC_RANGE (4096)
+
 extern float pressure;
 
+// two calibration points: measured ADC value at a known pressure
+typedef struct {
+  uint16_t adcLow;
+  uint16_t centibarLow;
+  uint16_t adcHigh;
+  uint16_t centibarHigh;
+} pressurecalibration_t;
+
 class PressureSensor {
 private:
-  float pressureMaxLimit;
-  float pressureMinLimit;
+  uint16_t pressureMaxLimit; // in centibar
+  uint16_t pressureMinLimit; // in centibar
   bool pressureIsAboveMaximum; // Compressor must be switched off above this limit for safety
   bool pressureIsBelowMinimum; // If compressor was switched off because pressure was to high, 
                                // compressor can be switched on again if pressure becomes below this limit
+  bool continuousSampling = false;
+  uint16_t rawSamples[PRESSURE_RING_SIZE];
+  uint16_t rawHead = 0;   // next entry to be written
+  uint16_t rawCount = 0;  // valid entries
+  unsigned long rawSamplesTotal = 0;
+  portMUX_TYPE rawSamplesLock = portMUX_INITIALIZER_UNLOCKED;
+  pressurecalibration_t calibration;
+  uint16_t adcToCentibar[PRESSURE_ADC_RANGE];
+  wheeltimer_t sampleTimer;
+
+  static void sample(void *context);
+  bool readDMASamples();
+  void addRawSample(uint16_t adcValue);
+  uint16_t medianOfLastSamples(uint16_t nrOfSamples);
+  void setPressure(int adcValue);
+  void buildConversionTable();
+  bool loadCalibration();
+  bool saveCalibration();
 
 public:
   PressureSensor(float maxPressureLimit, float minPressureLimit);
   
   bool newCalibrationInfoAvailable;
   
-  void loop();
+  void begin();
+
+  // with continuous sampling: collects the DMA samples and filters them into the pressure,
+  // from the safety interlock every SAFETY_INTERLOCK_PERIOD ms (see SafetyInterlock.h)
+  void update();
 
   void logInfoCalibration();
 
   bool tooHighPressure();
 
   bool lowPressure();
-};
\ No newline at end of file
+
+  uint16_t toCentibar(int adcValue) { return adcToCentibar[adcValue & (PRESSURE_ADC_RANGE - 1)]; }
+
+  // use the current (filtered) ADC value as calibration point for the given pressure;
+  // below PRESSURE_CALIBRATE_SPLIT bar it replaces the low point, otherwise the high point
+  bool calibrate(float referencePressure);
+
+  void logCalibration();
+
+  // copy up to maxSamples of the most recent raw ADC samples (oldest first) for diagnostics
+  uint16_t getRawSamples(uint16_t *buffer, uint16_t maxSamples);
+
+  unsigned long getRawSamplesTotal();
+
+  // log the most recent raw ADC samples (oldest first), for the samples command of the master
+  void logRawSamples(uint16_t nrOfSamples);
+};
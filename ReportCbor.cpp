@@ -0,0 +1,203 @@
+#include "ReportCbor.h"
+
+// head: major type in the top 3 bits, the value in the low 5 bits (< 24) or in the 1, 2, 4 or 8 bytes that follow
+void CborWriter::writeHead(uint8_t majorType, uint64_t value) {
+  uint8_t nrOfBytes;
+  uint8_t info;
+
+  if (value < 24) {
+    nrOfBytes = 0;
+    info = value;
+  } else if (value <= 0xff) {
+    nrOfBytes = 1;
+    info = 24;
+  } else if (value <= 0xffff) {
+    nrOfBytes = 2;
+    info = 25;
+  } else if (value <= 0xffffffff) {
+    nrOfBytes = 4;
+    info = 26;
+  } else {
+    nrOfBytes = 8;
+    info = 27;
+  }
+  if (used + 1 + nrOfBytes > size) {
+    overflow = true;
+    return;
+  }
+  buffer[used++] = (majorType << 5) | info;
+  while (nrOfBytes > 0) {
+    nrOfBytes--;
+    buffer[used++] = (value >> (8 * nrOfBytes)) & 0xff;
+  }
+}
+
+void CborWriter::integer(int64_t value) {
+  if (value < 0) {
+    writeHead(CBOR_NEGINT, (uint64_t)(-1 - value));
+  } else {
+    writeHead(CBOR_UINT, value);
+  }
+}
+
+bool writeReport(CborWriter &cbor, const reportvalues_t *values, uint16_t keyMask, uint8_t sensorMask) {
+  uint8_t nrOfKeys = 0;
+  uint8_t nrOfSensors = 0;
+
+  keyMask |= CBOR_KEY_BIT(CBOR_KEY_VERSION);
+  for (uint8_t key = CBOR_KEY_VERSION; key <= CBOR_KEY_LOOP; key++) {
+    if (keyMask & CBOR_KEY_BIT(key)) {
+      nrOfKeys++;
+    }
+  }
+  for (uint8_t i = 0; i < values->nrOfTempSensors; i++) {
+    if (sensorMask & (1 << i)) {
+      nrOfSensors++;
+    }
+  }
+
+  cbor.map(nrOfKeys);
+  cbor.uint(CBOR_KEY_VERSION);
+  cbor.uint(REPORT_CBOR_VERSION);
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_STATE)) {
+    cbor.uint(CBOR_KEY_STATE);
+    cbor.uint(values->machinestate);
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_POWERED_TIME)) {
+    cbor.uint(CBOR_KEY_POWERED_TIME);
+    cbor.uint(values->poweredTime);
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_RUNNING_TIME)) {
+    cbor.uint(CBOR_KEY_RUNNING_TIME);
+    cbor.uint(values->runningTime);
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_PRESSURE)) {
+    cbor.uint(CBOR_KEY_PRESSURE);
+    cbor.integer(values->pressure);
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_OIL_LEVEL)) {
+    cbor.uint(CBOR_KEY_OIL_LEVEL);
+    cbor.uint(values->oilLevel);
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_OPTO1)) {
+    cbor.uint(CBOR_KEY_OPTO1);
+    cbor.boolean(values->opto1);
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_OTA)) {
+    cbor.uint(CBOR_KEY_OTA);
+    cbor.boolean(values->ota);
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_TEMPERATURES)) {
+    cbor.uint(CBOR_KEY_TEMPERATURES);
+    cbor.array(nrOfSensors);
+    for (uint8_t i = 0; i < values->nrOfTempSensors; i++) {
+      const reporttemperature_t &temp = values->temp[i];
+
+      if (!(sensorMask & (1 << i))) {
+        continue;
+      }
+      cbor.array(4);
+      cbor.uint(temp.number);
+      if (temp.available) {
+        cbor.integer(temp.temperature);
+      } else {
+        cbor.null();
+      }
+      cbor.uint(temp.level);
+      cbor.uint(temp.crcErrors);
+    }
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_LOOP)) {
+    cbor.uint(CBOR_KEY_LOOP);
+    cbor.array(NR_OF_LOOP_STAGES);
+    for (uint8_t i = 0; i < NR_OF_LOOP_STAGES; i++) {
+      cbor.array(3);
+      cbor.uint(values->loop[i][0]);
+      cbor.uint(values->loop[i][1]);
+      cbor.uint(values->loop[i][2]);
+    }
+  }
+  return cbor.ok();
+}
+
+bool CborReader::next(cboritem_t *item) {
+  uint8_t info;
+  uint8_t nrOfBytes;
+
+  if (position >= size) {
+    return false;
+  }
+  item->majorType = buffer[position] >> 5;
+  info = buffer[position] & 0x1f;
+  position++;
+  if (info < 24) {
+    item->value = info;
+    return true;
+  }
+  if (info > 27) {
+    return false; // indefinite length, not used by the report
+  }
+  nrOfBytes = 1 << (info - 24);
+  if (position + nrOfBytes > size) {
+    return false;
+  }
+  item->value = 0;
+  while (nrOfBytes > 0) {
+    item->value = (item->value << 8) | buffer[position++];
+    nrOfBytes--;
+  }
+  return true;
+}
+
+bool CborReader::integer(int64_t *value) {
+  cboritem_t item;
+
+  if (!next(&item)) {
+    return false;
+  }
+  if (item.majorType == CBOR_UINT) {
+    *value = (int64_t)item.value;
+    return true;
+  }
+  if (item.majorType == CBOR_NEGINT) {
+    *value = -1 - (int64_t)item.value;
+    return true;
+  }
+  return false;
+}
+
+bool CborReader::skip() {
+  cboritem_t item;
+
+  if (!next(&item)) {
+    return false;
+  }
+  switch (item.majorType) {
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+      if (position + item.value > size) {
+        return false;
+      }
+      position += item.value;
+      return true;
+    case CBOR_ARRAY:
+      for (uint64_t i = 0; i < item.value; i++) {
+        if (!skip()) {
+          return false;
+        }
+      }
+      return true;
+    case CBOR_MAP:
+      for (uint64_t i = 0; i < 2 * item.value; i++) {
+        if (!skip()) {
+          return false;
+        }
+      }
+      return true;
+    case CBOR_SIMPLE:
+      // the value of a float follows the head, CBOR_NULL etc. have none
+      return true;
+    default:
+      return true;
+  }
+}
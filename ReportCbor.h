@@ -0,0 +1,141 @@
+#pragma once
+
+#include <Arduino.h>
+#include "TempSensor.h"
+#include "LoopProfiler.h"
+
+// Compact report, next to the JSON report of ACNode: a CBOR (RFC 8949) map
+// with small integer keys and numeric values, published on REPORT_CBOR_TOPIC.
+// Schema, version REPORT_CBOR_VERSION:
+//
+//   0: uint     schema version
+//   1: uint     machine state, machinestates_t of MachState.h
+//   2: uint     powered time, in s
+//   3: uint     running time, in s
+//   4: int      pressure, in 0.01 bar
+//   5: uint     oil level, reportlevel_t
+//   6: bool     opto1, the motor has power
+//   7: bool     OTA enabled
+//   8: array    per temperature sensor: [number, temperature in 0.01 degrees Celcius
+//               or null when not read, reportlevel_t, number of CRC errors]
+//   9: array    per loopstage_t: [p50, p99, max] in us, only when the loop profiler is reported
+//
+// A heartbeat report holds all keys, a change report (see ReportFilter.h)
+// only the version and the keys that changed, of key 8 only the sensors that
+// changed. New keys get new numbers, a consumer skips keys it does not know.
+#define REPORT_CBOR_TOPIC "report_cbor"
+#define REPORT_CBOR_VERSION (1)
+#define REPORT_CBOR_MAX_SIZE (200) // in bytes, fits the default MQTT_MAX_PACKET_SIZE of 256 with the topic
+
+typedef enum {
+  CBOR_KEY_VERSION = 0,
+  CBOR_KEY_STATE = 1,
+  CBOR_KEY_POWERED_TIME = 2,
+  CBOR_KEY_RUNNING_TIME = 3,
+  CBOR_KEY_PRESSURE = 4,
+  CBOR_KEY_OIL_LEVEL = 5,
+  CBOR_KEY_OPTO1 = 6,
+  CBOR_KEY_OTA = 7,
+  CBOR_KEY_TEMPERATURES = 8,
+  CBOR_KEY_LOOP = 9
+} reportcborkey_t;
+
+typedef enum {
+  REPORT_OK = 0,
+  REPORT_WARNING = 1,
+  REPORT_ERROR = 2, // the compressor is disabled
+  REPORT_NOT_AVAILABLE = 3 // sensor not found or not reacting
+} reportlevel_t;
+
+#define CBOR_KEY_BIT(key) (1 << (key))
+#define CBOR_ALL_KEYS (CBOR_KEY_BIT(CBOR_KEY_LOOP + 1) - 1)
+
+// the values of a report, in the units of the schema
+typedef struct {
+  uint8_t number;
+  bool available;
+  int32_t temperature; // in 0.01 degrees Celcius
+  uint8_t level; // reportlevel_t
+  uint32_t crcErrors;
+} reporttemperature_t;
+
+typedef struct {
+  uint8_t machinestate;
+  uint32_t poweredTime; // in s
+  uint32_t runningTime; // in s
+  int32_t pressure; // in 0.01 bar
+  uint8_t oilLevel; // reportlevel_t
+  bool opto1;
+  bool ota;
+  uint8_t nrOfTempSensors;
+  reporttemperature_t temp[MAX_NR_OF_TEMP_SENSORS];
+  uint32_t loop[NR_OF_LOOP_STAGES][3]; // p50, p99, max in us
+} reportvalues_t;
+
+// CBOR major types
+#define CBOR_UINT (0)
+#define CBOR_NEGINT (1)
+#define CBOR_BYTES (2)
+#define CBOR_TEXT (3)
+#define CBOR_ARRAY (4)
+#define CBOR_MAP (5)
+#define CBOR_SIMPLE (7) // false, true, null, floats
+
+#define CBOR_FALSE (20)
+#define CBOR_TRUE (21)
+#define CBOR_NULL (22)
+
+// definite length items into a fixed buffer, without heap
+class CborWriter {
+private:
+  uint8_t *buffer;
+  size_t size;
+  size_t used = 0;
+  bool overflow = false;
+
+  void writeHead(uint8_t majorType, uint64_t value);
+
+public:
+  CborWriter(uint8_t *outputBuffer, size_t bufferSize) : buffer(outputBuffer), size(bufferSize) {}
+
+  void map(size_t nrOfPairs) { writeHead(CBOR_MAP, nrOfPairs); }
+  void array(size_t nrOfItems) { writeHead(CBOR_ARRAY, nrOfItems); }
+  void uint(uint64_t value) { writeHead(CBOR_UINT, value); }
+  void integer(int64_t value);
+  void boolean(bool value) { writeHead(CBOR_SIMPLE, value ? CBOR_TRUE : CBOR_FALSE); }
+  void null() { writeHead(CBOR_SIMPLE, CBOR_NULL); }
+
+  size_t length() { return used; }
+  // false if the buffer was too small, the output is incomplete
+  bool ok() { return !overflow; }
+};
+
+// reference decoder for consumers: reads the head of one item at a time
+typedef struct {
+  uint8_t majorType;
+  uint64_t value; // the value, length or simple value; for CBOR_NEGINT the value is -1 - value
+} cboritem_t;
+
+class CborReader {
+private:
+  const uint8_t *buffer;
+  size_t size;
+  size_t position = 0;
+
+public:
+  CborReader(const uint8_t *inputBuffer, size_t bufferSize) : buffer(inputBuffer), size(bufferSize) {}
+
+  // false at the end of the buffer or for items this decoder does not handle
+  bool next(cboritem_t *item);
+
+  // reads an int or uint, false for other items
+  bool integer(int64_t *value);
+
+  // skips an item including its content
+  bool skip();
+
+  bool atEnd() { return position >= size; }
+};
+
+// writes the map with the version and the keys in keyMask, of key 8 only the sensors in sensorMask
+bool writeReport(CborWriter &cbor, const reportvalues_t *values, uint16_t keyMask, uint8_t sensorMask);
@@ -0,0 +1,66 @@
+#include "ReportFilter.h"
+
+uint16_t ReportFilter::changes(const reportvalues_t *values, unsigned long deadbandInterval, uint8_t *sensorMask) {
+  uint16_t keyMask = 0;
+  bool deadband = (millis() - lastDeadbandReport >= deadbandInterval);
+
+  *sensorMask = 0;
+  if (!valid) {
+    // nothing reported yet, the heartbeat report comes first
+    return 0;
+  }
+  if (values->machinestate != last.machinestate) {
+    keyMask |= CBOR_KEY_BIT(CBOR_KEY_STATE);
+  }
+  if (deadband && (abs(values->pressure - last.pressure) >= REPORT_PRESSURE_DEADBAND)) {
+    keyMask |= CBOR_KEY_BIT(CBOR_KEY_PRESSURE);
+  }
+  if (values->oilLevel != last.oilLevel) {
+    keyMask |= CBOR_KEY_BIT(CBOR_KEY_OIL_LEVEL);
+  }
+  if (values->opto1 != last.opto1) {
+    keyMask |= CBOR_KEY_BIT(CBOR_KEY_OPTO1);
+  }
+  for (uint8_t i = 0; i < values->nrOfTempSensors; i++) {
+    const reporttemperature_t &now = values->temp[i];
+    const reporttemperature_t &before = last.temp[i];
+
+    if ((now.available != before.available) || (now.level != before.level) || (now.crcErrors != before.crcErrors) ||
+        (deadband && now.available && (abs(now.temperature - before.temperature) >= REPORT_TEMPERATURE_DEADBAND))) {
+      *sensorMask |= 1 << i;
+    }
+  }
+  if (*sensorMask != 0) {
+    keyMask |= CBOR_KEY_BIT(CBOR_KEY_TEMPERATURES);
+  }
+  return keyMask;
+}
+
+void ReportFilter::reported(const reportvalues_t *values, uint16_t keyMask, uint8_t sensorMask) {
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_STATE)) {
+    last.machinestate = values->machinestate;
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_PRESSURE)) {
+    last.pressure = values->pressure;
+    lastDeadbandReport = millis();
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_OIL_LEVEL)) {
+    last.oilLevel = values->oilLevel;
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_OPTO1)) {
+    last.opto1 = values->opto1;
+  }
+  if (keyMask & CBOR_KEY_BIT(CBOR_KEY_TEMPERATURES)) {
+    lastDeadbandReport = millis();
+    last.nrOfTempSensors = values->nrOfTempSensors;
+    for (uint8_t i = 0; i < values->nrOfTempSensors; i++) {
+      if (sensorMask & (1 << i)) {
+        last.temp[i] = values->temp[i];
+      }
+    }
+  }
+  // the first heartbeat report is the reference
+  if ((keyMask & REPORT_FILTERED_KEYS) == REPORT_FILTERED_KEYS) {
+    valid = true;
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ReportCbor.h"
+
+// Change driven reporting: a state or level is reported as soon as it
+// changes, a value when it moved more than its deadband away from the value
+// that was reported last, at most once per deadband interval. Powered and
+// running time and the loop profiler only go out with the heartbeat report,
+// which holds all keys.
+#define REPORT_PRESSURE_DEADBAND (10) // in 0.01 bar
+#define REPORT_TEMPERATURE_DEADBAND (50) // in 0.01 degrees Celcius
+
+#define REPORT_FILTERED_KEYS (CBOR_KEY_BIT(CBOR_KEY_STATE) | CBOR_KEY_BIT(CBOR_KEY_PRESSURE) | CBOR_KEY_BIT(CBOR_KEY_OIL_LEVEL) | \
+                              CBOR_KEY_BIT(CBOR_KEY_OPTO1) | CBOR_KEY_BIT(CBOR_KEY_TEMPERATURES))
+
+class ReportFilter {
+private:
+  reportvalues_t last;
+  bool valid = false;
+  unsigned long lastDeadbandReport = 0;
+
+public:
+  // the keys and sensors that changed since they were reported, 0 if nothing changed;
+  // deadbandInterval in ms
+  uint16_t changes(const reportvalues_t *values, unsigned long deadbandInterval, uint8_t *sensorMask);
+
+  // remembers what was sent, a heartbeat report passes all keys and all sensors
+  void reported(const reportvalues_t *values, uint16_t keyMask, uint8_t sensorMask);
+};
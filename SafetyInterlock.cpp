@@ -0,0 +1,61 @@
+#include "SafetyInterlock.h"
+#include <ACNode.h>
+
+SafetyInterlock theSafetyInterlock;
+
+void SafetyInterlock::check(void *arg) {
+  SafetyInterlock *interlock = (SafetyInterlock *)arg;
+  int64_t now = esp_timer_get_time();
+  uint32_t interval = now - interlock->lastCheck;
+  uint32_t latency;
+
+  interlock->counters.checks++;
+  if (interval > interlock->counters.worstCheckInterval) {
+    interlock->counters.worstCheckInterval = interval;
+  }
+  interlock->lastCheck = now;
+  if (!interlock->mustSwitchOff() || (digitalRead(interlock->relayPin) == LOW)) {
+    interlock->lastSafe = now;
+    return;
+  }
+  digitalWrite(interlock->relayPin, LOW);
+  interlock->isTripped = true;
+  latency = esp_timer_get_time() - interlock->lastSafe;
+  interlock->counters.trips++;
+  if (latency > interlock->counters.worstTripLatency) {
+    interlock->counters.worstTripLatency = latency;
+  }
+  interlock->lastSafe = now;
+}
+
+void SafetyInterlock::begin(uint8_t relayPin, safetycheck_t mustSwitchOff) {
+  esp_timer_create_args_t timerArgs;
+  esp_err_t err;
+
+  this->relayPin = relayPin;
+  this->mustSwitchOff = mustSwitchOff;
+  lastCheck = esp_timer_get_time();
+  lastSafe = lastCheck;
+
+  timerArgs.callback = check;
+  timerArgs.arg = this;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name = "safety";
+  timerArgs.skip_unhandled_events = false;
+  err = esp_timer_create(&timerArgs, &checkTimer);
+  if (err == ESP_OK) {
+    err = esp_timer_start_periodic(checkTimer, (uint64_t)SAFETY_INTERLOCK_PERIOD * 1000);
+  }
+  timerIsRunning = (err == ESP_OK);
+  if (!timerIsRunning) {
+    Log.print("Safety interlock timer not available (error ");
+    Log.print(err);
+    Log.println("), the check runs from loop()");
+  }
+}
+
+void SafetyInterlock::loop() {
+  if (!timerIsRunning && (mustSwitchOff != NULL)) {
+    check(this);
+  }
+}
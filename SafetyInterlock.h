@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <atomic>
+
+// Safety interlock: switches the relay off when the compressor must stop for
+// safety (pressure above its maximum, oil level too low, temperature too
+// high), without waiting for loop(). A periodic esp_timer calls the check
+// every SAFETY_INTERLOCK_PERIOD ms from the esp_timer task, which has a higher
+// priority than the TCP/IP and Ethernet tasks and does not run on the core of
+// loop(), where node.loop() blocks on reconnects, DNS and OTA checks. The
+// check collects the pressure samples itself (see PressureSensor::update()),
+// so a stalled loop() does not leave it with an old pressure.
+//
+// The relay is off at most SAFETY_INTERLOCK_PERIOD ms plus the dispatch delay
+// of the esp_timer task after a fault is known. loop() still does the rest:
+// the machine state, the LEDs, the display and the log. It learns of a trip
+// from takeTrip(), as the fault may be gone by the time it runs again (a
+// pressure just above the maximum falls back once the motor stopped).
+//
+// If the timer cannot be created or started, compressorLoop() calls the check
+// through loop(), so the pressure is still sampled and the relay is switched
+// off in the next pass of loop().
+#define SAFETY_INTERLOCK_PERIOD (5) // in ms
+
+typedef bool (*safetycheck_t)(); // in the esp_timer task, true if the relay must be off
+
+typedef struct {
+  uint32_t checks;
+  uint32_t trips; // the check switched the relay off
+  uint32_t worstTripLatency; // in us, from the last check with the relay safe to the relay off
+  uint32_t worstCheckInterval; // in us, between two checks
+} safetyinterlockcounters_t;
+
+class SafetyInterlock {
+private:
+  uint8_t relayPin;
+  safetycheck_t mustSwitchOff = NULL;
+  esp_timer_handle_t checkTimer = NULL;
+  bool timerIsRunning = false;
+  int64_t lastCheck = 0;
+  int64_t lastSafe = 0; // the relay was off or there was no fault
+  std::atomic<bool> isTripped { false };
+
+  static void check(void *arg);
+
+public:
+  volatile safetyinterlockcounters_t counters = { 0, 0, 0, 0 };
+
+  // after the relay pin is an output and the modules the check reads are started
+  void begin(uint8_t relayPin, safetycheck_t mustSwitchOff);
+
+  // from loop(), the check when the timer did not start
+  void loop();
+
+  bool timerRunning() { return timerIsRunning; }
+
+  // true once after the check switched the relay off
+  bool takeTrip() { return isTripped.exchange(false); }
+};
+
+extern SafetyInterlock theSafetyInterlock;
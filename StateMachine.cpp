@@ -0,0 +1,17 @@
+#include "StateMachine.h"
+
+const char *eventLabel[NR_OF_MACHINE_EVENTS] =
+{
+  "connected",
+  "disconnected",
+  "error",
+  "timeout",
+  "switch_on",
+  "switch_off",
+  "motor_started",
+  "motor_stopped",
+};
+
+const char *machineEventLabel(machineevent_t event) {
+  return eventLabel[event];
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Arduino.h>
+#include <MachState.h>
+
+// The transitions of machinestate as a table over (state, event), see
+// machineTransitions in main.cpp. machineEvent() looks the transition up in
+// constant time, checks its guard and runs the exit action of the old state
+// and the entry action of the new one (the table state[] in main.cpp). The
+// entry and exit actions are the only code that switches the relay and the
+// state LEDs; the interrupt of the Off button and the safety interlock still
+// switch the relay off directly, loop() follows with MACHINE_SWITCH_OFF.
+//
+// Every cell of the table is filled in, with STAY for an event that is
+// ignored in a state; bench_states enumerates the table on the host.
+#define NR_OF_MACHINE_STATES (RUNNING + 1)
+#define MACHINE_NO_TRANSITION (0xff)
+
+typedef enum {
+  MACHINE_CONNECTED, // node.onConnect()
+  MACHINE_DISCONNECTED, // node.onDisconnect()
+  MACHINE_ERROR, // node.onError()
+  MACHINE_TIMEOUT, // maxTimeInMilliSeconds of the state passed
+  MACHINE_SWITCH_ON, // On button, poweron command, manual override, the pressure is low again after a pressure error
+  MACHINE_SWITCH_OFF, // Off button, stop command, a fault, the automatic power off
+  MACHINE_MOTOR_STARTED, // opto1 is on
+  MACHINE_MOTOR_STOPPED, // opto1 is off
+  NR_OF_MACHINE_EVENTS
+} machineevent_t;
+
+typedef bool (*machineguard_t)(); // false refuses the transition
+
+typedef struct {
+  bool handled; // filled in, the table is complete when every cell is
+  machinestates_t next; // MACHINE_NO_TRANSITION: the event is ignored
+  machineguard_t guard; // NULL: always
+} machinetransition_t;
+
+#define STAY { true, MACHINE_NO_TRANSITION, NULL }
+#define GO(next) { true, next, NULL }
+#define GO_IF(next, guard) { true, next, guard }
+
+extern const machinetransition_t machineTransitions[NR_OF_MACHINE_STATES][NR_OF_MACHINE_EVENTS];
+
+// true if the event changed the state (or entered the same state again)
+bool machineEvent(machineevent_t event);
+
+const char *machineStateLabel(machinestates_t machineState);
+const char *machineEventLabel(machineevent_t event);
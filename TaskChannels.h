@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+// Lock free channels between two tasks, without heap.
+//
+// SpscRing: a ring of N entries with one producer and one consumer; push()
+// fails when the ring is full, nothing is overwritten.
+//
+// SnapshotBuffer: the latest value of T, published by one task and read by
+// another, in two buffers with a sequence number each that is odd while the
+// buffer is written, as the display snapshot of OledDisplay.h. A read only
+// hands out its copy when the buffer was not rewritten while it was copied.
+template <typename T, uint8_t N>
+class SpscRing {
+private:
+  T entries[N];
+  std::atomic<uint32_t> head { 0 }; // next entry to write, only the producer writes it
+  std::atomic<uint32_t> tail { 0 }; // next entry to read, only the consumer writes it
+
+public:
+  bool push(const T &entry) {
+    uint32_t position = head.load(std::memory_order_relaxed);
+
+    if (position - tail.load(std::memory_order_acquire) >= N) {
+      return false;
+    }
+    entries[position % N] = entry;
+    head.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T *entry) {
+    uint32_t position = tail.load(std::memory_order_relaxed);
+
+    if (position == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *entry = entries[position % N];
+    tail.store(position + 1, std::memory_order_release);
+    return true;
+  }
+};
+
+template <typename T>
+class SnapshotBuffer {
+private:
+  T snapshots[2];
+  std::atomic<uint32_t> sequence[2] = { { 0 }, { 0 } };
+  std::atomic<uint8_t> published { 0 };
+
+public:
+  void publish(const T &snapshot) {
+    uint8_t next = published.load() ^ 1;
+
+    sequence[next].fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_release);
+    snapshots[next] = snapshot;
+    std::atomic_thread_fence(std::memory_order_release);
+    sequence[next].fetch_add(1);
+    published.store(next);
+  }
+
+  // false if nothing was published yet or the publisher kept rewriting it
+  bool read(T *snapshot) {
+    for (uint8_t attempt = 0; attempt < 3; attempt++) {
+      uint8_t current = published.load();
+      uint32_t before = sequence[current].load();
+
+      if (before & 1) {
+        continue;
+      }
+      T copy = snapshots[current];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if ((sequence[current].load() == before) && (before != 0)) {
+        *snapshot = copy;
+        return true;
+      }
+    }
+    return false;
+  }
+};
@@ -1,7 +1,10 @@
 #include "TempSensor.h"
 #include "OledDisplay.h"
+#include "OneWireRmt.h"
 #include <OneWire.h> 
 #include <ACNode.h>
+#include "LogEvent.h"
+#include "FaultMask.h"
 
 #ifndef TEMPSENSOR
 #define TEMPSENSOR      ( 4)  // one wire digital input (GPIO4)
@@ -16,133 +19,311 @@
 
 #define MAX_TEMP_IS_TOO_HIGH_WINDOW (10000) // in ms default 10000 = 10 seconds. Error is only signalled after this time window is passed
 
+// levels of a sensor that is found on the bus but not configured
+#define DEFAULT_TEMP_IS_HIGH_LEVEL (60.0) // in degrees Celcius
+#define DEFAULT_TEMP_IS_TOO_HIGH_LEVEL (90.0) // in degrees Celcius
+
 // temperature sensor
 OneWire oneWire(ONE_WIRE_BUS); // used for the temperature sensor
 DallasTemperature sensorTemp(&oneWire);
+OneWireRmt oneWireRmt; // after the sensors are found the bus is driven by the RMT
+
+TempSensorBus theTempSensorBus;
+
+TempSensorRegistry theTempSensors;
+
+TempSensorBus::TempSensorBus() {
+  conversionTime = MAX_TEMP_CONVERSIONTIME / (1 << (12 - TEMP_RESOLUTION));
+}
+
+void TempSensorBus::begin() {
+  sensorTemp.begin();
+  sensorTemp.setWaitForConversion(false);
+}
+
+void TempSensorBus::startRmt() {
+  if (!oneWireRmt.begin(ONE_WIRE_BUS)) {
+    Log.println("Temperature sensors: RMT not available, the OneWire bus is bit-banged");
+  }
+}
+
+void TempSensorBus::conversionStarted(onewireresult_t result, const uint8_t *data, void *context) {
+  TempSensorBus *bus = (TempSensorBus *)context;
+
+  // without an answer the sensors fail to read and report it
+  theTimerWheel.restart(&bus->conversionTimer, bus->conversionTime);
+}
+
+void TempSensorBus::conversionDone(void *context) {
+  TempSensorBus *bus = (TempSensorBus *)context;
+
+  bus->converting = false;
+  bus->conversionNr++;
+  bus->nrOfReads = 0;
+  bus->waitingForReads = true;
+}
+
+void TempSensorBus::addSensor() {
+  nrOfSensors++;
+}
+
+void TempSensorBus::loop() {
+  if (nrOfSensors == 0) {
+    return;
+  }
+  if (converting) {
+    return;
+  }
+  if (!waitingForReads) {
+    // skip ROM, convert T: all sensors convert at the same time
+    if (oneWireRmt.isAvailable()) {
+      if (!oneWireRmt.convertAll(conversionStarted, this)) {
+        return;
+      }
+      theTimerWheel.start(&conversionTimer, ONEWIRE_RMT_TIMEOUT + conversionTime, 0, conversionDone, this);
+    } else {
+      sensorTemp.requestTemperatures();
+      theTimerWheel.start(&conversionTimer, conversionTime, 0, conversionDone, this);
+    }
+    converting = true;
+  }
+}
 
-int currentTempSensor = 0;
+void TempSensorBus::readDone() {
+  nrOfReads++;
+  if (nrOfReads >= nrOfSensors) {
+    waitingForReads = false;
+  }
+}
 
-TemperatureSensor::TemperatureSensor(float tempIsHighLevel, float tempIsTooHighLevel, const char *tempLabel) {
-  tempSensorNr = currentTempSensor++;
+void TemperatureSensor::configure(int sensorNr, float tempIsHighLevel, float tempIsTooHighLevel, const char *tempLabel, const char *reportKey) {
+  tempSensorNr = sensorNr;
 	theTempIsHighLevel = tempIsHighLevel;
 	theTempIsTooHighLevel = tempIsTooHighLevel;
-  conversionTime = MAX_TEMP_CONVERSIONTIME / (1 << (12 - TEMP_RESOLUTION));
-  sprintf(labelTempSensor, "%s", tempLabel);
+  snprintf(labelTempSensor, sizeof(labelTempSensor), "%s", tempLabel);
+  snprintf(reportKeyTempSensor, sizeof(reportKeyTempSensor), "%s", reportKey);
+}
+
+// the flag and the fault of the sensor in theFaults
+void TemperatureSensor::setErrorTempIsTooHigh(bool error) {
+  ErrorTempIsTooHigh = error;
+  theFaults.set((fault_t)(FAULT_TEMPERATURE + tempSensorNr - 1), error);
 }
 
-void TemperatureSensor::begin() {
+void TemperatureSensor::begin(const uint8_t *deviceAddress) {
   tempIsHigh = false;
-  ErrorTempIsTooHigh = false;
-  if (tempSensorNr == 0) {
-    sensorTemp.begin();
-  }
+  setErrorTempIsTooHigh(false);
 
-  tempSensorAvailable = sensorTemp.getAddress(tempDeviceAddress, tempSensorNr);
+  tempSensorAvailable = (deviceAddress != NULL);
   if (!tempSensorAvailable) {
     temperature = -127;
 
     Log.print("Temperature sensor ");
-    Log.print(tempSensorNr + 1);
+    Log.print(tempSensorNr);
     Log.print(" (");
     Log.print(labelTempSensor);
     Log.println("): sensor not detected at init of node!");
     return;
   }
+  memcpy(tempDeviceAddress, deviceAddress, sizeof(DeviceAddress));
   sensorTemp.setResolution(tempDeviceAddress, TEMP_RESOLUTION);
-  sensorTemp.setWaitForConversion(false);
-  sensorTemp.requestTemperaturesByAddress(tempDeviceAddress);
-  tempAvailableTime = millis() + conversionTime;
+  theTempSensorBus.addSensor();
   tryCount = MAX_NR_OF_TRIES;
+
+  Log.print("Temperature sensor ");
+  Log.print(tempSensorNr);
+  Log.print(" (");
+  Log.print(labelTempSensor);
+  Log.print("): ROM address ");
+  for (uint8_t i = 0; i < sizeof(DeviceAddress); i++) {
+    Log.printf("%02X", tempDeviceAddress[i]);
+  }
+  Log.println("");
 }
 
-void TemperatureSensor::loop() {
-  if (!tempSensorAvailable) {
-    return;
+bool TemperatureSensor::loop() {
+  if (!tempSensorAvailable || readPending || ((theTempSensorBus.conversion() == lastConversion) && !retryRead)) {
+    return false;
   }
-  if (millis() > tempAvailableTime) {
+  if (oneWireRmt.isAvailable()) {
+    // the result comes in scratchpadRead(), from the loop of the registry
+    if (oneWireRmt.readScratchpad(tempDeviceAddress, scratchpadRead, this)) {
+      lastConversion = theTempSensorBus.conversion();
+      readPending = true;
+    }
+    return true;
+  }
+  lastConversion = theTempSensorBus.conversion();
+  currentTemperature = sensorTemp.getTempC(tempDeviceAddress);
+  if (currentTemperature == -127) {
     currentTemperature = sensorTemp.getTempC(tempDeviceAddress);
-    if (currentTemperature == -127) {
-      currentTemperature = sensorTemp.getTempC(tempDeviceAddress);
+  }
+  newReading();
+  return true;
+}
+
+void TemperatureSensor::scratchpadRead(onewireresult_t result, const uint8_t *data, void *context) {
+  TemperatureSensor *sensor = (TemperatureSensor *)context;
+  int16_t raw;
+
+  sensor->readPending = false;
+  sensor->lastReadResult = result;
+  if (result == ONEWIRE_OK) {
+    // 1/16 degrees, the bits below the resolution are undefined
+    raw = (int16_t)((data[1] << 8) | data[0]);
+    raw &= ~((1 << (12 - TEMP_RESOLUTION)) - 1);
+    sensor->currentTemperature = raw / 16.0;
+  } else {
+    if (result == ONEWIRE_CRC_ERROR) {
+      sensor->crcErrors++;
     }
-    if (currentTemperature == -127) {
-      if (tryCount > 0) {
-        tryCount--;
-        tempAvailableTime = millis() + conversionTime;
-        return;
+    sensor->currentTemperature = -127;
+    // read once more before the reading counts as failed
+    if (!sensor->retryRead) {
+      sensor->retryRead = true;
+      return;
+    }
+  }
+  sensor->retryRead = false;
+  sensor->newReading();
+}
+
+void TemperatureSensor::newReading() {
+  theTempSensorBus.readDone();
+  if (currentTemperature == -127) {
+    if (tryCount > 0) {
+      tryCount--;
+      return;
+    } else {
+      notReacting = true;
+      if (lastReadResult == ONEWIRE_CRC_ERROR) {
+        logEvent(EVENT_TEMP_CRC_NOT_REACTING, tempSensorNr);
       } else {
-        Log.print("Temperature sensor ");
-        Log.print(tempSensorNr + 1);
-        Log.print(" (");
-        Log.print(labelTempSensor);
-        Log.println("): sensor does not react, perhaps not available?");
+        logEvent(EVENT_TEMP_NOT_REACTING, tempSensorNr);
       }
-    } else {
-      if (currentTemperature != previousTemperature) {
-        previousTemperature = currentTemperature;
-        temperature = currentTemperature;
+    }
+  } else {
+    notReacting = false;
+    if (currentTemperature != previousTemperature) {
+      previousTemperature = currentTemperature;
+      temperature = currentTemperature;
 /*        
-        Serial.print("Temperature ");
-        Serial.print(tempSensor + 1);
-        Serial.print(" changed, current temperature = ");
-        Serial.print(temperature);
-        Serial.println(" degrees C");
+      Serial.print("Temperature ");
+      Serial.print(tempSensor + 1);
+      Serial.print(" changed, current temperature = ");
+      Serial.print(temperature);
+      Serial.println(" degrees C");
 */        
-      }
     }
-    tryCount = MAX_NR_OF_TRIES;
-    sensorTemp.requestTemperaturesByAddress(tempDeviceAddress);
-    tempAvailableTime = millis() + conversionTime;
-    if (temperature <= theTempIsHighLevel) {
-      if (tempIsHigh) {
-        Log.print("Temperature sensor ");
-        Log.print(tempSensorNr + 1);
-        Log.print(" (");
-        Log.print(labelTempSensor);
-        Log.println("): temperature is OK now (below warning threshold)");
-      }
-      tempIsHigh = false;
-      if (ErrorTempIsTooHigh)
-      {
-        nextTimeDisplay = true;
-      }
-      ErrorTempIsTooHigh = false;
-      tempIsTooHighStart = 0;
-    } else {
-      if (!tempIsHigh) {
-        Log.print("WARNING: temperature sensor ");
-        Log.print(tempSensorNr + 1);
-        Log.print(" (");
-        Log.print(labelTempSensor);
-        Log.println("): temperature is above warning level. Please check the compressor");
-      }
-      tempIsHigh = true;
-      if ((temperature > theTempIsTooHighLevel) && !ErrorTempIsTooHigh) {
-        if (tempIsTooHighStart == 0) {
-          tempIsTooHighStart = millis();
-        } else {
-          if (millis() > (tempIsTooHighStart + MAX_TEMP_IS_TOO_HIGH_WINDOW)) {
-            nextTimeDisplay = true;
-            ErrorTempIsTooHigh = true;
-            Log.print("ERROR, sensor ");
-            Log.print(tempSensorNr + 1);
-            Log.print(" (");
-            Log.print(labelTempSensor);
-            Log.println("): Temperature is too high, compressor is disabled. Please check the compressor!");
-          }
-        }
+  }
+  tryCount = MAX_NR_OF_TRIES;
+  if (temperature <= theTempIsHighLevel) {
+    if (tempIsHigh) {
+      logEvent(EVENT_TEMP_OK_NOW, tempSensorNr);
+    }
+    tempIsHigh = false;
+    if (ErrorTempIsTooHigh)
+    {
+      nextTimeDisplay = true;
+    }
+    setErrorTempIsTooHigh(false);
+    tempIsTooHighStart = 0;
+  } else {
+    if (!tempIsHigh) {
+      logEvent(EVENT_TEMP_ABOVE_WARNING, tempSensorNr);
+    }
+    tempIsHigh = true;
+    if ((temperature > theTempIsTooHighLevel) && !ErrorTempIsTooHigh) {
+      if (tempIsTooHighStart == 0) {
+        tempIsTooHighStart = uptimeMs();
       } else {
-        if ((temperature <= theTempIsTooHighLevel) && ErrorTempIsTooHigh) {
-          tempIsTooHighStart = 0;
-          ErrorTempIsTooHigh = false;
+        if (uptimeMs() > (tempIsTooHighStart + MAX_TEMP_IS_TOO_HIGH_WINDOW)) {
           nextTimeDisplay = true;
-          Log.print("WARNING, sensor ");
-          Log.print(tempSensorNr + 1);
-          Log.print(" (");
-          Log.print(labelTempSensor);
-          Log.println("): Temperature is below error level now, but still above warning level. Please check the compressor!");
+          setErrorTempIsTooHigh(true);
+          logEvent(EVENT_TEMP_ERROR, tempSensorNr);
         }
       }
+    } else {
+      if ((temperature <= theTempIsTooHighLevel) && ErrorTempIsTooHigh) {
+        tempIsTooHighStart = 0;
+        setErrorTempIsTooHigh(false);
+        nextTimeDisplay = true;
+        logEvent(EVENT_TEMP_BELOW_ERROR, tempSensorNr);
+      }
     }
   }
 }
 
+int TempSensorRegistry::findSensor(const tempsensorconfig_t *config, uint8_t nrOfConfigs, const uint8_t *deviceAddress, bool *assigned) {
+  static const DeviceAddress anyAddress = { 0 };
+  int firstFree = -1;
+
+  for (uint8_t i = 0; i < nrOfConfigs; i++) {
+    if (memcmp(config[i].address, deviceAddress, sizeof(DeviceAddress)) == 0) {
+      return i;
+    }
+    if ((firstFree < 0) && !assigned[i] && (memcmp(config[i].address, anyAddress, sizeof(DeviceAddress)) == 0)) {
+      firstFree = i;
+    }
+  }
+  return firstFree;
+}
+
+void TempSensorRegistry::begin(const tempsensorconfig_t *config, uint8_t nrOfConfigs) {
+  bool assigned[MAX_NR_OF_TEMP_SENSORS] = { false };
+  DeviceAddress deviceAddress;
+  uint8_t nrOfDevices;
+  char label[20];
+  char reportKey[48];
+  int index;
+
+  theTempSensorBus.begin();
+
+  if (nrOfConfigs > MAX_NR_OF_TEMP_SENSORS) {
+    nrOfConfigs = MAX_NR_OF_TEMP_SENSORS;
+  }
+  for (nrOfSensors = 0; nrOfSensors < nrOfConfigs; nrOfSensors++) {
+    sensors[nrOfSensors].configure(nrOfSensors + 1, config[nrOfSensors].tempIsHighLevel, config[nrOfSensors].tempIsTooHighLevel,
+                                   config[nrOfSensors].label, config[nrOfSensors].reportKey);
+  }
+
+  nrOfDevices = sensorTemp.getDeviceCount();
+  for (uint8_t device = 0; device < nrOfDevices; device++) {
+    if (!sensorTemp.getAddress(deviceAddress, device)) {
+      continue;
+    }
+    index = findSensor(config, nrOfConfigs, deviceAddress, assigned);
+    if ((index >= 0) && assigned[index]) {
+      continue; // the same ROM address twice in the configuration
+    }
+    if (index < 0) {
+      if (nrOfSensors >= MAX_NR_OF_TEMP_SENSORS) {
+        Log.println("Temperature sensors: too many sensors on the bus, sensor ignored");
+        continue;
+      }
+      index = nrOfSensors++;
+      sprintf(label, "Sensor %d", index + 1);
+      sprintf(reportKey, "temperature_sensor_%d", index + 1);
+      sensors[index].configure(index + 1, DEFAULT_TEMP_IS_HIGH_LEVEL, DEFAULT_TEMP_IS_TOO_HIGH_LEVEL, label, reportKey);
+    }
+    assigned[index] = true;
+    sensors[index].begin(deviceAddress);
+  }
+
+  for (uint8_t i = 0; i < nrOfConfigs; i++) {
+    if (!assigned[i]) {
+      sensors[i].begin(NULL);
+    }
+  }
+  theTempSensorBus.startRmt();
+}
+
+void TempSensorRegistry::loop() {
+  oneWireRmt.loop();
+  theTempSensorBus.loop();
+  for (uint8_t i = 0; i < nrOfSensors; i++) {
+    if (sensors[i].loop()) {
+      return;
+    }
+  }
+}
@@ -1,6 +1,55 @@
 #pragma once
 
 #include <DallasTemperature.h> // install DallasTemperature by Miles Burton
+#include "OneWireRmt.h"
+#include "TimerWheel.h"
+
+// One conversion for all sensors on the OneWire bus: a Skip-ROM "convert T"
+// starts all sensors at once, after the conversion time each sensor reads its
+// own scratchpad. The next conversion starts when all sensors have read.
+class TempSensorBus {
+private:
+  unsigned long conversionTime;
+  wheeltimer_t conversionTimer; // the conversion is done
+  uint32_t conversionNr = 0; // number of completed conversions
+  bool converting = false;
+  bool waitingForReads = false;
+  uint8_t nrOfSensors = 0;
+  uint8_t nrOfReads = 0;
+
+  static void conversionStarted(onewireresult_t result, const uint8_t *data, void *context);
+  static void conversionDone(void *context);
+
+public:
+  TempSensorBus();
+
+  void begin();
+
+  // after the sensors are found: convert and read through the RMT from here on
+  void startRmt();
+
+  void addSensor();
+
+  void loop();
+
+  uint32_t conversion() { return conversionNr; }
+
+  void readDone();
+};
+
+extern TempSensorBus theTempSensorBus;
+
+#define MAX_NR_OF_TEMP_SENSORS (8)
+
+// a sensor is found by its ROM address, an entry with address { 0 } takes the
+// first sensor on the bus that is not configured by its address
+typedef struct {
+  DeviceAddress address;
+  float tempIsHighLevel; // in degrees Celcius, warning
+  float tempIsTooHighLevel; // in degrees Celcius, the compressor is disabled
+  const char *label; // used in logging
+  const char *reportKey; // used in reporting, _error and _warning are appended for the messages
+} tempsensorconfig_t;
 
 class TemperatureSensor {
 
@@ -12,21 +61,60 @@ private:
 	float theTempIsHighLevel;
 	float theTempIsTooHighLevel;
 	float previousTemperature = -500;
-	unsigned long conversionTime;
-	unsigned long tempAvailableTime = 0;
-	unsigned long tempIsTooHighStart = 0;
+	uint32_t lastConversion = 0;
+	uint64_t tempIsTooHighStart = 0; // uptimeMs()
 	int tryCount;
 	char labelTempSensor[20];
+	char reportKeyTempSensor[48];
+	bool readPending = false;
+	bool retryRead = false;
+	onewireresult_t lastReadResult = ONEWIRE_OK;
+
+	static void scratchpadRead(onewireresult_t result, const uint8_t *data, void *context);
+
+	void newReading();
+	void setErrorTempIsTooHigh(bool error);
 
 public:
-  float temperature;
-  bool tempIsHigh;
-  bool ErrorTempIsTooHigh;
+  float temperature = -127;
+  bool notReacting = false; // the last readings failed, temperature is the last value read
+  uint32_t crcErrors = 0; // readings with a CRC error, a missing sensor is not counted
+  bool tempIsHigh = false;
+  bool ErrorTempIsTooHigh = false;
 
-  TemperatureSensor(float tempIsHighLevel, float tempIsTooHighLevel, const char *tempLabel);
+  void configure(int sensorNr, float tempIsHighLevel, float tempIsTooHighLevel, const char *tempLabel, const char *reportKey);
 
-  void begin();
-  
+  // NULL: the sensor was not found on the bus
+  void begin(const uint8_t *deviceAddress);
+
+  // true if the sensor used the bus
+  bool loop();
+
+  int number() { return tempSensorNr; }
+  const char *label() { return labelTempSensor; }
+  const char *reportKey() { return reportKeyTempSensor; }
+  float tempIsHighLevel() { return theTempIsHighLevel; }
+  float tempIsTooHighLevel() { return theTempIsTooHighLevel; }
+};
+
+// all temperature sensors: the configured sensors first, then the sensors
+// found on the bus at boot that are not configured
+class TempSensorRegistry {
+private:
+  TemperatureSensor sensors[MAX_NR_OF_TEMP_SENSORS];
+  uint8_t nrOfSensors = 0;
+
+  int findSensor(const tempsensorconfig_t *config, uint8_t nrOfConfigs, const uint8_t *deviceAddress, bool *assigned);
+
+public:
+  void begin(const tempsensorconfig_t *config, uint8_t nrOfConfigs);
+
+  // reads at most one sensor per call, to spread the bus time over the loop
   void loop();
+
+  uint8_t count() { return nrOfSensors; }
+
+  TemperatureSensor &sensor(uint8_t index) { return sensors[index]; }
 };
 
+extern TempSensorRegistry theTempSensors;
@@ -0,0 +1,174 @@
+#include "TimerWheel.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_RANGE ((uint64_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) // in ticks
+
+TimerWheel theTimerWheel;
+
+TimerWheel::TimerWheel() {
+  for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    for (uint8_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+      slots[level][slot] = NULL;
+    }
+    nrOfTimers[level] = 0;
+  }
+}
+
+// into the lowest level the deadline fits in, relative to currentTick
+void TimerWheel::insert(wheeltimer_t *timer) {
+  uint64_t delta = timer->deadline - currentTick;
+  uint64_t tick = timer->deadline;
+  uint8_t level = 0;
+
+  if (delta >= TIMER_WHEEL_RANGE) {
+    // beyond the top level: wait in its last slot and cascade again
+    tick = currentTick + TIMER_WHEEL_RANGE - 1;
+    level = TIMER_WHEEL_LEVELS - 1;
+  } else {
+    while ((delta >> (TIMER_WHEEL_BITS * (level + 1))) != 0) {
+      level++;
+    }
+  }
+  timer->level = level;
+  timer->slot = (tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+  timer->previous = NULL;
+  timer->next = slots[level][timer->slot];
+  if (timer->next != NULL) {
+    timer->next->previous = timer;
+  }
+  slots[level][timer->slot] = timer;
+  nrOfTimers[level]++;
+  timer->scheduled = true;
+}
+
+void TimerWheel::unlink(wheeltimer_t *timer) {
+  if (timer->previous != NULL) {
+    timer->previous->next = timer->next;
+  } else {
+    slots[timer->level][timer->slot] = timer->next;
+  }
+  if (timer->next != NULL) {
+    timer->next->previous = timer->previous;
+  }
+  nrOfTimers[timer->level]--;
+  timer->scheduled = false;
+  if (timer->deadline <= cachedDeadline) {
+    deadlineIsValid = false;
+  }
+}
+
+// the tick being handled has passed: the deadline is the next tick at the earliest
+void TimerWheel::schedule(wheeltimer_t *timer, uint64_t deadline) {
+  if (timer->scheduled) {
+    unlink(timer);
+  }
+  timer->deadline = (deadline > currentTick) ? deadline : currentTick + 1;
+  insert(timer);
+  if (deadlineIsValid && (timer->deadline < cachedDeadline)) {
+    cachedDeadline = timer->deadline;
+  }
+}
+
+void TimerWheel::start(wheeltimer_t *timer, uint32_t delay, uint32_t period, timercallback_t callback, void *context) {
+  timer->period = period;
+  timer->callback = callback;
+  timer->context = context;
+  schedule(timer, uptimeMs() + delay);
+}
+
+void TimerWheel::restart(wheeltimer_t *timer, uint32_t delay) {
+  schedule(timer, uptimeMs() + delay);
+}
+
+void TimerWheel::stop(wheeltimer_t *timer) {
+  if (timer->scheduled) {
+    unlink(timer);
+  }
+}
+
+// the slot is due: its timers move down to the levels below
+void TimerWheel::cascade(uint8_t level, uint8_t slot) {
+  wheeltimer_t *timer = slots[level][slot];
+
+  slots[level][slot] = NULL;
+  while (timer != NULL) {
+    wheeltimer_t *next = timer->next;
+
+    nrOfTimers[level]--;
+    insert(timer);
+    counters.cascaded++;
+    timer = next;
+  }
+}
+
+void TimerWheel::tick(uint64_t tick) {
+  wheeltimer_t *timer;
+
+  currentTick = tick;
+  for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+    if ((tick & (((uint64_t)1 << (TIMER_WHEEL_BITS * level)) - 1)) != 0) {
+      break;
+    }
+    cascade(level, (tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+  }
+
+  // one at a time: a callback may stop the other timers of the slot; nothing new lands in it, the deadlines are later
+  while ((timer = slots[0][tick & TIMER_WHEEL_MASK]) != NULL) {
+    unlink(timer);
+    // a periodic timer keeps its phase, unless it is more than a period late
+    if (timer->period > 0) {
+      uint64_t deadline = timer->deadline + timer->period;
+      schedule(timer, (deadline > currentTick) ? deadline : currentTick + timer->period);
+    }
+    counters.fired++;
+    timer->callback(timer->context);
+  }
+}
+
+uint32_t TimerWheel::run() {
+  uint64_t now = uptimeMs();
+  uint32_t firedBefore = counters.fired;
+
+  counters.runs++;
+  while (currentTick < now) {
+    uint8_t level = 0;
+    uint64_t next;
+
+    // the ticks up to the next cascade of the lowest level with timers do nothing
+    while ((level < TIMER_WHEEL_LEVELS) && (nrOfTimers[level] == 0)) {
+      level++;
+    }
+    if (level == TIMER_WHEEL_LEVELS) {
+      currentTick = now;
+      break;
+    }
+    next = ((currentTick >> (TIMER_WHEEL_BITS * level)) + 1) << (TIMER_WHEEL_BITS * level);
+    if (next > now) {
+      currentTick = now;
+      break;
+    }
+    tick(next);
+  }
+  return counters.fired - firedBefore;
+}
+
+uint64_t TimerWheel::nextDeadline() {
+  if (deadlineIsValid) {
+    return cachedDeadline;
+  }
+  cachedDeadline = TIMER_WHEEL_NEVER;
+  for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    if (nrOfTimers[level] == 0) {
+      continue;
+    }
+    for (uint8_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+      for (wheeltimer_t *timer = slots[level][slot]; timer != NULL; timer = timer->next) {
+        if (timer->deadline < cachedDeadline) {
+          cachedDeadline = timer->deadline;
+        }
+      }
+    }
+  }
+  deadlineIsValid = true;
+  return cachedDeadline;
+}
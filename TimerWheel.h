@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Periodic and one-shot work of the control loop: a hierarchical timer wheel
+// on a 64 bit time base in ms, which does not wrap like millis() does after
+// 49.7 days. A timer is a wheeltimer_t owned by the module, the wheel only
+// links it, without heap. Level 0 has a slot per tick, each next level a slot
+// per TIMER_WHEEL_SLOTS slots of the level below; a timer is kept in the
+// lowest level its deadline fits in and cascades down as the time comes
+// closer. Deadlines beyond the top level wait in its last slot.
+//
+// loop() calls run(), which only calls the timers that are due; nextDeadline()
+// tells how long the loop may sleep.
+#define TIMER_WHEEL_BITS (6)
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS (4) // with a tick of 1 ms up to 4.6 h ahead
+#define TIMER_WHEEL_NEVER (UINT64_MAX)
+
+// 64 bit monotonic time in ms since boot, safe to use from every task
+inline uint64_t uptimeMs() {
+  return (uint64_t)esp_timer_get_time() / 1000;
+}
+
+typedef void (*timercallback_t)(void *context);
+
+typedef struct wheeltimer_s {
+  struct wheeltimer_s *next;
+  struct wheeltimer_s *previous;
+  uint64_t deadline; // in ms, uptimeMs()
+  uint32_t period; // in ms, 0 for a one-shot timer
+  timercallback_t callback;
+  void *context;
+  bool scheduled;
+  uint8_t level;
+  uint8_t slot;
+} wheeltimer_t;
+
+typedef struct {
+  uint32_t runs;     // calls of run()
+  uint32_t fired;    // timers called
+  uint32_t cascaded; // timers moved to a lower level
+} timerwheelcounters_t;
+
+class TimerWheel {
+private:
+  wheeltimer_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+  uint16_t nrOfTimers[TIMER_WHEEL_LEVELS];
+  uint64_t currentTick = 0; // all ticks up to and including this one are handled
+  uint64_t cachedDeadline = TIMER_WHEEL_NEVER;
+  bool deadlineIsValid = true;
+
+  void schedule(wheeltimer_t *timer, uint64_t deadline);
+  void insert(wheeltimer_t *timer);
+  void unlink(wheeltimer_t *timer);
+  void cascade(uint8_t level, uint8_t slot);
+  void tick(uint64_t tick);
+
+public:
+  timerwheelcounters_t counters = { 0, 0, 0 };
+
+  TimerWheel();
+
+  // the callback after delay ms and then every period ms (0: once); a scheduled timer is moved
+  void start(wheeltimer_t *timer, uint32_t delay, uint32_t period, timercallback_t callback, void *context);
+
+  // the same callback, period and context again after delay ms
+  void restart(wheeltimer_t *timer, uint32_t delay);
+
+  void stop(wheeltimer_t *timer);
+
+  bool isScheduled(const wheeltimer_t *timer) { return timer->scheduled; }
+
+  // calls the timers that are due, returns the number called
+  uint32_t run();
+
+  // the earliest deadline in ms, TIMER_WHEEL_NEVER if no timer is scheduled
+  uint64_t nextDeadline();
+};
+
+extern TimerWheel theTimerWheel;
@@ -0,0 +1,74 @@
+// Display bus traffic benchmark.
+//
+// Runs the firmware against the compressor model (see bench_loop) and reports
+// the display traffic per DISPLAY_WINDOW frame: the tile bytes the display
+// code draws, which is what went over the bus before the shadow tile buffer,
+// against the tile bytes that are actually sent. The fake u8x8 backend also
+// counts the window commands around every transfer. The display is drawn by
+// its own task, so the oled_display stage of loop() only publishes a snapshot.
+//
+// usage: bench_display [-t seconds]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <U8x8lib.h>
+#include <plant.h>
+#include <unistd.h>
+
+#include "LoopProfiler.h"
+#include "OledDisplay.h"
+
+extern U8X8_SSD1327_WS_128X128_HW_I2C u8x8;
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 600;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:")) != -1) {
+    if (opt == 't') {
+      seconds = strtoul(optarg, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-t seconds]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  plant_init();
+  setup();
+  node.hostConnect();
+
+  unsigned long start = millis();
+  plant_press(PLANT_ON_BUTTON, start + 3000, 300);
+  plant_press(PLANT_OFF_BUTTON, start + seconds * 800, 300);
+  node.hostHoldReports(true);
+
+  // skip the boot screen
+  while (millis() < start + 2000) {
+    plant_step(100);
+    hal_service_inputs();
+    loop();
+  }
+  theLoopProfiler.reset();
+  displaytraffic_t before = displayTraffic;
+  uint64_t busBefore = u8x8.bytesSent;
+
+  unsigned long end = start + seconds * 1000;
+  while (millis() < end) {
+    plant_step(100);
+    hal_service_inputs();
+    loop();
+  }
+
+  uint32_t frames = displayTraffic.frames - before.frames;
+  double drawn = (double)(displayTraffic.bytesDrawn - before.bytesDrawn) / frames;
+  double sent = (double)(displayTraffic.bytesSent - before.bytesSent) / frames;
+  double bus = (double)(u8x8.bytesSent - busBefore) / frames;
+  LoopHistogram &h = theLoopProfiler.stage[STAGE_OLEDDISPLAY];
+
+  printf("simulated %lu s, %u display frames\n", seconds, frames);
+  printf("tile bytes per frame: %.0f drawn, %.0f sent (%.1f%% of drawn), max %u sent in one frame\n", drawn, sent,
+         drawn > 0 ? 100.0 * sent / drawn : 0.0, displayTraffic.maxFrameBytesSent);
+  printf("bus bytes per frame including window commands: %.0f\n", bus);
+  printf("oled_display stage of loop() (device us): p50 %lu, p99 %lu, max %lu\n", h.percentile(50), h.percentile(99), h.maximum());
+  return 0;
+}
@@ -0,0 +1,209 @@
+// Event log benchmark and decoder.
+//
+// Runs the firmware against the compressor model (see bench_loop): the
+// compressor is switched on, the oil level drops for a while and a sensor is
+// unplugged, so that most events are logged. The records published on
+// LOG_EVENT_MQTT_TOPIC are decoded with the table of LogEvent.h and merged
+// with the text lines of LOG_MQTT_TOPIC; the result must be the text telnet
+// got, line by line. Prints the MQTT log bytes against the same log as text.
+//
+// -d decodes event messages instead: one message per line on stdin, in hex,
+// as a consumer without the firmware sees them (labels are not known).
+//
+// usage: bench_eventlog [-t seconds] [-v] | bench_eventlog -d
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <plant.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "LogRing.h"
+#include "LogEvent.h"
+
+// collects what the flush task writes to the sinks
+class CaptureStream : public TLog {
+public:
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    return 1;
+  }
+  size_t write(const uint8_t *buf, size_t len) override {
+    text.append((const char *)buf, len);
+    return len;
+  }
+  using Print::write;
+
+  std::string text;
+};
+
+static std::vector<std::string> textLines;
+static std::vector<std::vector<uint8_t>> eventMessages;
+static uint64_t textBytes = 0;
+static uint64_t eventBytes = 0;
+
+static void split(const std::string &text, std::vector<std::string> *lines) {
+  size_t at = 0;
+
+  while (at < text.size()) {
+    size_t end = text.find('\n', at);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    lines->push_back(text.substr(at, end - at));
+    at = end + 1;
+  }
+}
+
+// the lines of one message, false if it is not valid
+static bool decodeMessage(const uint8_t *payload, size_t len, std::vector<std::string> *lines) {
+  char text[LOG_EVENT_TEXT_SIZE];
+  size_t at = 1;
+
+  if ((len < 2) || (payload[0] != LOG_EVENT_VERSION)) {
+    return false;
+  }
+  while (at < len) {
+    size_t size = renderLogEvent(payload + at, len - at, text, sizeof(text));
+    if (size == 0) {
+      return false;
+    }
+    std::string line(text);
+    if (line.empty()) {
+      lines->push_back(line);
+    } else {
+      split(line, lines);
+    }
+    at += size;
+  }
+  return true;
+}
+
+static int decoder() {
+  char hex[2 * 1024 + 2];
+  int status = 0;
+
+  while (fgets(hex, sizeof(hex), stdin) != NULL) {
+    std::vector<uint8_t> payload;
+    std::vector<std::string> lines;
+    unsigned int byte;
+
+    for (const char *h = hex; sscanf(h, "%2x", &byte) == 1; h += 2) {
+      payload.push_back(byte);
+    }
+    if (!decodeMessage(payload.data(), payload.size(), &lines)) {
+      fprintf(stderr, "not a valid event message\n");
+      status = 1;
+      continue;
+    }
+    for (const std::string &line : lines) {
+      printf("%s\n", line.c_str());
+    }
+  }
+  return status;
+}
+
+static void run(unsigned long seconds) {
+  unsigned long end = millis() + seconds * 1000;
+  while (millis() < end) {
+    plant_step(1000);
+    hal_service_inputs();
+    loop();
+  }
+}
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 300;
+  bool verbose = false;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "t:vd")) != -1) {
+    if (opt == 't') {
+      seconds = strtoul(optarg, nullptr, 10);
+    } else if (opt == 'v') {
+      verbose = true;
+    } else if (opt == 'd') {
+      return decoder();
+    } else {
+      fprintf(stderr, "usage: %s [-t seconds] [-v] | %s -d\n", argv[0], argv[0]);
+      return 1;
+    }
+  }
+
+  // from boot on: what telnet gets and what is published
+  auto telnet = std::make_shared<CaptureStream>();
+  theLogRing.addPrintStream(telnet);
+  node.hostOnSend([](const char *topic, const uint8_t *payload, size_t len) {
+    if (!strcmp(topic, LOG_MQTT_TOPIC)) {
+      split(std::string((const char *)payload, len), &textLines);
+      textBytes += len;
+    } else if (!strcmp(topic, LOG_EVENT_MQTT_TOPIC)) {
+      eventMessages.push_back(std::vector<uint8_t>(payload, payload + len));
+      eventBytes += len;
+    }
+  });
+  plant_init();
+  setup();
+  node.hostConnect();
+  node.hostHoldReports(true);
+
+  plant_press(PLANT_ON_BUTTON, millis() + 2000, 300);
+  run(seconds / 3);
+  hal_set_pin(PLANT_OILLEVELSENSOR, LOW);
+  run(seconds / 3);
+  hal_set_pin(PLANT_OILLEVELSENSOR, HIGH);
+  hal_set_temp_sensor_missing(1, true);
+  run(seconds - 2 * (seconds / 3));
+  // let the flush task catch up and publish the last batches
+  for (int i = 0; i < 5; i++) {
+    delay(2 * LOG_FLUSH_PERIOD);
+    usleep(10000);
+    loop();
+  }
+
+  // the events decoded, merged with the text lines in the order of telnet
+  std::vector<std::string> eventLines;
+  std::vector<std::string> telnetLines;
+  uint64_t renderedBytes = 0;
+  for (const std::vector<uint8_t> &message : eventMessages) {
+    ok = decodeMessage(message.data(), message.size(), &eventLines) && ok;
+  }
+  for (const std::string &line : eventLines) {
+    renderedBytes += line.size() + 1;
+  }
+  split(telnet->text, &telnetLines);
+  size_t nextText = 0;
+  size_t nextEvent = 0;
+  for (const std::string &line : telnetLines) {
+    if (verbose) {
+      printf("  %s\n", line.c_str());
+    }
+    if ((nextEvent < eventLines.size()) && (line == eventLines[nextEvent])) {
+      nextEvent++;
+    } else if ((nextText < textLines.size()) && (line == textLines[nextText])) {
+      nextText++;
+    } else {
+      printf("  not on MQTT: \"%s\"\n", line.c_str());
+      ok = false;
+    }
+  }
+  ok = (nextEvent == eventLines.size()) && (nextText == textLines.size()) && ok;
+
+  uint32_t tableSize = 0;
+  for (uint8_t id = 0; id < NR_OF_LOG_EVENTS; id++) {
+    tableSize += strlen(logEventFormat(id)) + 1;
+  }
+  printf("simulated %lu s: %zu telnet lines, %u events, %zu text lines\n", seconds, telnetLines.size(),
+         theLogRing.counters.events, textLines.size());
+  printf("  events on MQTT: %llu bytes in %zu messages, as text %llu bytes (%.1fx)\n", (unsigned long long)eventBytes,
+         eventMessages.size(), (unsigned long long)renderedBytes, eventBytes ? (double)renderedBytes / eventBytes : 0.0);
+  printf("  MQTT log: %llu bytes, all as text %llu bytes\n", (unsigned long long)(eventBytes + textBytes),
+         (unsigned long long)(renderedBytes + textBytes));
+  printf("  table: %u events, %u bytes of text\n", NR_OF_LOG_EVENTS, tableSize);
+  ok = (theLogRing.counters.events > 0) && (eventBytes * 10 < renderedBytes) && ok;
+
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
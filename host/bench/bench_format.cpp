@@ -0,0 +1,89 @@
+// Fixed point formatter benchmark.
+//
+// Checks formatFixed() against snprintf for the formats used by the display
+// and the report, over the value ranges the node produces (DS18B20
+// temperatures in 1/16 degree, pressure in 0.01 bar, hour counters), and
+// times both on this host. On the ESP32 the gap is larger: the float printf
+// path converts through double, which runs in software floating point.
+
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+
+#include "FixedFormat.h"
+
+typedef std::chrono::steady_clock host_clock;
+
+typedef struct {
+  const char *name;
+  uint8_t width;
+  uint8_t decimals;
+  std::vector<float> values;
+} formatcase_t;
+
+int main() {
+  std::vector<formatcase_t> cases = {
+    { "%7.2f temperature", 7, 2, {} },
+    { "%4.1f pressure", 4, 1, {} },
+    { "%5.2f pressure", 5, 2, {} },
+    { "%9.2f hours", 9, 2, {} },
+    { "%f hours", 0, 6, {} },
+    { "%4.0f limit", 4, 0, {} },
+  };
+  for (int t = -55 * 16; t <= 125 * 16; t++) {
+    cases[0].values.push_back(t / 16.0f);
+    cases[5].values.push_back(t / 16.0f);
+  }
+  cases[0].values.push_back(-127);
+  for (int cbar = 0; cbar <= 1500; cbar++) {
+    cases[1].values.push_back(cbar * 0.01f);
+    cases[2].values.push_back(cbar * 0.01f);
+  }
+  for (unsigned long s = 0; s < 20000UL * 3600; s += 997) {
+    cases[3].values.push_back((float)s / 3600);
+    cases[4].values.push_back((float)s / 3600);
+  }
+
+  bool ok = true;
+  printf("  %-20s %8s %10s %10s %10s\n", "format", "values", "mismatch", "sprintf ns", "fixed ns");
+  for (auto &c : cases) {
+    char format[16];
+    char expected[32];
+    char actual[32];
+    size_t mismatches = 0;
+    snprintf(format, sizeof(format), "%%%u.%uf", c.width, c.decimals);
+    for (float v : c.values) {
+      snprintf(expected, sizeof(expected), format, v);
+      formatFixed(actual, v, c.width, c.decimals);
+      if (strcmp(expected, actual)) {
+        if (mismatches++ == 0) {
+          printf("  first mismatch: '%s' against '%s'\n", actual, expected);
+        }
+      }
+    }
+    ok = ok && (mismatches == 0);
+
+    const int rounds = 20;
+    volatile char sink = 0;
+    auto t0 = host_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      for (float v : c.values) {
+        sprintf(expected, format, v);
+        sink = sink + expected[0];
+      }
+    }
+    auto t1 = host_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      for (float v : c.values) {
+        formatFixed(actual, v, c.width, c.decimals);
+        sink = sink + actual[0];
+      }
+    }
+    auto t2 = host_clock::now();
+    double n = (double)rounds * c.values.size();
+    printf("  %-20s %8zu %10zu %10.1f %10.1f\n", c.name, c.values.size(), mismatches,
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / n,
+           std::chrono::duration<double, std::nano>(t2 - t1).count() / n);
+  }
+  return ok ? 0 : 1;
+}
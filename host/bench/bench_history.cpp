@@ -0,0 +1,125 @@
+// History compression benchmark.
+//
+// Adds hours of 1 Hz samples with the resolution the node really has
+// (pressure in 0.01 bar, DS18B20 temperatures in 1/16 degree) to the
+// firmware's History, then streams the whole window back over the stubbed
+// MQTT node and checks every decoded sample against what was added.
+//
+// usage: bench_history [-t hours]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "History.h"
+
+typedef struct {
+  uint32_t timestamp;
+  float pressure;
+  float temperature1;
+  float temperature2;
+  bool opto1;
+  machinestates_t machinestate;
+} benchsample_t;
+
+int main(int argc, char **argv) {
+  unsigned long hours = 4;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:")) != -1) {
+    if (opt == 't') {
+      hours = strtoul(optarg, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-t hours]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  hal_init();
+  if (!theHistory.begin()) {
+    return 1;
+  }
+
+  // compressor cycling between 6 and 8 bar: pumping up for 90 s, idle until the pressure has dropped
+  std::vector<benchsample_t> added;
+  unsigned long seed = 1;
+  float centibar = 600;
+  float temperature1 = 20;
+  float temperature2 = 20;
+  bool running = false;
+  for (uint32_t t = 0; t < hours * 3600; t++) {
+    seed = seed * 1103515245 + 12345;
+    int noise = (int)((seed >> 16) % 5) - 2;
+    if (running) {
+      centibar += 2.2;
+      temperature1 += 0.05;
+      temperature2 += 0.03;
+      running = centibar < 800;
+    } else {
+      centibar -= 0.4;
+      temperature1 -= (temperature1 - 20) * 0.002;
+      temperature2 -= (temperature2 - 20) * 0.002;
+      running = centibar < 600;
+    }
+    benchsample_t s;
+    s.timestamp = t + 1;
+    s.pressure = (int)(centibar + noise) * 0.01f;
+    s.temperature1 = roundf(temperature1 * 16) / 16;
+    s.temperature2 = roundf(temperature2 * 16) / 16;
+    s.opto1 = running;
+    s.machinestate = running ? RUNNING : POWERED;
+    added.push_back(s);
+    theHistory.add(s.timestamp, s.pressure, s.temperature1, s.temperature2, s.opto1, s.machinestate);
+  }
+  uint32_t samples = theHistory.nrOfSamples();
+  uint32_t bytes = theHistory.bytesUsed();
+
+  // stream everything that is still in the store
+  std::string stream;
+  size_t pages = 0;
+  size_t largestPage = 0;
+  node.hostOnSend([&](const char *topic, const uint8_t *payload, size_t len) {
+    if (!strcmp(topic, "history")) {
+      stream.append((const char *)payload, len);
+      pages++;
+      largestPage = std::max(largestPage, len);
+    }
+  });
+  theHistory.requestWindow(0, hours * 3600);
+  while (stream.size() < 4 || stream.compare(stream.size() - 4, 4, "end\n")) {
+    hal_advance_us(100000);
+    theTimerWheel.run();
+  }
+
+  size_t first = added.size() - samples;
+  size_t decoded = 0;
+  size_t mismatches = 0;
+  const char *line = stream.c_str();
+  while (*line) {
+    unsigned int timestamp;
+    float p, t1, t2;
+    int opto1, machinestate;
+    if (sscanf(line, "%u,%f,%f,%f,%d,%d", &timestamp, &p, &t1, &t2, &opto1, &machinestate) == 6) {
+      const benchsample_t &s = added[first + decoded];
+      if ((timestamp != s.timestamp) || (fabsf(p - s.pressure) > 0.006) || (fabsf(t1 - s.temperature1) > 0.006) ||
+          (fabsf(t2 - s.temperature2) > 0.006) || (opto1 != s.opto1) || (machinestate != s.machinestate)) {
+        mismatches++;
+      }
+      decoded++;
+    }
+    line = strchr(line, '\n');
+    line = line ? line + 1 : "";
+  }
+
+  printf("added %zu samples (%lu h at 1 Hz), %u still in the store\n", added.size(), hours, samples);
+  printf("store: %u bytes used of %zu, %.2f bytes per sample, %.1f h fit in the store\n", bytes,
+         sizeof(historyblock_t) * HISTORY_NR_OF_BLOCKS, (float)bytes / samples,
+         (float)sizeof(historyblock_t) * HISTORY_NR_OF_BLOCKS / ((float)bytes / samples) / 3600);
+  printf("uncompressed: %zu bytes per sample\n", sizeof(historysample_t));
+  printf("streamed: %zu pages, largest page %zu bytes, %zu samples decoded, %zu mismatches\n", pages, largestPage, decoded,
+         mismatches);
+
+  return ((decoded == samples) && (mismatches == 0) && (largestPage <= 340)) ? 0 : 1;
+}
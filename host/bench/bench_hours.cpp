@@ -0,0 +1,149 @@
+// Operating hours benchmark.
+//
+// Sets up the calendar of OperatingHours.h with the default late hours, a
+// longer evening on one day and a holiday and a build night as overrides, and
+// walks the wall clock through weeks in steps of a minute. Checks isAllowed()
+// against the calendar evaluated from the local time on every step, reports
+// how often the cached answer was recomputed, checks that the calendar is the
+// same after a reboot and that an answer cached from the clock before the NTP
+// sync is dropped by invalidate(), and times a check against the hour
+// comparison of ntp.hours() it replaced.
+//
+// usage: bench_hours [-w weeks]
+
+#include <Arduino.h>
+#include <NTP.h>
+#include <plant.h>
+#include <chrono>
+#include <unistd.h>
+
+#include "OperatingHours.h"
+
+extern NTP ntp;
+
+#define STEP (60) // in s
+#define CHECKS (1000000)
+#define DISABLED_TIME_START (19) // as main.cpp
+#define DISABLED_TIME_END (7)
+
+typedef struct {
+  uint32_t from, to;
+  bool allowed;
+} override_t;
+
+static uint32_t week[7];
+static override_t overrides[2];
+
+// the calendar from the local time, without a cache
+static bool reference() {
+  uint32_t now = ntp.epoch();
+  bool allowed = (week[ntp.weekDay()] >> ntp.hours()) & 1;
+
+  for (const override_t &o : overrides) {
+    if ((o.from <= now) && (now < o.to)) {
+      allowed = o.allowed;
+    }
+  }
+  return allowed;
+}
+
+static uint32_t walk(OperatingHours &hours, unsigned long weeks, uint32_t *changes) {
+  uint32_t wrong = 0;
+  bool last = hours.isAllowed();
+
+  *changes = 0;
+  for (unsigned long step = 0; step < weeks * 7 * 86400 / STEP; step++) {
+    hal_advance_us(STEP * 1000000ULL);
+    bool allowed = hours.isAllowed();
+
+    wrong += (allowed != reference()) ? 1 : 0;
+    *changes += (allowed != last) ? 1 : 0;
+    last = allowed;
+  }
+  return wrong;
+}
+
+static bool oldIsDisabled() {
+  int currentHour = ntp.hours();
+
+  if (DISABLED_TIME_START < DISABLED_TIME_END) {
+    return (currentHour >= DISABLED_TIME_START) && (currentHour < DISABLED_TIME_END);
+  } else {
+    return (currentHour >= DISABLED_TIME_START) || (currentHour < DISABLED_TIME_END);
+  }
+}
+
+template <typename F>
+static double nsPerCheck(F check) {
+  volatile uint32_t sum = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  for (uint32_t i = 0; i < CHECKS; i++) {
+    sum += check() ? 1 : 0;
+  }
+  auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  return (double)duration.count() / CHECKS;
+}
+
+int main(int argc, char **argv) {
+  unsigned long weeks = 4;
+  uint32_t changes, wrong, wrongAfterReboot;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "w:")) != -1) {
+    if (opt == 'w') {
+      weeks = strtoul(optarg, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-w weeks]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  plant_init();
+  hal_set_wallclock(1, 0, 0); // Monday 00:00
+  uint32_t monday = ntp.epoch();
+
+  // the default of main.cpp, a build night on Thursday until 23:00
+  theOperatingHours.begin(OperatingHours::window(DISABLED_TIME_END, DISABLED_TIME_START));
+  ok = theOperatingHours.setHours(4, DISABLED_TIME_END, 23) && ok;
+  // a holiday on the second Monday, an event on the first Saturday night
+  overrides[0] = { monday + 7 * 86400, monday + 8 * 86400, false };
+  overrides[1] = { monday + 5 * 86400 + 20 * 3600, monday + 6 * 86400 + 2 * 3600, true };
+  for (const override_t &o : overrides) {
+    ok = theOperatingHours.addOverride(o.from, o.to, o.allowed) && ok;
+  }
+  for (uint8_t day = 0; day < 7; day++) {
+    week[day] = OperatingHours::window(DISABLED_TIME_END, (day == 4) ? 23 : DISABLED_TIME_START);
+  }
+
+  wrong = walk(theOperatingHours, weeks, &changes);
+  printf("%lu weeks in steps of %u s: %u changes, %u recomputes, %u checks not as the calendar\n", weeks, STEP, changes,
+         theOperatingHours.counters.recomputes, wrong);
+  ok = (wrong == 0) && (changes >= 2 * 7 * weeks) && ok;
+
+  // after a reboot the calendar is read from SPIFFS, the overrides have passed by now
+  static OperatingHours rebooted;
+  overrides[0] = overrides[1] = { 0, 0, false };
+  rebooted.begin(OPERATING_HOURS_ALL_DAY);
+  wrongAfterReboot = walk(rebooted, 1, &changes);
+  printf("after a reboot: %u changes in a week, %u checks not as the calendar\n", changes, wrongAfterReboot);
+  ok = (wrongAfterReboot == 0) && (changes == 2 * 7) && ok;
+
+  // the answer cached at boot from a clock that is not set yet, then NTP sets it
+  hal_set_wallclock(1, 3, 0); // Monday 03:00, denied
+  theOperatingHours.invalidate();
+  bool beforeSync = theOperatingHours.isAllowed();
+  hal_set_wallclock(1, 10, 0); // Monday 10:00, allowed
+  bool cached = theOperatingHours.isAllowed();
+  theOperatingHours.invalidate();
+  bool afterSync = theOperatingHours.isAllowed();
+  printf("clock set from 03:00 to 10:00: %s before, %s cached, %s after invalidate()\n", beforeSync ? "allowed" : "denied",
+         cached ? "allowed" : "denied", afterSync ? "allowed" : "denied");
+  ok = !beforeSync && (afterSync == reference()) && afterSync && ok;
+
+  printf("check (ns): isAllowed() %.1f, ntp.hours() and compare %.1f\n", nsPerCheck([]() { return theOperatingHours.isAllowed(); }),
+         nsPerCheck([]() { return !oldIsDisabled(); }));
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// Input capture benchmark.
+//
+// Runs the firmware against the compressor model (see bench_loop) while
+// node.loop() stalls regularly, and switches the compressor on and off with
+// buttons that bounce: every press and release is a burst of edges within a
+// few ms, at a random moment. Measures the time from the first edge of the Off
+// button to the relay going off, and reports the time from an edge to the
+// callback in loop() as the firmware records it (see InputCapture.h). Checks
+// that every press and release is exactly one change of the input, that every
+// press switches the compressor on or off, and that the relay is off within
+// INPUT_MAX_RELAY_LATENCY of the edge however long loop() takes, and that
+// every press reaches loop() as an event of ControlEvents.h.
+//
+// usage: bench_input [-c cycles] [-s period_ms:stall_ms]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <MachState.h>
+#include <plant.h>
+#include <unistd.h>
+
+#include "ControlEvents.h"
+#include "InputCapture.h"
+#include "LoopProfiler.h"
+
+extern machinestates_t machinestate;
+
+#define INPUT_MAX_RELAY_LATENCY (2000) // in us
+#define BOUNCE_EDGES (5) // edges of a press or release, odd: the last one stays
+#define BOUNCE_TIME (3000) // in us, the edges of a press or release are within this time
+
+static uint32_t optoChanges = 0;
+static int optoLevel = LOW;
+
+static uint32_t random(uint32_t from, uint32_t to) {
+  return from + (uint32_t)(rand() % (to - from + 1));
+}
+
+static void run(unsigned long ms) {
+  unsigned long end = millis() + ms;
+
+  while (millis() < end) {
+    plant_step(100);
+    // the model switches the opto coupler without bounces
+    if (hal_get_pin(PLANT_OPTO1) != optoLevel) {
+      optoLevel = hal_get_pin(PLANT_OPTO1);
+      optoChanges++;
+    }
+    loop();
+  }
+}
+
+// a bouncing contact, ends at level; with relayLatency the time from the first edge to the relay off
+static void bounce(uint8_t pin, int level, LoopHistogram *relayLatency = NULL) {
+  for (int i = 0; i < BOUNCE_EDGES; i++) {
+    uint64_t edge = hal_now_us();
+
+    hal_set_pin(pin, (i % 2) ? !level : level);
+    if ((i == 0) && (relayLatency != NULL)) {
+      relayLatency->add((hal_get_pin(PLANT_RELAY_GPIO) == LOW) ? hal_now_us() - edge : INPUT_MAX_RELAY_LATENCY + 1);
+    }
+    hal_advance_us(BOUNCE_TIME / BOUNCE_EDGES);
+  }
+}
+
+int main(int argc, char **argv) {
+  unsigned long cycles = 50;
+  unsigned long stallPeriod = 1000;
+  unsigned long stall = 250;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "c:s:")) != -1) {
+    if (opt == 'c') {
+      cycles = strtoul(optarg, nullptr, 10);
+    } else if (opt == 's') {
+      sscanf(optarg, "%lu:%lu", &stallPeriod, &stall);
+    } else {
+      fprintf(stderr, "usage: %s [-c cycles] [-s period_ms:stall_ms]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  plant_init();
+  setup();
+  node.hostConnect();
+  node.hostHoldReports(true);
+  hal_set_node_stall(stallPeriod, stall);
+  run(5000);
+
+  LoopHistogram relayLatency;
+  uint32_t notSwitchedOn = 0;
+  uint32_t notSwitchedOff = 0;
+  inputcapturecounters_t before = theInputCapture.counters;
+  uint32_t optoBefore = optoChanges;
+  uint32_t postedBefore = theControlEvents.counters.posted;
+  theInputCapture.latency.reset();
+  srand(1);
+  for (unsigned long cycle = 0; cycle < cycles; cycle++) {
+    run(random(100, 2000));
+    bounce(PLANT_ON_BUTTON, LOW);
+    run(300);
+    bounce(PLANT_ON_BUTTON, HIGH);
+    run(random(2000, 5000));
+    if (machinestate < POWERED) {
+      notSwitchedOn++;
+    }
+
+    // the relay goes off in the interrupt of the first edge
+    bounce(PLANT_OFF_BUTTON, LOW, &relayLatency);
+    run(random(200, 500));
+    bounce(PLANT_OFF_BUTTON, HIGH);
+    run(1000);
+    if (machinestate != SWITCHEDOFF) {
+      notSwitchedOff++;
+    }
+  }
+
+  inputcapturecounters_t &c = theInputCapture.counters;
+  uint32_t changes = c.changes - before.changes;
+  uint32_t expected = 4 * cycles + (optoChanges - optoBefore);
+  printf("%lu on/off cycles with bouncing buttons, node.loop() stalls %lu ms every %lu ms\n", cycles, stall, stallPeriod);
+  printf("  %u edges, %u bounces, %u changes (expected %u), %u actions, %u overruns\n", c.edges - before.edges,
+         c.bounces - before.bounces, changes, expected, c.actions - before.actions, c.overruns);
+  printf("  Off button edge to relay off (us):  p50 %lu, p99 %lu, max %lu\n", relayLatency.percentile(50),
+         relayLatency.percentile(99), relayLatency.maximum());
+  printf("  edge to callback in loop() (us):    p50 %lu, p99 %lu, max %lu\n", theInputCapture.latency.percentile(50),
+         theInputCapture.latency.percentile(99), theInputCapture.latency.maximum());
+  printf("  %u presses did not switch on, %u did not switch off\n", notSwitchedOn, notSwitchedOff);
+  controlcounters_t &e = theControlEvents.counters;
+  uint32_t posted = e.posted - postedBefore;
+  printf("  %u control events (expected %lu), %u lost, at most %u waiting, longest wait %u us\n", posted, 2 * cycles,
+         e.lost, e.maxDepth, e.worstLatency);
+
+  ok = (changes == expected) && (c.overruns == 0) && (c.actions - before.actions == cycles) && ok;
+  ok = (posted == 2 * cycles) && (e.lost == 0) && ok;
+  ok = (relayLatency.maximum() <= INPUT_MAX_RELAY_LATENCY) && (notSwitchedOn == 0) && (notSwitchedOff == 0) && ok;
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
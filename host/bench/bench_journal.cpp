@@ -0,0 +1,92 @@
+// Duration counter journal benchmark.
+//
+// Commits the counters every SAVE_DURATION_COUNTERS_WINDOW for a number of
+// simulated days, reports the flash bytes written per day, then simulates
+// power cuts: a torn record at the end of the journal and a compaction
+// interrupted between removing the journal and renaming the new file. After
+// each the journal must recover the newest complete record.
+//
+// usage: bench_journal [-d days]
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <vector>
+#include <unistd.h>
+
+#include "DurationJournal.h"
+
+#define COMMIT_WINDOW (300) // in s, SAVE_DURATION_COUNTERS_WINDOW in main.cpp
+
+static bool recovers(const char *what, unsigned long powered, unsigned long running) {
+  DurationJournal rebooted;
+  unsigned long poweredTotal = 0;
+  unsigned long runningTotal = 0;
+  bool ok = rebooted.load(&poweredTotal, &runningTotal) && (poweredTotal == powered) && (runningTotal == running);
+
+  printf("%-36s %s (%lu s powered, %lu s running)\n", what, ok ? "recovered" : "FAILED", poweredTotal, runningTotal);
+  return ok;
+}
+
+static void tearLastRecord(size_t bytesLost) {
+  File journalFile = SPIFFS.open(DURATION_JOURNAL_FILE, "rb");
+  std::vector<uint8_t> data(journalFile.size());
+  journalFile.readBytes((char *)data.data(), data.size());
+  journalFile.close();
+  journalFile = SPIFFS.open(DURATION_JOURNAL_FILE, "wb");
+  journalFile.write(data.data(), data.size() - bytesLost);
+  journalFile.close();
+}
+
+int main(int argc, char **argv) {
+  unsigned long days = 7;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "d:")) != -1) {
+    if (opt == 'd') {
+      days = strtoul(optarg, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-d days]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  DurationJournal journal;
+  unsigned long powered = 0;
+  unsigned long running = 0;
+  unsigned long commits = days * 86400 / COMMIT_WINDOW;
+  for (unsigned long i = 0; i < commits; i++) {
+    powered += COMMIT_WINDOW;
+    running += COMMIT_WINDOW / 3;
+    ok = journal.commit(powered, running) && ok;
+  }
+  printf("%lu commits in %lu days: %.0f bytes per day written, journal %zu bytes\n", commits, days,
+         (double)SPIFFS.bytesWritten / days, SPIFFS.open(DURATION_JOURNAL_FILE, "rb").size());
+  ok = recovers("clean reboot:", powered, running) && ok;
+
+  // power cut while appending: half of the newest record is written
+  journal.commit(powered + COMMIT_WINDOW, running);
+  tearLastRecord(sizeof(durationrecord_t) / 2);
+  ok = recovers("torn record:", powered, running) && ok;
+
+  // commits after the torn record must survive a reboot
+  DurationJournal afterTear;
+  unsigned long p = 0, r = 0;
+  afterTear.load(&p, &r);
+  afterTear.commit(powered + 2 * COMMIT_WINDOW, running);
+  ok = recovers("commit after torn record:", powered + 2 * COMMIT_WINDOW, running) && ok;
+
+  // power cut during compaction: the journal is removed, the new file is not renamed yet
+  durationrecord_t newest;
+  File journalFile = SPIFFS.open(DURATION_JOURNAL_FILE, "rb");
+  journalFile.seek(journalFile.size() - sizeof(durationrecord_t));
+  journalFile.readBytes((char *)&newest, sizeof(newest));
+  journalFile.close();
+  SPIFFS.rename(DURATION_JOURNAL_FILE, DURATION_JOURNAL_COMPACT_FILE);
+  journalFile = SPIFFS.open(DURATION_JOURNAL_COMPACT_FILE, "wb");
+  journalFile.write((uint8_t *)&newest, sizeof(newest));
+  journalFile.close();
+  ok = recovers("interrupted compaction:", powered + 2 * COMMIT_WINDOW, running) && ok;
+
+  return ok ? 0 : 1;
+}
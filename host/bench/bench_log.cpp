@@ -0,0 +1,230 @@
+// Asynchronous log benchmark.
+//
+// Runs the firmware against the compressor model (see bench_loop) and
+// reports the loop() passes that write the LOGGING_TIME_WINDOW dump, against
+// the same lines written synchronously to MqttLogStream and
+// TelnetSerialStream as before (the text as telnet gets it, the events
+// rendered). Then it checks the ring buffer of LogRing
+// on its own: a burst larger than the ring must drop the oldest lines and
+// count them, and a consumer thread flushing while the producer writes must
+// see every line that is not counted as dropped, complete and in order.
+//
+// usage: bench_log [-t seconds] [-n lines]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <plant.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "LogRing.h"
+#include "LogEvent.h"
+
+// collects what the flush task writes
+class CaptureStream : public TLog {
+public:
+  size_t write(uint8_t c) override {
+    text += (char)c;
+    writes++;
+    return 1;
+  }
+  size_t write(const uint8_t *buf, size_t len) override {
+    text.append((const char *)buf, len);
+    writes++;
+    return len;
+  }
+  using Print::write;
+
+  std::string text;
+  uint32_t writes = 0;
+};
+
+static uint32_t logPublishes = 0;
+
+// a line that can be checked: number, then the number repeated up to the length
+static void writeLine(LogRing &log, uint32_t number) {
+  char line[LOG_LINE_SIZE];
+  int length = snprintf(line, sizeof(line), "%u:", number);
+  int repeat = 20 + number % 100;
+
+  for (int i = 0; i < repeat; i++) {
+    line[length++] = 'a' + (number + i) % 26;
+  }
+  line[length] = 0;
+  log.println(line);
+}
+
+static bool checkLine(const std::string &line, uint32_t *number) {
+  char *end;
+
+  *number = strtoul(line.c_str(), &end, 10);
+  if (*end != ':') {
+    return false;
+  }
+  size_t at = end + 1 - line.c_str();
+  int repeat = 20 + *number % 100;
+  if (line.size() != at + repeat) {
+    return false;
+  }
+  for (int i = 0; i < repeat; i++) {
+    if (line[at + i] != (char)('a' + (*number + i) % 26)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// every line complete, numbers increasing; returns the number of lines
+static bool checkLines(const std::string &text, uint32_t *nrOfLines, uint32_t *first, uint32_t *last) {
+  size_t at = 0;
+  bool ok = true;
+  bool any = false;
+
+  *nrOfLines = 0;
+  while (at < text.size()) {
+    size_t end = text.find('\n', at);
+    uint32_t number;
+
+    if (end == std::string::npos) {
+      return false;
+    }
+    if (!checkLine(text.substr(at, end - at), &number)) {
+      ok = false;
+    } else {
+      ok = (!any || (number > *last)) && ok;
+      if (!any) {
+        *first = number;
+      }
+      *last = number;
+      any = true;
+    }
+    (*nrOfLines)++;
+    at = end + 1;
+  }
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 120;
+  unsigned long lines = 200000;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "t:n:")) != -1) {
+    if (opt == 't') {
+      seconds = strtoul(optarg, nullptr, 10);
+    } else if (opt == 'n') {
+      lines = strtoul(optarg, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-t seconds] [-n lines]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // the firmware: the passes that log
+  plant_init();
+  setup();
+  node.hostConnect();
+  node.hostHoldReports(true);
+  node.hostOnSend([](const char *topic, const uint8_t *payload, size_t len) {
+    if (!strcmp(topic, LOG_MQTT_TOPIC) || !strcmp(topic, LOG_EVENT_MQTT_TOPIC)) {
+      logPublishes++;
+    }
+  });
+  auto rendered = std::make_shared<CaptureStream>();
+  theLogRing.addPrintStream(rendered);
+  unsigned long start = millis();
+  plant_press(PLANT_ON_BUTTON, start + 3000, 300);
+  uint32_t loggingPasses = 0;
+  uint64_t loggingMax = 0;
+  uint64_t loggingTotal = 0;
+  while (millis() < start + seconds * 1000) {
+    uint32_t linesBefore = theLogRing.counters.lines;
+    plant_step(100);
+    hal_service_inputs();
+    uint64_t t = hal_now_us();
+    loop();
+    uint64_t spent = hal_now_us() - t;
+    if (theLogRing.counters.lines - linesBefore >= 4) {
+      loggingPasses++;
+      loggingMax = std::max(loggingMax, spent);
+      loggingTotal += spent;
+    }
+  }
+  // let the flush task catch up and publish the last batch
+  delay(2 * LOG_FLUSH_PERIOD);
+  loop();
+
+  // the same lines written synchronously, as before
+  TLog syncLog;
+  syncLog.addPrintStream(std::make_shared<MqttLogStream>());
+  syncLog.addPrintStream(std::make_shared<TelnetSerialStream>());
+  uint64_t publishesBefore = hal_counters.mqttPublishes;
+  uint64_t t = hal_now_us();
+  syncLog.print(rendered->text.c_str());
+  uint64_t syncTotal = hal_now_us() - t;
+  uint32_t syncPublishes = hal_counters.mqttPublishes - publishesBefore;
+
+  printf("simulated %lu s: %u lines logged, %u dropped, %u truncated, %u batches\n", seconds,
+         theLogRing.counters.lines, theLogRing.counters.dropped, theLogRing.counters.truncated, theLogRing.counters.batches);
+  printf("  asynchronous: %u passes that log, max %llu us, total %llu us, %u MQTT publishes\n", loggingPasses,
+         (unsigned long long)loggingMax, (unsigned long long)loggingTotal, logPublishes);
+  printf("  synchronous:  the same lines take %llu us of the control loop, %u MQTT publishes\n",
+         (unsigned long long)syncTotal, syncPublishes);
+  ok = (theLogRing.counters.dropped == 0) && (logPublishes < syncPublishes) && (loggingTotal * 10 < syncTotal) && ok;
+
+  // a burst larger than the ring, without a consumer: the newest lines are kept
+  LogRing burst;
+  auto burstSink = std::make_shared<CaptureStream>();
+  burst.addPrintStream(burstSink);
+  for (uint32_t i = 0; i < 3 * LOG_RING_LINES; i++) {
+    writeLine(burst, i);
+  }
+  while (burst.counters.batches < 100) {
+    uint32_t before = burst.counters.batches;
+    burst.flush();
+    if (burst.counters.batches == before) {
+      break;
+    }
+  }
+  uint32_t nrOfLines = 0, first = 0, last = 0;
+  bool linesOk = checkLines(burstSink->text, &nrOfLines, &first, &last);
+  printf("burst of %u lines: %u delivered (%u - %u) in %u writes, %u dropped\n", 3 * LOG_RING_LINES, nrOfLines, first,
+         last, burstSink->writes, burst.counters.dropped);
+  ok = linesOk && (nrOfLines == LOG_RING_LINES) && (first == 2 * LOG_RING_LINES) && (last == 3 * LOG_RING_LINES - 1) &&
+       (burst.counters.dropped == 2 * LOG_RING_LINES) && ok;
+
+  // producer and consumer at the same time
+  LogRing concurrent;
+  auto concurrentSink = std::make_shared<CaptureStream>();
+  concurrent.addPrintStream(concurrentSink);
+  std::atomic<bool> done(false);
+  std::thread consumer([&]() {
+    while (!done) {
+      concurrent.flush();
+    }
+    concurrent.flush();
+    concurrent.flush();
+  });
+  for (uint32_t i = 0; i < lines; i++) {
+    writeLine(concurrent, i);
+  }
+  done = true;
+  consumer.join();
+  while (true) {
+    uint32_t before = concurrent.counters.batches;
+    concurrent.flush();
+    if (concurrent.counters.batches == before) {
+      break;
+    }
+  }
+  linesOk = checkLines(concurrentSink->text, &nrOfLines, &first, &last);
+  printf("%lu lines with a concurrent consumer: %u delivered, %u dropped, %s\n", lines, nrOfLines,
+         concurrent.counters.dropped, linesOk ? "all complete and in order" : "CORRUPTED");
+  ok = linesOk && (nrOfLines + concurrent.counters.dropped == lines) && (last == lines - 1) && ok;
+
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
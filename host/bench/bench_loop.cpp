@@ -0,0 +1,119 @@
+// Loop latency benchmark for the host build.
+//
+// Drives setup()/loop() of the unmodified firmware against the compressor
+// model in plant.cpp and reports:
+//  - loop() iterations per second, both on the host CPU and as the node would
+//    see them (virtual time, see hal.h for the device cost model),
+//  - per stage latency (p50/p99/max) of each stage of loop(), as recorded by
+//    the firmware's own LoopProfiler,
+//  - the low priority work shed in passes that ran over LOOP_PASS_BUDGET.
+// -p adds temperature probes to the bus besides the compressor and motor
+// sensors, they are found at boot as unconfigured sensors.
+//
+// usage: bench_loop [-t seconds] [-k tick_us] [-s period_ms:stall_ms] [-p probes] [-v]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <plant.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <unistd.h>
+
+#include "LoopProfiler.h"
+#include "PressureSensor.h"
+#include <MachState.h>
+
+extern machinestates_t machinestate;
+
+typedef std::chrono::steady_clock host_clock;
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 600;
+  unsigned long tick_us = 100;
+  unsigned long probes = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:k:s:p:v")) != -1) {
+    switch (opt) {
+      case 't':
+        seconds = strtoul(optarg, nullptr, 10);
+        break;
+      case 'k':
+        tick_us = strtoul(optarg, nullptr, 10);
+        break;
+      case 's': {
+        unsigned long period = 0, stall = 0;
+        sscanf(optarg, "%lu:%lu", &period, &stall);
+        hal_set_node_stall(period, stall);
+        break;
+      }
+      case 'p':
+        probes = strtoul(optarg, nullptr, 10);
+        break;
+      case 'v':
+        hal_verbose = true;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-t seconds] [-k tick_us] [-s period_ms:stall_ms] [-p probes] [-v]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  plant_init();
+  for (unsigned long i = 0; i < probes; i++) {
+    const uint8_t rom[8] = { 0x28, 0xbb, (uint8_t)i, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    hal_add_temp_sensor(rom, 30.0 + i);
+  }
+  setup();
+  node.hostConnect();
+
+  unsigned long start = millis();
+  plant_press(PLANT_ON_BUTTON, start + 3000, 300);
+  plant_press(PLANT_OFF_BUTTON, start + seconds * 800, 300);
+
+  // keep the profiler from being reset by the periodic report
+  node.hostHoldReports(true);
+  theLoopProfiler.reset();
+
+  std::vector<uint32_t> loopTimes;
+  uint64_t passes = 0;
+  uint64_t v0 = hal_now_us();
+  auto h0 = host_clock::now();
+  unsigned long end = start + seconds * 1000;
+  while (millis() < end) {
+    plant_step(tick_us);
+    hal_service_inputs();
+    uint64_t t = hal_now_us();
+    loop();
+    loopTimes.push_back((uint32_t)(hal_now_us() - t));
+    passes++;
+  }
+  double host_s = std::chrono::duration<double>(host_clock::now() - h0).count();
+  double virt_s = (hal_now_us() - v0) / 1e6;
+  std::sort(loopTimes.begin(), loopTimes.end());
+
+  printf("simulated %lu s, %llu loop() passes\n", seconds, (unsigned long long)passes);
+  printf("loop() rate: %.0f/s on the node (modelled), %.0f/s on this host\n", passes / virt_s, passes / host_s);
+  printf("final state %d, pressure %.2f bar, %llu I2C bytes, %llu OneWire bytes, %llu MQTT publishes\n",
+         machinestate, pressure, (unsigned long long)hal_counters.i2cBytes,
+         (unsigned long long)hal_counters.oneWireBytes, (unsigned long long)hal_counters.mqttPublishes);
+  printf("\n  %-28s %8s %8s %8s\n", "stage (device us)", "p50", "p99", "max");
+  printf("  %-28s %8u %8u %8u\n", "loop()", loopTimes[passes / 2], loopTimes[(passes * 99) / 100], loopTimes[passes - 1]);
+  for (int i = 0; i < NR_OF_LOOP_STAGES; i++) {
+    LoopHistogram &h = theLoopProfiler.stage[i];
+    printf("  %-28s %8lu %8lu %8lu\n", theLoopProfiler.label((loopstage_t)i), h.percentile(50), h.percentile(99), h.maximum());
+  }
+  printf("\nshed in passes over %d us:", LOOP_PASS_BUDGET);
+  for (int i = 0; i < NR_OF_LOOP_WORK; i++) {
+    printf(" %s %u", theLoopProfiler.label((loopwork_t)i), theLoopProfiler.shed[i]);
+  }
+  printf("\n");
+
+  node.hostReport();
+  printf("\nreport payload: %zu bytes\n", node.hostLastReport().size());
+  if (hal_verbose) {
+    printf("%s\n", node.hostLastReport().c_str());
+  }
+  return 0;
+}
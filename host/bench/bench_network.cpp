@@ -0,0 +1,140 @@
+// Network task benchmark.
+//
+// Runs the firmware against the compressor model (see bench_loop) while
+// node.loop() stalls periodically, as it does on a broker reconnect, once
+// with node.loop() in loop() and once with the network task of NetworkTask.h,
+// each in a child process. Reports the time of a pass of loop() (p50/p99/max)
+// and the time from a command of the master to the machine state it sets,
+// and checks that with the task no pass of loop() waits for the stall and
+// that every stop and poweron command is still carried out.
+//
+// The task is a host thread that follows the virtual clock in real time, so
+// the command latencies of the task differ a little from run to run.
+//
+// usage: bench_network [-t seconds] [-s period_ms:stall_ms]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <MachState.h>
+#include <plant.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "LoopProfiler.h"
+#include "NetworkTask.h"
+
+extern machinestates_t machinestate;
+
+#define COMMAND_WINDOW (1500) // in ms, between the commands of the master
+#define MAX_PASS_WITH_TASK (1000) // in us, far below a stall
+
+static void step(bool withTask) {
+  plant_step(1000);
+  if (withTask) {
+    // the task runs on the host clock, give it the time of the step
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+}
+
+static int measure(bool withTask, unsigned long seconds, unsigned long stall) {
+  LoopHistogram passTime; // in us
+  LoopHistogram commandLatency; // in ms
+  uint32_t commands = 0;
+  uint32_t missed = 0;
+
+  plant_init();
+  hal_refuse_task("network", !withTask);
+  setup();
+  node.hostInLoop([]() { node.hostConnect(); });
+
+  unsigned long end = millis() + seconds * 1000;
+  unsigned long nextCommand = millis() + COMMAND_WINDOW;
+  bool powerOn = true;
+  while (millis() < end) {
+    step(withTask);
+    uint64_t start = hal_now_us();
+    loop();
+    passTime.add(hal_now_us() - start);
+
+    if ((millis() >= nextCommand) && (machinestate >= SWITCHEDOFF)) {
+      machinestates_t expected = powerOn ? POWERED : SWITCHEDOFF;
+      const char *command = powerOn ? "poweron" : "stop";
+      unsigned long sent = millis();
+      unsigned long deadline = sent + stall + COMMAND_WINDOW; // the command may arrive at the end of a stall
+
+      node.hostInLoop([command]() { node.hostCommand(command); });
+      while ((machinestate != expected) && (millis() < deadline)) {
+        step(withTask);
+        start = hal_now_us();
+        loop();
+        passTime.add(hal_now_us() - start);
+      }
+      commands++;
+      if (machinestate == expected) {
+        commandLatency.add(millis() - sent);
+      } else {
+        missed++;
+      }
+      powerOn = !powerOn;
+      nextCommand = millis() + COMMAND_WINDOW;
+    }
+  }
+
+  networkcounters_t &c = theNetworkTask.counters;
+  printf("%s:\n", withTask ? "network task" : "node.loop() in loop()");
+  printf("  loop() pass (us):         p50 %lu, p99 %lu, max %lu\n", passTime.percentile(50), passTime.percentile(99),
+         passTime.maximum());
+  printf("  command to state (ms):    p50 %lu, p99 %lu, max %lu, %u commands, %u missed\n", commandLatency.percentile(50),
+         commandLatency.percentile(99), commandLatency.maximum(), commands, missed);
+  if (withTask) {
+    printf("  %u passes of the task, %u events (%u lost), %u messages (%u lost)\n", c.passes, c.events, c.eventsLost,
+           c.messages, c.messagesLost);
+  }
+
+  bool ok = (commands > 0) && (missed == 0) && (theNetworkTask.taskRunning() == withTask);
+  if (withTask) {
+    ok = (passTime.maximum() <= MAX_PASS_WITH_TASK) && (c.eventsLost == 0) && (c.messagesLost == 0) && ok;
+  }
+  fflush(stdout);
+  return ok ? 0 : 1;
+}
+
+// in a child process, setup() runs once per process
+static bool run(bool withTask, unsigned long seconds, unsigned long stall) {
+  int status;
+  pid_t child;
+
+  fflush(stdout);
+  child = fork();
+  if (child == 0) {
+    _exit(measure(withTask, seconds, stall));
+  }
+  waitpid(child, &status, 0);
+  return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 60;
+  unsigned long period = 10000, stall = 2000;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "t:s:")) != -1) {
+    if (opt == 't') {
+      seconds = strtoul(optarg, nullptr, 10);
+    } else if (opt == 's') {
+      sscanf(optarg, "%lu:%lu", &period, &stall);
+    } else {
+      fprintf(stderr, "usage: %s [-t seconds] [-s period_ms:stall_ms]\n", argv[0]);
+      return 1;
+    }
+  }
+  hal_set_node_stall(period, stall);
+  printf("%lu s, node.loop() stalls %lu ms every %lu ms\n", seconds, stall, period);
+
+  ok = run(false, seconds, stall) && ok;
+  ok = run(true, seconds, stall) && ok;
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
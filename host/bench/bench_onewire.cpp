@@ -0,0 +1,106 @@
+// OneWire RMT transport benchmark.
+//
+// Runs the firmware against the compressor model (see bench_loop) with the
+// temperature sensors read through the RMT state machine and reports the
+// temp_sensors stage of loop(), which only starts transactions and collects
+// their results. Then it injects bit errors on the bus, which must show up
+// as CRC errors and not as a missing sensor, and unplugs a sensor, which must
+// show up as a missing sensor and not as CRC errors.
+//
+// usage: bench_onewire [-t seconds]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <plant.h>
+#include <unistd.h>
+
+#include "LoopProfiler.h"
+#include "TempSensor.h"
+
+extern OneWireRmt oneWireRmt;
+
+static void run(unsigned long seconds) {
+  unsigned long end = millis() + seconds * 1000;
+  while (millis() < end) {
+    plant_step(100);
+    hal_service_inputs();
+    loop();
+  }
+}
+
+static void counters(const char *what) {
+  onewirecounters_t &c = oneWireRmt.counters;
+  printf("%-20s %u transactions, %u no presence, %u no response, %u CRC errors, %u timeouts\n", what,
+         c.transactions, c.noPresence, c.noResponse, c.crcErrors, c.timeouts);
+}
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 300;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "t:")) != -1) {
+    if (opt == 't') {
+      seconds = strtoul(optarg, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-t seconds]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  plant_init();
+  setup();
+  node.hostConnect();
+  node.hostHoldReports(true);
+
+  if (!oneWireRmt.isAvailable()) {
+    printf("RMT transport not started\n");
+    return 1;
+  }
+
+  unsigned long start = millis();
+  plant_press(PLANT_ON_BUTTON, start + 3000, 300);
+  theLoopProfiler.reset();
+  run(seconds);
+
+  LoopHistogram &h = theLoopProfiler.stage[STAGE_TEMPSENSORS];
+  printf("simulated %lu s, temp_sensors stage of loop() (device us): p50 %lu, p99 %lu, max %lu\n", seconds,
+         h.percentile(50), h.percentile(99), h.maximum());
+  for (uint8_t i = 0; i < theTempSensors.count(); i++) {
+    TemperatureSensor &s = theTempSensors.sensor(i);
+    printf("sensor %d (%s): %.4f degrees Celcius\n", s.number(), s.label(), s.temperature);
+    ok = (s.temperature > 0) && (s.crcErrors == 0) && ok;
+  }
+  counters("clean bus:");
+  ok = (oneWireRmt.counters.crcErrors == 0) && (oneWireRmt.counters.noResponse == 0) && ok;
+
+  // a bad contact: one bit in 200 the sensors send is flipped
+  onewirecounters_t before = oneWireRmt.counters;
+  hal_set_onewire_bit_errors(200);
+  run(60);
+  hal_set_onewire_bit_errors(0);
+  // the transaction in flight is collected by the sensors in the next passes
+  run(1);
+  counters("bit errors:");
+  uint32_t crcErrors = 0;
+  for (uint8_t i = 0; i < theTempSensors.count(); i++) {
+    crcErrors += theTempSensors.sensor(i).crcErrors;
+  }
+  printf("  CRC errors counted by the sensors: %u\n", crcErrors);
+  ok = (crcErrors > 0) && (crcErrors == oneWireRmt.counters.crcErrors - before.crcErrors) &&
+       (oneWireRmt.counters.noResponse == before.noResponse) && ok;
+
+  // the motor sensor is unplugged
+  before = oneWireRmt.counters;
+  uint32_t motorCrcErrors = theTempSensors.sensor(1).crcErrors;
+  hal_set_temp_sensor_missing(1, true);
+  run(10);
+  counters("sensor 2 unplugged:");
+  printf("  sensor 2 %s, CRC errors %u\n", theTempSensors.sensor(1).notReacting ? "does not react" : "still reads",
+         theTempSensors.sensor(1).crcErrors - motorCrcErrors);
+  ok = theTempSensors.sensor(1).notReacting && (theTempSensors.sensor(1).crcErrors == motorCrcErrors) &&
+       (oneWireRmt.counters.noResponse > before.noResponse) && (theTempSensors.sensor(0).temperature > 0) && ok;
+
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
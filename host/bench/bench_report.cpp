@@ -0,0 +1,290 @@
+// CBOR report benchmark.
+//
+// Runs the firmware against the compressor model (see bench_loop), triggers
+// the report and decodes the CBOR payload on topic report_cbor with the
+// reference decoder of ReportCbor.h. Every value is checked against the
+// verbose JSON report of the same pass, then a sensor is unplugged, which
+// must show up as a null temperature. Prints the sizes of both payloads and
+// of the MQTT packets they need (PubSubClient counts the fixed header, the
+// topic and the payload against MQTT_MAX_PACKET_SIZE), and checks them
+// against the default of 256 for CBOR and the size of the README for JSON.
+//
+// usage: bench_report [-t seconds] [-v]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <MachState.h>
+#include <plant.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "ReportCbor.h"
+#include "LoopProfiler.h"
+#include "TempSensor.h"
+
+extern machinestates_t machinestate;
+
+#define MQTT_HEADER_SIZE (5) // fixed header with a 2 byte remaining length, plus 2 bytes topic length
+#define MQTT_TOPIC_PREFIX "ac/log/compressor/" // a typical topic of the node
+#define MQTT_JSON_PACKET_SIZE (1536) // the MQTT_MAX_PACKET_SIZE of the README for the JSON report
+
+typedef struct {
+  bool present[10];
+  int64_t value[8];
+  int64_t temperature[MAX_NR_OF_TEMP_SENSORS][4];
+  bool temperatureNull[MAX_NR_OF_TEMP_SENSORS];
+  uint8_t nrOfTemperatures;
+  int64_t loop[NR_OF_LOOP_STAGES][3];
+  uint8_t nrOfStages;
+} decodedreport_t;
+
+static std::vector<uint8_t> cborPayload;
+
+static void run(unsigned long seconds) {
+  unsigned long end = millis() + seconds * 1000;
+  while (millis() < end) {
+    plant_step(100);
+    hal_service_inputs();
+    loop();
+  }
+}
+
+// the value of a JSON field, numbers and the leading number of a string value
+static bool jsonNumber(const std::string &json, const std::string &key, double *value) {
+  size_t at = json.find("\"" + key + "\":");
+  if (at == std::string::npos) {
+    return false;
+  }
+  at += key.size() + 3;
+  if (json[at] == '"') {
+    at++;
+  }
+  if (json.compare(at, 4, "true") == 0) {
+    *value = 1;
+  } else if (json.compare(at, 5, "false") == 0) {
+    *value = 0;
+  } else {
+    *value = strtod(json.c_str() + at, nullptr);
+  }
+  return true;
+}
+
+static bool decode(const std::vector<uint8_t> &payload, decodedreport_t *report) {
+  CborReader cbor(payload.data(), payload.size());
+  cboritem_t item;
+  int64_t key;
+
+  memset(report, 0, sizeof(*report));
+  if (!cbor.next(&item) || (item.majorType != CBOR_MAP)) {
+    return false;
+  }
+  for (uint64_t pair = 0; pair < item.value; pair++) {
+    cboritem_t value;
+
+    if (!cbor.integer(&key)) {
+      return false;
+    }
+    if ((key < 0) || (key > CBOR_KEY_LOOP)) {
+      if (!cbor.skip()) {
+        return false;
+      }
+      continue;
+    }
+    report->present[key] = true;
+    if (key == CBOR_KEY_TEMPERATURES) {
+      if (!cbor.next(&value) || (value.majorType != CBOR_ARRAY) || (value.value > MAX_NR_OF_TEMP_SENSORS)) {
+        return false;
+      }
+      report->nrOfTemperatures = value.value;
+      for (uint8_t i = 0; i < report->nrOfTemperatures; i++) {
+        cboritem_t field;
+
+        if (!cbor.next(&field) || (field.majorType != CBOR_ARRAY) || (field.value != 4)) {
+          return false;
+        }
+        for (uint8_t j = 0; j < 4; j++) {
+          CborReader peek = cbor;
+          if ((j == 1) && peek.next(&field) && (field.majorType == CBOR_SIMPLE) && (field.value == CBOR_NULL)) {
+            cbor = peek;
+            report->temperatureNull[i] = true;
+          } else if (!cbor.integer(&report->temperature[i][j])) {
+            return false;
+          }
+        }
+      }
+    } else if (key == CBOR_KEY_LOOP) {
+      if (!cbor.next(&value) || (value.majorType != CBOR_ARRAY) || (value.value > NR_OF_LOOP_STAGES)) {
+        return false;
+      }
+      report->nrOfStages = value.value;
+      for (uint8_t i = 0; i < report->nrOfStages; i++) {
+        cboritem_t field;
+
+        if (!cbor.next(&field) || (field.majorType != CBOR_ARRAY) || (field.value != 3)) {
+          return false;
+        }
+        for (uint8_t j = 0; j < 3; j++) {
+          if (!cbor.integer(&report->loop[i][j])) {
+            return false;
+          }
+        }
+      }
+    } else if ((key == CBOR_KEY_OPTO1) || (key == CBOR_KEY_OTA)) {
+      if (!cbor.next(&value) || (value.majorType != CBOR_SIMPLE)) {
+        return false;
+      }
+      report->value[key] = (value.value == CBOR_TRUE);
+    } else if (!cbor.integer(&report->value[key])) {
+      return false;
+    }
+  }
+  return cbor.atEnd();
+}
+
+static bool check(bool ok, const char *what) {
+  if (!ok) {
+    printf("  mismatch: %s\n", what);
+  }
+  return ok;
+}
+
+// compares the decoded CBOR report with the JSON report of the same pass
+static bool compare(const decodedreport_t &r, const std::string &json, uint64_t profilerP50[], uint64_t profilerMax[]) {
+  bool ok = true;
+  double value;
+
+  for (int key = CBOR_KEY_VERSION; key <= CBOR_KEY_LOOP; key++) {
+    ok = check(r.present[key], "key missing") && ok;
+  }
+  ok = check(r.value[CBOR_KEY_VERSION] == REPORT_CBOR_VERSION, "version") && ok;
+  ok = check(r.value[CBOR_KEY_STATE] == machinestate, "state") && ok;
+  ok = check(jsonNumber(json, "powered_time", &value) && (fabs(value * 3600 - r.value[CBOR_KEY_POWERED_TIME]) < 1), "powered_time") && ok;
+  ok = check(jsonNumber(json, "running_time", &value) && (fabs(value * 3600 - r.value[CBOR_KEY_RUNNING_TIME]) < 1), "running_time") && ok;
+  ok = check(jsonNumber(json, "pressure_sensor", &value) && (fabs(value * 100 - r.value[CBOR_KEY_PRESSURE]) < 0.51), "pressure") && ok;
+  ok = check((json.find("oil_level_sensor\"") != std::string::npos) == (r.value[CBOR_KEY_OIL_LEVEL] == REPORT_OK), "oil level") && ok;
+  ok = check(jsonNumber(json, "opto1", &value) && ((value != 0) == (r.value[CBOR_KEY_OPTO1] != 0)), "opto1") && ok;
+  ok = check(jsonNumber(json, "ota", &value) && (value == r.value[CBOR_KEY_OTA]), "ota") && ok;
+
+  ok = check(r.nrOfTemperatures == theTempSensors.count(), "number of temperature sensors") && ok;
+  for (uint8_t i = 0; i < r.nrOfTemperatures; i++) {
+    TemperatureSensor &s = theTempSensors.sensor(i);
+    std::string key = s.reportKey();
+
+    ok = check(r.temperature[i][0] == s.number(), "sensor number") && ok;
+    ok = check(r.temperature[i][3] == s.crcErrors, "CRC errors") && ok;
+    if (r.temperatureNull[i]) {
+      ok = check(r.temperature[i][2] == REPORT_NOT_AVAILABLE, "status of a missing sensor") && ok;
+      ok = check(json.find("Error reading temperature sensor " + std::to_string(s.number())) != std::string::npos,
+                 "missing sensor in the JSON report") && ok;
+    } else {
+      ok = check(jsonNumber(json, key, &value) && (fabs(value * 100 - r.temperature[i][1]) < 0.51), "temperature") && ok;
+      ok = check((json.find(key + "_error") != std::string::npos) == (r.temperature[i][2] == REPORT_ERROR), "error") && ok;
+      ok = check((json.find(key + "_warning") != std::string::npos) == (r.temperature[i][2] == REPORT_WARNING), "warning") && ok;
+    }
+  }
+
+  ok = check(r.nrOfStages == NR_OF_LOOP_STAGES, "number of loop stages") && ok;
+  for (uint8_t i = 0; i < r.nrOfStages; i++) {
+    ok = check((r.loop[i][0] == (int64_t)profilerP50[i]) && (r.loop[i][2] == (int64_t)profilerMax[i]), "loop stage") && ok;
+  }
+  return ok;
+}
+
+static void print(const decodedreport_t &r) {
+  printf("  {0: %lld, 1: %lld, 2: %lld, 3: %lld, 4: %lld, 5: %lld, 6: %s, 7: %s, 8: [", (long long)r.value[0],
+         (long long)r.value[1], (long long)r.value[2], (long long)r.value[3], (long long)r.value[4],
+         (long long)r.value[5], r.value[6] ? "true" : "false", r.value[7] ? "true" : "false");
+  for (uint8_t i = 0; i < r.nrOfTemperatures; i++) {
+    if (r.temperatureNull[i]) {
+      printf("%s[%lld, null, %lld, %lld]", i ? ", " : "", (long long)r.temperature[i][0],
+             (long long)r.temperature[i][2], (long long)r.temperature[i][3]);
+    } else {
+      printf("%s[%lld, %lld, %lld, %lld]", i ? ", " : "", (long long)r.temperature[i][0], (long long)r.temperature[i][1],
+             (long long)r.temperature[i][2], (long long)r.temperature[i][3]);
+    }
+  }
+  printf("], 9: [");
+  for (uint8_t i = 0; i < r.nrOfStages; i++) {
+    printf("%s[%lld, %lld, %lld]", i ? ", " : "", (long long)r.loop[i][0], (long long)r.loop[i][1], (long long)r.loop[i][2]);
+  }
+  printf("]}\n");
+}
+
+// one report: decode and compare
+static bool report(const char *what) {
+  uint64_t profilerP50[NR_OF_LOOP_STAGES];
+  uint64_t profilerMax[NR_OF_LOOP_STAGES];
+  decodedreport_t decoded;
+  bool ok;
+
+  // the report resets the profiler, keep what it should contain
+  for (int i = 0; i < NR_OF_LOOP_STAGES; i++) {
+    profilerP50[i] = theLoopProfiler.stage[i].percentile(50);
+    profilerMax[i] = theLoopProfiler.stage[i].maximum();
+  }
+  cborPayload.clear();
+  node.hostReport();
+  const std::string &json = node.hostLastReport();
+
+  printf("%s\n", what);
+  ok = check(!cborPayload.empty(), "no CBOR report sent") && decode(cborPayload, &decoded);
+  if (!ok) {
+    printf("  CBOR report cannot be decoded\n");
+    return false;
+  }
+  printf("  JSON %zu bytes, CBOR %zu bytes (%.1fx smaller); MQTT packets %zu and %zu bytes\n", json.size(),
+         cborPayload.size(), (double)json.size() / cborPayload.size(),
+         MQTT_HEADER_SIZE + strlen(MQTT_TOPIC_PREFIX "report") + json.size(),
+         MQTT_HEADER_SIZE + strlen(MQTT_TOPIC_PREFIX REPORT_CBOR_TOPIC) + cborPayload.size());
+  if (hal_verbose) {
+    print(decoded);
+  }
+  ok = compare(decoded, json, profilerP50, profilerMax);
+  ok = check(MQTT_HEADER_SIZE + strlen(MQTT_TOPIC_PREFIX "report") + json.size() <= MQTT_JSON_PACKET_SIZE,
+             "JSON report does not fit the MQTT_MAX_PACKET_SIZE of the README") && ok;
+  return check(MQTT_HEADER_SIZE + strlen(MQTT_TOPIC_PREFIX REPORT_CBOR_TOPIC) + cborPayload.size() <= 256,
+               "CBOR report does not fit the default MQTT_MAX_PACKET_SIZE") && ok;
+}
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 120;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "t:v")) != -1) {
+    if (opt == 't') {
+      seconds = strtoul(optarg, nullptr, 10);
+    } else if (opt == 'v') {
+      hal_verbose = true;
+    } else {
+      fprintf(stderr, "usage: %s [-t seconds] [-v]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  plant_init();
+  setup();
+  node.hostConnect();
+  node.hostHoldReports(true);
+  node.hostOnSend([](const char *topic, const uint8_t *payload, size_t len) {
+    if (!strcmp(topic, REPORT_CBOR_TOPIC)) {
+      cborPayload.assign(payload, payload + len);
+    }
+  });
+
+  unsigned long start = millis();
+  plant_press(PLANT_ON_BUTTON, start + 3000, 300);
+  theLoopProfiler.reset();
+  run(seconds);
+  ok = report("compressor running:") && ok;
+
+  // the motor sensor is unplugged
+  hal_set_temp_sensor_missing(1, true);
+  run(10);
+  ok = report("sensor 2 unplugged:") && ok;
+
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+// Safety interlock benchmark.
+//
+// Runs the firmware against the compressor model (see bench_loop) with a
+// broken pressure switch: the motor keeps running past PRESSURE_MAX_LIMIT.
+// loop() stalls for long periods while the pressure rises, as it does when
+// node.loop() blocks on a reconnect; the model and the clock go on meanwhile.
+// Measures the time from the pressure crossing the limit to the relay going
+// off and the overshoot, and reports the worst trip latency and check
+// interval the interlock measured itself (see SafetyInterlock.h). Checks that
+// the relay is off within SAFETY_MAX_RELAY_LATENCY of the crossing however
+// long loop() stalls, and that loop() follows with the compressor switched off.
+// Then runs the same cutoffs with the esp_timer of the interlock refused and
+// without stalls: loop() must sample the pressure and do the check itself.
+//
+// usage: bench_safety [-c cycles] [-s stall_ms]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <MachState.h>
+#include <plant.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "SafetyInterlock.h"
+#include "LoopProfiler.h"
+
+extern machinestates_t machinestate;
+
+#define PRESSURE_MAX_LIMIT (12.0) // in bar, as in main.cpp
+#define SAFETY_MAX_RELAY_LATENCY (300) // in ms, the median filter of the pressure takes part of it
+
+static uint64_t crossing = 0; // in us, the pressure of the model crossed the limit
+static uint64_t relayOff = 0; // in us
+static bool inStall = false;
+static bool offInStall = false;
+static float maxPressure = 0;
+
+static uint32_t random(uint32_t from, uint32_t to) {
+  return from + (uint32_t)(rand() % (to - from + 1));
+}
+
+static void step() {
+  plant_step(1000);
+  if ((crossing == 0) && (plant.pressure > PRESSURE_MAX_LIMIT)) {
+    crossing = hal_now_us();
+  }
+  if ((relayOff == 0) && (hal_get_pin(PLANT_RELAY_GPIO) == LOW)) {
+    relayOff = hal_now_us();
+    offInStall = inStall;
+  }
+  if (plant.pressure > maxPressure) {
+    maxPressure = plant.pressure;
+  }
+}
+
+static void run(unsigned long ms) {
+  unsigned long end = millis() + ms;
+
+  while (millis() < end) {
+    step();
+    loop();
+  }
+}
+
+// loop() does not run, the model, the clock and the esp_timer task go on
+static void stall(unsigned long ms) {
+  unsigned long end = millis() + ms;
+
+  inStall = true;
+  while (millis() < end) {
+    step();
+  }
+  inStall = false;
+}
+
+static int measure(bool withTimer, unsigned long cycles, unsigned long stallTime) {
+  plant_init();
+  hal_refuse_esp_timer("safety", !withTimer);
+  setup();
+  node.hostConnect();
+  node.hostHoldReports(true);
+  run(5000);
+
+  LoopHistogram latency; // in ms
+  float maxOvershoot = 0;
+  uint32_t offInStalls = 0;
+  uint32_t notOn = 0;
+  uint32_t notFollowed = 0;
+  srand(1);
+  for (unsigned long cycle = 0; cycle < cycles; cycle++) {
+    // the tank is vented, the compressor is switched on (again)
+    plant.overPressure = 0;
+    plant.pressure = 5.0;
+    run(1000);
+    if (machinestate < POWERED) {
+      plant_press(PLANT_ON_BUTTON, millis() + 10, 300);
+      run(2000);
+    }
+    if (hal_get_pin(PLANT_RELAY_GPIO) != HIGH) {
+      notOn++;
+      continue;
+    }
+
+    // the pressure switch breaks just below the limit, loop() stalls most of the time
+    plant.overPressure = 13.0;
+    plant.pressure = PRESSURE_MAX_LIMIT - random(1, 50) * 0.01;
+    crossing = 0;
+    relayOff = 0;
+    maxPressure = 0;
+    while ((relayOff == 0) && (plant.pressure < plant.overPressure)) {
+      run(random(20, 300));
+      stall(stallTime);
+    }
+    // with the noise of the sensor the relay may go off just before the model crosses the limit
+    latency.add(((crossing > 0) && (relayOff > crossing)) ? (relayOff - crossing) / 1000 : 0);
+    if (maxPressure - PRESSURE_MAX_LIMIT > maxOvershoot) {
+      maxOvershoot = maxPressure - PRESSURE_MAX_LIMIT;
+    }
+    if (offInStall) {
+      offInStalls++;
+    }
+    run(500);
+    if (machinestate >= POWERED) {
+      notFollowed++;
+    }
+  }
+
+  volatile safetyinterlockcounters_t &c = theSafetyInterlock.counters;
+  bool ok = (latency.maximum() <= SAFETY_MAX_RELAY_LATENCY) && (notOn == 0) && (notFollowed == 0) &&
+            (theSafetyInterlock.timerRunning() == withTimer);
+
+  if (withTimer) {
+    printf("%lu pressure cutoffs with a broken pressure switch, loop() stalls %lu ms\n", cycles, stallTime);
+  } else {
+    printf("%lu pressure cutoffs with a broken pressure switch, no interlock timer, loop() does not stall\n", cycles);
+  }
+  printf("  limit crossed to relay off (ms):  p50 %lu, p99 %lu, max %lu, overshoot %.3f bar\n", latency.percentile(50),
+         latency.percentile(99), latency.maximum(), maxOvershoot);
+  printf("  %u relay off while loop() stalled, %u trips by the interlock\n", offInStalls, c.trips);
+  printf("  interlock: %u checks, worst trip latency %u us, worst check interval %u us\n", c.checks, c.worstTripLatency,
+         c.worstCheckInterval);
+  printf("  %u not switched on, %u not switched off by loop() after the trip\n", notOn, notFollowed);
+  if (withTimer) {
+    ok = (c.worstTripLatency <= SAFETY_INTERLOCK_PERIOD * 1000) && (c.trips > 0) && ok;
+  } else {
+    ok = (c.checks > 0) && ok;
+  }
+  fflush(stdout);
+  return ok ? 0 : 1;
+}
+
+// in a child process, setup() runs once per process
+static bool measureInChild(bool withTimer, unsigned long cycles, unsigned long stallTime) {
+  int status;
+  pid_t child;
+
+  fflush(stdout);
+  child = fork();
+  if (child == 0) {
+    _exit(measure(withTimer, cycles, stallTime));
+  }
+  waitpid(child, &status, 0);
+  return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char **argv) {
+  unsigned long cycles = 20;
+  unsigned long stallTime = 2000;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "c:s:")) != -1) {
+    if (opt == 'c') {
+      cycles = strtoul(optarg, nullptr, 10);
+    } else if (opt == 's') {
+      stallTime = strtoul(optarg, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-c cycles] [-s stall_ms]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  ok = measureInChild(true, cycles, stallTime) && ok;
+  ok = measureInChild(false, cycles, 0) && ok;
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,268 @@
+// Machine state benchmark.
+//
+// Enumerates the transition table of StateMachine.h and checks that every
+// event is handled in every state, that every transition goes to a valid
+// state, that every transition that switches the compressor on has a guard,
+// which states can be reached from BOOTING and that every state the relay
+// can be on in goes to SWITCHEDOFF on switch off. Then runs the firmware
+// against the compressor model (see bench_loop) with the commands of the
+// master and the buttons, checks after every pass of loop() that the relay
+// is on in POWERED and RUNNING only and the motor LED is on in RUNNING only,
+// checks that the stop command and the Off button switch the relay off in
+// TRANSIENTERROR and NOCONN, and times machineEvent().
+//
+// usage: bench_states [-t seconds] [-v]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <MachState.h>
+#include <plant.h>
+#include <chrono>
+#include <unistd.h>
+
+#include "LoopProfiler.h"
+#include "StateMachine.h"
+
+extern machinestates_t machinestate;
+
+#define COMMAND_WINDOW (20000) // in ms, between the commands of the master and the buttons
+#define LED_MOTOR_CHANNEL (1) // PWM_LED_CHANNEL2 of main.cpp
+#define DISPATCHES (1000000)
+
+static bool isOn(uint8_t machineState) {
+  return (machineState == POWERED) || (machineState == RUNNING);
+}
+
+static bool checkTable() {
+  bool reachable[NR_OF_MACHINE_STATES] = { false };
+  uint8_t todo[NR_OF_MACHINE_STATES];
+  uint8_t nrOfTodo = 0;
+  bool relayMayBeOn[NR_OF_MACHINE_STATES] = { false };
+  uint32_t unhandled = 0, invalid = 0, unguarded = 0, transitions = 0, notSwitchedOff = 0;
+
+  printf("%-24s", "");
+  for (uint8_t e = 0; e < NR_OF_MACHINE_EVENTS; e++) {
+    printf(" %-13s", machineEventLabel((machineevent_t)e));
+  }
+  printf("\n");
+  for (uint8_t s = 0; s < NR_OF_MACHINE_STATES; s++) {
+    printf("%-24.24s", machineStateLabel((machinestates_t)s));
+    for (uint8_t e = 0; e < NR_OF_MACHINE_EVENTS; e++) {
+      const machinetransition_t &t = machineTransitions[s][e];
+      char cell[32];
+
+      if (!t.handled) {
+        unhandled++;
+        snprintf(cell, sizeof(cell), "?");
+      } else if (t.next == MACHINE_NO_TRANSITION) {
+        snprintf(cell, sizeof(cell), "-");
+      } else if (t.next >= NR_OF_MACHINE_STATES) {
+        invalid++;
+        snprintf(cell, sizeof(cell), "%u!", t.next);
+      } else {
+        transitions++;
+        snprintf(cell, sizeof(cell), "%u%s", t.next, (t.guard != NULL) ? " if" : "");
+        if (isOn(t.next) && !isOn(s) && (t.guard == NULL)) {
+          unguarded++;
+        }
+      }
+      printf(" %-13s", cell);
+    }
+    printf("\n");
+  }
+
+  // the states reachable from BOOTING, guards taken as true
+  reachable[BOOTING] = true;
+  todo[nrOfTodo++] = BOOTING;
+  while (nrOfTodo > 0) {
+    uint8_t s = todo[--nrOfTodo];
+
+    for (uint8_t e = 0; e < NR_OF_MACHINE_EVENTS; e++) {
+      uint8_t next = machineTransitions[s][e].next;
+
+      if ((next < NR_OF_MACHINE_STATES) && !reachable[next]) {
+        reachable[next] = true;
+        todo[nrOfTodo++] = next;
+      }
+    }
+  }
+  printf("%u states, %u events, %u transitions; not reachable from %s:", NR_OF_MACHINE_STATES, NR_OF_MACHINE_EVENTS,
+         transitions, machineStateLabel(BOOTING));
+  for (uint8_t s = 0; s < NR_OF_MACHINE_STATES; s++) {
+    if (!reachable[s]) {
+      printf(" %s,", machineStateLabel((machinestates_t)s));
+    }
+  }
+  printf("\n%u cells not handled, %u invalid states, %u switch on transitions without a guard\n", unhandled, invalid,
+         unguarded);
+
+  // the states reachable from POWERED that keep the relay, a reboot drops it
+  relayMayBeOn[POWERED] = true;
+  todo[nrOfTodo++] = POWERED;
+  while (nrOfTodo > 0) {
+    uint8_t s = todo[--nrOfTodo];
+
+    for (uint8_t e = 0; e < NR_OF_MACHINE_EVENTS; e++) {
+      uint8_t next = machineTransitions[s][e].next;
+
+      if ((next < NR_OF_MACHINE_STATES) && (next != SWITCHEDOFF) && (next != REBOOT) && !relayMayBeOn[next]) {
+        relayMayBeOn[next] = true;
+        todo[nrOfTodo++] = next;
+      }
+    }
+  }
+  printf("the relay may be on in:");
+  for (uint8_t s = 0; s < NR_OF_MACHINE_STATES; s++) {
+    if (relayMayBeOn[s]) {
+      printf(" %s,", machineStateLabel((machinestates_t)s));
+      notSwitchedOff += (machineTransitions[s][MACHINE_SWITCH_OFF].next != SWITCHEDOFF) ? 1 : 0;
+    }
+  }
+  printf("\n%u of these states do not go to %s on switch off\n", notSwitchedOff, machineStateLabel(SWITCHEDOFF));
+  // the compressor must be reachable, switched on and off
+  return (unhandled == 0) && (invalid == 0) && (unguarded == 0) && (notSwitchedOff == 0) && reachable[SWITCHEDOFF] &&
+         reachable[POWERED] && reachable[RUNNING];
+}
+
+static bool checkFirmware(unsigned long seconds, bool verbose) {
+  uint32_t passes = 0, relayWrong = 0, ledWrong = 0, changes = 0;
+  uint32_t commands = 0;
+  uint8_t laststate = machinestate;
+
+  plant_init();
+  setup();
+  node.hostInLoop([]() { node.hostConnect(); });
+
+  unsigned long end = millis() + seconds * 1000;
+  unsigned long nextCommand = millis() + COMMAND_WINDOW;
+  while (millis() < end) {
+    plant_step(1000);
+    loop();
+    passes++;
+
+    if (machinestate != laststate) {
+      if (verbose) {
+        printf("  %8lu ms  %s -> %s\n", millis(), machineStateLabel((machinestates_t)laststate),
+               machineStateLabel(machinestate));
+      }
+      changes++;
+      laststate = machinestate;
+    }
+    // NOCONN and the error states keep the relay as it was
+    if (machinestate >= SWITCHEDOFF) {
+      relayWrong += ((hal_get_pin(PLANT_RELAY_GPIO) == HIGH) != isOn(machinestate)) ? 1 : 0;
+      ledWrong += ((hal_get_ledc(LED_MOTOR_CHANNEL) != 0) != (machinestate == RUNNING)) ? 1 : 0;
+    }
+
+    if (millis() >= nextCommand) {
+      // poweron, stop, On button, Off button
+      switch (commands++ % 4) {
+        case 0:
+          node.hostInLoop([]() { node.hostCommand("poweron"); });
+          break;
+        case 1:
+          node.hostInLoop([]() { node.hostCommand("stop"); });
+          break;
+        case 2:
+          plant_press(PLANT_ON_BUTTON, millis() + 10, 200);
+          break;
+        case 3:
+          plant_press(PLANT_OFF_BUTTON, millis() + 10, 200);
+          break;
+      }
+      nextCommand = millis() + COMMAND_WINDOW;
+    }
+  }
+
+  printf("%lu s, %u passes, %u commands and button presses, %u state changes\n", seconds, passes, commands, changes);
+  printf("%u passes with the relay, %u with the motor LED not as the state\n", relayWrong, ledWrong);
+  return (relayWrong == 0) && (ledWrong == 0) && (changes >= commands);
+}
+
+// runs loop() until the machine state is expected, false if it is not within ms
+static bool runUntil(machinestates_t expected, unsigned long ms) {
+  unsigned long end = millis() + ms;
+
+  while ((machinestate != expected) && (millis() < end)) {
+    plant_step(1000);
+    loop();
+  }
+  return machinestate == expected;
+}
+
+// switched on, then an error or a lost connection, which keep the relay on; stop or the Off button must drop it
+static bool checkSwitchOff(bool verbose) {
+  uint32_t wrong = 0;
+
+  for (uint8_t test = 0; test < 3; test++) {
+    machinestates_t errorState = (test == 0) ? TRANSIENTERROR : NOCONN;
+
+    node.hostInLoop([]() { node.hostConnect(); });
+    node.hostInLoop([]() { node.hostCommand("stop"); });
+    runUntil(SWITCHEDOFF, 5000);
+    node.hostInLoop([]() { node.hostCommand("poweron"); });
+    if (!runUntil(POWERED, 5000)) {
+      wrong++;
+      continue;
+    }
+    if (errorState == TRANSIENTERROR) {
+      node.hostInLoop([]() { node.hostError(ACNODE_ERROR_FATAL); });
+    } else {
+      node.hostInLoop([]() { node.hostDisconnect(); });
+    }
+    bool kept = runUntil(errorState, 5000) && (hal_get_pin(PLANT_RELAY_GPIO) == HIGH);
+    if (test < 2) {
+      node.hostInLoop([]() { node.hostCommand("stop"); });
+    } else {
+      plant_press(PLANT_OFF_BUTTON, millis() + 10, 200);
+    }
+    bool off = runUntil(SWITCHEDOFF, 5000) && (hal_get_pin(PLANT_RELAY_GPIO) == LOW);
+    if (verbose || !kept || !off) {
+      printf("  %s in %s: relay %s, %s\n", (test < 2) ? "stop" : "Off button", machineStateLabel(errorState),
+             kept ? "kept on" : "not kept on", off ? "switched off" : "not switched off");
+    }
+    wrong += (kept && off) ? 0 : 1;
+  }
+  printf("stop and Off button in %s and %s: %u of 3 not switched off\n", machineStateLabel(TRANSIENTERROR),
+         machineStateLabel(NOCONN), wrong);
+  return wrong == 0;
+}
+
+// the cost of a dispatch, for an event that is ignored in the current state
+static void timeDispatch() {
+  machinestates_t saved = machinestate;
+
+  machinestate = SWITCHEDOFF;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < DISPATCHES; i++) {
+    machineEvent((i & 1) ? MACHINE_MOTOR_STARTED : MACHINE_MOTOR_STOPPED);
+  }
+  auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  machinestate = saved;
+  printf("machineEvent(): %.1f ns per event\n", (double)duration.count() / DISPATCHES);
+}
+
+int main(int argc, char **argv) {
+  unsigned long seconds = 300;
+  bool verbose = false;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "t:v")) != -1) {
+    if (opt == 't') {
+      seconds = strtoul(optarg, nullptr, 10);
+    } else if (opt == 'v') {
+      verbose = true;
+    } else {
+      fprintf(stderr, "usage: %s [-t seconds] [-v]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  ok = checkTable() && ok;
+  ok = checkFirmware(seconds, verbose) && ok;
+  ok = checkSwitchOff(verbose) && ok;
+  timeDispatch();
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+// Timer wheel benchmark.
+//
+// Drives a TimerWheel with random one-shot and periodic timers against a
+// reference of the expected deadlines: the clock advances in random steps,
+// from a few ms to hours, and the callbacks stop other timers and restart
+// themselves. Every timer must be called in the first run() at or after its
+// deadline, never before, and a periodic timer must keep its phase.
+//
+// Then runs the firmware against the compressor model (see bench_loop) from
+// just before 2^32 ms of uptime, where millis() of the node wraps, to past
+// it: the periodic work must go on and the compressor must stay switched on.
+//
+// usage: bench_timer [-n steps] [-s seed]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <MachState.h>
+#include <plant.h>
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+
+#include "TimerWheel.h"
+#include "History.h"
+
+extern machinestates_t machinestate;
+
+#define NR_OF_BENCH_TIMERS (200)
+
+typedef struct {
+  wheeltimer_t timer;
+  uint64_t expected; // in ms, the deadline of the reference
+  uint32_t period;
+  bool scheduled;
+} benchtimer_t;
+
+static TimerWheel wheel;
+static benchtimer_t timers[NR_OF_BENCH_TIMERS];
+static uint64_t previousRun = 0; // in ms, the time of the run() before
+static uint32_t early = 0;
+static uint32_t late = 0;
+
+static uint32_t random(uint32_t from, uint32_t to) {
+  return from + (uint32_t)(rand() % (to - from + 1));
+}
+
+static void fired(void *context) {
+  benchtimer_t *t = (benchtimer_t *)context;
+  uint64_t now = uptimeMs();
+
+  if (now < t->expected) {
+    early++;
+  }
+  if (previousRun >= t->expected) {
+    late++;
+  }
+  if (t->period > 0) {
+    t->expected += t->period;
+  } else {
+    t->scheduled = false;
+  }
+
+  // what the firmware does from its callbacks
+  if (random(0, 7) == 0) {
+    benchtimer_t *other = &timers[random(0, NR_OF_BENCH_TIMERS - 1)];
+    wheel.stop(&other->timer);
+    other->scheduled = false;
+  }
+  if (t->scheduled && (random(0, 15) == 0)) {
+    uint32_t delay = random(1, 100000);
+    wheel.restart(&t->timer, delay);
+    t->expected = now + delay;
+  }
+}
+
+static void startRandom(benchtimer_t *t) {
+  uint32_t delay = (random(0, 9) == 0) ? random(0, 1 << 26) : random(0, 5000);
+
+  t->period = (random(0, 2) == 0) ? 0 : random(100, 100000);
+  wheel.start(&t->timer, delay, t->period, fired, t);
+  // the time of the last run() is handled: a timer due now is called in the next run()
+  t->expected = std::max(uptimeMs() + delay, previousRun + 1);
+  t->scheduled = true;
+}
+
+static uint32_t advance() {
+  uint32_t choice = random(0, 99);
+
+  if (choice < 70) {
+    return random(1, 10);
+  }
+  if (choice < 99) {
+    return random(10, 2000);
+  }
+  return random(2000, 1 << 24);
+}
+
+// the state of the wheel against the reference
+static bool consistent() {
+  uint64_t deadline = TIMER_WHEEL_NEVER;
+
+  for (benchtimer_t &t : timers) {
+    if (wheel.isScheduled(&t.timer) != t.scheduled) {
+      return false;
+    }
+    if (t.scheduled && (t.expected < deadline)) {
+      deadline = t.expected;
+    }
+  }
+  return wheel.nextDeadline() == deadline;
+}
+
+static bool randomTimers(uint32_t steps) {
+  bool ok = true;
+  uint32_t inconsistent = 0;
+
+  wheel.run();
+  previousRun = uptimeMs();
+  for (benchtimer_t &t : timers) {
+    startRandom(&t);
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t step = 0; step < steps; step++) {
+    hal_advance_us((uint64_t)advance() * 1000);
+    wheel.run();
+    previousRun = uptimeMs();
+    if (!consistent()) {
+      inconsistent++;
+    }
+    if (random(0, 3) == 0) {
+      benchtimer_t *t = &timers[random(0, NR_OF_BENCH_TIMERS - 1)];
+      if (!t->scheduled || (random(0, 3) == 0)) {
+        startRandom(t);
+      } else {
+        wheel.stop(&t->timer);
+        t->scheduled = false;
+      }
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("random timers: %u steps, %.1f h simulated\n", steps, (uptimeMs() - 1000) / 3600000.0);
+  printf("  %u runs, %u called, %u cascaded, %.0f ns host time per call\n", wheel.counters.runs, wheel.counters.fired,
+         wheel.counters.cascaded, wheel.counters.fired ? seconds * 1e9 / wheel.counters.fired : 0.0);
+  printf("  %u early, %u late, %u steps inconsistent with the reference\n", early, late, inconsistent);
+  ok = (early == 0) && (late == 0) && (inconsistent == 0) && (wheel.counters.fired > 0);
+  return ok;
+}
+
+static void run(unsigned long seconds) {
+  for (unsigned long i = 0; i < seconds * 10; i++) {
+    plant_step(100000);
+    hal_service_inputs();
+    loop();
+  }
+}
+
+static bool pastWrap() {
+  const uint64_t wrap = (uint64_t)1 << 32; // in ms
+
+  plant_init();
+  hal_advance_us((wrap - 120000) * 1000 - hal_now_us());
+  hal_set_wallclock(3, 10, 0); // Wednesday 10:00
+  setup();
+  node.hostConnect();
+  plant_press(PLANT_ON_BUTTON, millis() + 2000, 300);
+  run(60);
+  uint32_t samplesBefore = theHistory.nrOfSamples();
+  uint32_t firedBefore = theTimerWheel.counters.fired;
+  bool poweredBefore = (machinestate >= POWERED);
+
+  run(120);
+  uint32_t samples = theHistory.nrOfSamples() - samplesBefore;
+  uint32_t fired = theTimerWheel.counters.fired - firedBefore;
+  printf("firmware from %llu ms to %llu ms of uptime:\n", (unsigned long long)(wrap - 60000), (unsigned long long)uptimeMs());
+  printf("  %u history samples, %u timers called in 120 s, compressor %s\n", samples, fired,
+         (machinestate >= POWERED) ? "switched on" : "switched off");
+  return poweredBefore && (machinestate >= POWERED) && (samples >= 118) && (uptimeMs() > wrap);
+}
+
+int main(int argc, char **argv) {
+  uint32_t steps = 200000;
+  unsigned int seed = 1;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+    if (opt == 'n') {
+      steps = strtoul(optarg, nullptr, 10);
+    } else if (opt == 's') {
+      seed = strtoul(optarg, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-n steps] [-s seed]\n", argv[0]);
+      return 1;
+    }
+  }
+  srand(seed);
+
+  ok = randomTimers(steps) && ok;
+  ok = pastWrap() && ok;
+
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+// Report traffic benchmark.
+//
+// Runs the firmware against the compressor model (see bench_loop) through an
+// idle period, a period with the compressor switched on and a second idle
+// period, and counts the report messages and bytes the node publishes in
+// each. The reference is the fixed 5 minute report period of ACNode with the
+// full JSON report. Checks that the machine state changes go out in a change
+// report in the same loop() pass, that idle traffic drops by at least 10x and
+// that a node that is switched on sends no more than with the fixed period.
+//
+// usage: bench_traffic [-i idle hours] [-r running minutes]
+
+#include <Arduino.h>
+#include <ACNode.h>
+#include <MachState.h>
+#include <plant.h>
+#include <algorithm>
+#include <string>
+#include <unistd.h>
+
+#include "ReportCbor.h"
+
+extern machinestates_t machinestate;
+
+#define FIXED_REPORT_PERIOD (5 * 60) // in s, the default of ACNode
+
+typedef struct {
+  uint32_t heartbeats; // JSON reports
+  uint32_t cborHeartbeats; // CBOR reports with all keys
+  uint32_t changes;
+  uint64_t bytes;
+  size_t jsonSize;
+} traffic_t;
+
+static traffic_t traffic;
+static int64_t lastReportedState = -1;
+
+// the machine state of a CBOR report, -1 if it has none
+static int64_t reportedState(const uint8_t *payload, size_t len) {
+  CborReader cbor(payload, len);
+  cboritem_t item;
+  int64_t key;
+
+  if (!cbor.next(&item) || (item.majorType != CBOR_MAP)) {
+    return -1;
+  }
+  for (uint64_t pair = 0; pair < item.value; pair++) {
+    int64_t value;
+
+    if (!cbor.integer(&key)) {
+      return -1;
+    }
+    if (key == CBOR_KEY_STATE) {
+      return cbor.integer(&value) ? value : -1;
+    }
+    if (!cbor.skip()) {
+      return -1;
+    }
+  }
+  return -1;
+}
+
+static void onSend(const char *topic, const uint8_t *payload, size_t len) {
+  if (!strcmp(topic, "report")) {
+    traffic.heartbeats++;
+    traffic.bytes += len;
+    traffic.jsonSize = len;
+  } else if (!strcmp(topic, REPORT_CBOR_TOPIC)) {
+    traffic.bytes += len;
+    int64_t state = reportedState(payload, len);
+    if (state >= 0) {
+      lastReportedState = state;
+    }
+    // a change report never holds the times and the loop profiler, the heartbeat report all keys
+    CborReader cbor(payload, len);
+    cboritem_t item;
+    if (cbor.next(&item)) {
+      if (item.value < CBOR_KEY_LOOP) {
+        traffic.changes++;
+      } else {
+        traffic.cborHeartbeats++;
+      }
+    }
+  }
+}
+
+// false if a state change was not reported in the same loop() pass
+static bool run(unsigned long seconds) {
+  unsigned long end = millis() + seconds * 1000;
+  bool ok = true;
+
+  while (millis() < end) {
+    machinestates_t before = machinestate;
+    plant_step(1000);
+    hal_service_inputs();
+    loop();
+    if ((machinestate != before) && (lastReportedState != machinestate)) {
+      printf("  state %d at %lu ms not reported\n", machinestate, millis());
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+static double phase(const char *what, unsigned long seconds, const traffic_t &before) {
+  uint32_t heartbeats = traffic.heartbeats - before.heartbeats;
+  uint32_t cborHeartbeats = traffic.cborHeartbeats - before.cborHeartbeats;
+  uint32_t changes = traffic.changes - before.changes;
+  uint64_t bytes = traffic.bytes - before.bytes;
+  uint64_t fixedBytes = (uint64_t)(seconds / FIXED_REPORT_PERIOD) * traffic.jsonSize;
+
+  printf("%-18s %6lu s: %4u JSON and %4u CBOR heartbeats, %5u change reports, %8llu bytes; fixed period %8llu bytes (%.1fx)\n",
+         what, seconds, heartbeats, cborHeartbeats, changes, (unsigned long long)bytes, (unsigned long long)fixedBytes,
+         bytes ? (double)fixedBytes / bytes : 0.0);
+  return bytes ? (double)fixedBytes / bytes : 0.0;
+}
+
+int main(int argc, char **argv) {
+  unsigned long idleHours = 4;
+  unsigned long runningMinutes = 30;
+  int opt;
+  bool ok = true;
+
+  while ((opt = getopt(argc, argv, "i:r:")) != -1) {
+    if (opt == 'i') {
+      idleHours = strtoul(optarg, nullptr, 10);
+    } else if (opt == 'r') {
+      runningMinutes = strtoul(optarg, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [-i idle hours] [-r running minutes]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  plant_init();
+  setup();
+  node.hostConnect();
+  node.hostOnSend(onSend);
+
+  traffic_t before = traffic;
+  ok = run(idleHours * 3600) && ok;
+  double idleGain = phase("switched off:", idleHours * 3600, before);
+
+  before = traffic;
+  plant_press(PLANT_ON_BUTTON, millis() + 1000, 300);
+  plant_press(PLANT_OFF_BUTTON, millis() + runningMinutes * 60000 - 1000, 300);
+  ok = run(runningMinutes * 60) && ok;
+  double activeGain = phase("switched on:", runningMinutes * 60, before);
+
+  before = traffic;
+  ok = run(idleHours * 3600) && ok;
+  idleGain = std::min(idleGain, phase("switched off again:", idleHours * 3600, before));
+
+  printf("JSON heartbeat %zu bytes\n", traffic.jsonSize);
+  ok = (idleGain >= 10) && (activeGain >= 1) && ok;
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
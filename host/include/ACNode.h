@@ -0,0 +1,131 @@
+#pragma once
+
+// Host stand-in for the ACNode library (github.com/dirkx/AccesSystem). Only
+// the API surface the CompressorNode uses is provided; MQTT traffic is
+// counted and, when hal verbose output is enabled, printed.
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+typedef enum {
+  ACNODE_ERROR_FATAL,
+} acnode_error_t;
+
+typedef enum {
+  BOARD_OLIMEX,
+} board_t;
+
+class LED {
+public:
+  typedef enum {
+    LED_OFF, LED_FLASH, LED_FAST, LED_ON, LED_IDLE, LED_PENDING, LED_ERROR,
+  } led_state_t;
+};
+
+class TLog : public Print {
+public:
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t len) override;
+  using Print::write;
+
+  void addPrintStream(const std::shared_ptr<TLog> &stream) { handlers.push_back(stream); }
+
+protected:
+  std::vector<std::shared_ptr<TLog>> handlers;
+};
+
+class MqttLogStream : public TLog {
+public:
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t len) override;
+  using Print::write;
+
+private:
+  std::string line;
+};
+
+class TelnetSerialStream : public TLog {
+public:
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t len) override;
+  using Print::write;
+};
+
+extern TLog Log;
+extern TLog Debug;
+
+class ACBase {
+public:
+  typedef enum { CMD_DECLINE, CMD_CLAIMED } cmd_result_t;
+};
+
+class OTA : public ACBase {
+public:
+  OTA(const char *password) { (void)password; }
+};
+
+class ACNode : public ACBase {
+public:
+  typedef std::function<void()> THandlerFunction_Connect;
+  typedef std::function<void()> THandlerFunction_Disconnect;
+  typedef std::function<void(acnode_error_t)> THandlerFunction_Error;
+  typedef std::function<cmd_result_t(const char *cmd, const char *rest)> THandlerFunction_Command;
+  typedef std::function<void(JsonObject &report)> THandlerFunction_Report;
+  typedef std::function<void(const char *topic, const uint8_t *payload, size_t len)> THandlerFunction_HostSend;
+
+  ACNode(const char *machine) : moi(machine) {}
+
+  void set_mqtt_prefix(const char *prefix) { (void)prefix; }
+  void set_master(const char *master) { (void)master; }
+  void set_report_period(unsigned long period) { report_period = period; }
+
+  void onConnect(THandlerFunction_Connect fn) { connect_cb = fn; }
+  void onDisconnect(THandlerFunction_Disconnect fn) { disconnect_cb = fn; }
+  void onError(THandlerFunction_Error fn) { error_cb = fn; }
+  void onValidatedCmd(THandlerFunction_Command fn) { command_cb = fn; }
+  void onReport(THandlerFunction_Report fn) { report_cb = fn; }
+
+  void addHandler(ACBase *handler) { (void)handler; }
+  void begin(board_t board);
+  void loop();
+  void delayedReboot();
+  IPAddress localIP() { return IPAddress(10, 0, 0, 95); }
+
+  void send(const char *topic, const char *payload, bool raw = false);
+  void send(const char *topic, const uint8_t *payload, size_t len);
+
+  // host only: inject network events and inspect traffic
+  void hostConnect();
+  void hostDisconnect();
+  void hostError(acnode_error_t err);
+  cmd_result_t hostCommand(const char *cmd, const char *rest = "");
+  void hostReport();
+  void hostInLoop(std::function<void()> fn); // fn runs in the next node.loop(), on its task, as a message of the broker
+  void hostHoldReports(bool hold) { hold_reports = hold; } // no periodic reports, whatever period the firmware sets
+  const std::string &hostLastReport() const { return last_report; }
+  void hostOnSend(THandlerFunction_HostSend fn) { send_cb = fn; }
+
+  const char *moi;
+
+private:
+  THandlerFunction_Connect connect_cb;
+  THandlerFunction_Disconnect disconnect_cb;
+  THandlerFunction_Error error_cb;
+  THandlerFunction_Command command_cb;
+  THandlerFunction_Report report_cb;
+  THandlerFunction_HostSend send_cb;
+  unsigned long report_period = 5 * 60 * 1000;
+  unsigned long last_report_ms = 0;
+  bool reported = false;
+  bool hold_reports = false;
+  uint64_t next_stall = 0;
+  std::string last_report;
+  std::mutex pending_lock;
+  std::vector<std::function<void()>> pending;
+};
+
+extern ACNode node;
@@ -0,0 +1,130 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 core. Only the parts used by the
+// CompressorNode firmware are provided. Time is virtual, see hal.h.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <functional>
+#include <string>
+
+#include "hal.h"
+
+#define HIGH (1)
+#define LOW  (0)
+
+#define INPUT        (0x01)
+#define OUTPUT       (0x02)
+#define INPUT_PULLUP (0x05)
+
+#define RISING  (0x01)
+#define FALLING (0x02)
+#define CHANGE  (0x03)
+
+#define DEC (10)
+#define HEX (16)
+
+#define IRAM_ATTR
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+// the handler is called from hal_set_pin() on a matching edge, like a GPIO interrupt
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+void ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+class String {
+public:
+  String() {}
+  String(const char *s) : str(s ? s : "") {}
+  String(const std::string &s) : str(s) {}
+  String(int v) : str(std::to_string(v)) {}
+  String(unsigned long v) : str(std::to_string(v)) {}
+
+  const char *c_str() const { return str.c_str(); }
+  size_t length() const { return str.length(); }
+
+  String &operator+=(const String &o) { str += o.str; return *this; }
+  String &operator+=(const char *o) { str += o; return *this; }
+  bool operator==(const String &o) const { return str == o.str; }
+
+  std::string str;
+};
+
+inline String operator+(const String &a, const String &b) { return String(a.str + b.str); }
+inline String operator+(const char *a, const String &b) { return String(std::string(a) + b.str); }
+inline String operator+(const String &a, const char *b) { return String(a.str + b); }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t len);
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = DEC);
+  size_t print(unsigned int v, int base = DEC);
+  size_t print(long v, int base = DEC);
+  size_t print(unsigned long v, int base = DEC);
+  size_t print(long long v, int base = DEC);
+  size_t print(unsigned long long v, int base = DEC);
+  size_t print(double v, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(const T &v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t len) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  void restart();
+  uint32_t getFreeHeap();
+};
+
+extern EspClass ESP;
+
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : addr{a, b, c, d} {}
+  String toString() const;
+  uint8_t addr[4] = {0, 0, 0, 0};
+};
+
+void setup();
+void loop();
@@ -0,0 +1,40 @@
+#pragma once
+
+// Minimal stand-in for the ArduinoJson 5 JsonObject used by ACNode::onReport.
+// Values are kept pre-serialised so the payload can be measured.
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+class JsonObject {
+public:
+  class Proxy {
+  public:
+    Proxy(JsonObject &o, const std::string &k) : obj(o), key(k) {}
+    Proxy &operator=(const char *v);
+    Proxy &operator=(const String &v) { return *this = v.c_str(); }
+    Proxy &operator=(bool v);
+    Proxy &operator=(int v) { return setNumber(std::to_string(v)); }
+    Proxy &operator=(unsigned int v) { return setNumber(std::to_string(v)); }
+    Proxy &operator=(long v) { return setNumber(std::to_string(v)); }
+    Proxy &operator=(unsigned long v) { return setNumber(std::to_string(v)); }
+    Proxy &operator=(long long v) { return setNumber(std::to_string(v)); }
+    Proxy &operator=(unsigned long long v) { return setNumber(std::to_string(v)); }
+    Proxy &operator=(double v);
+
+  private:
+    Proxy &setNumber(const std::string &v);
+    JsonObject &obj;
+    std::string key;
+  };
+
+  Proxy operator[](const char *key) { return Proxy(*this, key); }
+  Proxy operator[](const String &key) { return Proxy(*this, key.str); }
+
+  size_t size() const { return fields.size(); }
+  void clear() { fields.clear(); }
+  std::string serialize() const;
+
+  std::map<std::string, std::string> fields;
+};
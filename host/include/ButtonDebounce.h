@@ -0,0 +1,28 @@
+#pragma once
+
+// Host stand-in for ButtonDebounce: a pin is reported as changed once it has
+// been stable for the debounce delay. Like the interrupt driven original the
+// callback also fires from hal_service_inputs(), not only from update().
+
+#include <Arduino.h>
+
+class ButtonDebounce {
+public:
+  typedef std::function<void(int)> BTN_CALLBACK;
+
+  ButtonDebounce(int pin, unsigned long delay);
+
+  void update();
+  int state();
+  void setCallback(BTN_CALLBACK callback) { this->callback = callback; }
+
+  ButtonDebounce *next;
+
+private:
+  int pin;
+  unsigned long delay;
+  int lastState;
+  int lastRaw;
+  unsigned long lastChange = 0;
+  BTN_CALLBACK callback;
+};
@@ -0,0 +1,6 @@
+#pragma once
+#include <Arduino.h>
+#include <SPIFFS.h>
+
+void prepareCache(bool wipe);
+void wipe_eeprom();
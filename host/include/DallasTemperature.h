@@ -0,0 +1,33 @@
+#pragma once
+
+// Host stand-in for DallasTemperature. The bus population comes from
+// hal_add_temp_sensor(); every bus transaction charges the OneWire slot time.
+
+#include <Arduino.h>
+#include <OneWire.h>
+
+typedef uint8_t DeviceAddress[8];
+
+#define DEVICE_DISCONNECTED_C (-127)
+
+class DallasTemperature {
+public:
+  DallasTemperature(OneWire *oneWire) : bus(oneWire) {}
+
+  void begin();
+  uint8_t getDeviceCount();
+  bool getAddress(uint8_t *deviceAddress, uint8_t index);
+  bool isConnected(const uint8_t *deviceAddress);
+  bool setResolution(const uint8_t *deviceAddress, uint8_t newResolution, bool skipGlobalBitResolutionCalculation = false);
+  void setWaitForConversion(bool flag) { waitForConversion = flag; }
+  bool getWaitForConversion() { return waitForConversion; }
+  void requestTemperatures();
+  bool requestTemperaturesByAddress(const uint8_t *deviceAddress);
+  float getTempC(const uint8_t *deviceAddress);
+  bool isConversionComplete();
+  static uint16_t millisToWaitForConversion(uint8_t bitResolution) { return 750 / (1 << (12 - bitResolution)); }
+
+private:
+  OneWire *bus;
+  bool waitForConversion = true;
+};
@@ -0,0 +1,9 @@
+#pragma once
+#include <Arduino.h>
+
+class EEPROMClass {
+public:
+  bool begin(size_t size) { (void)size; return true; }
+};
+
+extern EEPROMClass EEPROM;
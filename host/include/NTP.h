@@ -0,0 +1,30 @@
+#pragma once
+
+// Host stand-in for NTP by Stefan Staub. Local time follows the virtual clock
+// from the wall clock set with hal_set_wallclock().
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+enum week_t { Last, First, Second, Third, Fourth };
+enum dow_t { Sun = 1, Mon, Tue, Wed, Thu, Fri, Sat };
+enum month_t { Jan, Feb, Mar, Apr, May, Jun, Jul, Aug, Sep, Oct, Nov, Dec };
+
+class NTP {
+public:
+  NTP(WiFiUDP &udp) { (void)udp; }
+  void ruleDST(const char *tzName, int8_t week, int8_t wday, int8_t month, int8_t hour, int tzOffset) {
+    (void)tzName; (void)week; (void)wday; (void)month; (void)hour; (void)tzOffset;
+  }
+  void ruleSTD(const char *tzName, int8_t week, int8_t wday, int8_t month, int8_t hour, int tzOffset) {
+    (void)tzName; (void)week; (void)wday; (void)month; (void)hour; (void)tzOffset;
+  }
+  void begin() {}
+  bool update() { return true; }
+
+  int8_t hours();
+  int8_t minutes();
+  int8_t seconds();
+  int8_t weekDay(); // 0 = Sunday
+  time_t epoch();
+};
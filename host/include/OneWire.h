@@ -0,0 +1,9 @@
+#pragma once
+
+#include <Arduino.h>
+
+class OneWire {
+public:
+  OneWire(uint8_t pin) : pin(pin) {}
+  uint8_t pin;
+};
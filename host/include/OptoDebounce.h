@@ -0,0 +1,24 @@
+#pragma once
+
+// Host stand-in for the ACNode OptoDebounce: the 230VAC opto coupler input is
+// a 50 Hz pulse train on the node, here it is a plain level.
+
+#include <Arduino.h>
+
+class OptoDebounce {
+public:
+  typedef enum { OFF, ON } state_t;
+
+  OptoDebounce(int pin, unsigned long delay = 20) : pin(pin), delay(delay) {}
+
+  void begin() {}
+  void loop();
+  state_t state() { return current; }
+
+private:
+  int pin;
+  unsigned long delay;
+  state_t current = OFF;
+  unsigned long lastChange = 0;
+  int lastRaw = LOW;
+};
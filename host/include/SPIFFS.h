@@ -0,0 +1,50 @@
+#pragma once
+
+// In-memory stand-in for the ESP32 SPIFFS filesystem. Contents survive a
+// simulated reboot (ESP.restart()) but not the host process.
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+class File {
+public:
+  File() {}
+  File(const std::shared_ptr<std::vector<uint8_t>> &data, bool writable, size_t pos)
+    : data(data), writable(writable), pos(pos) {}
+
+  operator bool() const { return (bool)data; }
+
+  size_t write(const uint8_t *buf, size_t len);
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t readBytes(char *buf, size_t len);
+  size_t read(uint8_t *buf, size_t len) { return readBytes((char *)buf, len); }
+  int read();
+  int available() const { return data ? (int)(data->size() - pos) : 0; }
+  bool seek(size_t p);
+  size_t position() const { return pos; }
+  size_t size() const { return data ? data->size() : 0; }
+  void flush() {}
+  void setTimeout(unsigned long timeout) { (void)timeout; }
+  void close() { data.reset(); }
+
+private:
+  std::shared_ptr<std::vector<uint8_t>> data;
+  bool writable = false;
+  size_t pos = 0;
+};
+
+class SPIFFSFS {
+public:
+  bool begin(bool formatOnFail = false) { (void)formatOnFail; return true; }
+  bool exists(const String &path);
+  bool remove(const String &path);
+  bool rename(const String &from, const String &to);
+  File open(const String &path, const char *mode = "r");
+  size_t usedBytes();
+
+  // host only
+  uint64_t bytesWritten = 0;
+};
+
+extern SPIFFSFS SPIFFS;
@@ -0,0 +1,54 @@
+#pragma once
+
+// Host stand-in for the U8g2 u8x8 API. No pixels are rendered; every tile
+// sent to the panel is counted and its bus time charged to the virtual clock.
+// Fonts only carry the u8x8 font header (first/last glyph, tile size).
+
+#include <Arduino.h>
+
+#define U8X8_PIN_NONE (255)
+
+extern const uint8_t u8x8_font_px437wyse700a_2x2_r[];
+extern const uint8_t u8x8_font_px437wyse700b_2x2_r[];
+extern const uint8_t u8x8_font_px437wyse700b_2x2_f[];
+extern const uint8_t u8x8_font_chroma48medium8_r[];
+extern const uint8_t u8x8_font_amstrad_cpc_extended_f[];
+
+class U8X8 {
+public:
+  U8X8(unsigned long byteCostUs) : byteCostUs(byteCostUs) {}
+
+  bool begin();
+  void clear() { clearDisplay(); }
+  void clearDisplay();
+  void setCursor(uint8_t x, uint8_t y) { cx = x; cy = y; }
+  void setFont(const uint8_t *font) { this->font = font; }
+  void setBusClock(uint32_t clock) { (void)clock; }
+  uint8_t getCols() { return 16; }
+  uint8_t getRows() { return 16; }
+  void drawGlyph(uint8_t x, uint8_t y, uint8_t encoding);
+  uint8_t drawString(uint8_t x, uint8_t y, const char *s);
+  void drawTile(uint8_t x, uint8_t y, uint8_t cnt, uint8_t *tile_ptr);
+
+  // host only: bytes that went over the bus
+  uint64_t bytesSent = 0;
+
+protected:
+  void sendTiles(unsigned tiles);
+
+  unsigned long byteCostUs;
+  const uint8_t *font = nullptr;
+  uint8_t cx = 0, cy = 0;
+};
+
+class U8X8_SSD1327_WS_128X128_SW_I2C : public U8X8 {
+public:
+  U8X8_SSD1327_WS_128X128_SW_I2C(uint8_t clock, uint8_t data, uint8_t reset = U8X8_PIN_NONE)
+    : U8X8(HAL_COST_SW_I2C_BYTE_US) { (void)clock; (void)data; (void)reset; }
+};
+
+class U8X8_SSD1327_WS_128X128_HW_I2C : public U8X8 {
+public:
+  U8X8_SSD1327_WS_128X128_HW_I2C(uint8_t reset = U8X8_PIN_NONE, uint8_t clock = U8X8_PIN_NONE, uint8_t data = U8X8_PIN_NONE)
+    : U8X8(HAL_COST_HW_I2C_BYTE_US) { (void)clock; (void)data; (void)reset; }
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <esp_err.h>
+
+// the virtual clock, in us since boot
+int64_t esp_timer_get_time();
+
+// esp_timer callbacks run in the esp_timer task on the node; here they are
+// called as the virtual clock passes their alarm, with the clock at the alarm,
+// and the work they do is not charged to the control loop
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum {
+  ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void *arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char *name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
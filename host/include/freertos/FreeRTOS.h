@@ -0,0 +1,36 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF FreeRTOS API. Tasks run as host threads;
+// work they do is not charged to the virtual clock of the control loop (see
+// hal_charge_us), as it runs on another task or core on the node. Delays wait
+// for virtual time to pass.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE (0)
+#define pdTRUE (1)
+#define pdPASS (1)
+#define pdFAIL (0)
+#define errQUEUE_FULL (0)
+#define portMAX_DELAY ((TickType_t)0xffffffff)
+#define portTICK_PERIOD_MS (1)
+#define portYIELD_FROM_ISR() do { } while (0)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY (0x7fffffff)
+#define configMAX_PRIORITIES (25)
+
+// the esp_timer callbacks run on the control thread between its steps (see
+// esp_timer.h), so a critical section has nothing to exclude on the host
+typedef struct {
+  uint32_t owner;
+  uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+#define portENTER_CRITICAL(mux) do { (void)(mux); } while (0)
+#define portEXIT_CRITICAL(mux) do { (void)(mux); } while (0)
@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS ring buffer, as handed out by the RMT driver.
+// Receive never blocks on the host, an item is there or it is not.
+
+#include <freertos/FreeRTOS.h>
+
+typedef void *RingbufHandle_t;
+
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *item_size, TickType_t ticks_to_wait);
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item);
@@ -0,0 +1,84 @@
+#pragma once
+
+// Host hardware abstraction: a virtual clock plus a simple cost model for the
+// peripherals the firmware talks to. Stub calls that would block the ESP32
+// (bit-banged I2C, OneWire slots, ADC reads) charge their device time to the
+// virtual clock, so micros()/millis() deltas measured by the firmware on the
+// host approximate the time the same code takes on the node.
+
+#include <stdint.h>
+#include <stddef.h>
+
+// device cost model, in us
+#define HAL_COST_ANALOGREAD_US        (10)    // single ADC1 conversion
+#define HAL_COST_LEDCWRITE_US         (2)
+#define HAL_COST_GPIO_ISR_US          (3)     // interrupt entry and exit around a GPIO handler
+#define HAL_COST_SW_I2C_BYTE_US       (90)    // u8x8 bit-banged I2C, ~100 kHz
+#define HAL_COST_HW_I2C_BYTE_US       (23)    // hardware I2C at 400 kHz
+#define HAL_COST_ONEWIRE_RESET_US     (960)
+#define HAL_COST_ONEWIRE_BYTE_US      (560)   // 8 slots of ~70 us
+#define HAL_COST_RMT_CALL_US          (5)     // RMT driver call: filling or returning items
+#define HAL_COST_NODE_LOOP_US         (150)   // ACNode housekeeping per pass
+#define HAL_COST_MQTT_PUBLISH_US      (150)   // building and writing one MQTT publish to the socket
+#define HAL_COST_SERIAL_BYTE_US       (87)    // UART at 115200 baud, the TX FIFO is small compared to a log line
+
+// virtual clock
+void hal_init();
+uint64_t hal_now_us();
+void hal_advance_us(uint64_t us);   // time passing outside of the firmware
+void hal_charge_us(uint64_t us);    // device time spent blocking the caller
+void hal_set_wallclock(int weekday, int hour, int minute); // weekday 0 = Sunday
+uint64_t hal_wallclock_s();         // local time in seconds since a Sunday 00:00
+
+// ACNode stall injection: every period_ms of virtual time node.loop() blocks
+// for stall_ms (broker reconnects, DNS, OTA checks); in a task it blocks that
+// task until the virtual clock passed stall_ms
+void hal_set_node_stall(uint32_t period_ms, uint32_t stall_ms);
+void hal_node_stall(uint64_t &next_stall);
+
+// a task with this name is not started, as if the node ran out of memory, so
+// the firmware does its work from loop(); hal_init() refuses the network task
+// of main.cpp, which keeps the benches that drive ACNode deterministic
+void hal_refuse_task(const char *name, bool refuse);
+
+// esp_timer_create() fails for a timer with this name, as if the node ran out of memory
+void hal_refuse_esp_timer(const char *name, bool refuse);
+
+// echo Serial, Log and MQTT traffic to stdout
+extern bool hal_verbose;
+
+// inputs
+void hal_set_pin(uint8_t pin, int level);
+int hal_get_pin(uint8_t pin);
+void hal_set_adc(uint8_t pin, uint16_t value);
+uint16_t hal_adc_value(uint8_t pin); // without the cost of analogRead()
+uint32_t hal_get_ledc(uint8_t channel);
+
+// OneWire bus population for the DallasTemperature stub
+int hal_add_temp_sensor(const uint8_t rom[8], float celsius);
+void hal_set_temp(int index, float celsius);
+void hal_set_temp_sensor_missing(int index, bool missing); // unplugged: no presence, no answer
+
+// the same bus at slot level, for the RMT stub: a reset returns whether a
+// device answered, a slot carries the bit of the master and returns the bus
+// level (a device pulls a read slot low for a 0)
+bool hal_onewire_reset();
+int hal_onewire_slot(int bit);
+// every period-th bit a device sends is flipped, 0 is off
+void hal_set_onewire_bit_errors(uint32_t period);
+
+// run all ButtonDebounce / OptoDebounce edge detection, like their interrupts would
+void hal_service_inputs();
+
+// counters
+struct hal_counters_t {
+  uint64_t i2cBytes;
+  uint64_t i2cTransfers;
+  uint64_t oneWireResets;
+  uint64_t oneWireBytes;
+  uint64_t mqttPublishes;
+  uint64_t mqttBytes;
+  uint64_t gpioToggles;
+};
+
+extern hal_counters_t hal_counters;
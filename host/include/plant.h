@@ -0,0 +1,34 @@
+#pragma once
+
+// Simple model of the compressor the node controls, used to drive the host
+// build with realistic inputs: the relay starts the motor (seen by the opto
+// coupler), the motor builds up pressure until the compressor's own pressure
+// switch cuts out, and the temperatures follow the motor duty cycle.
+
+#include <Arduino.h>
+
+// GPIO numbers as wired on the Olimex ESP32-PoE backplane, see main.cpp
+#define PLANT_RELAY_GPIO          (14)
+#define PLANT_ON_BUTTON           (15)
+#define PLANT_OFF_BUTTON          ( 5)
+#define PLANT_OPTO1               (36)
+#define PLANT_OILLEVELSENSOR      (39)
+#define PLANT_PRESSURESENSOR      (35)
+#define PLANT_INFO_BUTTON         (34)
+
+struct plant_t {
+  bool motorRunning;
+  float pressure;       // in bar
+  float tempCompressor; // in degrees Celcius
+  float tempMotor;
+  float cutOut;         // compressor pressure switch, in bar
+  float cutIn;
+  float overPressure;   // if > 0, the pressure switch is broken and the motor keeps running up to this pressure
+};
+
+extern plant_t plant;
+
+void plant_init();
+void plant_step(uint64_t dt_us);
+void plant_press(uint8_t pin, unsigned long at_ms, unsigned long duration_ms);
+uint16_t plant_pressure_to_adc(float bar);
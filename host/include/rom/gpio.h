@@ -0,0 +1,8 @@
+#pragma once
+
+// Host stand-in for the ROM GPIO matrix functions.
+
+#include <stdint.h>
+
+void gpio_matrix_out(uint32_t gpio, uint32_t signal_idx, bool out_inv, bool oen_inv);
+void gpio_matrix_in(uint32_t gpio, uint32_t signal_idx, bool inv);
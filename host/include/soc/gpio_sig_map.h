@@ -0,0 +1,5 @@
+#pragma once
+
+// GPIO matrix signal numbers of the peripherals used by the firmware
+#define RMT_SIG_IN0_IDX (83)
+#define RMT_SIG_OUT0_IDX (87)
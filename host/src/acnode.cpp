@@ -0,0 +1,176 @@
+#include <ACNode.h>
+#include <EEPROM.h>
+#include <Cache.h>
+
+TLog Log;
+TLog Debug;
+EEPROMClass EEPROM;
+
+size_t TLog::write(uint8_t c) {
+  for (auto &h : handlers) {
+    h->write(c);
+  }
+  return 1;
+}
+
+size_t TLog::write(const uint8_t *buf, size_t len) {
+  for (auto &h : handlers) {
+    h->write(buf, len);
+  }
+  return len;
+}
+
+// the ACNode MqttLogStream publishes a message for every completed line
+size_t MqttLogStream::write(uint8_t c) {
+  if (c == '\n') {
+    hal_counters.mqttPublishes++;
+    hal_counters.mqttBytes += line.size();
+    hal_charge_us(HAL_COST_MQTT_PUBLISH_US);
+    line.clear();
+  } else if (c != '\r') {
+    line += (char)c;
+  }
+  return 1;
+}
+
+size_t MqttLogStream::write(const uint8_t *buf, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    write(buf[i]);
+  }
+  return len;
+}
+
+size_t TelnetSerialStream::write(uint8_t c) {
+  return Serial.write(c);
+}
+
+size_t TelnetSerialStream::write(const uint8_t *buf, size_t len) {
+  return Serial.write(buf, len);
+}
+
+JsonObject::Proxy &JsonObject::Proxy::operator=(const char *v) {
+  std::string s = "\"";
+  for (const char *p = v; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      s += '\\';
+    }
+    s += *p;
+  }
+  obj.fields[key] = s + "\"";
+  return *this;
+}
+
+JsonObject::Proxy &JsonObject::Proxy::operator=(bool v) {
+  obj.fields[key] = v ? "true" : "false";
+  return *this;
+}
+
+JsonObject::Proxy &JsonObject::Proxy::operator=(double v) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.9g", v);
+  return setNumber(buf);
+}
+
+JsonObject::Proxy &JsonObject::Proxy::setNumber(const std::string &v) {
+  obj.fields[key] = v;
+  return *this;
+}
+
+std::string JsonObject::serialize() const {
+  std::string out = "{";
+  for (auto &f : fields) {
+    if (out.size() > 1) {
+      out += ",";
+    }
+    out += "\"" + f.first + "\":" + f.second;
+  }
+  return out + "}";
+}
+
+void ACNode::begin(board_t board) {
+  (void)board;
+}
+
+void ACNode::loop() {
+  hal_charge_us(HAL_COST_NODE_LOOP_US);
+  hal_node_stall(next_stall);
+  std::vector<std::function<void()>> received;
+  {
+    std::lock_guard<std::mutex> guard(pending_lock);
+    received.swap(pending);
+  }
+  for (auto &fn : received) {
+    fn();
+  }
+  // like ACNode, a new period counts from the previous report
+  if (report_cb && !hold_reports && (!reported || (millis() - last_report_ms >= report_period))) {
+    reported = true;
+    last_report_ms = millis();
+    hostReport();
+  }
+}
+
+void ACNode::delayedReboot() {
+  ESP.restart();
+}
+
+void ACNode::send(const char *topic, const char *payload, bool raw) {
+  (void)raw;
+  send(topic, (const uint8_t *)payload, strlen(payload));
+}
+
+void ACNode::send(const char *topic, const uint8_t *payload, size_t len) {
+  hal_counters.mqttPublishes++;
+  hal_counters.mqttBytes += len;
+  hal_charge_us(HAL_COST_MQTT_PUBLISH_US);
+  if (hal_verbose) {
+    printf("MQTT %s/%s: %zu bytes\n", moi, topic ? topic : "", len);
+  }
+  if (send_cb) {
+    send_cb(topic, payload, len);
+  }
+}
+
+void ACNode::hostConnect() {
+  if (connect_cb) {
+    connect_cb();
+  }
+}
+
+void ACNode::hostDisconnect() {
+  if (disconnect_cb) {
+    disconnect_cb();
+  }
+}
+
+void ACNode::hostError(acnode_error_t err) {
+  if (error_cb) {
+    error_cb(err);
+  }
+}
+
+ACBase::cmd_result_t ACNode::hostCommand(const char *cmd, const char *rest) {
+  if (command_cb) {
+    return command_cb(cmd, rest);
+  }
+  return CMD_DECLINE;
+}
+
+void ACNode::hostInLoop(std::function<void()> fn) {
+  std::lock_guard<std::mutex> guard(pending_lock);
+  pending.push_back(fn);
+}
+
+void ACNode::hostReport() {
+  JsonObject report;
+  report_cb(report);
+  last_report = report.serialize();
+  send("report", last_report.c_str());
+}
+
+void prepareCache(bool wipe) {
+  (void)wipe;
+}
+
+void wipe_eeprom() {
+}
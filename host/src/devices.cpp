@@ -0,0 +1,385 @@
+#include <ButtonDebounce.h>
+#include <OptoDebounce.h>
+#include <DallasTemperature.h>
+#include <U8x8lib.h>
+#include <NTP.h>
+#include <vector>
+
+// ButtonDebounce
+
+static ButtonDebounce *buttons = nullptr;
+
+ButtonDebounce::ButtonDebounce(int pin, unsigned long delay) : pin(pin), delay(delay) {
+  lastState = HIGH;
+  lastRaw = HIGH;
+  next = buttons;
+  buttons = this;
+}
+
+void ButtonDebounce::update() {
+  int raw = digitalRead(pin);
+  if (raw != lastRaw) {
+    lastRaw = raw;
+    lastChange = millis();
+    return;
+  }
+  if ((raw != lastState) && (millis() - lastChange >= delay)) {
+    lastState = raw;
+    if (callback) {
+      callback(lastState);
+    }
+  }
+}
+
+int ButtonDebounce::state() {
+  return lastState;
+}
+
+void hal_service_inputs() {
+  for (ButtonDebounce *b = buttons; b; b = b->next) {
+    b->update();
+  }
+}
+
+// OptoDebounce
+
+void OptoDebounce::loop() {
+  int raw = digitalRead(pin);
+  if (raw != lastRaw) {
+    lastRaw = raw;
+    lastChange = millis();
+  }
+  if (millis() - lastChange >= delay) {
+    current = (raw == HIGH) ? ON : OFF;
+  }
+}
+
+// DallasTemperature
+
+struct sim_sensor_t {
+  uint8_t rom[8];
+  float celsius;
+  float scratchpad;
+  uint8_t resolution;
+  bool missing;
+};
+
+static std::vector<sim_sensor_t> sensors;
+
+int hal_add_temp_sensor(const uint8_t rom[8], float celsius) {
+  sim_sensor_t s;
+  memcpy(s.rom, rom, 8);
+  s.celsius = celsius;
+  s.scratchpad = 85.0; // DS18B20 power-on value
+  s.resolution = 12;
+  s.missing = false;
+  sensors.push_back(s);
+  return (int)sensors.size() - 1;
+}
+
+void hal_set_temp(int index, float celsius) {
+  sensors.at(index).celsius = celsius;
+}
+
+void hal_set_temp_sensor_missing(int index, bool missing) {
+  sensors.at(index).missing = missing;
+}
+
+static void oneWireTransaction(unsigned bytes) {
+  hal_counters.oneWireResets++;
+  hal_counters.oneWireBytes += bytes;
+  hal_charge_us(HAL_COST_ONEWIRE_RESET_US + (uint64_t)bytes * HAL_COST_ONEWIRE_BYTE_US);
+}
+
+static sim_sensor_t *findSensor(const uint8_t *rom) {
+  for (auto &s : sensors) {
+    if (!s.missing && (memcmp(s.rom, rom, 8) == 0)) {
+      return &s;
+    }
+  }
+  return nullptr;
+}
+
+static float quantize(float celsius, uint8_t resolution) {
+  float step = 0.5f / (1 << (resolution - 9));
+  return roundf(celsius / step) * step;
+}
+
+void DallasTemperature::begin() {
+  // ROM search: 64 triplets of slots per device
+  for (size_t i = 0; i < sensors.size(); i++) {
+    oneWireTransaction(24);
+  }
+}
+
+uint8_t DallasTemperature::getDeviceCount() {
+  return (uint8_t)sensors.size();
+}
+
+bool DallasTemperature::getAddress(uint8_t *deviceAddress, uint8_t index) {
+  oneWireTransaction(24 * (index + 1));
+  if (index >= sensors.size()) {
+    return false;
+  }
+  memcpy(deviceAddress, sensors[index].rom, 8);
+  return true;
+}
+
+bool DallasTemperature::isConnected(const uint8_t *deviceAddress) {
+  oneWireTransaction(9 + 9);
+  return findSensor(deviceAddress) != nullptr;
+}
+
+bool DallasTemperature::setResolution(const uint8_t *deviceAddress, uint8_t newResolution, bool skipGlobalBitResolutionCalculation) {
+  (void)skipGlobalBitResolutionCalculation;
+  oneWireTransaction(9 + 4);
+  sim_sensor_t *s = findSensor(deviceAddress);
+  if (!s) {
+    return false;
+  }
+  s->resolution = newResolution;
+  return true;
+}
+
+// conversions complete instantly on the host; the firmware waits for the
+// conversion time itself since waitForConversion is switched off
+void DallasTemperature::requestTemperatures() {
+  oneWireTransaction(2); // skip ROM, convert T
+  for (auto &s : sensors) {
+    if (s.missing) {
+      continue;
+    }
+    s.scratchpad = quantize(s.celsius, s.resolution);
+  }
+}
+
+bool DallasTemperature::requestTemperaturesByAddress(const uint8_t *deviceAddress) {
+  oneWireTransaction(9 + 1); // match ROM, convert T
+  sim_sensor_t *s = findSensor(deviceAddress);
+  if (!s) {
+    return false;
+  }
+  s->scratchpad = quantize(s->celsius, s->resolution);
+  return true;
+}
+
+float DallasTemperature::getTempC(const uint8_t *deviceAddress) {
+  oneWireTransaction(9 + 9); // match ROM, read scratchpad
+  sim_sensor_t *s = findSensor(deviceAddress);
+  if (!s) {
+    return DEVICE_DISCONNECTED_C;
+  }
+  return s->scratchpad;
+}
+
+bool DallasTemperature::isConversionComplete() {
+  return true;
+}
+
+// the DS18B20s at slot level: ROM command, function command, then the
+// scratchpad of the selected devices, wired-AND when more than one is selected
+
+enum sim_onewire_phase_t { OW_ROM_COMMAND, OW_MATCH_ROM, OW_FUNCTION_COMMAND, OW_READ, OW_IGNORE };
+
+static sim_onewire_phase_t owPhase = OW_IGNORE;
+static std::vector<bool> owSelected;
+static uint8_t owBits[9 * 8];
+static unsigned owBitCount = 0;
+static uint8_t owMatch[8];
+static uint32_t owBitErrorPeriod = 0;
+static uint32_t owBitsSent = 0;
+
+void hal_set_onewire_bit_errors(uint32_t period) {
+  owBitErrorPeriod = period;
+}
+
+static uint8_t simCrc8(const uint8_t *data, unsigned length) {
+  uint8_t crc = 0;
+  while (length--) {
+    uint8_t byte = *data++;
+    for (int i = 0; i < 8; i++) {
+      uint8_t mix = (crc ^ byte) & 0x01;
+      crc >>= 1;
+      if (mix) {
+        crc ^= 0x8C;
+      }
+      byte >>= 1;
+    }
+  }
+  return crc;
+}
+
+static void simScratchpad(const sim_sensor_t &s, uint8_t *data) {
+  int16_t raw = (int16_t)lroundf(s.scratchpad * 16);
+  data[0] = raw & 0xff;
+  data[1] = (raw >> 8) & 0xff;
+  data[2] = 0x4b; // TH
+  data[3] = 0x46; // TL
+  data[4] = (uint8_t)(((s.resolution - 9) << 5) | 0x1f);
+  data[5] = 0xff;
+  data[6] = 0x0c;
+  data[7] = 0x10;
+  data[8] = simCrc8(data, 8);
+}
+
+bool hal_onewire_reset() {
+  bool present = false;
+
+  owSelected.assign(sensors.size(), false);
+  for (auto &s : sensors) {
+    present = present || !s.missing;
+  }
+  owPhase = present ? OW_ROM_COMMAND : OW_IGNORE;
+  owBitCount = 0;
+  return present;
+}
+
+static uint8_t owByte(unsigned first) {
+  uint8_t value = 0;
+  for (int i = 0; i < 8; i++) {
+    value |= (owBits[first + i] & 1) << i;
+  }
+  return value;
+}
+
+int hal_onewire_slot(int bit) {
+  switch (owPhase) {
+    case OW_ROM_COMMAND:
+    case OW_FUNCTION_COMMAND:
+    case OW_MATCH_ROM:
+      owBits[owBitCount++] = bit;
+      if ((owPhase == OW_MATCH_ROM) && (owBitCount == 64)) {
+        for (int i = 0; i < 8; i++) {
+          owMatch[i] = owByte(i * 8);
+        }
+        for (size_t i = 0; i < sensors.size(); i++) {
+          owSelected[i] = !sensors[i].missing && (memcmp(sensors[i].rom, owMatch, 8) == 0);
+        }
+        owPhase = OW_FUNCTION_COMMAND;
+        owBitCount = 0;
+      } else if ((owPhase != OW_MATCH_ROM) && (owBitCount == 8)) {
+        uint8_t command = owByte(0);
+        owBitCount = 0;
+        if (owPhase == OW_ROM_COMMAND) {
+          if (command == 0xcc) { // skip ROM
+            for (size_t i = 0; i < sensors.size(); i++) {
+              owSelected[i] = !sensors[i].missing;
+            }
+            owPhase = OW_FUNCTION_COMMAND;
+          } else if (command == 0x55) { // match ROM
+            owPhase = OW_MATCH_ROM;
+          } else {
+            owPhase = OW_IGNORE;
+          }
+        } else {
+          owPhase = OW_IGNORE;
+          if (command == 0x44) { // convert T
+            for (size_t i = 0; i < sensors.size(); i++) {
+              if (owSelected[i]) {
+                sensors[i].scratchpad = quantize(sensors[i].celsius, sensors[i].resolution);
+              }
+            }
+          } else if (command == 0xbe) { // read scratchpad
+            uint8_t data[9];
+            uint8_t wired[9];
+            memset(wired, 0xff, sizeof(wired));
+            for (size_t i = 0; i < sensors.size(); i++) {
+              if (owSelected[i]) {
+                simScratchpad(sensors[i], data);
+                for (int j = 0; j < 9; j++) {
+                  wired[j] &= data[j];
+                }
+              }
+            }
+            for (int j = 0; j < 9 * 8; j++) {
+              owBits[j] = (wired[j / 8] >> (j % 8)) & 1;
+            }
+            owPhase = OW_READ;
+          }
+        }
+      }
+      return bit;
+    case OW_READ:
+      if (owBitCount < 9 * 8) {
+        int level = bit & owBits[owBitCount++];
+        owBitsSent++;
+        if ((owBitErrorPeriod != 0) && ((owBitsSent % owBitErrorPeriod) == 0)) {
+          level ^= 1;
+        }
+        return level;
+      }
+      return bit;
+    case OW_IGNORE:
+      break;
+  }
+  return bit;
+}
+
+// U8x8
+
+// u8x8 font header: first glyph, last glyph, tile width, tile height
+const uint8_t u8x8_font_px437wyse700a_2x2_r[] = { 32, 127, 2, 2 };
+const uint8_t u8x8_font_px437wyse700b_2x2_r[] = { 32, 127, 2, 2 };
+const uint8_t u8x8_font_px437wyse700b_2x2_f[] = { 32, 255, 2, 2 };
+const uint8_t u8x8_font_chroma48medium8_r[] = { 32, 127, 1, 1 };
+const uint8_t u8x8_font_amstrad_cpc_extended_f[] = { 32, 255, 1, 1 };
+
+#define SSD1327_TILE_BYTES (32) // 8x8 pixels, 4 bit greyscale
+#define SSD1327_WINDOW_BYTES (8) // I2C address, control byte and column/row window commands
+
+bool U8X8::begin() {
+  sendTiles(0);
+  return true;
+}
+
+void U8X8::sendTiles(unsigned tiles) {
+  unsigned long bytes = SSD1327_WINDOW_BYTES + tiles * SSD1327_TILE_BYTES;
+  bytesSent += bytes;
+  hal_counters.i2cBytes += bytes;
+  hal_counters.i2cTransfers++;
+  hal_charge_us((uint64_t)bytes * byteCostUs);
+}
+
+void U8X8::clearDisplay() {
+  for (int row = 0; row < 16; row++) {
+    sendTiles(16);
+  }
+}
+
+void U8X8::drawGlyph(uint8_t x, uint8_t y, uint8_t encoding) {
+  (void)x;
+  (void)y;
+  (void)encoding;
+  uint8_t w = font ? font[2] : 1;
+  uint8_t h = font ? font[3] : 1;
+  for (uint8_t row = 0; row < h; row++) {
+    sendTiles(w);
+  }
+}
+
+uint8_t U8X8::drawString(uint8_t x, uint8_t y, const char *s) {
+  uint8_t w = font ? font[2] : 1;
+  uint8_t n = 0;
+  while (*s) {
+    drawGlyph(x, y, (uint8_t)*s++);
+    x += w;
+    n++;
+  }
+  return n;
+}
+
+void U8X8::drawTile(uint8_t x, uint8_t y, uint8_t cnt, uint8_t *tile_ptr) {
+  (void)x;
+  (void)y;
+  (void)tile_ptr;
+  sendTiles(cnt);
+}
+
+// NTP
+
+int8_t NTP::hours() { return (hal_wallclock_s() / 3600) % 24; }
+int8_t NTP::minutes() { return (hal_wallclock_s() / 60) % 60; }
+int8_t NTP::seconds() { return hal_wallclock_s() % 60; }
+int8_t NTP::weekDay() { return (hal_wallclock_s() / 86400) % 7; }
+// 4 Jan 1970 was a Sunday
+time_t NTP::epoch() { return (time_t)(hal_wallclock_s() + 3 * 86400); }
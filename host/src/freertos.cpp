@@ -0,0 +1,137 @@
+#include <Arduino.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <list>
+#include <set>
+#include <string>
+#include <vector>
+
+// tasks never return; at exit they are stopped in their next vTaskDelay
+struct hosttaskexit {};
+
+static std::atomic<bool> stopping(false);
+static std::list<std::thread> tasks;
+static std::set<std::string> refusedTasks;
+static thread_local TaskHandle_t currentTask = nullptr; // the control thread is no task
+
+void hal_refuse_task(const char *name, bool refuse) {
+  if (refuse) {
+    refusedTasks.insert(name);
+  } else {
+    refusedTasks.erase(name);
+  }
+}
+
+static void stopTasks() {
+  stopping = true;
+  for (auto &t : tasks) {
+    t.join();
+  }
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+  (void)stackDepth;
+  (void)priority;
+  (void)core;
+  if (refusedTasks.count(name) > 0) {
+    return pdFAIL;
+  }
+  if (tasks.empty()) {
+    atexit(stopTasks);
+  }
+  tasks.emplace_back();
+  TaskHandle_t task = (TaskHandle_t)&tasks.back();
+  if (handle) {
+    *handle = task;
+  }
+  tasks.back() = std::thread([function, parameter, task]() {
+    currentTask = task;
+    try {
+      function(parameter);
+    } catch (hosttaskexit &) {
+    }
+  });
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+  return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  uint64_t until = hal_now_us() + (uint64_t)ticks * 1000;
+  do {
+    if (stopping) {
+      throw hosttaskexit();
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+  } while (hal_now_us() < until);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+  (void)handle;
+  throw hosttaskexit();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return currentTask;
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)(hal_now_us() / 1000);
+}
+
+struct hostqueue {
+  std::mutex lock;
+  std::deque<std::vector<uint8_t>> items;
+  size_t length;
+  size_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  QueueHandle_t queue = new hostqueue;
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+// waiting for room or for an item is not modelled: a full or empty queue fails at once
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait) {
+  (void)ticksToWait;
+  std::lock_guard<std::mutex> guard(queue->lock);
+  if (queue->items.size() >= queue->length) {
+    return errQUEUE_FULL;
+  }
+  const uint8_t *p = (const uint8_t *)item;
+  queue->items.emplace_back(p, p + queue->itemSize);
+  return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken) {
+  if (higherPriorityTaskWoken) {
+    *higherPriorityTaskWoken = pdFALSE;
+  }
+  return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait) {
+  (void)ticksToWait;
+  std::lock_guard<std::mutex> guard(queue->lock);
+  if (queue->items.empty()) {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->items.size();
+}
@@ -0,0 +1,347 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdarg.h>
+#include <atomic>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// virtual clock: starts at 1 s so that `millis() > next` style checks with a
+// zero initialised `next` behave as they do after boot on the node
+static std::atomic<uint64_t> now_us(1000000);
+static std::thread::id controlThread;
+static uint64_t wallclock_offset_s = 0;
+
+static uint32_t stall_period_ms = 0;
+static uint32_t stall_ms = 0;
+
+static int pins[64];
+
+typedef struct {
+  void (*handler)(void *);
+  void *arg;
+  int mode;
+} interrupt_t;
+
+static interrupt_t interrupts[64];
+static uint16_t adc[64];
+static uint32_t ledc[16];
+static int ledc_pin[16];
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void *arg;
+  uint64_t period;
+  uint64_t alarm;
+  bool armed;
+};
+
+static std::vector<esp_timer *> espTimers;
+static std::set<std::string> refusedEspTimers;
+static bool inTimerTask = false;
+
+hal_counters_t hal_counters;
+
+HardwareSerial Serial;
+EspClass ESP;
+
+void hal_init() {
+  controlThread = std::this_thread::get_id();
+  hal_refuse_task("network", true);
+  for (int i = 0; i < 64; i++) {
+    pins[i] = HIGH; // inputs idle high, buttons are active low
+    adc[i] = 0;
+  }
+  for (int i = 0; i < 16; i++) {
+    ledc_pin[i] = -1;
+  }
+}
+
+uint64_t hal_now_us() {
+  return now_us.load();
+}
+
+// moves the clock on, calling the esp_timer callbacks that come due on the way at their alarm
+static void advanceClock(uint64_t us) {
+  uint64_t until = now_us + us;
+
+  while (!inTimerTask) {
+    esp_timer *due = nullptr;
+
+    for (esp_timer *timer : espTimers) {
+      if (timer->armed && (timer->alarm <= until) && ((due == nullptr) || (timer->alarm < due->alarm))) {
+        due = timer;
+      }
+    }
+    if (due == nullptr) {
+      break;
+    }
+    if (due->alarm > now_us) {
+      now_us = due->alarm;
+    }
+    due->alarm += due->period;
+    inTimerTask = true;
+    due->callback(due->arg);
+    inTimerTask = false;
+  }
+  now_us = until;
+}
+
+void hal_advance_us(uint64_t us) {
+  advanceClock(us);
+}
+
+void hal_charge_us(uint64_t us) {
+  // only the control loop is modelled as a single thread of execution, work
+  // done by other host threads runs on another core/task on the node, as does
+  // the work of an esp_timer callback
+  if ((std::this_thread::get_id() == controlThread) && !inTimerTask) {
+    advanceClock(us);
+  }
+}
+
+void hal_set_wallclock(int weekday, int hour, int minute) {
+  uint64_t s = ((uint64_t)weekday * 24 + hour) * 3600 + (uint64_t)minute * 60;
+  wallclock_offset_s = s + 7 * 86400 - (now_us / 1000000) % (7 * 86400);
+}
+
+uint64_t hal_wallclock_s() {
+  return wallclock_offset_s + now_us / 1000000;
+}
+
+void hal_set_node_stall(uint32_t period_ms, uint32_t duration_ms) {
+  stall_period_ms = period_ms;
+  stall_ms = duration_ms;
+}
+
+void hal_node_stall(uint64_t &next_stall) {
+  if (stall_period_ms == 0) {
+    return;
+  }
+  if (next_stall == 0) {
+    next_stall = now_us + (uint64_t)stall_period_ms * 1000;
+  }
+  if (now_us >= next_stall) {
+    next_stall = now_us + (uint64_t)stall_period_ms * 1000;
+    if (std::this_thread::get_id() == controlThread) {
+      hal_charge_us((uint64_t)stall_ms * 1000);
+    } else {
+      // in a task only that task is blocked, the control loop goes on
+      vTaskDelay(stall_ms);
+    }
+  }
+}
+
+void hal_set_pin(uint8_t pin, int level) {
+  int previous = pins[pin & 63];
+  interrupt_t &interrupt = interrupts[pin & 63];
+
+  pins[pin & 63] = level;
+  if ((interrupt.handler != nullptr) && (level != previous) &&
+      ((interrupt.mode == CHANGE) || ((interrupt.mode == RISING) && level) || ((interrupt.mode == FALLING) && !level))) {
+    hal_charge_us(HAL_COST_GPIO_ISR_US);
+    interrupt.handler(interrupt.arg);
+  }
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode) {
+  interrupts[pin & 63] = { handler, arg, mode };
+}
+
+void detachInterrupt(uint8_t pin) {
+  interrupts[pin & 63] = { nullptr, nullptr, 0 };
+}
+
+int hal_get_pin(uint8_t pin) {
+  return pins[pin & 63];
+}
+
+void hal_set_adc(uint8_t pin, uint16_t value) {
+  adc[pin & 63] = value;
+}
+
+uint16_t hal_adc_value(uint8_t pin) {
+  return adc[pin & 63];
+}
+
+uint32_t hal_get_ledc(uint8_t channel) {
+  return ledc[channel & 15];
+}
+
+unsigned long millis() {
+  return (unsigned long)(now_us / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)now_us;
+}
+
+int64_t esp_timer_get_time() {
+  return (int64_t)now_us.load();
+}
+
+void hal_refuse_esp_timer(const char *name, bool refuse) {
+  if (refuse) {
+    refusedEspTimers.insert(name);
+  } else {
+    refusedEspTimers.erase(name);
+  }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+  if ((create_args->name != nullptr) && (refusedEspTimers.count(create_args->name) > 0)) {
+    return ESP_ERR_NO_MEM;
+  }
+  esp_timer *timer = new esp_timer;
+
+  timer->callback = create_args->callback;
+  timer->arg = create_args->arg;
+  timer->period = 0;
+  timer->alarm = 0;
+  timer->armed = false;
+  espTimers.push_back(timer);
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+  if (period == 0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->period = period;
+  timer->alarm = now_us + period;
+  timer->armed = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer->armed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->armed = false;
+  return ESP_OK;
+}
+
+void delay(unsigned long ms) {
+  hal_charge_us((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hal_charge_us(us);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pins[pin & 63] != val) {
+    hal_counters.gpioToggles++;
+  }
+  pins[pin & 63] = val;
+}
+
+int digitalRead(uint8_t pin) {
+  return pins[pin & 63];
+}
+
+uint16_t analogRead(uint8_t pin) {
+  hal_charge_us(HAL_COST_ANALOGREAD_US);
+  return adc[pin & 63];
+}
+
+void ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits) {
+  (void)channel;
+  (void)freq;
+  (void)resolution_bits;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel) {
+  ledc_pin[channel & 15] = pin;
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+  hal_charge_us(HAL_COST_LEDCWRITE_US);
+  ledc[channel & 15] = duty;
+}
+
+size_t Print::write(const uint8_t *buf, size_t len) {
+  size_t n = 0;
+  while (len--) {
+    n += write(*buf++);
+  }
+  return n;
+}
+
+static size_t printNumber(Print *p, const char *fmt, long long v, int base) {
+  char buf[72];
+  if (base == HEX) {
+    snprintf(buf, sizeof(buf), "%llx", v);
+  } else {
+    snprintf(buf, sizeof(buf), fmt, v);
+  }
+  return p->write(buf);
+}
+
+size_t Print::print(int v, int base) { return printNumber(this, "%lld", v, base); }
+size_t Print::print(unsigned int v, int base) { return printNumber(this, "%llu", v, base); }
+size_t Print::print(long v, int base) { return printNumber(this, "%lld", v, base); }
+size_t Print::print(unsigned long v, int base) { return printNumber(this, "%llu", v, base); }
+size_t Print::print(long long v, int base) { return printNumber(this, "%lld", v, base); }
+size_t Print::print(unsigned long long v, int base) { return printNumber(this, "%llu", (long long)v, base); }
+
+size_t Print::print(double v, int digits) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return write(buf);
+}
+
+size_t Print::printf(const char *fmt, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  return write(buf);
+}
+
+bool hal_verbose = false;
+
+size_t HardwareSerial::write(uint8_t c) {
+  hal_charge_us(HAL_COST_SERIAL_BYTE_US);
+  if (hal_verbose) {
+    fputc(c, stdout);
+  }
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len) {
+  hal_charge_us(len * HAL_COST_SERIAL_BYTE_US);
+  if (hal_verbose) {
+    fwrite(buf, 1, len, stdout);
+  }
+  return len;
+}
+
+void EspClass::restart() {
+  fflush(stdout);
+  fprintf(stderr, "ESP.restart() at %llu ms\n", (unsigned long long)(now_us / 1000));
+  exit(2);
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return 200 * 1024;
+}
+
+String IPAddress::toString() const {
+  char buf[20];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]);
+  return String(buf);
+}
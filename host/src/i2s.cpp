@@ -0,0 +1,98 @@
+#include <Arduino.h>
+#include <driver/i2s.h>
+
+// GPIO of each ADC1 channel
+static const uint8_t adc1ChannelPin[8] = { 36, 37, 38, 39, 32, 33, 34, 35 };
+
+static bool installed = false;
+static bool enabled = false;
+static i2s_config_t config;
+static uint8_t pin = 0;
+static adc1_channel_t channel = ADC1_CHANNEL_0;
+static uint64_t lastSample_us = 0;
+static uint64_t pending = 0;
+
+esp_err_t adc1_config_width(adc_bits_width_t width_bit) {
+  (void)width_bit;
+  return ESP_OK;
+}
+
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten) {
+  (void)channel;
+  (void)atten;
+  return ESP_OK;
+}
+
+esp_err_t i2s_driver_install(i2s_port_t i2s_num, const i2s_config_t *i2s_config, int queue_size, void *i2s_queue) {
+  (void)i2s_num;
+  (void)queue_size;
+  (void)i2s_queue;
+  if (installed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  config = *i2s_config;
+  installed = true;
+  return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t i2s_num) {
+  (void)i2s_num;
+  installed = false;
+  enabled = false;
+  return ESP_OK;
+}
+
+esp_err_t i2s_set_adc_mode(adc_unit_t adc_unit, adc1_channel_t adc_channel) {
+  if (adc_unit != ADC_UNIT_1) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  channel = adc_channel;
+  pin = adc1ChannelPin[adc_channel];
+  return ESP_OK;
+}
+
+esp_err_t i2s_adc_enable(i2s_port_t i2s_num) {
+  (void)i2s_num;
+  if (!installed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  enabled = true;
+  lastSample_us = hal_now_us();
+  pending = 0;
+  return ESP_OK;
+}
+
+esp_err_t i2s_adc_disable(i2s_port_t i2s_num) {
+  (void)i2s_num;
+  enabled = false;
+  return ESP_OK;
+}
+
+esp_err_t i2s_read(i2s_port_t i2s_num, void *dest, size_t size, size_t *bytes_read, uint32_t ticks_to_wait) {
+  (void)i2s_num;
+  (void)ticks_to_wait;
+  *bytes_read = 0;
+  if (!enabled) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  uint64_t now = hal_now_us();
+  pending += (now - lastSample_us) * config.sample_rate / 1000000;
+  lastSample_us = now;
+  uint64_t capacity = (uint64_t)config.dma_buf_count * config.dma_buf_len;
+  if (pending > capacity) {
+    pending = capacity; // DMA overran, oldest buffers are lost
+  }
+  size_t n = size / sizeof(uint16_t);
+  if (n > pending) {
+    n = pending;
+  }
+  // the sample holds the channel number in the top 4 bits, as on the ESP32
+  uint16_t value = (uint16_t)(((unsigned)channel << 12) | (hal_adc_value(pin) & 0x0fff));
+  uint16_t *out = (uint16_t *)dest;
+  for (size_t i = 0; i < n; i++) {
+    out[i] = value;
+  }
+  pending -= n;
+  *bytes_read = n * sizeof(uint16_t);
+  return ESP_OK;
+}
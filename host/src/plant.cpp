@@ -0,0 +1,88 @@
+#include <plant.h>
+#include <vector>
+
+#define PLANT_ADC_0_5V (144)
+#define PLANT_ADC_4_5V (3000)
+#define PLANT_ADC_NOISE (8) // in bits, peak
+
+plant_t plant;
+
+struct press_t {
+  uint8_t pin;
+  unsigned long at;
+  unsigned long until;
+};
+
+static std::vector<press_t> presses;
+static uint32_t noise = 12345;
+
+void plant_init() {
+  static const uint8_t rom1[8] = { 0x28, 0xaa, 0x01, 0x02, 0x03, 0x04, 0x05, 0x5e };
+  static const uint8_t rom2[8] = { 0x28, 0xaa, 0x11, 0x12, 0x13, 0x14, 0x15, 0x6f };
+
+  hal_init();
+  hal_set_wallclock(3, 10, 0); // Wednesday 10:00
+  plant.motorRunning = false;
+  plant.pressure = 0;
+  plant.tempCompressor = 20;
+  plant.tempMotor = 20;
+  plant.cutOut = 8.0;
+  plant.cutIn = 6.0;
+  plant.overPressure = 0;
+  hal_add_temp_sensor(rom1, plant.tempCompressor);
+  hal_add_temp_sensor(rom2, plant.tempMotor);
+  hal_set_pin(PLANT_OPTO1, LOW);
+  hal_set_pin(PLANT_RELAY_GPIO, LOW);
+  plant_step(0);
+}
+
+uint16_t plant_pressure_to_adc(float bar) {
+  return (uint16_t)(PLANT_ADC_0_5V + bar / 12.0 * (PLANT_ADC_4_5V - PLANT_ADC_0_5V));
+}
+
+void plant_press(uint8_t pin, unsigned long at_ms, unsigned long duration_ms) {
+  presses.push_back({ pin, at_ms, at_ms + duration_ms });
+}
+
+void plant_step(uint64_t dt_us) {
+  float dt = dt_us / 1e6f;
+
+  hal_advance_us(dt_us);
+
+  bool relay = hal_get_pin(PLANT_RELAY_GPIO) == HIGH;
+  float limit = (plant.overPressure > 0) ? plant.overPressure : plant.cutOut;
+  if (!relay || (plant.pressure >= limit)) {
+    plant.motorRunning = false;
+  } else if (plant.pressure <= plant.cutIn) {
+    plant.motorRunning = true;
+  }
+  hal_set_pin(PLANT_OPTO1, plant.motorRunning ? HIGH : LOW);
+
+  plant.pressure += (plant.motorRunning ? 0.15f : -0.02f) * dt;
+  if (plant.pressure < 0) {
+    plant.pressure = 0;
+  }
+  plant.tempCompressor += ((plant.motorRunning ? 75.0f : 20.0f) - plant.tempCompressor) * dt / 600.0f;
+  plant.tempMotor += ((plant.motorRunning ? 55.0f : 20.0f) - plant.tempMotor) * dt / 900.0f;
+  hal_set_temp(0, plant.tempCompressor);
+  hal_set_temp(1, plant.tempMotor);
+
+  noise = noise * 1103515245 + 12345;
+  int adc = plant_pressure_to_adc(plant.pressure) + (int)((noise >> 16) % (2 * PLANT_ADC_NOISE + 1)) - PLANT_ADC_NOISE;
+  hal_set_adc(PLANT_PRESSURESENSOR, adc < 0 ? 0 : (adc > 4095 ? 4095 : adc));
+
+  unsigned long now = millis();
+  bool pressed[64] = { false };
+  bool scripted[64] = { false };
+  for (auto &p : presses) {
+    scripted[p.pin & 63] = true;
+    if ((now >= p.at) && (now < p.until)) {
+      pressed[p.pin & 63] = true;
+    }
+  }
+  for (int pin = 0; pin < 64; pin++) {
+    if (scripted[pin]) {
+      hal_set_pin(pin, pressed[pin] ? LOW : HIGH);
+    }
+  }
+}
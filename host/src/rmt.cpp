@@ -0,0 +1,216 @@
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include <rom/gpio.h>
+#include <vector>
+
+// only the OneWire use of the RMT is modelled: every TX item is a reset pulse
+// (a low of 400 us or more) or a time slot on the simulated bus of hal.h
+
+#define RMT_ONEWIRE_RESET_MIN (400) // in ticks of 1 us
+#define RMT_ONEWIRE_SAMPLE (15) // a device holds a read slot low past the sample point for a 0
+#define RMT_ONEWIRE_PRESENCE_WAIT (30)
+#define RMT_ONEWIRE_PRESENCE_LOW (120)
+
+struct sim_rmt_channel_t {
+  rmt_config_t config;
+  bool configured;
+  bool installed;
+  bool receiving;
+  uint16_t idleThreshold;
+  std::vector<rmt_item32_t> received; // the item in the ring buffer
+  uint64_t readyAt_us; // when reception ends in virtual time
+  bool itemPending;
+  bool itemTaken;
+};
+
+static sim_rmt_channel_t channels[RMT_CHANNEL_MAX];
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+  (void)gpio_num;
+  (void)mode;
+  return ESP_OK;
+}
+
+void gpio_matrix_out(uint32_t gpio, uint32_t signal_idx, bool out_inv, bool oen_inv) {
+  (void)gpio;
+  (void)signal_idx;
+  (void)out_inv;
+  (void)oen_inv;
+}
+
+void gpio_matrix_in(uint32_t gpio, uint32_t signal_idx, bool inv) {
+  (void)gpio;
+  (void)signal_idx;
+  (void)inv;
+}
+
+esp_err_t rmt_config(const rmt_config_t *rmt_param) {
+  if ((rmt_param->channel >= RMT_CHANNEL_MAX) || (rmt_param->mem_block_num == 0) ||
+      (rmt_param->channel + rmt_param->mem_block_num > RMT_CHANNEL_MAX)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  sim_rmt_channel_t &c = channels[rmt_param->channel];
+  c.config = *rmt_param;
+  c.configured = true;
+  if (rmt_param->rmt_mode == RMT_MODE_RX) {
+    c.idleThreshold = rmt_param->rx_config.idle_threshold;
+  }
+  return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags) {
+  (void)rx_buf_size;
+  (void)intr_alloc_flags;
+  if ((channel >= RMT_CHANNEL_MAX) || !channels[channel].configured) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (channels[channel].installed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  channels[channel].installed = true;
+  return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) {
+  if (channel >= RMT_CHANNEL_MAX) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  channels[channel].installed = false;
+  channels[channel].receiving = false;
+  return ESP_OK;
+}
+
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t *buf_handle) {
+  if ((channel >= RMT_CHANNEL_MAX) || !channels[channel].installed || (channels[channel].config.rmt_mode != RMT_MODE_RX)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *buf_handle = &channels[channel];
+  return ESP_OK;
+}
+
+esp_err_t rmt_set_rx_idle_thresh(rmt_channel_t channel, uint16_t thresh) {
+  if (channel >= RMT_CHANNEL_MAX) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  channels[channel].idleThreshold = thresh;
+  return ESP_OK;
+}
+
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool rx_idx_rst) {
+  (void)rx_idx_rst;
+  if ((channel >= RMT_CHANNEL_MAX) || !channels[channel].installed) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  channels[channel].receiving = true;
+  channels[channel].itemPending = false;
+  channels[channel].received.clear();
+  return ESP_OK;
+}
+
+esp_err_t rmt_rx_stop(rmt_channel_t channel) {
+  if (channel >= RMT_CHANNEL_MAX) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  channels[channel].receiving = false;
+  return ESP_OK;
+}
+
+static void addLevel(std::vector<rmt_item32_t> &items, int level, uint32_t duration) {
+  if (!items.empty() && (items.back().duration1 == 0) && (items.back().level0 != (uint32_t)level)) {
+    items.back().level1 = level;
+    items.back().duration1 = duration;
+    return;
+  }
+  if (!items.empty() && (items.back().duration1 != 0) && (items.back().level1 == (uint32_t)level)) {
+    items.back().duration1 += duration;
+    return;
+  }
+  rmt_item32_t item;
+  item.val = 0;
+  item.level0 = level;
+  item.duration0 = duration;
+  items.push_back(item);
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *rmt_item, int item_num, bool wait_tx_done) {
+  if ((channel >= RMT_CHANNEL_MAX) || !channels[channel].installed || (channels[channel].config.rmt_mode != RMT_MODE_TX)) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  hal_charge_us(HAL_COST_RMT_CALL_US);
+
+  // what the bus shows: the low periods of the master, stretched by the devices
+  std::vector<rmt_item32_t> bus;
+  uint64_t total_us = 0;
+  unsigned slots = 0;
+  for (int i = 0; i < item_num; i++) {
+    uint32_t low = rmt_item[i].duration0;
+    uint32_t high = rmt_item[i].duration1;
+    total_us += low + high;
+    if (low >= RMT_ONEWIRE_RESET_MIN) {
+      hal_counters.oneWireResets++;
+      addLevel(bus, 0, low);
+      if (hal_onewire_reset() && (high > RMT_ONEWIRE_PRESENCE_WAIT)) {
+        addLevel(bus, 1, RMT_ONEWIRE_PRESENCE_WAIT);
+        addLevel(bus, 0, RMT_ONEWIRE_PRESENCE_LOW);
+        total_us += RMT_ONEWIRE_PRESENCE_LOW;
+      } else {
+        addLevel(bus, 1, high);
+      }
+      continue;
+    }
+    int bit = (low < RMT_ONEWIRE_SAMPLE) ? 1 : 0;
+    int level = hal_onewire_slot(bit);
+    slots++;
+    if ((bit == 1) && (level == 0)) {
+      low = 2 * RMT_ONEWIRE_SAMPLE;
+      high = (low < rmt_item[i].duration0 + high) ? rmt_item[i].duration0 + high - low : 1;
+    }
+    addLevel(bus, 0, low);
+    addLevel(bus, 1, high);
+  }
+  hal_counters.oneWireBytes += slots / 8;
+  if (!bus.empty()) {
+    // the idle line ends the reception
+    if (bus.back().duration1 != 0) {
+      bus.back().duration1 = 0;
+    }
+  }
+
+  // every RX channel on the same pin records the bus
+  for (int i = 0; i < RMT_CHANNEL_MAX; i++) {
+    sim_rmt_channel_t &rx = channels[i];
+    if (rx.installed && rx.receiving && (rx.config.rmt_mode == RMT_MODE_RX) && (rx.config.gpio_num == channels[channel].config.gpio_num)) {
+      size_t capacity = (size_t)rx.config.mem_block_num * RMT_MEM_ITEM_NUM;
+      rx.received = bus;
+      if (rx.received.size() > capacity) {
+        rx.received.resize(capacity); // the RX memory overflows
+      }
+      rx.readyAt_us = hal_now_us() + total_us + rx.idleThreshold;
+      rx.itemPending = true;
+      rx.itemTaken = false;
+    }
+  }
+  if (wait_tx_done) {
+    hal_charge_us(total_us);
+  }
+  return ESP_OK;
+}
+
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *item_size, TickType_t ticks_to_wait) {
+  (void)ticks_to_wait;
+  sim_rmt_channel_t *rx = (sim_rmt_channel_t *)ringbuf;
+  if (!rx->itemPending || rx->itemTaken || (hal_now_us() < rx->readyAt_us)) {
+    return nullptr;
+  }
+  hal_charge_us(HAL_COST_RMT_CALL_US);
+  rx->itemTaken = true;
+  *item_size = rx->received.size() * sizeof(rmt_item32_t);
+  return rx->received.data();
+}
+
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item) {
+  (void)item;
+  sim_rmt_channel_t *rx = (sim_rmt_channel_t *)ringbuf;
+  rx->itemPending = false;
+  rx->itemTaken = false;
+}
@@ -0,0 +1,83 @@
+#include <SPIFFS.h>
+#include <map>
+
+SPIFFSFS SPIFFS;
+
+static std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+
+size_t File::write(const uint8_t *buf, size_t len) {
+  if (!data || !writable) {
+    return 0;
+  }
+  if (pos + len > data->size()) {
+    data->resize(pos + len);
+  }
+  memcpy(data->data() + pos, buf, len);
+  pos += len;
+  SPIFFS.bytesWritten += len;
+  return len;
+}
+
+size_t File::readBytes(char *buf, size_t len) {
+  if (!data) {
+    return 0;
+  }
+  size_t n = std::min(len, data->size() - pos);
+  memcpy(buf, data->data() + pos, n);
+  pos += n;
+  return n;
+}
+
+int File::read() {
+  uint8_t c;
+  return (readBytes((char *)&c, 1) == 1) ? c : -1;
+}
+
+bool File::seek(size_t p) {
+  if (!data || (p > data->size())) {
+    return false;
+  }
+  pos = p;
+  return true;
+}
+
+bool SPIFFSFS::exists(const String &path) {
+  return files.count(path.str) != 0;
+}
+
+bool SPIFFSFS::remove(const String &path) {
+  return files.erase(path.str) != 0;
+}
+
+bool SPIFFSFS::rename(const String &from, const String &to) {
+  auto it = files.find(from.str);
+  if (it == files.end()) {
+    return false;
+  }
+  files[to.str] = it->second;
+  files.erase(it);
+  return true;
+}
+
+File SPIFFSFS::open(const String &path, const char *mode) {
+  auto it = files.find(path.str);
+  if (mode[0] == 'r') {
+    if (it == files.end()) {
+      return File();
+    }
+    return File(it->second, strchr(mode, '+') != nullptr, 0);
+  }
+  if ((it == files.end()) || (mode[0] == 'w')) {
+    files[path.str] = std::make_shared<std::vector<uint8_t>>();
+  }
+  auto data = files[path.str];
+  return File(data, true, (mode[0] == 'a') ? data->size() : 0);
+}
+
+size_t SPIFFSFS::usedBytes() {
+  size_t n = 0;
+  for (auto &f : files) {
+    n += f.second->size();
+  }
+  return n;
+}
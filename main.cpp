@@ -43,8 +43,6 @@
 #include <WiredEthernet.h>
 #include <SIG2.h>
 #include <Cache.h>
-#include <OptoDebounce.h>
-#include <ButtonDebounce.h>
 #include <WiFiUdp.h>
 #include <EEPROM.h>
 #include <NTP.h> // install NTP by Stefan Staub
@@ -55,6 +53,23 @@
 #include "PressureSensor.h"
 #include "OledDisplay.h"
 #include "OilLevelSensor.h"
+#include "LoopProfiler.h"
+#include "History.h"
+#include "DurationJournal.h"
+#include "FixedFormat.h"
+#include "ReportCbor.h"
+#include "ReportFilter.h"
+#include "LogRing.h"
+#include "LogEvent.h"
+#include "TimerWheel.h"
+#include "InputCapture.h"
+#include "SafetyInterlock.h"
+#include "TaskChannels.h"
+#include "NetworkTask.h"
+#include "FaultMask.h"
+#include "StateMachine.h"
+#include "ControlEvents.h"
+#include "OperatingHours.h"
 
 WiFiUDP wifiUDP;
 NTP ntp(wifiUDP);
@@ -70,27 +85,22 @@ NTP ntp(wifiUDP);
 #define BUTTON_OFF_PRESSED (LOW) // the input level of te GPIO port used for button off, if this button is pressed
 #define BUTTON_INFO_CALIBRATION_PRESSED (LOW) // the input level of te GPIO port used for button info and calibrations, if this button is pressed
 
-ButtonDebounce buttonOn(ON_BUTTON, 150 /* mSeconds */); // buttonOn is used to switch on the compressor
-ButtonDebounce buttonOff(OFF_BUTTON, 150 /* mSeconds */); // buttonOff is used to switch off the compressor
-ButtonDebounce buttonInfoCalibration(INFO_CALIBRATION_BUTTON, 150 /* mSeconds */); // buttonInfoCalibration is used to toggle Info / Calibration mode on/off
+// edges are captured by interrupts, see InputCapture.h; the Off button acts on its first edge
+CapturedInput buttonOn(ON_BUTTON, INPUT_SETTLE, 150 /* mSeconds */); // buttonOn is used to switch on the compressor
+CapturedInput buttonOff(OFF_BUTTON, INPUT_LEADING, 150 /* mSeconds */); // buttonOff is used to switch off the compressor
+CapturedInput buttonInfoCalibration(INFO_CALIBRATION_BUTTON, INPUT_SETTLE, 150 /* mSeconds */); // buttonInfoCalibration is used to toggle Info / Calibration mode on/off
 
 // 230VAC optocoupler
-OptoDebounce opto1(OPTO1); // wired to N0 - L1 of 3 phase compressor motor, to detect if the motor has power (or not)
-
-// temperature sensors
-#define TEMP_SENSOR_LABEL1 ("Compressor") // label used in logging for temp. sensor 1
-#define TEMP_SENSOR_LABEL2 ("Motor") // label used in logging for temp. sensor 2
-#define TEMP_REPORT_ERROR1 ("temperature_sensor_1_(compressor)_error") // label used in reporting for temp. sensor 1
-#define TEMP_REPORT_WARNING1 ("temperature_sensor_1_(compressor)_warning") // label used in reporting for temp. sensor 1
-#define TEMP_REPORT1 ("temperature_sensor_1_(compressor)") // label used in reporting for temp. sensor 1
-#define TEMP_REPORT_ERROR2 ("temperature_sensor_2_(motor)_error") // label used in reporting for temp. sensor 2
-#define TEMP_REPORT_WARNING2 ("temperature_sensor_2_(motor)_warning") // label used in reporting for temp. sensor 2
-#define TEMP_REPORT2 ("temperature_sensor_2_(motor)") // label used in reporting for temp. sensor 2
-// Temperature warning and error levels
-#define TEMP_IS_HIGH_LEVEL_1 (60.0) // in degrees Celcius, used for temperature is high warning of sensor 1
-#define TEMP_IS_TOO_HIGH_LEVEL_1 (90.0) // in degrees Celcius, used to disable the compressor when temperature is too high of sensor 1
-#define TEMP_IS_HIGH_LEVEL_2 (60.0) // in degrees Celcius, used for temperature is high warning of sensor 2
-#define TEMP_IS_TOO_HIGH_LEVEL_2 (90.0) // in degrees Celcius, used to disable the compressor when temperature is too high of sensor 2
+#define OPTO1_ON (HIGH) // the state of opto1 while the motor has power
+CapturedInput opto1(OPTO1, INPUT_PULSES, 20 /* mSeconds */); // wired to N0 - L1 of 3 phase compressor motor, to detect if the motor has power (or not)
+
+// temperature sensors: ROM address, warning level and error level (in degrees Celcius), label used in logging and
+// key used in reporting. Address { 0 } is the next sensor found on the bus, in ROM order; sensors that are found
+// but not listed here are added as "Sensor <n>" with the default levels of TempSensor.cpp
+tempsensorconfig_t tempSensorConfig[] = {
+  { { 0 }, 60.0, 90.0, "Compressor", "temperature_sensor_1_(compressor)" },
+  { { 0 }, 60.0, 90.0, "Motor", "temperature_sensor_2_(motor)" },
+};
 
 
 // Pressure limits, used for safety
@@ -113,9 +123,10 @@ OptoDebounce opto1(OPTO1); // wired to N0 - L1 of 3 phase compressor motor, to d
 // For LED's showing node error
 #define BLINKING_LED_PERIOD (600) // in ms
 
-// for storage in EEProm of the duration counters
-#define SAVE_DURATION_COUNTERS_WINDOW (86400) // in seconds (86400 = 24 hour)
+// for storage in SPIFFS of the duration counters, see DurationJournal.h
+#define SAVE_DURATION_COUNTERS_WINDOW (300) // in seconds (300 = 5 minutes)
 
+// legacy duration counter file, only read when the journal is empty
 #define DURATION_DIR_PREFIX "/init"
 #define DURATION_FILE_PREFIX "/duration"
 
@@ -126,6 +137,8 @@ OptoDebounce opto1(OPTO1); // wired to N0 - L1 of 3 phase compressor motor, to d
 // IF the compressor is not allowed at late hours (DISABLE_COMPRESSOR AT LATE HOURS = true) the 
 // compressor will not switch on automatically (or by hand if the on button is pressed normally) from
 // DISABLED_TIME_START to DISABLED_START_END
+// These are the default hours of every day of the week, until the master sets the hours of a day or an
+// override with the hours and override commands, see OperatingHours.h
 // Pressing the on button longer than MAX_WAIT_TIME_BUTTON_ON_PRESSED will override this behaviour by
 // switching on the compressor anyhow. In all cases the compressor will switch of after AUTOTIMEOUT (in ms)
 // unless the button on is pressed again or a new auto on command is received while the compressor is
@@ -152,11 +165,35 @@ OptoDebounce opto1(OPTO1); // wired to N0 - L1 of 3 phase compressor motor, to d
 // for logging to MQTT etc.
 #define LOGGING_ENABLED                       (true)  // to enable/disable logging
 #define LOGGING_TIME_WINDOW                   (20000)  // in ms
+#define LOGGING_ASYNC                         (true)  // log lines are written to the sinks by the log flush task, see LogRing.h
+
+// node.loop() runs in its own task on core 0, see NetworkTask.h; only with LOGGING_ASYNC
+#define NETWORK_TASK                          (true)  // to enable/disable the network task
+#define REPORT_SNAPSHOT_WINDOW                (100)  // in ms, the values of the report are published for the network task
+
+// for reporting the latency of the different stages of loop()
+#define LOOP_PROFILER_REPORT                  (true)  // to enable/disable the loop_*_us fields in the report
+
+// a pass of loop() over LOOP_PASS_BUDGET sheds its low priority work, see LoopProfiler.h
+#define LOOP_SHED_DEFER                       (10)  // in ms, a shed status dump is tried again after this time
 
+// the periodic work of loop() runs from theTimerWheel, see TimerWheel.h; between the deadlines the loop may sleep
+#define LOOP_IDLE_SLEEP                       (false)  // to enable/disable sleeping until the next deadline
+#define LOOP_MAX_IDLE_SLEEP                   (5)  // in ms, the buttons, sensors and MQTT are polled at least this often
 
-// for testing the timing of the different loops etc.
-// #define TEST_TIMING
-#define TEST_TIME_LIMIT (100)
+// for the compact CBOR report on topic report_cbor, see ReportCbor.h
+#define REPORT_CBOR_ENABLED                   (true)  // to enable/disable the CBOR report
+#define REPORT_LEGACY_JSON                    (true)  // to enable/disable the verbose fields of the JSON report, only state is left
+
+// for change driven reporting on topic report_cbor, see ReportFilter.h
+#define REPORT_CHANGE_DRIVEN                  (true)  // to enable/disable change reports and the adaptive heartbeat
+#define REPORT_HEARTBEAT_ACTIVE               (120000)  // in ms, full CBOR report while the compressor is powered
+#define REPORT_HEARTBEAT_IDLE                 (3600000)  // in ms, full JSON and CBOR report in all states
+#define REPORT_DEADBAND_INTERVAL_ACTIVE       (15000)  // in ms, pressure and temperatures at most once per interval while powered
+#define REPORT_DEADBAND_INTERVAL_IDLE         (300000)  // in ms, in all other states
+
+// for the in RAM history of pressure, temperatures and machine state
+#define HISTORY_SAMPLE_WINDOW                 (1000)  // in ms
 
 // for testing with WiFi
 // ACNode node = ACNode(MACHINE, WIFI_NETWORK, WIFI_PASSWD);
@@ -171,26 +208,34 @@ OTA ota = OTA(OTA_PASSWD);
 
 #define NEVER (0)
 
+// the entry and exit actions of the states, see machineEvent()
+void enterReboot();
+void enterSwitchedOff();
+void enterPowered();
+void enterRunning();
+void exitRunning();
+
 struct {
   const char * label;                   // name of this state
   LED::led_state_t ledState;            // flashing pattern for the aartLED. Zie ook https://wiki.makerspaceleiden.nl/mediawiki/index.php/Powernode_1.1.
-  time_t maxTimeInMilliSeconds;         // how long we can stay in this state before we timeout.
-  machinestates_t failStateOnTimeout;   // what state we transition to on timeout.
-} state[RUNNING + 1] =
+  time_t maxTimeInMilliSeconds;         // how long we can stay in this state before we timeout, see MACHINE_TIMEOUT.
+  void (*onEntry)();                    // switches the relay and the LEDs for this state, NULL if nothing.
+  void (*onExit)();                     // NULL if nothing.
+} state[NR_OF_MACHINE_STATES] =
 {
-  { "Booting",              LED::LED_ERROR,           120 * 1000, REBOOT },
-  { "Out of order",         LED::LED_ERROR,           120 * 1000, REBOOT },
-  { "Rebooting",            LED::LED_ERROR,           120 * 1000, REBOOT },
-  { "Transient Error",      LED::LED_ERROR,           120 * 1000, REBOOT },
-  { "No network",           LED::LED_FLASH,           120 * 1000, REBOOT },
-  { "Waiting for card",     LED::LED_IDLE,            NEVER, REBOOT },
-  { "Checking card",        LED::LED_IDLE,            NEVER, REBOOT },
-  { "Compressor switched off", LED::LED_IDLE,         NEVER, SWITCHEDOFF},
-  { "Powered - motor off",  LED::LED_IDLE,            NEVER, POWERED },
-  { "Powered - motor running", LED::LED_ON,           NEVER, RUNNING },
+  { "Booting",              LED::LED_ERROR,           120 * 1000, NULL, NULL },
+  { "Out of order",         LED::LED_ERROR,           120 * 1000, NULL, NULL },
+  { "Rebooting",            LED::LED_ERROR,           120 * 1000, enterReboot, NULL },
+  { "Transient Error",      LED::LED_ERROR,           120 * 1000, NULL, NULL },
+  { "No network",           LED::LED_FLASH,           120 * 1000, NULL, NULL },
+  { "Waiting for card",     LED::LED_IDLE,            NEVER, NULL, NULL },
+  { "Checking card",        LED::LED_IDLE,            NEVER, NULL, NULL },
+  { "Compressor switched off", LED::LED_IDLE,         NEVER, enterSwitchedOff, NULL },
+  { "Powered - motor off",  LED::LED_IDLE,            NEVER, enterPowered, NULL },
+  { "Powered - motor running", LED::LED_ON,           NEVER, enterRunning, exitRunning },
 };
 
-unsigned long laststatechange = 0;
+uint64_t laststatechange = 0; // uptimeMs()
 static machinestates_t laststate = BOOTING;
 machinestates_t machinestate = BOOTING;
 
@@ -203,65 +248,72 @@ float running = 0.0;
 unsigned long lastSavedPoweredCounter = 0;
 unsigned long lastSavedRunningCounter = 0;
 
+DurationJournal theDurationJournal;
+
+ReportFilter theReportFilter;
+unsigned long lastFullReport = 0; // millis() of the last report with all keys, JSON or CBOR only
+
+// the values of the report, published by loop() for onReport() in the network task
+typedef struct {
+  uint32_t number; // of the snapshot, from 1
+  reportvalues_t values; // with the loop stages
+  float pressure; // in bar
+  float temperature[MAX_NR_OF_TEMP_SENSORS]; // in degrees Celcius
+  int opto1;
+  char loopSummary[NR_OF_LOOP_STAGES][32]; // p50/p99/max in us
+  char inputLatency[32];
+  char relayLatency[32];
+  uint32_t logDroppedLines;
+  uint32_t safetyTrips;
+  uint32_t safetyTripLatency;
+  uint32_t safetyCheckInterval;
+  uint32_t loopShed[NR_OF_LOOP_WORK];
+  controlcounters_t controlEvents;
+  char disabledBy[96]; // the faults of FAULTS_DISABLE that are set, see FaultMask.h
+  uint32_t faultSets[NR_OF_FAULTS];
+} reportsnapshot_t;
+
+SnapshotBuffer<reportsnapshot_t> reportSnapshot;
+reportsnapshot_t publishedReports[2]; // the last two snapshots, for theReportFilter when one is reported
+uint32_t nrOfReportSnapshots = 0;
+
 // pressure sensor
 PressureSensor thePressureSensor(PRESSURE_MAX_LIMIT, PRESSURE_BELOW_LIMIT);
 
-// temperature sensors
-TemperatureSensor theTempSensor1(TEMP_IS_HIGH_LEVEL_1, TEMP_IS_TOO_HIGH_LEVEL_1, TEMP_SENSOR_LABEL1);
-TemperatureSensor theTempSensor2(TEMP_IS_HIGH_LEVEL_2, TEMP_IS_TOO_HIGH_LEVEL_2, TEMP_SENSOR_LABEL2);
-
 // oil level sensor
 OilLevelSensor theOilLevelSensor;
 
 // OledDisplay
 OledDisplay theOledDisplay;
 
-unsigned long blinkingLedNextTime = 0;
 bool blinkingLedIsOn = false;
 bool ledIsBlinking = false;
 
 char reportStr[128];
 
-unsigned long nextLoggingTime = 0;
-
-unsigned long DurationCounterSave;
-
-unsigned long verifyButtonOnPressedTime;
 bool verifyButtonOnIsStillPressed = false;
-bool isManualSwitchedOn = false;
-bool isManualSwitchedOnVerifyOverride = false;
-bool isManualSwitchedOff = false;
-bool isManualTimeOutExtended = false;
 
-unsigned long ledDisableTime = 0;
-unsigned long nextLedDisableTime = 0;
+uint64_t ledDisableTime = 0;
 bool showLedDisable = false;
 bool disableLedIsOn = false;
 
-unsigned long autoPowerOff;
+uint64_t autoPowerOff; // uptimeMs()
 bool compressorIsOn = false;
 
-bool automaticStopReceived = false;
-bool automaticPowerOnReceived = false;
-bool automaticPowerOnDenied = false;
-
-bool ErrorPressureIsTooHigh = false;
-bool showErrorPressureIsTooHigh = false;
-bool showPressureIsOK = false;
-
 bool checkCalibButtonsPressed = false;
-long int checkCalibTimeOut = 0;
 bool showInfoAndCalibration = false;
 IPAddress theLocalIPAddress;
 
-unsigned long nextNTPUpdateTime = 0;
-
-
-// for testing loop timing
-long long prevTime = 0;
-int waitcount = 0;
-int placeCount = 0;
-long long averageTime[40] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,};
+// the periodic and delayed work of the control loop, see TimerWheel.h
+wheeltimer_t ntpTimer;
+wheeltimer_t blinkingLedTimer;
+wheeltimer_t ledDisableTimer;
+wheeltimer_t verifyButtonOnTimer;
+wheeltimer_t checkCalibTimer;
+wheeltimer_t durationCounterTimer;
+wheeltimer_t historyTimer;
+wheeltimer_t loggingTimer;
+wheeltimer_t reportSnapshotTimer;
 
 void checkClearEEPromAndCacheButtonPressed(void) {
   unsigned long ButtonPressedTime;
@@ -311,6 +363,7 @@ void checkClearEEPromAndCacheButtonPressed(void) {
       if (SPIFFS.exists(path)) {
         SPIFFS.remove(path);
       } 
+      theDurationJournal.clear();
       theOledDisplay.cacheCleared();
       Log.println("Cache cleared!");
       // wait until button is released, than reboot
@@ -344,35 +397,10 @@ void saveDurationCounters() {
   }
 
   if ((tmpCounter1 != lastSavedPoweredCounter) || (tmpCounter2 != lastSavedRunningCounter)) {
-    String path = DURATION_DIR_PREFIX + (String)DURATION_FILE_PREFIX;
-    File durationFile;
-    unsigned int writeSize;
-    durationFile = SPIFFS.open(path, "wb");
-    if(!durationFile) {
-      Log.print("There was an error opening the ");
-      Log.print(DURATION_DIR_PREFIX);
-      Log.print(DURATION_FILE_PREFIX);
-      Log.println(" file for writing");
-      return;
-    }
-    writeSize = durationFile.write((byte*)&tmpCounter1, sizeof(tmpCounter1));
-    if (writeSize != sizeof(tmpCounter1)) {
-      Log.print("ERROR --> powered_total: ");
-      Log.print(tmpCounter1);
-      Log.println(" NOT stored in SPIFFS");
-      durationFile.close();
-      return;
-    }
-
-    writeSize = durationFile.write((byte*)&tmpCounter2, sizeof(tmpCounter2));
-    if (writeSize != sizeof(tmpCounter2)) {
-      Log.print("ERROR --> running_total: ");
-      Log.print(tmpCounter2);
-      Log.println(" NOT stored in SPIFFS");
-      durationFile.close();
-      return;
+    if (theDurationJournal.commit(tmpCounter1, tmpCounter2)) {
+      lastSavedPoweredCounter = tmpCounter1;
+      lastSavedRunningCounter = tmpCounter2;
     }
-    durationFile.close();
   }
 }
 
@@ -385,6 +413,13 @@ void loadDurationCounters() {
     Log.println("An Error has occurred while mounting SPIFFS");
     return;
   }
+  if (theDurationJournal.load(&powered_total, &running_total)) {
+    powered = (float)powered_total / 3600.0;
+    running = (float)running_total / 3600.0;
+    lastSavedPoweredCounter = powered_total;
+    lastSavedRunningCounter = running_total;
+    return;
+  }
   if (SPIFFS.exists(path)) {
     durationFile = SPIFFS.open(path, "rb");
     if(!durationFile) {
@@ -427,51 +462,258 @@ void loadDurationCounters() {
 }
 
 bool compressorIsDisabeled() {
-  int currentHour;
-
-  currentHour = ntp.hours();
-/* 
- * for test of NTP, check if time shown is correct 
-  Serial.print("Current hour: ");
-  Serial.println(currentHour);
-*/  
-  if (DISABLED_TIME_START < DISABLED_TIME_END) {
-    if (ErrorOilLevelIsTooLow ||  theTempSensor1.ErrorTempIsTooHigh || theTempSensor2.ErrorTempIsTooHigh || ErrorPressureIsTooHigh || thePressureSensor.tooHighPressure() ||
-        (((currentHour >= DISABLED_TIME_START) && (currentHour < DISABLED_TIME_END)) && DISABLE_COMPRESSOR_AT_LATE_HOURS)) {
-      return true;
+  if (theFaults.any(FAULTS_DISABLE)) {
+    return true;
+  }
+  return !theOperatingHours.isAllowed();
+}
+
+// the compressor is not switched on over a fault the control loop and the safety interlock switch it off for
+bool switchOnIsSafe() {
+  return !theFaults.any(FAULTS_SWITCH_OFF);
+}
+
+// the transitions of machinestate, see StateMachine.h; a row per state, a column per machineevent_t:
+//   connected, disconnected, error, timeout, switch_on, switch_off, motor_started, motor_stopped
+const machinetransition_t machineTransitions[NR_OF_MACHINE_STATES][NR_OF_MACHINE_EVENTS] =
+{
+  // BOOTING
+  { GO(SWITCHEDOFF), GO(NOCONN), GO(TRANSIENTERROR), GO(REBOOT), STAY, STAY, STAY, STAY },
+  // OUTOFORDER
+  { GO(SWITCHEDOFF), GO(NOCONN), GO(TRANSIENTERROR), GO(REBOOT), STAY, STAY, STAY, STAY },
+  // REBOOT: the timeout enters it again, to retry the reboot
+  { STAY, STAY, STAY, GO(REBOOT), STAY, STAY, STAY, STAY },
+  // TRANSIENTERROR: the relay keeps its state, switch off drops it
+  { GO(SWITCHEDOFF), GO(NOCONN), STAY, GO(REBOOT), GO_IF(POWERED, switchOnIsSafe), GO(SWITCHEDOFF), STAY, STAY },
+  // NOCONN: the relay keeps its state until the node is connected again or it is switched off
+  { GO(SWITCHEDOFF), STAY, GO(TRANSIENTERROR), GO(REBOOT), GO_IF(POWERED, switchOnIsSafe), GO(SWITCHEDOFF), STAY, STAY },
+  // WAITINGFORCARD, not used by the compressor
+  { GO(SWITCHEDOFF), GO(NOCONN), GO(TRANSIENTERROR), GO(REBOOT), STAY, STAY, STAY, STAY },
+  // CHECKINGCARD, not used by the compressor
+  { GO(SWITCHEDOFF), GO(NOCONN), GO(TRANSIENTERROR), GO(REBOOT), STAY, STAY, STAY, STAY },
+  // SWITCHEDOFF
+  { STAY, GO(NOCONN), GO(TRANSIENTERROR), STAY, GO_IF(POWERED, switchOnIsSafe), STAY, STAY, STAY },
+  // POWERED
+  { GO(SWITCHEDOFF), GO(NOCONN), GO(TRANSIENTERROR), STAY, STAY, GO(SWITCHEDOFF), GO(RUNNING), STAY },
+  // RUNNING
+  { GO(SWITCHEDOFF), GO(NOCONN), GO(TRANSIENTERROR), STAY, STAY, GO(SWITCHEDOFF), STAY, GO(POWERED) },
+};
+
+bool machineEvent(machineevent_t event) {
+  const machinetransition_t &transition = machineTransitions[machinestate][event];
+
+  if ((transition.next == MACHINE_NO_TRANSITION) || ((transition.guard != NULL) && !transition.guard())) {
+    return false;
+  }
+  if (state[machinestate].onExit != NULL) {
+    state[machinestate].onExit();
+  }
+  machinestate = transition.next;
+  if (state[machinestate].onEntry != NULL) {
+    state[machinestate].onEntry();
+  }
+  return true;
+}
+
+const char *machineStateLabel(machinestates_t machineState) {
+  return state[machineState].label;
+}
+
+void enterReboot() {
+  saveDurationCounters();
+  node.delayedReboot();
+}
+
+// compressor switched off completely
+void enterSwitchedOff() {
+  digitalWrite(RELAY_GPIO, 0);
+  // digitalWrite(LED1, 0);
+  // digitalWrite(LED2, 0);
+  ledcWrite(PWM_LED_CHANNEL1, 0);
+  ledcWrite(PWM_LED_CHANNEL2, 0);
+  if (compressorIsOn) {
+    compressorIsOn = false;
+    logEvent(EVENT_SWITCHED_OFF);
+  }
+}
+
+// compressor switched on, but motor is off
+void enterPowered() {
+  digitalWrite(RELAY_GPIO, 1);
+  // digitalWrite(LED1, 1);
+  ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);
+  if (!compressorIsOn) {
+    compressorIsOn = true;
+    logEvent(EVENT_SWITCHED_ON);
+  }
+}
+
+// compressor switched on and motor is running
+void enterRunning() {
+  // digitalWrite(LED2, 1);
+  ledcWrite(PWM_LED_CHANNEL2, LED2_DIM_VALUE);
+}
+
+void exitRunning() {
+  // digitalWrite(LED2, 0);
+  ledcWrite(PWM_LED_CHANNEL2, 0);
+}
+
+// the timers of the control loop, see setup() and compressorLoop()
+void verifyButtonOnOverride(void *context) {
+  if (verifyButtonOnIsStillPressed && (buttonOn.state() == BUTTON_ON_PRESSED)) {
+    verifyButtonOnIsStillPressed = false;
+    if (machineEvent(MACHINE_SWITCH_ON)) {
+      autoPowerOff = uptimeMs() + AUTOTIMEOUT; 
+      theOledDisplay.showStatus(MANUALOVERRIDE);
+      logEvent(EVENT_MANUAL_OVERRIDE);
+    }
+  }
+}
+
+void flashDisableLed(void *context) {
+  if (uptimeMs() < ledDisableTime) {
+    if (disableLedIsOn) {
+      // digitalWrite(LED1, 0);
+      ledcWrite(PWM_LED_CHANNEL1, 0);
     } else {
-      return false;
+      // digitalWrite(LED1, 1);
+      ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);
     }
+    disableLedIsOn = !disableLedIsOn;
+  } else {
+    theTimerWheel.stop(&ledDisableTimer);
+    showLedDisable = false;
+    disableLedIsOn = false;
+    // digitalWrite(LED1, 0);
+    ledcWrite(PWM_LED_CHANNEL1, 0);
+  }
+}
+
+// both buttons are still pressed after CALIB_WINDOW_TIME, else the timer was stopped
+void checkCalibButtons(void *context) {
+  showInfoAndCalibration = !showInfoAndCalibration;
+  saveDurationCounters();
+  checkCalibButtonsPressed = false;
+}
+
+void blinkLeds(void *context) {
+  if (blinkingLedIsOn) {
+    // digitalWrite(LED1, 0);
+    // digitalWrite(LED2, 0);
+    ledcWrite(PWM_LED_CHANNEL1, 0);
+    ledcWrite(PWM_LED_CHANNEL2, 0);
+  } else {
+    // digitalWrite(LED1, 1);
+    // digitalWrite(LED2, 1);
+    ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);
+    ledcWrite(PWM_LED_CHANNEL2, LED2_DIM_VALUE);
+  }
+  blinkingLedIsOn = !blinkingLedIsOn;
+}
+
+// save duration counters in EEProm every SAVE_DURATION_COUNTERS_WINDOW number of seconds
+void saveDurationCountersPeriodically(void *context) {
+  Log.print("powered_total = ");
+  Log.println(powered_total);
+  Log.print("running_total = ");
+  Log.println(running_total);
+
+  saveDurationCounters();
+}
+
+void sampleHistory(void *context) {
+  // the history keeps the first two sensors
+  theHistory.add(uptimeMs() / 1000, pressure, (theTempSensors.count() > 0) ? theTempSensors.sensor(0).temperature : -127,
+                 (theTempSensors.count() > 1) ? theTempSensors.sensor(1).temperature : -127,
+                 opto1.state() == OPTO1_ON, machinestate);
+}
+
+void logStatus(void *context) {
+  // not in a pass that ran over its budget, a later one does it
+  if (!theLoopProfiler.mayRun(WORK_STATUS_LOG)) {
+    theTimerWheel.restart(&loggingTimer, LOOP_SHED_DEFER);
+    return;
+  }
+  logEvent(EVENT_EMPTY_LINE);
+
+  // Log pressure
+  logEvent(EVENT_PRESSURE, centiValue(pressure));
+
+  // Log oil level
+  if (ErrorOilLevelIsTooLow) {
+    logEvent(EVENT_OIL_LEVEL_ERROR);
   } else {
-    if (ErrorOilLevelIsTooLow || theTempSensor1.ErrorTempIsTooHigh || theTempSensor2.ErrorTempIsTooHigh ||
-        (((currentHour >= DISABLED_TIME_START) || (currentHour < DISABLED_TIME_END)) && DISABLE_COMPRESSOR_AT_LATE_HOURS)) {
-      return true;
+    if (oilLevelIsTooLow) {
+      logEvent(EVENT_OIL_LEVEL_WARNING);
     } else {
-      return false;
+      logEvent(EVENT_OIL_LEVEL_OK);
     }
   }
+
+  // log temperature
+  for (uint8_t i = 0; i < theTempSensors.count(); i++) {
+    TemperatureSensor &tempSensor = theTempSensors.sensor(i);
+
+    if ((tempSensor.temperature == -127) || tempSensor.notReacting) {
+      logEvent(EVENT_TEMP_NOT_READ, tempSensor.number());
+    } else {
+      if (tempSensor.ErrorTempIsTooHigh) {
+        logEvent(EVENT_TEMP_IS_TOO_HIGH, tempSensor.number());
+      } else {
+        if (tempSensor.tempIsHigh) {
+          logEvent(EVENT_TEMP_IS_HIGH, tempSensor.number());
+        }
+      }
+      logEvent(EVENT_TEMP, tempSensor.number(), centiValue(tempSensor.temperature));
+    }
+    if (tempSensor.crcErrors > 0) {
+      logEvent(EVENT_TEMP_CRC_ERRORS, tempSensor.number(), tempSensor.crcErrors);
+    }
+  }
+
+  // Log machine state
+  switch (machinestate) {
+    case SWITCHEDOFF:
+        logEvent(EVENT_IS_SWITCHED_OFF);
+      break;
+    case POWERED:
+      logEvent(EVENT_IS_POWERED);
+      break;
+    case RUNNING:
+      logEvent(EVENT_IS_RUNNING);
+      break;
+    case REBOOT:
+    case WAITINGFORCARD:
+    case CHECKINGCARD:
+    case TRANSIENTERROR:
+    case OUTOFORDER:
+    case NOCONN:
+    case BOOTING:
+      break;
+  }
+
+  // lines the log flush task could not keep up with
+  if (theLogRing.counters.dropped > 0) {
+    logEvent(EVENT_LOG_DROPPED, theLogRing.counters.dropped);
+  }
 }
 
 void buttonOnChanged(int state) {
   // Debug.printf("Button On changed to %d\n", state);
-  if ((state == BUTTON_ON_PRESSED) && !ErrorOilLevelIsTooLow && !theTempSensor1.ErrorTempIsTooHigh && !theTempSensor2.ErrorTempIsTooHigh 
-        && !ErrorPressureIsTooHigh && thePressureSensor.lowPressure()
+  if ((state == BUTTON_ON_PRESSED) && !theFaults.any(FAULTS_DISABLE | FAULT_BIT(FAULT_PRESSURE_NOT_LOW))
         && (buttonOff.state() != BUTTON_OFF_PRESSED) && (machinestate == SWITCHEDOFF)) {
     if (!compressorIsDisabeled()) {
-      digitalWrite(RELAY_GPIO, 1);
-      // digitalWrite(LED1, 1);   
-      ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);   
-      machinestate = POWERED;
-      compressorIsOn = true;
-      autoPowerOff = millis() + AUTOTIMEOUT;
-      isManualSwitchedOn = true;
+      machineEvent(MACHINE_SWITCH_ON);
+      autoPowerOff = uptimeMs() + AUTOTIMEOUT;
+      theControlEvents.post(CONTROL_BUTTON_ON);
       verifyButtonOnIsStillPressed = false;
     } else {
-      verifyButtonOnPressedTime = millis() + MAX_WAIT_TIME_BUTTON_ON_PRESSED;
-      isManualSwitchedOnVerifyOverride = true;
+      theTimerWheel.start(&verifyButtonOnTimer, MAX_WAIT_TIME_BUTTON_ON_PRESSED, 0, verifyButtonOnOverride, NULL);
+      theControlEvents.post(CONTROL_BUTTON_ON_DENIED);
       // flash LED to show that function is disabled
-      ledDisableTime = millis() + LED_DISABLE_DURATION;
-      nextLedDisableTime = millis() + LED_DISABLE_PERIOD;
+      ledDisableTime = uptimeMs() + LED_DISABLE_DURATION;
+      theTimerWheel.start(&ledDisableTimer, LED_DISABLE_PERIOD, LED_DISABLE_PERIOD, flashDisableLed, NULL);
       showLedDisable = true;
       // digitalWrite(LED1, 1);
       ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);
@@ -479,12 +721,12 @@ void buttonOnChanged(int state) {
       verifyButtonOnIsStillPressed = true;
     }
   } else {
-    if (ErrorPressureIsTooHigh || !thePressureSensor.lowPressure()) {
-      showErrorPressureIsTooHigh = true;
+    if (theFaults.any(FAULT_BIT(FAULT_PRESSURE_ERROR) | FAULT_BIT(FAULT_PRESSURE_NOT_LOW))) {
+      theControlEvents.post(CONTROL_PRESSURE_NOT_LOW);
     }
     if ((state == BUTTON_ON_PRESSED) && (machinestate > SWITCHEDOFF)) {
-      autoPowerOff = millis() + AUTOTIMEOUT;
-      isManualTimeOutExtended = true;
+      autoPowerOff = uptimeMs() + AUTOTIMEOUT;
+      theControlEvents.post(CONTROL_TIMEOUT_EXTENDED);
     }
     verifyButtonOnIsStillPressed = false;
 
@@ -493,7 +735,7 @@ void buttonOnChanged(int state) {
         showInfoAndCalibration = false;
       } else {
         checkCalibButtonsPressed = true;
-        checkCalibTimeOut = millis() + CALIB_WINDOW_TIME;
+        theTimerWheel.start(&checkCalibTimer, CALIB_WINDOW_TIME, 0, checkCalibButtons, NULL);
       }
     } else {
       if (!(state == BUTTON_ON_PRESSED)) {
@@ -503,19 +745,28 @@ void buttonOnChanged(int state) {
   }
 }
 
+// in the interrupt of the Off button: the relay goes off now, buttonOffChanged() does the rest from loop()
+bool IRAM_ATTR switchOffFromInterrupt(int level) {
+  if ((level != BUTTON_OFF_PRESSED) || (buttonOn.state() == BUTTON_ON_PRESSED) || !compressorIsOn) {
+    return false;
+  }
+  digitalWrite(RELAY_GPIO, 0);
+  return true;
+}
+
+// in the esp_timer task, see SafetyInterlock.h: the faults compressorLoop() switches the compressor off for
+bool relayMustBeOff() {
+  thePressureSensor.update();
+  return theFaults.any(FAULTS_SWITCH_OFF);
+}
+
 void buttonOffChanged(int state) {
 //    Debug.printf("Button Off changed to %d\n", state);
-  if ((state == BUTTON_OFF_PRESSED) && (buttonOn.state() != BUTTON_ON_PRESSED) && ((machinestate >= POWERED) || ErrorPressureIsTooHigh)) {
-    digitalWrite(RELAY_GPIO, 0);
-    // digitalWrite(LED1, 0);
-    // digitalWrite(LED2, 0);
-    ledcWrite(PWM_LED_CHANNEL1, 0);
-    ledcWrite(PWM_LED_CHANNEL2, 0);
-    compressorIsOn = false;
-    machinestate = SWITCHEDOFF;
-    isManualSwitchedOff = true;
-    if (ErrorPressureIsTooHigh) {
-      showPressureIsOK = true;
+  if ((state == BUTTON_OFF_PRESSED) && (buttonOn.state() != BUTTON_ON_PRESSED) && ((machinestate >= POWERED) || compressorIsOn || theFaults.isSet(FAULT_PRESSURE_ERROR))) {
+    machineEvent(MACHINE_SWITCH_OFF);
+    theControlEvents.post(CONTROL_BUTTON_OFF);
+    if (theFaults.isSet(FAULT_PRESSURE_ERROR)) {
+      theControlEvents.post(CONTROL_PRESSURE_OK);
     }
   } else {
     if ((state == BUTTON_OFF_PRESSED) && (digitalRead(ON_BUTTON) == BUTTON_ON_PRESSED)) {
@@ -523,7 +774,7 @@ void buttonOffChanged(int state) {
         showInfoAndCalibration = false;
       } else {
         checkCalibButtonsPressed = true;
-        checkCalibTimeOut = millis() + CALIB_WINDOW_TIME;
+        theTimerWheel.start(&checkCalibTimer, CALIB_WINDOW_TIME, 0, checkCalibButtons, NULL);
       }
     } else {
       if (!(state == BUTTON_OFF_PRESSED)) {
@@ -533,6 +784,271 @@ void buttonOffChanged(int state) {
   }
 }
 
+// the values of the JSON report as numbers, in the units of ReportCbor.h; the loop profiler only for the heartbeat
+void collectReportValues(reportvalues_t *values) {
+  values->machinestate = machinestate;
+  values->poweredTime = powered_total + ((machinestate == POWERED) ? (millis() - powered_last) / 1000 : 0);
+  values->runningTime = running_total + ((machinestate == RUNNING) ? (millis() - running_last) / 1000 : 0);
+  values->pressure = lroundf(pressure * 100);
+  values->oilLevel = !oilLevelIsTooLow ? REPORT_OK : (ErrorOilLevelIsTooLow ? REPORT_ERROR : REPORT_WARNING);
+  values->opto1 = (opto1.state() == OPTO1_ON);
+#ifdef OTA_PASSWD
+  values->ota = true;
+#else
+  values->ota = false;
+#endif
+
+  values->nrOfTempSensors = theTempSensors.count();
+  for (uint8_t i = 0; i < theTempSensors.count(); i++) {
+    TemperatureSensor &tempSensor = theTempSensors.sensor(i);
+    reporttemperature_t &temp = values->temp[i];
+
+    temp.number = tempSensor.number();
+    temp.available = (tempSensor.temperature != -127) && !tempSensor.notReacting;
+    temp.temperature = temp.available ? lroundf(tempSensor.temperature * 100) : 0;
+    if (!temp.available) {
+      temp.level = REPORT_NOT_AVAILABLE;
+    } else {
+      temp.level = tempSensor.ErrorTempIsTooHigh ? REPORT_ERROR : (tempSensor.tempIsHigh ? REPORT_WARNING : REPORT_OK);
+    }
+    temp.crcErrors = tempSensor.crcErrors;
+  }
+}
+
+// the mask of the keys of a full report
+uint16_t fullReportKeys() {
+  return LOOP_PROFILER_REPORT ? CBOR_ALL_KEYS : CBOR_ALL_KEYS & ~CBOR_KEY_BIT(CBOR_KEY_LOOP);
+}
+
+// from loop() and from onReport() in the network task, theReportFilter is updated by loop()
+bool sendReportCbor(const reportvalues_t *values, uint16_t keyMask, uint8_t sensorMask) {
+  uint8_t buffer[REPORT_CBOR_MAX_SIZE];
+  CborWriter cbor(buffer, sizeof(buffer));
+
+  if (writeReport(cbor, values, keyMask, sensorMask)) {
+    theNetworkTask.send(REPORT_CBOR_TOPIC, buffer, cbor.length());
+    return true;
+  }
+  Log.println("CBOR report does not fit in REPORT_CBOR_MAX_SIZE, not sent");
+  return false;
+}
+
+// p50/p99/max of each stage of loop() since the previous full report
+void collectLoopValues(reportvalues_t *values) {
+  for (int i = 0; i < NR_OF_LOOP_STAGES; i++) {
+    LoopHistogram &stage = theLoopProfiler.stage[i];
+
+    values->loop[i][0] = stage.percentile(50);
+    values->loop[i][1] = stage.percentile(99);
+    values->loop[i][2] = stage.maximum();
+  }
+}
+
+void publishReportSnapshot() {
+  reportsnapshot_t &snapshot = publishedReports[(nrOfReportSnapshots + 1) % 2];
+
+  snapshot.number = ++nrOfReportSnapshots;
+  collectReportValues(&snapshot.values);
+  collectLoopValues(&snapshot.values);
+  for (int i = 0; i < NR_OF_LOOP_STAGES; i++) {
+    theLoopProfiler.summary((loopstage_t)i, snapshot.loopSummary[i], sizeof(snapshot.loopSummary[i]));
+  }
+  snapshot.pressure = pressure;
+  for (uint8_t i = 0; i < theTempSensors.count(); i++) {
+    snapshot.temperature[i] = theTempSensors.sensor(i).temperature;
+  }
+  snapshot.opto1 = opto1.state();
+  theInputCapture.latency.summary(snapshot.inputLatency, sizeof(snapshot.inputLatency));
+  theInputCapture.actionLatency.summary(snapshot.relayLatency, sizeof(snapshot.relayLatency));
+  snapshot.logDroppedLines = theLogRing.counters.dropped;
+  snapshot.safetyTrips = theSafetyInterlock.counters.trips;
+  snapshot.safetyTripLatency = theSafetyInterlock.counters.worstTripLatency;
+  snapshot.safetyCheckInterval = theSafetyInterlock.counters.worstCheckInterval;
+  memcpy(snapshot.loopShed, theLoopProfiler.shed, sizeof(snapshot.loopShed));
+  snapshot.controlEvents = theControlEvents.counters;
+  theFaults.describe(FAULTS_DISABLE, snapshot.disabledBy, sizeof(snapshot.disabledBy));
+  for (int i = 0; i < NR_OF_FAULTS; i++) {
+    snapshot.faultSets[i] = theFaults.statisticsOf((fault_t)i).sets;
+  }
+  reportSnapshot.publish(snapshot);
+}
+
+// after a full report the loop profiler and the latencies start again
+void restartProfiler() {
+  if (LOOP_PROFILER_REPORT) {
+    theLoopProfiler.reset();
+    theInputCapture.latency.reset();
+    theInputCapture.actionLatency.reset();
+  }
+}
+
+// onReport() sent the report of the snapshot with this number (0: no CBOR report), the profiler starts again
+void reported(uint32_t number) {
+  const reportsnapshot_t &snapshot = publishedReports[number % 2];
+
+  if ((number != 0) && (snapshot.number == number)) {
+    theReportFilter.reported(&snapshot.values, fullReportKeys(), (1 << snapshot.values.nrOfTempSensors) - 1);
+    lastFullReport = millis();
+  }
+  restartProfiler();
+}
+
+// sends what changed since the last report; the report of ACNode (JSON and
+// CBOR) stays on REPORT_HEARTBEAT_IDLE, while powered a CBOR only heartbeat
+// with all keys goes out every REPORT_HEARTBEAT_ACTIVE in between
+void reportChanges() {
+  reportvalues_t values;
+  uint16_t keyMask;
+  uint8_t sensorMask;
+  bool active = (machinestate >= POWERED);
+
+  theNetworkTask.setReportPeriod(REPORT_HEARTBEAT_IDLE);
+  collectReportValues(&values);
+  if (active && (millis() - lastFullReport >= REPORT_HEARTBEAT_ACTIVE)) {
+    sensorMask = (1 << values.nrOfTempSensors) - 1;
+    collectLoopValues(&values);
+    if (sendReportCbor(&values, fullReportKeys(), sensorMask)) {
+      theReportFilter.reported(&values, fullReportKeys(), sensorMask);
+      lastFullReport = millis();
+      restartProfiler();
+    }
+    return;
+  }
+  keyMask = theReportFilter.changes(&values, active ? REPORT_DEADBAND_INTERVAL_ACTIVE : REPORT_DEADBAND_INTERVAL_IDLE, &sensorMask);
+  if ((keyMask != 0) && sendReportCbor(&values, keyMask, sensorMask)) {
+    theReportFilter.reported(&values, keyMask, sensorMask);
+  }
+}
+
+// a command of the master, claimed by onValidatedCmd() in the network task
+void controlCommand(const char *cmd, const char *rest) {
+  if (!strcasecmp(cmd, "stop")) {
+    machineEvent(MACHINE_SWITCH_OFF);
+    theControlEvents.post(CONTROL_AUTO_STOP);
+    theFaults.set(FAULT_PRESSURE_ERROR, false);
+    return;
+  };
+
+  if (!strcasecmp(cmd, "poweron")) {
+    if (!compressorIsDisabeled()) {
+      if (machineEvent(MACHINE_SWITCH_ON)) {
+        theControlEvents.post(CONTROL_AUTO_POWER_ON);
+      };
+      autoPowerOff = uptimeMs() + AUTOTIMEOUT;
+    } else {
+      theControlEvents.post(CONTROL_AUTO_POWER_ON_DENIED);
+    }
+    return;
+  };
+
+  // calibrate <pressure in bar>: the current pressure sensor value is used as calibration point
+  if (!strcasecmp(cmd, "calibrate")) {
+    if (!showInfoAndCalibration) {
+      Log.println("Pressure calibration denied: info / calibration mode is not active");
+    } else if ((rest == NULL) || (*rest == 0)) {
+      Log.println("Pressure calibration: usage calibrate <reference pressure in bar>");
+    } else if (!thePressureSensor.calibrate(atof(rest))) {
+      Log.println("Pressure calibration failed");
+    }
+    return;
+  };
+
+  // hours [<day> <from> <to>]: the compressor may be switched on from hour from to hour to on day (0 = Sunday, all: every day),
+  // from == to: not at all on that day
+  if (!strcasecmp(cmd, "hours")) {
+    char day[8];
+    char *dayEnd;
+    long dayNumber = -1;
+    unsigned int from, to;
+    bool valid = false;
+
+    if ((rest == NULL) || (*rest == 0)) {
+      theOperatingHours.dump();
+      return;
+    }
+    if (sscanf(rest, "%7s %u %u", day, &from, &to) == 3) {
+      if (!strcasecmp(day, "all")) {
+        valid = true;
+      } else {
+        // a day that is not a number is not Sunday
+        dayNumber = strtol(day, &dayEnd, 10);
+        valid = (dayEnd != day) && (*dayEnd == 0) && (dayNumber >= 0) && (dayNumber <= 6);
+      }
+    }
+    if (!valid || !theOperatingHours.setHours(dayNumber, from, to)) {
+      Log.println("Operating hours: usage hours <day 0-6 | all> <from hour> <to hour>");
+    }
+    return;
+  };
+
+  // override <from> <to> allow|deny, override clear: switching on is allowed or denied from from to to (in s since 1970)
+  if (!strcasecmp(cmd, "override")) {
+    char allow[8];
+    unsigned long from, to;
+
+    if ((rest != NULL) && !strcasecmp(rest, "clear")) {
+      theOperatingHours.clearOverrides();
+    } else if ((rest == NULL) || (sscanf(rest, "%lu %lu %7s", &from, &to, allow) != 3) ||
+               !theOperatingHours.addOverride(from, to, !strcasecmp(allow, "allow"))) {
+      Log.println("Operating hours: usage override <from> <to> allow|deny, or override clear");
+    }
+    return;
+  };
+
+  // samples [<n>]: log the last n raw ADC samples of the pressure sensor, all PRESSURE_RING_SIZE without n
+  if (!strcasecmp(cmd, "samples")) {
+    thePressureSensor.logRawSamples(((rest != NULL) && (*rest != 0)) ? atoi(rest) : PRESSURE_RING_SIZE);
+    return;
+  };
+
+  // history [<from> <to>]: stream the history (in s since boot) on topic history, a single value means the last <from> s
+  if (!strcasecmp(cmd, "history")) {
+    // the samples are stamped with uptimeMs(), millis() wraps after 49 days
+    uint64_t now = uptimeMs() / 1000;
+    unsigned long from = 0;
+    unsigned long to = now;
+
+    if ((rest != NULL) && (sscanf(rest, "%lu %lu", &from, &to) == 1)) {
+      from = (from < now) ? now - from : 0;
+      to = now;
+    }
+    if (!theHistory.requestWindow(from, to)) {
+      Log.println("History: no samples available in the requested window");
+    }
+    return;
+  };
+}
+
+// the events of the network task: the connection, the commands and the reports sent
+void handleNetworkEvents() {
+  networkevent_t event;
+
+  while (theNetworkTask.nextEvent(&event)) {
+    switch (event.type) {
+      case NETWORK_CONNECTED:
+        machineEvent(MACHINE_CONNECTED);
+        break;
+
+      case NETWORK_DISCONNECTED:
+        machineEvent(MACHINE_DISCONNECTED);
+        break;
+
+      case NETWORK_ERROR:
+        Log.print("Error ");
+        Log.println(event.error);
+        machineEvent(MACHINE_ERROR);
+        break;
+
+      case NETWORK_COMMAND:
+        controlCommand(event.command, event.command + strlen(event.command) + 1);
+        break;
+
+      case NETWORK_REPORTED:
+        reported(event.report);
+        break;
+    }
+  }
+}
 
 void setup() {
   Serial.begin(115200);
@@ -562,14 +1078,15 @@ void setup() {
   ledcAttachPin(LED1, PWM_LED_CHANNEL1);
   ledcAttachPin(LED2, PWM_LED_CHANNEL2);
 
-  theOledDisplay.begin(TEMP_IS_HIGH_LEVEL_1, TEMP_IS_TOO_HIGH_LEVEL_1, TEMP_IS_HIGH_LEVEL_2, TEMP_IS_TOO_HIGH_LEVEL_2);
+  theOledDisplay.begin();
 
   Serial.printf("Boot state: ButtonOn:%d ButtonOff:%d\n", digitalRead(ON_BUTTON), digitalRead(OFF_BUTTON));
 
   checkClearEEPromAndCacheButtonPressed();
 
   loadDurationCounters();
-  DurationCounterSave = millis() / 1000 + SAVE_DURATION_COUNTERS_WINDOW;
+  theTimerWheel.start(&durationCounterTimer, SAVE_DURATION_COUNTERS_WINDOW * 1000, SAVE_DURATION_COUNTERS_WINDOW * 1000,
+                      saveDurationCountersPeriodically, NULL);
 
   node.set_mqtt_prefix("ac");
   node.set_master("master");
@@ -587,6 +1104,7 @@ void setup() {
   buttonOn.setCallback(buttonOnChanged);
 
   buttonOff.setCallback(buttonOffChanged);
+  buttonOff.setAction(switchOffFromInterrupt);
 
   buttonInfoCalibration.setCallback([](int state) {
     showInfoAndCalibration = !showInfoAndCalibration;
@@ -595,126 +1113,180 @@ void setup() {
 
   theOilLevelSensor.begin();
 
+  theInputCapture.begin();
+
+  thePressureSensor.begin();
+
+  theSafetyInterlock.begin(RELAY_GPIO, relayMustBeOff);
+
+  theHistory.begin();
+
+  // the callbacks of the node run in the network task, loop() handles their events, see handleNetworkEvents()
   node.onConnect([]() {
-    machinestate = SWITCHEDOFF;
+    theNetworkTask.postEvent(NETWORK_CONNECTED);
   });
   node.onDisconnect([]() {
-    machinestate = NOCONN;
+    theNetworkTask.postEvent(NETWORK_DISCONNECTED);
   });
   node.onError([](acnode_error_t err) {
-    Log.print("Error ");
-    Log.println(err);
-    machinestate = TRANSIENTERROR;
+    theNetworkTask.postError(err);
   });
 
   node.onValidatedCmd([](const char *cmd, const char * rest) -> ACBase::cmd_result_t  {
-    if (!strcasecmp(cmd, "stop")) {
-      machinestate = SWITCHEDOFF;
-      digitalWrite(RELAY_GPIO, 0);
-      // digitalWrite(LED1, 0);
-      // digitalWrite(LED2, 0);
-      ledcWrite(PWM_LED_CHANNEL1, 0);
-      ledcWrite(PWM_LED_CHANNEL2, 0);
-      compressorIsOn = false;
-      automaticStopReceived = true;
-      ErrorPressureIsTooHigh = false;
-      return ACNode::CMD_CLAIMED;
-    };
-
-    if (!strcasecmp(cmd, "poweron")) {
-      if (!compressorIsDisabeled()) {
-        if (machinestate < POWERED) {
-          digitalWrite(RELAY_GPIO, 1);
-          // digitalWrite(LED1, 1);
-          // digitalWrite(LED2, 0);
-          ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);
-          ledcWrite(PWM_LED_CHANNEL2, 0);
-          compressorIsOn = true;
-          machinestate = POWERED;
-          automaticPowerOnReceived = true;
-        };
-        autoPowerOff = millis() + AUTOTIMEOUT;
-      } else {
-        automaticPowerOnDenied = true;
-      }
+    if (!strcasecmp(cmd, "stop") || !strcasecmp(cmd, "poweron") || !strcasecmp(cmd, "calibrate") || !strcasecmp(cmd, "history") ||
+        !strcasecmp(cmd, "hours") || !strcasecmp(cmd, "override") || !strcasecmp(cmd, "samples")) {
+      theNetworkTask.postCommand(cmd, rest);
       return ACBase::CMD_CLAIMED;
     };
     return ACBase::CMD_DECLINE;
   });
 
   node.onReport([](JsonObject  & report) {
-    report["state"] = state[machinestate].label;
+    reportsnapshot_t snapshot;
+    const reportvalues_t &values = snapshot.values;
+    uint32_t sent = 0;
 
-    powered = ((float)powered_total + ((machinestate == POWERED) ? (float)((millis() - powered_last) / 1000) : 0)) / 3600;
-    running = ((float)running_total + ((machinestate == RUNNING) ? (float)((millis() - running_last) / 1000) : 0)) / 3600;
+    // without the network task this runs in loop(), with the values of now
+    if (!theNetworkTask.taskRunning()) {
+      publishReportSnapshot();
+    }
+    if (!reportSnapshot.read(&snapshot)) {
+      return;
+    }
+    report["state"] = state[values.machinestate].label;
 
-    sprintf(reportStr, "%f hours", powered);
+    if (REPORT_CBOR_ENABLED && sendReportCbor(&values, fullReportKeys(), (1 << values.nrOfTempSensors) - 1)) {
+      sent = snapshot.number;
+    }
+    theNetworkTask.postReport(sent);
+    if (!REPORT_LEGACY_JSON) {
+      return;
+    }
+
+    formatFixed(reportStr, "", (float)values.poweredTime / 3600, 0, 6, " hours");
     report["powered_time"] = reportStr;
-    sprintf(reportStr, "%f hours", running);
+    formatFixed(reportStr, "", (float)values.runningTime / 3600, 0, 6, " hours");
     report["running_time"] = reportStr;
 
-    if (theTempSensor1.temperature == -127) {
-      sprintf(reportStr, "Error reading temperature sensor 1 (%s), perhaps not connected?", TEMP_SENSOR_LABEL1);
-    } else {
-      if (theTempSensor1.ErrorTempIsTooHigh) {
-        sprintf(reportStr, "ERROR: Temperature sensor 1 (%s) is too high, compressor is disabled!", TEMP_SENSOR_LABEL1);
-        report[TEMP_REPORT_ERROR1] = reportStr;
-      } else {
-        if (theTempSensor1.tempIsHigh) {
-          sprintf(reportStr, "WARNING: Temperature sensor 1 (%s) is very high!", TEMP_SENSOR_LABEL1);
-          report[TEMP_REPORT_WARNING1] = reportStr;
-        }
-      }
-      sprintf(reportStr, "%f degrees Celcius", theTempSensor1.temperature);
-    }
-    report[TEMP_REPORT1] = reportStr;
+    for (uint8_t i = 0; i < values.nrOfTempSensors; i++) {
+      const reporttemperature_t &temp = values.temp[i];
+      TemperatureSensor &tempSensor = theTempSensors.sensor(i); // only its label and report key
+      char keyStr[64];
 
-    if (theTempSensor2.temperature == -127) {
-      sprintf(reportStr, "Error reading temperature sensor 2 (%s), perhaps not connected?", TEMP_SENSOR_LABEL2);
-    } else {
-      if (theTempSensor2.ErrorTempIsTooHigh) {
-        sprintf(reportStr, "ERROR: Temperature sensor 2 (%s) is too high, compressor is disabled!", TEMP_SENSOR_LABEL2);
-        report[TEMP_REPORT_ERROR1] = reportStr;
+      if (!temp.available) {
+        sprintf(reportStr, "Error reading temperature sensor %d (%s), perhaps not connected?", temp.number, tempSensor.label());
       } else {
-        if (theTempSensor2.tempIsHigh) {
-          sprintf(reportStr, "WARNING: Temperature sensor 2 (%s) is very high!", TEMP_SENSOR_LABEL2);
-          report[TEMP_REPORT_WARNING2] = reportStr;
+        if (temp.level == REPORT_ERROR) {
+          sprintf(keyStr, "%s_error", tempSensor.reportKey());
+          sprintf(reportStr, "ERROR: Temperature sensor %d (%s) is too high, compressor is disabled!", temp.number, tempSensor.label());
+          report[keyStr] = reportStr;
+        } else {
+          if (temp.level == REPORT_WARNING) {
+            sprintf(keyStr, "%s_warning", tempSensor.reportKey());
+            sprintf(reportStr, "WARNING: Temperature sensor %d (%s) is very high!", temp.number, tempSensor.label());
+            report[keyStr] = reportStr;
+          }
         }
+        formatFixed(reportStr, "", snapshot.temperature[i], 0, 6, " degrees Celcius");
+      }
+      report[tempSensor.reportKey()] = reportStr;
+      // a bad connection, not a missing sensor
+      if (temp.crcErrors > 0) {
+        sprintf(keyStr, "%s_crc_errors", tempSensor.reportKey());
+        report[keyStr] = temp.crcErrors;
       }
-      sprintf(reportStr, "%f degrees Celcius", theTempSensor2.temperature);
     }
-    report[TEMP_REPORT2] = reportStr;
 
 
-    if (!oilLevelIsTooLow)
+    if (values.oilLevel == REPORT_OK)
     {
       report["oil_level_sensor"] = "oil level is OK!";
     } else {
-      if (ErrorOilLevelIsTooLow) {
+      if (values.oilLevel == REPORT_ERROR) {
         report["oil_level_sensor_error"] = "ERROR: Oil level is too low, compressor is disabled";
       } else {
         report["oil_level_sensor_warning"] = "WARNING: Oil level is too low!";
       }
     }
-    sprintf(reportStr, "%5.2f bar", pressure);
+    formatFixed(reportStr, "", snapshot.pressure, 5, 2, " bar");
     report["pressure_sensor"] = reportStr;
-#ifdef OTA_PASSWD
-    report["ota"] = true;
-#else
-    report["ota"] = false;
-#endif
-    report["opto1"] = opto1.state();
+    report["ota"] = values.ota;
+    report["opto1"] = snapshot.opto1;
+    if (snapshot.logDroppedLines > 0) {
+      report["log_dropped_lines"] = snapshot.logDroppedLines;
+    }
+    if (snapshot.safetyTrips > 0) {
+      report["safety_trips"] = snapshot.safetyTrips;
+    }
+    if (snapshot.controlEvents.lost > 0) {
+      report["control_events_lost"] = snapshot.controlEvents.lost;
+    }
+    // why the compressor cannot be switched on now, and how often each of these faults occurred since boot
+    if (snapshot.disabledBy[0] != 0) {
+      report["disabled_by"] = snapshot.disabledBy;
+    }
+    for (int i = 0; i < NR_OF_FAULTS; i++) {
+      if ((FAULTS_DISABLE & FAULT_BIT(i)) && (snapshot.faultSets[i] > 0)) {
+        char keyStr[48];
+
+        sprintf(keyStr, "fault_%s", theFaults.label((fault_t)i));
+        report[keyStr] = snapshot.faultSets[i];
+      }
+    }
+    // the low priority work skipped since boot in passes of loop() that ran over their budget
+    for (int i = 0; i < NR_OF_LOOP_WORK; i++) {
+      if (snapshot.loopShed[i] > 0) {
+        char keyStr[32];
+
+        sprintf(keyStr, "shed_%s", theLoopProfiler.label((loopwork_t)i));
+        report[keyStr] = snapshot.loopShed[i];
+      }
+    }
+
+    if (LOOP_PROFILER_REPORT) {
+      // p50/p99/max in us of each stage of loop() since the previous report
+      char keyStr[32];
+      for (int i = 0; i < NR_OF_LOOP_STAGES; i++) {
+        sprintf(keyStr, "loop_%s_us", theLoopProfiler.label((loopstage_t)i));
+        report[keyStr] = snapshot.loopSummary[i];
+      }
+      // from an edge of an input to its callback and to the relay switched off by the interrupt of the Off button
+      report["input_latency_us"] = snapshot.inputLatency;
+      report["relay_latency_us"] = snapshot.relayLatency;
+      // since boot: the worst time from a fault to the relay off by the safety interlock and between its checks
+      report["safety_trip_us"] = snapshot.safetyTripLatency;
+      report["safety_check_us"] = snapshot.safetyCheckInterval;
+      // since boot: the most events of the callbacks waiting for loop() and the longest wait
+      report["control_events_depth"] = snapshot.controlEvents.maxDepth;
+      report["control_events_us"] = snapshot.controlEvents.worstLatency;
+    }
   });
 
-  Log.addPrintStream(std::make_shared<MqttLogStream>(mqttlogStream));
+  // the labels of the events rendered as text, see LogEvent.h
+  setLogEventLabels([](uint8_t value) -> const char * { return (value <= RUNNING) ? state[value].label : NULL; },
+                    [](uint8_t value) -> const char * {
+                      for (uint8_t i = 0; i < theTempSensors.count(); i++) {
+                        if (theTempSensors.sensor(i).number() == value) {
+                          return theTempSensors.sensor(i).label();
+                        }
+                      }
+                      return NULL;
+                    });
 
   auto t = std::make_shared<TelnetSerialStream>(telnetSerialStream);
-  Log.addPrintStream(t);
+  if (LOGGING_ASYNC) {
+    // the MQTT batches of the flush task are published by theNetworkTask
+    theLogRing.addPrintStream(t);
+    theLogRing.begin(true);
+    Log.addPrintStream(std::shared_ptr<LogRing>(&theLogRing, [](LogRing *) {}));
+  } else {
+    Log.addPrintStream(std::make_shared<MqttLogStream>(mqttlogStream));
+    Log.addPrintStream(t);
+  }
   Debug.addPrintStream(t);
 
-  // init temperature sensors and start reading first values
-  theTempSensor1.begin();
-  theTempSensor2.begin();
+  // find the temperature sensors and start reading first values
+  theTempSensors.begin(tempSensorConfig, sizeof(tempSensorConfig) / sizeof(tempSensorConfig[0]));
 
 #ifdef OTA_PASSWD
   node.addHandler(&ota);
@@ -726,202 +1298,158 @@ void setup() {
 
   // Olimex ESP32-PoE board is used
   node.begin(BOARD_OLIMEX);
+  // the network task publishes the log batches, it needs the log ring; its first report has the values of the boot
+  publishReportSnapshot();
+  theNetworkTask.begin(NETWORK_TASK && LOGGING_ASYNC);
   
   theOledDisplay.clearDisplay();
+  theOledDisplay.startTask();
 
   ntp.ruleDST("CEST", Last, Sun, Mar, 2, 120); // last sunday in march 2:00, timezone +120min (+1 GMT + 1h summertime offset)
   ntp.ruleSTD("CET", Last, Sun, Oct, 3, 60); // last sunday in october 3:00, timezone +60min (+1 GMT)
   ntp.begin();
   ntp.update();
+  theTimerWheel.start(&ntpTimer, NTP_UPDATE_WINDOW, NTP_UPDATE_WINDOW, [](void *context) {
+    // the operating hours may have been cached from the clock before the sync
+    if (ntp.update()) {
+      theOperatingHours.invalidate();
+    }
+  }, NULL);
+  theOperatingHours.begin(DISABLE_COMPRESSOR_AT_LATE_HOURS ? OperatingHours::window(DISABLED_TIME_END, DISABLED_TIME_START)
+                                                           : OPERATING_HOURS_ALL_DAY);
+
+  theTimerWheel.start(&historyTimer, HISTORY_SAMPLE_WINDOW, HISTORY_SAMPLE_WINDOW, sampleHistory, NULL);
+  if (LOGGING_ENABLED) {
+    theTimerWheel.start(&loggingTimer, 0, LOGGING_TIME_WINDOW, logStatus, NULL);
+  }
+  if (theNetworkTask.taskRunning()) {
+    theTimerWheel.start(&reportSnapshotTimer, 0, REPORT_SNAPSHOT_WINDOW, [](void *context) { publishReportSnapshot(); }, NULL);
+  }
+  // the time-out of the first state counts from the end of setup()
+  laststatechange = uptimeMs();
 }
 
-void buttons_optocoupler_loop() {
+// what the buttons, the commands and the timers of this pass posted, see ControlEvents.h
+void handleControlEvents() {
+  controlevent_t event;
 
-  opto1.loop();
+  while (theControlEvents.next(&event)) {
+    switch (event.type) {
+      case CONTROL_BUTTON_ON:
+        logEvent(EVENT_BUTTON_ON);
+        theOledDisplay.showStatus(MANUALSWITCHON);
+        break;
 
-  if (opto1.state() == OptoDebounce::ON) {
-    if (machinestate == POWERED) {
-      // digitalWrite(LED2, 1);
-      ledcWrite(PWM_LED_CHANNEL2, LED2_DIM_VALUE);
-      machinestate = RUNNING;
-    } 
-  } else {
-    if (machinestate == RUNNING) {
-      // digitalWrite(LED2, 0);
-      ledcWrite(PWM_LED_CHANNEL2, 0);
-      machinestate = POWERED;        
-    }
-  }
+      case CONTROL_BUTTON_ON_DENIED:
+        logEvent(EVENT_BUTTON_ON_DENIED);
+        theOledDisplay.showStatus(POWERONDISABLED);
+        break;
 
-  if (isManualSwitchedOn) {
-    isManualSwitchedOn = false;
-    Log.println("Compressor switched on with button");
-    theOledDisplay.showStatus(MANUALSWITCHON);
-  }
+      case CONTROL_BUTTON_OFF:
+        logEvent(EVENT_BUTTON_OFF);
+        theOledDisplay.showStatus(MANUALSWITCHOFF);
+        break;
 
-  if (isManualSwitchedOnVerifyOverride) {
-    isManualSwitchedOnVerifyOverride = false;
-    Log.println("Power on denied!");
-    Log.println("Power on is disabled during evening/night window");
-    theOledDisplay.showStatus(POWERONDISABLED);
-  }
+      case CONTROL_TIMEOUT_EXTENDED:
+        logEvent(EVENT_BUTTON_TIMEOUT_EXTENDED);
+        theOledDisplay.showStatus(TIMEOUTEXTENDED);
+        break;
 
-  if (isManualSwitchedOff) {
-    isManualSwitchedOff = false;
-    Log.println("Compressor switched off with button");
-    theOledDisplay.showStatus(MANUALSWITCHOFF);
-  }
+      case CONTROL_PRESSURE_NOT_LOW:
+        theOledDisplay.showStatus(ERRORPRESSUREISTOOHIGH);
+        theFaults.set(FAULT_PRESSURE_ERROR, true);
+        break;
 
-  if (isManualTimeOutExtended) {
-    isManualTimeOutExtended = false;
-    Log.println("Compressor timeout extended with button");
-    theOledDisplay.showStatus(TIMEOUTEXTENDED);
-  }
+      case CONTROL_PRESSURE_OK:
+        theFaults.set(FAULT_PRESSURE_ERROR, false);
+        theOledDisplay.showStatus(NOSTATUS);
+        break;
 
-  if (verifyButtonOnIsStillPressed) {
-    if (millis() > verifyButtonOnPressedTime) {
-      if (buttonOn.state() == BUTTON_ON_PRESSED) {
-        verifyButtonOnIsStillPressed = false;
-        digitalWrite(RELAY_GPIO, 1);
-        // digitalWrite(LED1, 1);
-        // digitalWrite(LED2, 0);
-        ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);
-        ledcWrite(PWM_LED_CHANNEL2, 0);
-        compressorIsOn = true;
-        machinestate = POWERED;
-        autoPowerOff = millis() + AUTOTIMEOUT; 
-        theOledDisplay.showStatus(MANUALOVERRIDE);
-        Log.println("Warning: compressor was switched on using manual override!");
-      }
-    } 
-  }
+      case CONTROL_AUTO_STOP:
+        logEvent(EVENT_AUTO_STOP);
+        theOledDisplay.showStatus(AUTOSWITCHOFF);
+        break;
 
-  if (showLedDisable) {
-    if (millis() < ledDisableTime) {
-      if (millis() >= nextLedDisableTime) {
-        nextLedDisableTime = /* millis() */ nextLedDisableTime + LED_DISABLE_PERIOD;
-        if (disableLedIsOn) {
-          // digitalWrite(LED1, 0);
-          ledcWrite(PWM_LED_CHANNEL1, 0);
-        } else {
-          // digitalWrite(LED1, 1);
-          ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);
-        }
-        disableLedIsOn = !disableLedIsOn;
-      }
-    } else {
-      showLedDisable = false;
-      disableLedIsOn = false;
-      // digitalWrite(LED1, 0);
-      ledcWrite(PWM_LED_CHANNEL1, 0);
+      case CONTROL_AUTO_POWER_ON:
+        logEvent(EVENT_AUTO_POWER_ON);
+        theOledDisplay.showStatus(AUTOSWITCHON);
+        break;
+
+      case CONTROL_AUTO_POWER_ON_DENIED:
+        logEvent(EVENT_AUTO_POWER_ON_DENIED);
+        theOledDisplay.showStatus(AUTOONDENIED);
+        break;
+
+      case NR_OF_CONTROL_EVENTS:
+        break;
     }
   }
+}
+
+void buttons_optocoupler_loop() {
+
+  theInputCapture.loop();
+
+  machineEvent((opto1.state() == OPTO1_ON) ? MACHINE_MOTOR_STARTED : MACHINE_MOTOR_STOPPED);
+
+  handleControlEvents();
 
   if (checkCalibButtonsPressed) {
-    if ((buttonOn.state() == BUTTON_ON_PRESSED) && (buttonOff.state() == BUTTON_OFF_PRESSED)) {
-      if (millis() > checkCalibTimeOut) {
-        showInfoAndCalibration = !showInfoAndCalibration;
-        saveDurationCounters();
-        checkCalibButtonsPressed = false;
-      }
-    } else {
+    if ((buttonOn.state() != BUTTON_ON_PRESSED) || (buttonOff.state() != BUTTON_OFF_PRESSED)) {
       checkCalibButtonsPressed = false;
+      theTimerWheel.stop(&checkCalibTimer);
     }
   }
 }
 
 void compressorLoop() {
- 
-  if (millis() >= nextNTPUpdateTime) {
-    ntp.update();
-    nextNTPUpdateTime = millis() + NTP_UPDATE_WINDOW;
-  }
-  
+  // the periodic and delayed work of all modules, only when it is due
+  theTimerWheel.run();
+
+  // only when its timer did not start: samples the pressure and switches the relay off
+  theSafetyInterlock.loop();
+
+  // the safety interlock switched the relay off, perhaps for a pressure that is below the maximum again
+  bool safetyTrip = theSafetyInterlock.takeTrip();
+  uint32_t faults = theFaults.faults();
+
   if (machinestate > SWITCHEDOFF) {
     // check if compressor must be switched off
-    if (ErrorOilLevelIsTooLow || theTempSensor1.ErrorTempIsTooHigh || theTempSensor2.ErrorTempIsTooHigh || thePressureSensor.tooHighPressure() || (millis() > autoPowerOff)) {
-      digitalWrite(RELAY_GPIO, 0);
-      // digitalWrite(LED1, 0);
-      // digitalWrite(LED2, 0);
-      ledcWrite(PWM_LED_CHANNEL1, 0);
-      ledcWrite(PWM_LED_CHANNEL2, 0);
-      compressorIsOn = false;
-      machinestate = SWITCHEDOFF;
-      if (ErrorOilLevelIsTooLow || theTempSensor1.ErrorTempIsTooHigh || theTempSensor2.ErrorTempIsTooHigh) {
-        Log.println("Compressor is disabled now due to error(s). Please check compressor!");
+    if ((faults & FAULTS_SWITCH_OFF) || safetyTrip || (uptimeMs() > autoPowerOff)) {
+      machineEvent(MACHINE_SWITCH_OFF);
+      if (faults & FAULTS_SENSORS) {
+        logEvent(EVENT_DISABLED_BY_ERRORS);
       }
-      if (thePressureSensor.tooHighPressure()) {
-        ErrorPressureIsTooHigh = true;
-        Log.print("Pressure is too high: ");
-        Log.print(pressure);
-        Log.println(" bar, compressor is switched off");
+      if ((faults & FAULT_BIT(FAULT_PRESSURE_TOO_HIGH)) || (safetyTrip && !(faults & FAULTS_SENSORS))) {
+        theFaults.set(FAULT_PRESSURE_ERROR, true);
+        logEvent(EVENT_PRESSURE_TOO_HIGH, centiValue(pressure));
         theOledDisplay.showStatus(ERRORPRESSUREISTOOHIGH);
       }
-      if (millis() > autoPowerOff) {
-        Log.println("Timeout: compressor automatically switched off");
+      if (uptimeMs() > autoPowerOff) {
+        logEvent(EVENT_TIMEOUT);
         theOledDisplay.showStatus(TIMEOUT);
       }
     }
   } else {
-    if (ErrorOilLevelIsTooLow || theTempSensor1.ErrorTempIsTooHigh || theTempSensor2.ErrorTempIsTooHigh || !thePressureSensor.lowPressure()) {
+    if (faults & (FAULTS_SENSORS | FAULT_BIT(FAULT_PRESSURE_NOT_LOW))) {
       ledIsBlinking = true;
-      if (millis() > blinkingLedNextTime) {
-        if (blinkingLedIsOn) {
-          // digitalWrite(LED1, 0);
-          // digitalWrite(LED2, 0);
-          ledcWrite(PWM_LED_CHANNEL1, 0);
-          ledcWrite(PWM_LED_CHANNEL2, 0);
-        } else {
-          // digitalWrite(LED1, 1);
-          // digitalWrite(LED2, 1);
-          ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);
-          ledcWrite(PWM_LED_CHANNEL2, LED2_DIM_VALUE);
-        }
-        blinkingLedIsOn = !blinkingLedIsOn;
-        blinkingLedNextTime = millis() + BLINKING_LED_PERIOD;
+      if (!theTimerWheel.isScheduled(&blinkingLedTimer)) {
+        theTimerWheel.start(&blinkingLedTimer, 0, BLINKING_LED_PERIOD, blinkLeds, NULL);
       }
     } else {
-      if (ErrorPressureIsTooHigh && thePressureSensor.lowPressure()) {
-        ErrorPressureIsTooHigh = false;
-        if (millis() < autoPowerOff) {
-          machinestate = POWERED;
+      theTimerWheel.stop(&blinkingLedTimer);
+      if (faults & FAULT_BIT(FAULT_PRESSURE_ERROR)) {
+        theFaults.set(FAULT_PRESSURE_ERROR, false);
+        if (uptimeMs() < autoPowerOff) {
+          machineEvent(MACHINE_SWITCH_ON);
           theOledDisplay.showStatus(NOSTATUS);
         }
       }
     }
   }
 
-  if (showErrorPressureIsTooHigh) {
-    theOledDisplay.showStatus(ERRORPRESSUREISTOOHIGH);
-    ErrorPressureIsTooHigh = true;
-    showErrorPressureIsTooHigh = false;
-  }
-
-  if (showPressureIsOK) {
-    ErrorPressureIsTooHigh = false;
-    theOledDisplay.showStatus(NOSTATUS);
-    showPressureIsOK = false;
-  }
-  
-  if (automaticStopReceived) {
-    Log.println("Automatic request received: Compressor stopped");
-    theOledDisplay.showStatus(AUTOSWITCHOFF);
-    automaticStopReceived = false;
-  }
-  if (automaticPowerOnReceived) {
-    Log.println("Automatic request received: Compressor powered on");
-    theOledDisplay.showStatus(AUTOSWITCHON);
-    automaticPowerOnReceived = false;
-  }  
-
-  if (automaticPowerOnDenied) {
-    Log.println("Automatic request denied to power on the compressor. Reason: late hours/night!");
-    theOledDisplay.showStatus(AUTOONDENIED);
-    automaticPowerOnDenied = false;
-  }  
-
   if (ledIsBlinking) {
-    if (!ErrorOilLevelIsTooLow && !theTempSensor1.ErrorTempIsTooHigh && !theTempSensor2.ErrorTempIsTooHigh && !ErrorPressureIsTooHigh) {
+    if (!theFaults.any(FAULTS_SENSORS | FAULT_BIT(FAULT_PRESSURE_ERROR))) {
       // digitalWrite(LED1, 0);
       // digitalWrite(LED2, 0);
       ledcWrite(PWM_LED_CHANNEL1, 0);
@@ -930,19 +1458,7 @@ void compressorLoop() {
     }
   }
 
-  // save duration counters in EEProm every SAVE_DURATION_COUNTERS_WINDOW number of seconds
-  if ((millis() / 1000) > DurationCounterSave) {
-    DurationCounterSave = millis() / 1000 + SAVE_DURATION_COUNTERS_WINDOW;
-
-    Log.print("powered_total = ");
-    Log.println(powered_total);
-    Log.print("running_total = ");
-    Log.println(running_total);
-
-    saveDurationCounters();
-  }
-
-  if (showInfoAndCalibration && thePressureSensor.newCalibrationInfoAvailable) {
+  if (showInfoAndCalibration && thePressureSensor.newCalibrationInfoAvailable && theLoopProfiler.mayRun(WORK_CALIBRATION_LOG)) {
     Log.println("Compressor Node Info");
     Log.print("Software version :");
     Log.println(SOFTWARE_VERSION);
@@ -950,167 +1466,62 @@ void compressorLoop() {
     Log.print("IP address: ");
     Log.println(theLocalIPAddress.toString());
     thePressureSensor.logInfoCalibration();
+    theHistory.logInfo();
     Log.println("");
   }
 
-  if (LOGGING_ENABLED && (millis() > nextLoggingTime)) {
-    nextLoggingTime = millis() + LOGGING_TIME_WINDOW;
-    
-    Log.println("");
-
-    // Log pressure
-    Log.print("Pressure = ");
-    Log.print(pressure);
-    Log.println(" bar");
-
-    // Log oil level
-    if (ErrorOilLevelIsTooLow) {
-      Log.println("ERROR: Oil level is too low; Compressor will be disabled; Please maintain the compressor by filling up the oil");
-    } else {
-      if (oilLevelIsTooLow) {
-        Log.println("Warning: Oil level is too low; Compressor will be disabled soon if this issue is not solved; Please verify the oil level and fill up if needed");
-      } else {
-        Log.println("Oil level is OK!");
-      }
-    }
-
-    // log temperature
-    if (theTempSensor1.temperature == -127) {
-      sprintf(reportStr, "Error reading temperature sensor 1 (%s), perhaps not connected?", TEMP_SENSOR_LABEL1);
-    } else {
-      if (theTempSensor1.ErrorTempIsTooHigh) {
-        sprintf(reportStr, "ERROR: Temperature sensor 1 (%s) is too high, compressor is disabled!", TEMP_SENSOR_LABEL1);
-        Log.println(reportStr);
-      } else {
-        if (theTempSensor1.tempIsHigh) {
-          sprintf(reportStr, "WARNING: Temperature sensor 1 (%s) is very high!", TEMP_SENSOR_LABEL1);
-          Log.println(reportStr);
-        }
-      }
-      sprintf(reportStr, "Temperature sensor 1 (%s) = %f degrees Celcius", TEMP_SENSOR_LABEL1, theTempSensor1.temperature);
-    }
-    Log.println(reportStr);
-
-    if (theTempSensor2.temperature == -127) {
-      sprintf(reportStr, "Error reading temperature sensor 2 (%s), perhaps not connected?", TEMP_SENSOR_LABEL2);
-    } else {
-      if (theTempSensor2.ErrorTempIsTooHigh) {
-        sprintf(reportStr, "ERROR: Temperature sensor 2 (%s) is too high, compressor is disabled!", TEMP_SENSOR_LABEL2);
-        Log.println(reportStr);
-      } else {
-        if (theTempSensor2.tempIsHigh) {
-          sprintf(reportStr, "WARNING: Temperature sensor 2 (%s) is very high!", TEMP_SENSOR_LABEL2);
-          Log.println(reportStr);
-        }
-      }
-      sprintf(reportStr, "Temperature sensor 2 (%s) = %f degrees Celcius", TEMP_SENSOR_LABEL2, theTempSensor2.temperature);
-    }  
-    Log.println(reportStr);
-
-    // Log machine state
-    switch (machinestate) {
-      case SWITCHEDOFF:
-          Log.println("Compressor is switched off");
-        break;
-      case POWERED:
-        if (!compressorIsOn) {
-          Log.println("Compressor is switched on, motor is off");
-        } else {
-          Log.println("Compressor is switched on, motor is off");
-        }
-        break;
-      case RUNNING:
-        Log.println("Compressor is switched on, motor is running");
-        break;
-      case REBOOT:
-      case WAITINGFORCARD:
-      case CHECKINGCARD:
-      case TRANSIENTERROR:
-      case OUTOFORDER:
-      case NOCONN:
-      case BOOTING:
-        break;
-    }
-  }
 }
 
 
-#ifdef TEST_TIMING
-void testLoopTiming(const char LoopPlace[]) {
-  long long timeDiff;
-  char tmpStr[50];
-
-  timeDiff = millis() - prevTime;
-  averageTime[placeCount] = averageTime[placeCount] + timeDiff;
-
-  if (waitcount >= 999) {
-    if ((averageTime[placeCount] > TEST_TIME_LIMIT) || (TEST_TIME_LIMIT <= 0)) {
-      sprintf(tmpStr, "%s: %lld ms", LoopPlace, averageTime[placeCount]);
-      Serial.println(tmpStr);
-    }
-    averageTime[placeCount] = 0;
-  }
-  placeCount++;
-  prevTime = millis();
-}
-#endif
-
 void loop() {
-#ifdef TEST_TIMING
-  prevTime = millis();
-  placeCount = 0;
-#endif
-
-  node.loop();
-#ifdef TEST_TIMING
-  testLoopTiming("na node.loop");
-#endif
-
-  theTempSensor1.loop();
-  theTempSensor2.loop();
-#ifdef TEST_TIMING
-  testLoopTiming("na theTempSensor1 en 2.loop");
-#endif
-
-  thePressureSensor.loop();
-#ifdef TEST_TIMING
-  testLoopTiming("na thePressureSensor.loop");
-#endif
-
-  if (!showLedDisable) {
-    theOledDisplay.loop(oilLevelIsTooLow, ErrorOilLevelIsTooLow, 
-                        theTempSensor1.temperature, theTempSensor1.tempIsHigh, theTempSensor1.ErrorTempIsTooHigh, 
-                        theTempSensor2.temperature, theTempSensor2.tempIsHigh, theTempSensor2.ErrorTempIsTooHigh, ErrorPressureIsTooHigh,
-                        pressure, machinestate, 
-                        powered_total, powered_last,
-                        running_total, running_last);
+  theLoopProfiler.begin();
+
+  theNetworkTask.loop();
+  handleNetworkEvents();
+  theLoopProfiler.mark(STAGE_NODE);
+
+  theTempSensors.loop();
+  theLoopProfiler.mark(STAGE_TEMPSENSORS);
+
+  if (!showLedDisable && theLoopProfiler.mayRun(WORK_DISPLAY)) {
+    // the display task renders the latest published values
+    displaysnapshot_t displaySnapshot;
+
+    displaySnapshot.oilLevelIsTooLow = oilLevelIsTooLow;
+    displaySnapshot.ErrorOilLevelIsTooLow = ErrorOilLevelIsTooLow;
+    displaySnapshot.nrOfTempSensors = theTempSensors.count();
+    for (uint8_t i = 0; i < theTempSensors.count(); i++) {
+      TemperatureSensor &tempSensor = theTempSensors.sensor(i);
+      displaySnapshot.temp[i] = { (uint8_t)tempSensor.number(), tempSensor.temperature, tempSensor.tempIsHighLevel(), tempSensor.tempIsTooHighLevel(),
+                                  tempSensor.tempIsHigh, tempSensor.ErrorTempIsTooHigh };
+    }
+    displaySnapshot.ErrorPressureIsTooHigh = theFaults.isSet(FAULT_PRESSURE_ERROR);
+    displaySnapshot.pressure = pressure;
+    displaySnapshot.machinestate = machinestate;
+    displaySnapshot.powered_total = powered_total;
+    displaySnapshot.powered_last = powered_last;
+    displaySnapshot.running_total = running_total;
+    displaySnapshot.running_last = running_last;
+    theOledDisplay.publish(&displaySnapshot);
   }
-#ifdef TEST_TIMING
-  testLoopTiming("na theOledDisplay.loop");
-#endif
+  theLoopProfiler.mark(STAGE_OLEDDISPLAY);
 
   compressorLoop();
-#ifdef TEST_TIMING
-  testLoopTiming("na compressorLoop");
-#endif
-
+  theLoopProfiler.mark(STAGE_COMPRESSOR);
 
   buttons_optocoupler_loop();
-#ifdef TEST_TIMING
-  testLoopTiming("na buttons_optocoupler.loop");
-#endif
-
+  theLoopProfiler.mark(STAGE_BUTTONS_OPTOCOUPLER);
 
   theOilLevelSensor.loop();
-#ifdef TEST_TIMING
-  testLoopTiming("na theOilLevelSensor.loop");
-#endif
+  theLoopProfiler.mark(STAGE_OILLEVELSENSOR);
+
+
+  if (REPORT_CBOR_ENABLED && REPORT_CHANGE_DRIVEN) {
+    reportChanges();
+  }
 
   if (laststate != machinestate) {
-    Log.print("Changed from state ");
-    Log.print(state[laststate].label);
-    Log.print(" to state ");
-    Log.println(state[machinestate].label);
+    logEvent(EVENT_STATE_CHANGED, laststate, machinestate);
 
     if (machinestate >= POWERED && laststate < POWERED) {
       powered_last = millis();
@@ -1125,74 +1536,27 @@ void loop() {
       running = (float)running_total / 3600.0;
     };
     laststate = machinestate;
-    laststatechange = millis();
+    laststatechange = uptimeMs();
   }
 
   if (state[machinestate].maxTimeInMilliSeconds != NEVER &&
-      (millis() - laststatechange > state[machinestate].maxTimeInMilliSeconds)) {
-    laststate = machinestate;
-    machinestate = state[machinestate].failStateOnTimeout;
-//    Debug.print("Time-out; transition from ");
-//    Debug.print(state[laststate].label);
-//    Debug.print(" to ");
+      (uptimeMs() - laststatechange > (uint64_t)state[machinestate].maxTimeInMilliSeconds)) {
+//    Debug.print("Time-out in ");
 //    Debug.println(state[machinestate].label);
-    return;
-  };
-  
-  switch (machinestate) {
-    case REBOOT:
-      saveDurationCounters();
-      node.delayedReboot();
-      break;
-
-    case SWITCHEDOFF:
-      // Compressor switched off completely.
-      if (compressorIsOn) {
-        digitalWrite(RELAY_GPIO, 0);
-        // digitalWrite(LED1, 0);
-        // digitalWrite(LED2, 0);
-        ledcWrite(PWM_LED_CHANNEL1, 0);
-        ledcWrite(PWM_LED_CHANNEL2, 0);
-        compressorIsOn = false;
-        Log.println("Compressor switched off");
-      }
-      break;
-
-    case POWERED:
-      // Compressor switched on, but motor is off
-      if (!compressorIsOn) {
-        digitalWrite(RELAY_GPIO, 1);
-        // digitalWrite(LED1, 1);
-        // digitalWrite(LED2, 0);
-        ledcWrite(PWM_LED_CHANNEL1, LED1_DIM_VALUE);
-        ledcWrite(PWM_LED_CHANNEL2, 0);
-        compressorIsOn = true;
-        Log.println("Compressor switched on, motor is off");
-      }
-      break;
-    case RUNNING:
-      // Compressor switched on and motor is running
-      break;
-
-    case WAITINGFORCARD:
-    case CHECKINGCARD:
-      // should not come here, so bail out
-      machinestate = REBOOT;
-      break;
-    case TRANSIENTERROR:
-    case OUTOFORDER:
-    case NOCONN:
-    case BOOTING:
-      break;
+    if (machineEvent(MACHINE_TIMEOUT)) {
+      // REBOOT enters itself again, its time-out counts from here
+      laststatechange = uptimeMs();
+    }
   };
+  theLoopProfiler.mark(STAGE_STATEMACHINE);
 
-#ifdef TEST_TIMING
-  testLoopTiming("na state machine (einde loop)");
+  if (LOOP_IDLE_SLEEP) {
+    uint64_t now = uptimeMs();
+    uint64_t deadline = theTimerWheel.nextDeadline();
 
-  waitcount++;
-  if (waitcount >= 1000) {
-    waitcount = 0;
+    if (deadline > now) {
+      delay((deadline - now < LOOP_MAX_IDLE_SLEEP) ? deadline - now : LOOP_MAX_IDLE_SLEEP);
+    }
   }
-#endif
 }
 